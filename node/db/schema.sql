@@ -29,7 +29,138 @@ CREATE INDEX IF NOT EXISTS idx_verified_at ON verified_alerts(verified_at);
 CREATE INDEX IF NOT EXISTS idx_event_type ON audit_log(event_type);
 CREATE INDEX IF NOT EXISTS idx_timestamp ON audit_log(timestamp);
 
+-- Row counts maintained by triggers so /metrics never scans the tables.
+-- Scopes: 'table' (totals), 'hazard_type', 'event_type'. INSERT OR REPLACE
+-- does not fire delete triggers, so the row it displaces is uncounted by a
+-- BEFORE INSERT trigger. Keep in sync with node/src/db/db.c.
+CREATE TABLE IF NOT EXISTS db_stats (
+    scope TEXT NOT NULL,
+    name TEXT NOT NULL,
+    count INTEGER NOT NULL DEFAULT 0,
+    PRIMARY KEY (scope, name)
+) WITHOUT ROWID;
+
+CREATE TRIGGER IF NOT EXISTS db_stats_alert_replace
+BEFORE INSERT ON verified_alerts
+WHEN EXISTS (SELECT 1 FROM verified_alerts WHERE alert_key = NEW.alert_key) BEGIN
+    UPDATE db_stats SET count = count - 1
+    WHERE (scope = 'table' AND name = 'verified_alerts')
+       OR (scope = 'hazard_type' AND name =
+           (SELECT hazard_type FROM verified_alerts WHERE alert_key = NEW.alert_key));
+END;
+
+CREATE TRIGGER IF NOT EXISTS db_stats_alert_insert
+AFTER INSERT ON verified_alerts BEGIN
+    INSERT INTO db_stats (scope, name, count) VALUES ('table', 'verified_alerts', 1)
+        ON CONFLICT (scope, name) DO UPDATE SET count = count + 1;
+    INSERT INTO db_stats (scope, name, count) VALUES ('hazard_type', NEW.hazard_type, 1)
+        ON CONFLICT (scope, name) DO UPDATE SET count = count + 1;
+END;
+
+CREATE TRIGGER IF NOT EXISTS db_stats_alert_update
+AFTER UPDATE OF hazard_type ON verified_alerts
+WHEN OLD.hazard_type IS NOT NEW.hazard_type BEGIN
+    UPDATE db_stats SET count = count - 1 WHERE scope = 'hazard_type' AND name = OLD.hazard_type;
+    INSERT INTO db_stats (scope, name, count) VALUES ('hazard_type', NEW.hazard_type, 1)
+        ON CONFLICT (scope, name) DO UPDATE SET count = count + 1;
+END;
+
+CREATE TRIGGER IF NOT EXISTS db_stats_alert_delete
+AFTER DELETE ON verified_alerts BEGIN
+    UPDATE db_stats SET count = count - 1
+    WHERE (scope = 'table' AND name = 'verified_alerts')
+       OR (scope = 'hazard_type' AND name = OLD.hazard_type);
+END;
+
+CREATE TRIGGER IF NOT EXISTS db_stats_event_insert
+AFTER INSERT ON audit_log BEGIN
+    INSERT INTO db_stats (scope, name, count) VALUES ('table', 'audit_log', 1)
+        ON CONFLICT (scope, name) DO UPDATE SET count = count + 1;
+    INSERT INTO db_stats (scope, name, count) VALUES ('event_type', NEW.event_type, 1)
+        ON CONFLICT (scope, name) DO UPDATE SET count = count + 1;
+END;
+
+CREATE TRIGGER IF NOT EXISTS db_stats_event_delete
+AFTER DELETE ON audit_log BEGIN
+    UPDATE db_stats SET count = count - 1
+    WHERE (scope = 'table' AND name = 'audit_log')
+       OR (scope = 'event_type' AND name = OLD.event_type);
+END;
+
+-- One-time backfill for databases created before db_stats existed
+INSERT OR REPLACE INTO db_stats (scope, name, count)
+    SELECT 'table', 'verified_alerts', n FROM (SELECT COUNT(*) AS n FROM verified_alerts)
+    WHERE NOT EXISTS (SELECT 1 FROM db_stats WHERE scope = 'meta');
+INSERT OR REPLACE INTO db_stats (scope, name, count)
+    SELECT 'table', 'audit_log', n FROM (SELECT COUNT(*) AS n FROM audit_log)
+    WHERE NOT EXISTS (SELECT 1 FROM db_stats WHERE scope = 'meta');
+INSERT OR REPLACE INTO db_stats (scope, name, count)
+    SELECT 'hazard_type', hazard_type, COUNT(*) FROM verified_alerts
+    WHERE NOT EXISTS (SELECT 1 FROM db_stats WHERE scope = 'meta') GROUP BY hazard_type;
+INSERT OR REPLACE INTO db_stats (scope, name, count)
+    SELECT 'event_type', event_type, COUNT(*) FROM audit_log
+    WHERE NOT EXISTS (SELECT 1 FROM db_stats WHERE scope = 'meta') GROUP BY event_type;
+INSERT OR IGNORE INTO db_stats (scope, name, count) VALUES ('meta', 'backfilled', 1);
+
+-- Per-minute (period 60) and per-hour (period 3600) counts for historical
+-- dashboards. They are not decremented when raw rows are deleted or moved to
+-- day archives, so they outlive the raw data. Keep in sync with
+-- node/src/db/db.c.
+CREATE TABLE IF NOT EXISTS db_rollups (
+    scope TEXT NOT NULL,                    -- 'hazard_type' or 'event_type'
+    period INTEGER NOT NULL,
+    bucket INTEGER NOT NULL,                -- Unix timestamp of the bucket start
+    name TEXT NOT NULL,
+    count INTEGER NOT NULL DEFAULT 0,
+    PRIMARY KEY (scope, period, bucket, name)
+) WITHOUT ROWID;
+
+CREATE TRIGGER IF NOT EXISTS db_rollup_alert_replace
+BEFORE INSERT ON verified_alerts
+WHEN EXISTS (SELECT 1 FROM verified_alerts WHERE alert_key = NEW.alert_key) BEGIN
+    UPDATE db_rollups SET count = count - 1
+    WHERE scope = 'hazard_type' AND period IN (60, 3600)
+      AND (bucket, name) IN (SELECT verified_at - verified_at % period, hazard_type
+                             FROM verified_alerts WHERE alert_key = NEW.alert_key);
+END;
+
+CREATE TRIGGER IF NOT EXISTS db_rollup_alert_insert
+AFTER INSERT ON verified_alerts BEGIN
+    INSERT INTO db_rollups (scope, period, bucket, name, count)
+    VALUES ('hazard_type', 60, NEW.verified_at - NEW.verified_at % 60, NEW.hazard_type, 1)
+        ON CONFLICT (scope, period, bucket, name) DO UPDATE SET count = count + 1;
+    INSERT INTO db_rollups (scope, period, bucket, name, count)
+    VALUES ('hazard_type', 3600, NEW.verified_at - NEW.verified_at % 3600, NEW.hazard_type, 1)
+        ON CONFLICT (scope, period, bucket, name) DO UPDATE SET count = count + 1;
+END;
+
+CREATE TRIGGER IF NOT EXISTS db_rollup_event_insert
+AFTER INSERT ON audit_log BEGIN
+    INSERT INTO db_rollups (scope, period, bucket, name, count)
+    VALUES ('event_type', 60, NEW.timestamp - NEW.timestamp % 60, NEW.event_type, 1)
+        ON CONFLICT (scope, period, bucket, name) DO UPDATE SET count = count + 1;
+    INSERT INTO db_rollups (scope, period, bucket, name, count)
+    VALUES ('event_type', 3600, NEW.timestamp - NEW.timestamp % 3600, NEW.event_type, 1)
+        ON CONFLICT (scope, period, bucket, name) DO UPDATE SET count = count + 1;
+END;
+
+-- One-time backfill for databases created before db_rollups existed
+INSERT OR REPLACE INTO db_rollups (scope, period, bucket, name, count)
+    SELECT 'hazard_type', p.period, verified_at - verified_at % p.period, hazard_type, COUNT(*)
+    FROM verified_alerts, (SELECT 60 AS period UNION ALL SELECT 3600) AS p
+    WHERE NOT EXISTS (SELECT 1 FROM db_rollups WHERE scope = 'meta')
+    GROUP BY 1, 2, 3, 4;
+INSERT OR REPLACE INTO db_rollups (scope, period, bucket, name, count)
+    SELECT 'event_type', p.period, timestamp - timestamp % p.period, event_type, COUNT(*)
+    FROM audit_log, (SELECT 60 AS period UNION ALL SELECT 3600) AS p
+    WHERE NOT EXISTS (SELECT 1 FROM db_rollups WHERE scope = 'meta')
+    GROUP BY 1, 2, 3, 4;
+INSERT OR IGNORE INTO db_rollups (scope, period, bucket, name, count)
+    VALUES ('meta', 0, 0, 'backfilled', 1);
+
 -- Example queries for reference:
 -- SELECT * FROM verified_alerts WHERE verified_at > (strftime('%s', 'now', '-1 hour'));
 -- SELECT * FROM audit_log WHERE event_type = 'alert_verified' ORDER BY timestamp DESC LIMIT 10;
-
+-- SELECT name, count FROM db_stats WHERE scope = 'hazard_type';
+-- SELECT bucket, name, count FROM db_rollups
+--     WHERE scope = 'event_type' AND period = 3600 AND bucket >= strftime('%s', 'now', '-1 day');
@@ -368,7 +368,8 @@ app.get("/alerts", (req, res) => {
  * Get system metrics
  */
 app.get("/metrics", (req, res) => {
-	db.get("SELECT COUNT(*) as total_alerts FROM verified_alerts", (err, alertRow) => {
+	// Counts come from the trigger-maintained db_stats table, not COUNT(*)
+	db.all("SELECT scope, name, count FROM db_stats WHERE scope != 'meta'", (err, rows) => {
 		if (err) {
 			return res.json({
 				messages_per_sec: 0,
@@ -378,14 +379,27 @@ app.get("/metrics", (req, res) => {
 			});
 		}
 
-		db.get("SELECT COUNT(*) as total_events FROM audit_log", (err, eventRow) => {
-			res.json({
-				messages_per_sec: 0.5, // Mock
-				rejected_count: 0,
-				active_nodes: 1,
-				verified_alerts: alertRow.total_alerts || 0,
-				total_events: eventRow.total_events || 0
-			});
+		const totals = {};
+		const alertsByHazard = {};
+		const eventsByType = {};
+		for (const row of rows || []) {
+			if (row.scope === "table") {
+				totals[row.name] = row.count;
+			} else if (row.scope === "hazard_type" && row.count > 0) {
+				alertsByHazard[row.name] = row.count;
+			} else if (row.scope === "event_type" && row.count > 0) {
+				eventsByType[row.name] = row.count;
+			}
+		}
+
+		res.json({
+			messages_per_sec: 0.5, // Mock
+			rejected_count: 0,
+			active_nodes: 1,
+			verified_alerts: totals.verified_alerts || 0,
+			total_events: totals.audit_log || 0,
+			alerts_by_hazard: alertsByHazard,
+			events_by_type: eventsByType
 		});
 	});
 });
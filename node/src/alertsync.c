@@ -0,0 +1,705 @@
+#include "alertsync.h"
+#include "timeutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#define ALERTSYNC_PEERS 16              // digest senders we remember replying to
+#define ALERTSYNC_ID_MAX 64
+
+typedef struct {
+    uint64_t bucket[ALERTSYNC_BUCKETS];
+    uint64_t root;
+    uint32_t count;
+} digest_t;
+
+typedef struct {
+    char id[ALERTSYNC_ID_MAX];
+    uint64_t replied_ns;
+} sync_peer_t;
+
+// Alerts copied out of the map, so messages are built without its lock
+typedef struct {
+    Alert *items;
+    size_t count;
+    size_t cap;
+    uint32_t mask;
+} alert_snapshot_t;
+
+typedef struct {
+    alertsync_config_t cfg;
+    alerts_map_t *map;
+    char node_id[ALERTSYNC_ID_MAX];
+    alertsync_send_fn send;
+    alertsync_seq_fn next_seq;
+    double rx_tokens;                   // inbound budget, refilled at rx_per_sec
+    uint64_t rx_refill_ns;
+    uint64_t next_digest_ns;
+    uint64_t last_root;
+    int disagreed;                      // since the last digest we sent
+    sync_peer_t peers[ALERTSYNC_PEERS];
+    uint64_t requested_ns[ALERTSYNC_BUCKETS];
+    alertsync_stats_t stats;
+    int stopping;
+    int initialized;
+    int thread_running;
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE wake;
+    HANDLE thread;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_t thread;
+#endif
+} alertsync_t;
+
+static alertsync_t g_sync;
+
+static void sync_lock(void) {
+#ifdef _WIN32
+    EnterCriticalSection(&g_sync.mutex);
+#else
+    pthread_mutex_lock(&g_sync.mutex);
+#endif
+}
+
+static void sync_unlock(void) {
+#ifdef _WIN32
+    LeaveCriticalSection(&g_sync.mutex);
+#else
+    pthread_mutex_unlock(&g_sync.mutex);
+#endif
+}
+
+static void sync_signal(void) {
+#ifdef _WIN32
+    WakeConditionVariable(&g_sync.wake);
+#else
+    pthread_cond_signal(&g_sync.wake);
+#endif
+}
+
+// Wait on the condition variable until woken or the monotonic deadline
+static void sync_wait_until(uint64_t deadline_ns) {
+#ifdef _WIN32
+    uint64_t now = monotonic_ns();
+    DWORD ms = deadline_ns > now ? (DWORD)((deadline_ns - now + 999999) / 1000000) : 0;
+    SleepConditionVariableCS(&g_sync.wake, &g_sync.mutex, ms);
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline_ns / 1000000000ull);
+    ts.tv_nsec = (long)(deadline_ns % 1000000000ull);
+    pthread_cond_timedwait(&g_sync.wake, &g_sync.mutex, &ts);
+#endif
+}
+
+// A peer disagrees or our table changed: go back to the base interval at
+// once rather than after a backed-off wait. Caller holds the lock.
+static void note_disagreement(void) {
+    g_sync.disagreed = 1;
+    uint64_t soon = monotonic_ns() + (uint64_t)g_sync.cfg.interval_ms * 1000000ull;
+    if (g_sync.next_digest_ns > soon) {
+        g_sync.next_digest_ns = soon;
+        sync_signal();
+    }
+}
+
+static int region_bucket(double lat, double lon) {
+    int64_t cx = (int64_t)floor(lat / ALERTSYNC_REGION_DEG);
+    int64_t cy = (int64_t)floor(lon / ALERTSYNC_REGION_DEG);
+    uint64_t h = (uint64_t)cx * 0x9E3779B97F4A7C15ull ^ (uint64_t)cy * 0xC2B2AE3D27D4EB4Full;
+    h ^= h >> 31;
+    return (int)(h % ALERTSYNC_BUCKETS);
+}
+
+static void digest_visit(const Alert *alert, void *arg) {
+    digest_t *d = (digest_t *)arg;
+    d->bucket[region_bucket(alert->latitude, alert->longitude)] ^= alert_fingerprint(alert);
+    d->count++;
+}
+
+static void compute_digest(digest_t *d) {
+    memset(d, 0, sizeof(*d));
+    alerts_map_foreach_live(g_sync.map, time(NULL), digest_visit, d);
+    uint64_t root = 1469598103934665603ull;
+    for (int i = 0; i < ALERTSYNC_BUCKETS; i++) {
+        root = (root ^ (d->bucket[i] + (uint64_t)i)) * 1099511628211ull;
+        root ^= root >> 29;
+    }
+    d->root = root ^ d->count;
+}
+
+static void snapshot_visit(const Alert *alert, void *arg) {
+    alert_snapshot_t *s = (alert_snapshot_t *)arg;
+    if (!(s->mask & (1u << region_bucket(alert->latitude, alert->longitude)))) {
+        return;
+    }
+    if (s->count == s->cap) {
+        size_t cap = s->cap ? s->cap * 2 : 16;
+        Alert *items = (Alert *)realloc(s->items, cap * sizeof(Alert));
+        if (!items) {
+            return;
+        }
+        s->items = items;
+        s->cap = cap;
+    }
+    s->items[s->count++] = *alert;
+}
+
+// Minimal field scans in the style of parse_json_fields()
+static int find_string(const char *json, const char *key, char *out, size_t cap) {
+    char pat[32];
+    snprintf(pat, sizeof(pat), "\"%s\":\"", key);
+    const char *p = strstr(json, pat);
+    if (!p) {
+        return 0;
+    }
+    p += strlen(pat);
+    const char *end = strchr(p, '"');
+    if (!end || (size_t)(end - p) >= cap) {
+        return 0;
+    }
+    memcpy(out, p, (size_t)(end - p));
+    out[end - p] = '\0';
+    return 1;
+}
+
+static int find_number(const char *json, const char *key, double *out) {
+    char pat[32];
+    snprintf(pat, sizeof(pat), "\"%s\":", key);
+    const char *p = strstr(json, pat);
+    if (!p) {
+        return 0;
+    }
+    char *end;
+    *out = strtod(p + strlen(pat), &end);
+    return end != p + strlen(pat);
+}
+
+static int send_payload(const char *payload, int len) {
+    if (len < 0 || g_sync.send(payload) != 0) {
+        return -1;
+    }
+    sync_lock();
+    g_sync.stats.bytes_sent += (uint64_t)len;
+    sync_unlock();
+    return 0;
+}
+
+static uint64_t next_seq(void) {
+    return g_sync.next_seq();
+}
+
+// Take one message from the inbound budget; caller holds the lock
+static int rx_budget_take(uint64_t now) {
+    double burst = (double)g_sync.cfg.rx_per_sec * ALERTSYNC_RX_BURST_S;
+    g_sync.rx_tokens += (double)(now - g_sync.rx_refill_ns) * 1e-9 * g_sync.cfg.rx_per_sec;
+    g_sync.rx_refill_ns = now;
+    if (g_sync.rx_tokens > burst) {
+        g_sync.rx_tokens = burst;
+    }
+    if (g_sync.rx_tokens < 1.0) {
+        return 0;
+    }
+    g_sync.rx_tokens -= 1.0;
+    return 1;
+}
+
+static void send_digest(const digest_t *d) {
+    char msg[256];
+    int len = snprintf(msg, sizeof(msg),
+                       "{\"msg_type\":\"alert_digest\",\"version\":1,\"ephemeral_id\":\"%s\",\"seq\":%llu,"
+                       "\"root\":\"%016llx\",\"count\":%u}",
+                       g_sync.node_id, (unsigned long long)next_seq(), (unsigned long long)d->root,
+                       (unsigned)d->count);
+    if (send_payload(msg, len) == 0) {
+        sync_lock();
+        g_sync.stats.digests_sent++;
+        sync_unlock();
+    }
+}
+
+static void send_buckets(const char *to, const digest_t *d) {
+    char msg[ALERTSYNC_BUCKETS * 17 + 256];
+    int len = snprintf(msg, sizeof(msg),
+                       "{\"msg_type\":\"alert_buckets\",\"version\":1,\"ephemeral_id\":\"%s\",\"seq\":%llu,"
+                       "\"to\":\"%s\",\"root\":\"%016llx\",\"count\":%u,\"buckets\":\"",
+                       g_sync.node_id, (unsigned long long)next_seq(), to, (unsigned long long)d->root,
+                       (unsigned)d->count);
+    for (int i = 0; i < ALERTSYNC_BUCKETS; i++) {
+        len += snprintf(msg + len, sizeof(msg) - (size_t)len, i ? ",%016llx" : "%016llx",
+                        (unsigned long long)d->bucket[i]);
+    }
+    len += snprintf(msg + len, sizeof(msg) - (size_t)len, "\"}");
+    if (send_payload(msg, len) == 0) {
+        sync_lock();
+        g_sync.stats.buckets_sent++;
+        sync_unlock();
+    }
+}
+
+static void send_request(const char *to, uint32_t mask) {
+    char msg[256];
+    int len = snprintf(msg, sizeof(msg),
+                       "{\"msg_type\":\"alert_request\",\"version\":1,\"ephemeral_id\":\"%s\",\"seq\":%llu,"
+                       "\"to\":\"%s\",\"mask\":\"%08x\"}",
+                       g_sync.node_id, (unsigned long long)next_seq(), to, (unsigned)mask);
+    if (send_payload(msg, len) == 0) {
+        sync_lock();
+        g_sync.stats.requests_sent++;
+        sync_unlock();
+    }
+}
+
+static int format_alert(char *buf, size_t cap, const Alert *a) {
+    int len = snprintf(buf, cap,
+                       "{\"key\":\"%s\",\"type\":\"%s\",\"lat\":%.6f,\"lon\":%.6f,\"conf\":%.4f,"
+                       "\"first\":%lld,\"last\":%lld,\"by\":\"",
+                       a->alert_key, a->hazard_type, a->latitude, a->longitude, a->confidence,
+                       (long long)a->first_seen, (long long)a->last_seen);
+    int n = a->confirmations < CONFIRMERS_MAX ? a->confirmations : CONFIRMERS_MAX;
+    for (int i = 0; i < n && len > 0 && (size_t)len < cap; i++) {
+        len += snprintf(buf + len, cap - (size_t)len, i ? ",%s" : "%s", a->confirmers[i]);
+    }
+    if (len > 0 && (size_t)len < cap) {
+        len += snprintf(buf + len, cap - (size_t)len, "\"}");
+    }
+    return len > 0 && (size_t)len < cap ? len : -1;
+}
+
+// Send our live alerts in the masked buckets, packed into as few
+// alert_sync messages as fit ALERTSYNC_MSG_BUDGET each
+static void send_alerts(const char *to, uint32_t mask) {
+    alert_snapshot_t snap;
+    memset(&snap, 0, sizeof(snap));
+    snap.mask = mask;
+    alerts_map_foreach_live(g_sync.map, time(NULL), snapshot_visit, &snap);
+
+    char msg[ALERTSYNC_MSG_BUDGET + 1024];
+    char rec[1024];
+    int len = 0;
+    size_t in_msg = 0;
+    for (size_t i = 0; i <= snap.count; i++) {
+        int rec_len = i < snap.count ? format_alert(rec, sizeof(rec), &snap.items[i]) : 0;
+        if (rec_len < 0) {
+            continue;
+        }
+        // Flush when this record would overflow the budget, or at the end
+        if (in_msg > 0 && (i == snap.count || (size_t)len + (size_t)rec_len + 3 > ALERTSYNC_MSG_BUDGET)) {
+            len += snprintf(msg + len, sizeof(msg) - (size_t)len, "]}");
+            if (send_payload(msg, len) == 0) {
+                sync_lock();
+                g_sync.stats.sync_msgs_sent++;
+                g_sync.stats.alerts_sent += in_msg;
+                sync_unlock();
+            }
+            in_msg = 0;
+        }
+        if (i == snap.count) {
+            break;
+        }
+        if (in_msg == 0) {
+            len = snprintf(msg, sizeof(msg),
+                           "{\"msg_type\":\"alert_sync\",\"version\":1,\"ephemeral_id\":\"%s\",\"seq\":%llu,"
+                           "\"to\":\"%s\",\"alerts\":[",
+                           g_sync.node_id, (unsigned long long)next_seq(), to);
+        }
+        len += snprintf(msg + len, sizeof(msg) - (size_t)len, in_msg ? ",%s" : "%s", rec);
+        in_msg++;
+    }
+    free(snap.items);
+}
+
+// Whether to answer this peer's digest now; remembers that we did
+static int peer_reply_due(const char *id, uint64_t now) {
+    uint64_t holdoff = (uint64_t)g_sync.cfg.holdoff_ms * 1000000ull;
+    sync_peer_t *slot = &g_sync.peers[0];
+    for (int i = 0; i < ALERTSYNC_PEERS; i++) {
+        sync_peer_t *p = &g_sync.peers[i];
+        if (strcmp(p->id, id) == 0) {
+            if (now - p->replied_ns < holdoff) {
+                return 0;
+            }
+            slot = p;
+            break;
+        }
+        if (p->replied_ns < slot->replied_ns) {
+            slot = p;
+        }
+    }
+    snprintf(slot->id, sizeof(slot->id), "%s", id);
+    slot->replied_ns = now;
+    return 1;
+}
+
+static void handle_digest(const char *from, const char *json) {
+    char root_hex[20];
+    if (!find_string(json, "root", root_hex, sizeof(root_hex))) {
+        return;
+    }
+    uint64_t root = strtoull(root_hex, NULL, 16);
+    digest_t mine;
+    compute_digest(&mine);
+
+    sync_lock();
+    g_sync.stats.digests_received++;
+    int reply = 0;
+    if (root == mine.root) {
+        g_sync.stats.digests_matched++;
+    } else {
+        note_disagreement();
+        reply = peer_reply_due(from, monotonic_ns());
+    }
+    sync_unlock();
+    if (reply) {
+        send_buckets(from, &mine);
+    }
+}
+
+static void handle_buckets(const char *from, const char *json) {
+    const char *p = strstr(json, "\"buckets\":\"");
+    if (!p) {
+        return;
+    }
+    p += strlen("\"buckets\":\"");
+    digest_t mine;
+    compute_digest(&mine);
+    uint32_t mask = 0;
+    for (int i = 0; i < ALERTSYNC_BUCKETS; i++) {
+        char *end;
+        uint64_t theirs = strtoull(p, &end, 16);
+        if (end == p) {
+            return;
+        }
+        if (theirs != mine.bucket[i]) {
+            mask |= 1u << i;
+        }
+        p = *end == ',' ? end + 1 : end;
+    }
+    if (mask == 0) {
+        return;
+    }
+
+    // Push ours, pull theirs; skip buckets we asked someone for just now
+    uint64_t now = monotonic_ns();
+    uint64_t holdoff = (uint64_t)g_sync.cfg.holdoff_ms * 1000000ull;
+    uint32_t request = 0;
+    sync_lock();
+    note_disagreement();
+    for (int i = 0; i < ALERTSYNC_BUCKETS; i++) {
+        if ((mask & (1u << i)) && now - g_sync.requested_ns[i] >= holdoff) {
+            g_sync.requested_ns[i] = now;
+            request |= 1u << i;
+        }
+    }
+    sync_unlock();
+    send_alerts(from, mask);
+    if (request) {
+        send_request(from, request);
+    }
+}
+
+static void handle_request(const char *from, const char *json) {
+    char mask_hex[16];
+    if (find_string(json, "mask", mask_hex, sizeof(mask_hex))) {
+        send_alerts(from, (uint32_t)strtoul(mask_hex, NULL, 16));
+    }
+}
+
+// Records carry no status or confirmation count: the receiver derives
+// both from the confirmer ids listed in "by"
+static int parse_alert_record(const char *rec, Alert *out) {
+    char by[CONFIRMERS_MAX * CONFIRMER_ID_MAX];
+    double lat, lon, conf, first, last;
+    memset(out, 0, sizeof(*out));
+    if (!find_string(rec, "key", out->alert_key, sizeof(out->alert_key)) ||
+        !find_string(rec, "type", out->hazard_type, sizeof(out->hazard_type)) ||
+        !find_string(rec, "by", by, sizeof(by)) ||
+        !find_number(rec, "lat", &lat) || !find_number(rec, "lon", &lon) ||
+        !find_number(rec, "conf", &conf) || !find_number(rec, "first", &first) ||
+        !find_number(rec, "last", &last)) {
+        return 0;
+    }
+    out->latitude = lat;
+    out->longitude = lon;
+    out->confidence = conf;
+    out->first_seen = (time_t)first;
+    out->last_seen = (time_t)last;
+    const char *id = by;
+    while (*id && out->confirmations < CONFIRMERS_MAX) {
+        const char *end = strchr(id, ',');
+        size_t len = end ? (size_t)(end - id) : strlen(id);
+        if (len > 0 && len < CONFIRMER_ID_MAX) {
+            memcpy(out->confirmers[out->confirmations++], id, len);
+        }
+        id += len + (end ? 1 : 0);
+    }
+    return 1;
+}
+
+static int handle_sync(const char *json) {
+    const char *p = strstr(json, "\"alerts\":[");
+    if (!p) {
+        return -1;
+    }
+    p += strlen("\"alerts\":[");
+    time_t now = time(NULL);
+    uint64_t received = 0, merged = 0;
+    char rec[1024];
+    // Records are flat objects, so each ends at the first '}'
+    while (*p == '{' || *p == ',') {
+        if (*p == ',') {
+            p++;
+            continue;
+        }
+        const char *end = strchr(p, '}');
+        if (!end || (size_t)(end - p) + 2 > sizeof(rec)) {
+            break;
+        }
+        memcpy(rec, p, (size_t)(end - p) + 1);
+        rec[end - p + 1] = '\0';
+        p = end + 1;
+        Alert a;
+        if (!parse_alert_record(rec, &a)) {
+            continue;
+        }
+        received++;
+        if (alerts_map_merge_at(g_sync.map, &a, now) == 1) {
+            merged++;
+        }
+    }
+    sync_lock();
+    g_sync.stats.alerts_received += received;
+    g_sync.stats.alerts_merged += merged;
+    if (merged) {
+        note_disagreement();
+    }
+    sync_unlock();
+    return 0;
+}
+
+// Sends a digest each time the digest interval passes. Caller holds the
+// lock, which is dropped while the digest is computed and sent.
+static void send_due_digest(uint64_t now) {
+    sync_unlock();
+    digest_t d;
+    compute_digest(&d);
+    sync_lock();
+    // Back off while everyone agrees and nothing changes here
+    int quiet = !g_sync.disagreed && g_sync.stats.digests_sent > 0 && d.root == g_sync.last_root;
+    int interval = quiet ? g_sync.stats.interval_ms * 2 : g_sync.cfg.interval_ms;
+    if (interval > g_sync.cfg.max_interval_ms) {
+        interval = g_sync.cfg.max_interval_ms;
+    }
+    g_sync.stats.interval_ms = interval;
+    g_sync.disagreed = 0;
+    g_sync.last_root = d.root;
+    g_sync.next_digest_ns = now + (uint64_t)interval * 1000000ull;
+    sync_unlock();
+    send_digest(&d);
+    sync_lock();
+}
+
+#ifdef _WIN32
+static DWORD WINAPI alertsync_thread(LPVOID arg) {
+#else
+static void *alertsync_thread(void *arg) {
+#endif
+    (void)arg;
+    sync_lock();
+    while (!g_sync.stopping) {
+        uint64_t now = monotonic_ns();
+        if (now < g_sync.next_digest_ns) {
+            sync_wait_until(g_sync.next_digest_ns);
+            continue;
+        }
+        send_due_digest(now);
+    }
+    sync_unlock();
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+void alertsync_config_defaults(alertsync_config_t *cfg) {
+    cfg->interval_ms = ALERTSYNC_DEFAULT_INTERVAL_MS;
+    cfg->max_interval_ms = ALERTSYNC_DEFAULT_MAX_INTERVAL_MS;
+    cfg->holdoff_ms = ALERTSYNC_DEFAULT_HOLDOFF_MS;
+    cfg->rx_per_sec = ALERTSYNC_DEFAULT_RX_PER_SEC;
+}
+
+int alertsync_init(const alertsync_config_t *cfg, alerts_map_t *map, const char *node_id,
+                   alertsync_seq_fn next_seq, alertsync_send_fn send) {
+    if (!cfg || !map || !node_id || !next_seq || !send || cfg->interval_ms <= 0 || cfg->rx_per_sec <= 0 ||
+        cfg->max_interval_ms < cfg->interval_ms || strlen(node_id) >= ALERTSYNC_ID_MAX) {
+        return -1;
+    }
+    memset(&g_sync, 0, sizeof(g_sync));
+    g_sync.cfg = *cfg;
+    g_sync.map = map;
+    strncpy(g_sync.node_id, node_id, sizeof(g_sync.node_id) - 1);
+    g_sync.send = send;
+    g_sync.next_seq = next_seq;
+    g_sync.rx_tokens = (double)cfg->rx_per_sec * ALERTSYNC_RX_BURST_S;
+    g_sync.rx_refill_ns = monotonic_ns();
+    g_sync.stats.interval_ms = cfg->interval_ms;
+    g_sync.next_digest_ns = monotonic_ns();     // announce ourselves at once
+#ifdef _WIN32
+    InitializeCriticalSection(&g_sync.mutex);
+    InitializeConditionVariable(&g_sync.wake);
+    g_sync.thread = CreateThread(NULL, 0, alertsync_thread, NULL, 0, NULL);
+    if (g_sync.thread == NULL) {
+        fprintf(stderr, "CreateThread alert sync failed\n");
+        DeleteCriticalSection(&g_sync.mutex);
+        return -1;
+    }
+#else
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (pthread_mutex_init(&g_sync.mutex, NULL) != 0 ||
+        pthread_cond_init(&g_sync.wake, &attr) != 0) {
+        fprintf(stderr, "Failed to initialize alert sync locks\n");
+        pthread_condattr_destroy(&attr);
+        return -1;
+    }
+    pthread_condattr_destroy(&attr);
+    if (pthread_create(&g_sync.thread, NULL, alertsync_thread, NULL) != 0) {
+        perror("pthread_create alert sync");
+        pthread_cond_destroy(&g_sync.wake);
+        pthread_mutex_destroy(&g_sync.mutex);
+        return -1;
+    }
+#endif
+    g_sync.thread_running = 1;
+    g_sync.initialized = 1;
+    printf("Alert sync enabled (digest every %d-%d ms, %d region buckets)\n",
+           cfg->interval_ms, cfg->max_interval_ms, ALERTSYNC_BUCKETS);
+    return 0;
+}
+
+void alertsync_shutdown(void) {
+    if (!g_sync.initialized || !g_sync.thread_running) {
+        return;
+    }
+    sync_lock();
+    g_sync.stopping = 1;
+    sync_signal();
+    sync_unlock();
+#ifdef _WIN32
+    WaitForSingleObject(g_sync.thread, INFINITE);
+    CloseHandle(g_sync.thread);
+#else
+    pthread_join(g_sync.thread, NULL);
+#endif
+    g_sync.thread_running = 0;
+}
+
+void alertsync_cleanup(void) {
+    if (!g_sync.initialized) {
+        return;
+    }
+    alertsync_shutdown();
+#ifdef _WIN32
+    DeleteCriticalSection(&g_sync.mutex);
+#else
+    pthread_cond_destroy(&g_sync.wake);
+    pthread_mutex_destroy(&g_sync.mutex);
+#endif
+    memset(&g_sync, 0, sizeof(g_sync));
+}
+
+int alertsync_enabled(void) {
+    return g_sync.initialized;
+}
+
+int alertsync_is_sync(const char *json) {
+    return json && strstr(json, "\"msg_type\":\"alert_") != NULL;
+}
+
+int alertsync_handle(const char *json) {
+    if (!g_sync.initialized) {
+        return 0;
+    }
+    char type[32], from[ALERTSYNC_ID_MAX], to[ALERTSYNC_ID_MAX];
+    if (!find_string(json, "msg_type", type, sizeof(type)) ||
+        !find_string(json, "ephemeral_id", from, sizeof(from))) {
+        return -1;
+    }
+    if (strcmp(from, g_sync.node_id) == 0) {
+        return 0;
+    }
+    // Every kind costs work here (merges, or alerts sent back), so all
+    // share one budget whoever sends them
+    sync_lock();
+    int allowed = rx_budget_take(monotonic_ns());
+    if (!allowed) {
+        g_sync.stats.over_budget++;
+    }
+    sync_unlock();
+    if (!allowed) {
+        return 1;
+    }
+    if (strcmp(type, "alert_sync") == 0) {
+        return handle_sync(json);
+    }
+    if (strcmp(type, "alert_digest") == 0) {
+        handle_digest(from, json);
+        return 0;
+    }
+    // The rest are addressed to one node
+    if (!find_string(json, "to", to, sizeof(to))) {
+        return -1;
+    }
+    if (strcmp(to, g_sync.node_id) != 0) {
+        return 0;
+    }
+    if (strcmp(type, "alert_buckets") == 0) {
+        handle_buckets(from, json);
+    } else if (strcmp(type, "alert_request") == 0) {
+        handle_request(from, json);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+void alertsync_get_stats(alertsync_stats_t *out) {
+    if (!out) {
+        return;
+    }
+    if (!g_sync.initialized) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    sync_lock();
+    *out = g_sync.stats;
+    sync_unlock();
+}
+
+void alertsync_print_stats(void) {
+    if (!g_sync.initialized) {
+        return;
+    }
+    alertsync_stats_t st;
+    alertsync_get_stats(&st);
+    printf("Alert sync: %llu digests sent (interval now %d ms), %llu received (%llu matched), "
+           "%llu bucket replies, %llu requests\n",
+           (unsigned long long)st.digests_sent, st.interval_ms, (unsigned long long)st.digests_received,
+           (unsigned long long)st.digests_matched, (unsigned long long)st.buckets_sent,
+           (unsigned long long)st.requests_sent);
+    printf("  alerts: %llu sent in %llu messages, %llu received, %llu merged; %llu bytes sent; "
+           "%llu received messages over budget\n",
+           (unsigned long long)st.alerts_sent, (unsigned long long)st.sync_msgs_sent,
+           (unsigned long long)st.alerts_received, (unsigned long long)st.alerts_merged,
+           (unsigned long long)st.bytes_sent, (unsigned long long)st.over_budget);
+}
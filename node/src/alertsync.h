@@ -0,0 +1,103 @@
+#ifndef ALERTSYNC_H
+#define ALERTSYNC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "core/alerts.h"
+
+// Anti-entropy sync of the alert table between nodes
+//
+// A node that joins an area learns the active alerts from its neighbours
+// instead of waiting for every hazard to be reported again. Live alerts are
+// hashed into ALERTSYNC_BUCKETS region buckets (by a ~5 km grid cell), each
+// holding the XOR of its alerts' fingerprints (alert_fingerprint()), so two
+// nodes with the same evidence have the same buckets. Exchange, all as
+// JSON through the normal send and receive path:
+//
+//   alert_digest   root hash and alert count, sent periodically
+//   alert_buckets  reply to a digest whose root differs: all bucket hashes
+//   alert_request  bitmask of differing buckets, asking for their alerts
+//   alert_sync     alerts of the requested buckets, split over datagrams
+//
+// On alert_buckets the digest's sender pushes its own alerts in the
+// differing buckets and requests the peer's, so both sides end up with
+// the union. alert_sync records are merged with alerts_map_merge_at() by
+// every node that hears them, addressed to it or not. Records carry the
+// confirmer ids but no status: each node re-derives VERIFIED itself, and
+// only for hazards it has also heard a signed report for.
+//
+// In steady state only digests flow. While every digest heard agrees and
+// the local table does not change, the digest interval doubles from
+// interval_ms up to max_interval_ms. Any disagreement resets it.
+
+#define ALERTSYNC_BUCKETS 32            // fits the request bitmask
+#define ALERTSYNC_REGION_DEG 0.05
+#define ALERTSYNC_DEFAULT_INTERVAL_MS 5000
+#define ALERTSYNC_DEFAULT_MAX_INTERVAL_MS 60000
+#define ALERTSYNC_DEFAULT_HOLDOFF_MS 1000
+#define ALERTSYNC_MSG_BUDGET 1400        // alert_sync payload per datagram
+#define ALERTSYNC_DEFAULT_RX_PER_SEC 50 // sync messages handled per second, all peers
+#define ALERTSYNC_RX_BURST_S 2          // burst allowance, in seconds of budget
+
+typedef struct {
+    int interval_ms;
+    int max_interval_ms;
+    int holdoff_ms;                     // min gap between replies to one peer's digests,
+                                        // and between requests for one bucket
+    int rx_per_sec;                     // inbound budget; excess messages are dropped
+} alertsync_config_t;
+
+typedef struct {
+    uint64_t digests_sent;
+    uint64_t digests_received;
+    uint64_t digests_matched;
+    uint64_t buckets_sent;
+    uint64_t requests_sent;
+    uint64_t sync_msgs_sent;
+    uint64_t alerts_sent;
+    uint64_t alerts_received;
+    uint64_t alerts_merged;             // changed the local table
+    uint64_t bytes_sent;
+    uint64_t over_budget;               // received messages dropped by the budget
+    int interval_ms;                    // current digest interval
+} alertsync_stats_t;
+
+// Next sequence number from the node's one counter, shared with its
+// reports, so (ephemeral_id, seq) stays unique for the replay check
+typedef uint64_t (*alertsync_seq_fn)(void);
+
+// Signs and queues one payload; returns 0 if queued
+typedef int (*alertsync_send_fn)(const char *payload);
+
+void alertsync_config_defaults(alertsync_config_t *cfg);
+
+/**
+ * Start syncing map with the node's neighbours; digests are sent by a
+ * timer thread, replies from alertsync_handle().
+ * @param node_id Our ephemeral id, used as sender and to spot replies to us
+ * @return 0 on success, -1 on error
+ */
+int alertsync_init(const alertsync_config_t *cfg, alerts_map_t *map, const char *node_id,
+                   alertsync_seq_fn next_seq, alertsync_send_fn send);
+
+// Stop the digest thread; replies to peers stop with the process thread
+void alertsync_shutdown(void);
+void alertsync_cleanup(void);
+int alertsync_enabled(void);
+
+// Nonzero if json is a sync message (msg_type alert_*)
+int alertsync_is_sync(const char *json);
+
+/**
+ * Handle a received sync message that passed the replay check and
+ * signature verification. Messages past the inbound budget (rx_per_sec,
+ * shared by all peers) are dropped; the buckets they would have fixed
+ * still differ at the next digest, so they are asked for again.
+ * @return 0 if handled, 1 if over budget, -1 if malformed
+ */
+int alertsync_handle(const char *json);
+
+void alertsync_get_stats(alertsync_stats_t *out);
+void alertsync_print_stats(void);
+
+#endif // ALERTSYNC_H
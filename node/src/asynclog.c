@@ -0,0 +1,501 @@
+#include "asynclog.h"
+#include "timeutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#define ALOG_IDLE_MS 5
+#define ALOG_FILE_BUFFER (64 * 1024)
+#define ALOG_CACHE_LINE 64
+#define ALOG_RECORD_MAX (sizeof(alog_record_t) + ALOG_MAX_ID + ALOG_MAX_PAYLOAD + 8)
+
+// Single-producer, single-consumer byte ring. head and tail only grow; the
+// owning thread advances head, the writer advances tail.
+typedef struct alog_ring {
+    uint64_t head;
+    char pad0[ALOG_CACHE_LINE - sizeof(uint64_t)];
+    uint64_t tail;
+    char pad1[ALOG_CACHE_LINE - sizeof(uint64_t)];
+    uint8_t *buf;
+    size_t mask;
+    uint64_t dropped;       // written by the producer only
+    uint64_t sampled_out;
+    unsigned reject_seq;
+    struct alog_ring *next;
+} alog_ring_t;
+
+typedef struct {
+    alog_level_t level;
+    alog_format_t format;
+    size_t ring_bytes;
+    unsigned sample_rejects;
+    FILE *out;
+    int owns_out;
+    alog_ring_t *rings;
+    uint64_t written;
+    volatile int stopping;
+    int running;
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+    HANDLE thread;
+#else
+    pthread_mutex_t mutex;
+    pthread_t thread;
+#endif
+} alog_t;
+
+typedef struct {
+    const char *name;
+    alog_level_t level;
+    int reject;             // subject to sampling
+} alog_event_info_t;
+
+static const alog_event_info_t k_events[ALOG_EV_COUNT] = {
+    { "received",      ALOG_INFO,  0 },
+    { "malformed",     ALOG_WARN,  1 },
+    { "replay",        ALOG_WARN,  1 },
+    { "rate_limited",  ALOG_WARN,  1 },
+    { "sig_valid",     ALOG_INFO,  0 },
+    { "sig_invalid",   ALOG_WARN,  1 },
+    { "sending",       ALOG_INFO,  0 },
+    { "signed",        ALOG_INFO,  0 },
+    { "sign_failed",   ALOG_ERROR, 0 },
+};
+
+static const char *const k_level_names[] = { "debug", "info", "warn", "error", "off" };
+
+static alog_t g_log;
+static __thread alog_ring_t *t_ring = NULL;
+
+static void log_lock(void) {
+#ifdef _WIN32
+    EnterCriticalSection(&g_log.mutex);
+#else
+    pthread_mutex_lock(&g_log.mutex);
+#endif
+}
+
+static void log_unlock(void) {
+#ifdef _WIN32
+    LeaveCriticalSection(&g_log.mutex);
+#else
+    pthread_mutex_unlock(&g_log.mutex);
+#endif
+}
+
+static void sleep_ms(int ms) {
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+#endif
+}
+
+void alog_config_defaults(alog_config_t *cfg) {
+    if (!cfg) {
+        return;
+    }
+    cfg->level = ALOG_INFO;
+    cfg->format = ALOG_FORMAT_TEXT;
+    cfg->path = NULL;
+    cfg->ring_bytes = ALOG_DEFAULT_RING_BYTES;
+    cfg->sample_rejects = 1;
+}
+
+int alog_parse_level(const char *s, alog_level_t *out) {
+    for (int i = 0; i <= ALOG_OFF; i++) {
+        if (strcmp(s, k_level_names[i]) == 0) {
+            *out = (alog_level_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int alog_parse_format(const char *s, alog_format_t *out) {
+    if (strcmp(s, "text") == 0) {
+        *out = ALOG_FORMAT_TEXT;
+    } else if (strcmp(s, "json") == 0) {
+        *out = ALOG_FORMAT_JSON;
+    } else if (strcmp(s, "binary") == 0) {
+        *out = ALOG_FORMAT_BINARY;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// ---- producer side ----
+
+static alog_ring_t *thread_ring(void) {
+    if (t_ring) {
+        return t_ring;
+    }
+    alog_ring_t *r = (alog_ring_t *)calloc(1, sizeof(alog_ring_t));
+    if (!r) {
+        return NULL;
+    }
+    r->buf = (uint8_t *)malloc(g_log.ring_bytes);
+    if (!r->buf) {
+        free(r);
+        return NULL;
+    }
+    r->mask = g_log.ring_bytes - 1;
+    log_lock();
+    r->next = g_log.rings;
+    __atomic_store_n(&g_log.rings, r, __ATOMIC_RELEASE);
+    log_unlock();
+    t_ring = r;
+    return r;
+}
+
+static void ring_put(alog_ring_t *r, uint64_t pos, const void *src, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    size_t off = (size_t)(pos & r->mask);
+    size_t first = r->mask + 1 - off;
+    if (first >= len) {
+        memcpy(r->buf + off, src, len);
+    } else {
+        memcpy(r->buf + off, src, first);
+        memcpy(r->buf, (const uint8_t *)src + first, len - first);
+    }
+}
+
+int alog_enabled(alog_event_t ev) {
+    return g_log.running && ev < ALOG_EV_COUNT && k_events[ev].level >= g_log.level;
+}
+
+void alog_event(alog_event_t ev, const struct sockaddr_in *src, const char *id, uint64_t seq,
+                const char *payload, size_t payload_len) {
+    if (!alog_enabled(ev)) {
+        return;
+    }
+    alog_ring_t *r = thread_ring();
+    if (!r) {
+        return;
+    }
+    if (k_events[ev].reject && g_log.sample_rejects > 1 &&
+        r->reject_seq++ % g_log.sample_rejects != 0) {
+        __atomic_store_n(&r->sampled_out, r->sampled_out + 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    size_t id_len = id ? strlen(id) : 0;
+    if (id_len > ALOG_MAX_ID) {
+        id_len = ALOG_MAX_ID;
+    }
+    if (!payload) {
+        payload_len = 0;
+    } else if (payload_len > ALOG_MAX_PAYLOAD) {
+        payload_len = ALOG_MAX_PAYLOAD;
+    }
+
+    alog_record_t rec;
+    rec.size = (uint32_t)((sizeof(rec) + id_len + payload_len + 7) & ~(size_t)7);
+    rec.event = (uint16_t)ev;
+    rec.level = (uint8_t)k_events[ev].level;
+    rec.id_len = (uint8_t)id_len;
+    rec.src_ip = src ? src->sin_addr.s_addr : 0;
+    rec.src_port = src ? ntohs(src->sin_port) : 0;
+    rec.payload_len = (uint16_t)payload_len;
+    rec.seq = seq;
+    rec.ts_us = wallclock_us();
+
+    uint64_t head = r->head;
+    uint64_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+    if (head + rec.size - tail > r->mask + 1) {
+        __atomic_store_n(&r->dropped, r->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    ring_put(r, head, &rec, sizeof(rec));
+    ring_put(r, head + sizeof(rec), id, id_len);
+    ring_put(r, head + sizeof(rec) + id_len, payload, payload_len);
+    __atomic_store_n(&r->head, head + rec.size, __ATOMIC_RELEASE);
+}
+
+// ---- writer side ----
+
+static void ring_get(const alog_ring_t *r, uint64_t pos, void *dst, size_t len) {
+    size_t off = (size_t)(pos & r->mask);
+    size_t first = r->mask + 1 - off;
+    if (first >= len) {
+        memcpy(dst, r->buf + off, len);
+    } else {
+        memcpy(dst, r->buf + off, first);
+        memcpy((uint8_t *)dst + first, r->buf, len - first);
+    }
+}
+
+static void write_json_string(FILE *out, const char *s, size_t len) {
+    fputc('"', out);
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        switch (c) {
+            case '"':  fputs("\\\"", out); break;
+            case '\\': fputs("\\\\", out); break;
+            case '\n': fputs("\\n", out); break;
+            case '\r': fputs("\\r", out); break;
+            case '\t': fputs("\\t", out); break;
+            default:
+                if (c < 0x20) {
+                    fprintf(out, "\\u%04x", c);
+                } else {
+                    fputc(c, out);
+                }
+        }
+    }
+    fputc('"', out);
+}
+
+static void format_ip(uint32_t ip, char *buf, size_t cap) {
+    const uint8_t *b = (const uint8_t *)&ip;   // network byte order
+    snprintf(buf, cap, "%u.%u.%u.%u", b[0], b[1], b[2], b[3]);
+}
+
+// The lines main.c printed before the logger existed
+static void write_text(FILE *out, const alog_record_t *rec, const char *id, const char *msg) {
+    char ip[16];
+    format_ip(rec->src_ip, ip, sizeof(ip));
+    int id_len = rec->id_len;
+    int msg_len = rec->payload_len;
+    switch ((alog_event_t)rec->event) {
+        case ALOG_EV_RECEIVED:
+            fprintf(out, "RECEIVED from %s:%u -> %.*s\n", ip, rec->src_port, msg_len, msg);
+            break;
+        case ALOG_EV_MALFORMED:
+            fputs("❌ Invalid JSON format - missing ephemeral_id or seq\n", out);
+            break;
+        case ALOG_EV_REPLAY:
+            fprintf(out, "⛔ Replay detected from %s (ephemeral_id: %.*s, seq: %llu)\n",
+                    ip, id_len, id, (unsigned long long)rec->seq);
+            break;
+        case ALOG_EV_RATE_LIMITED:
+            fprintf(out, "🚫 Rate limit exceeded from %s (ephemeral_id: %.*s)\n", ip, id_len, id);
+            break;
+        case ALOG_EV_SIG_VALID:
+            fputs("SIGNATURE VERIFICATION: VALID ✓\n", out);
+            break;
+        case ALOG_EV_SIG_INVALID:
+            fputs("SIGNATURE VERIFICATION: INVALID ✗\n", out);
+            break;
+        case ALOG_EV_SENDING:
+            fprintf(out, "SENDING: %.*s\n", msg_len, msg);
+            break;
+        case ALOG_EV_SIGNED:
+            fputs("MESSAGE SIGNED ✓\n", out);
+            break;
+        case ALOG_EV_SIGN_FAILED:
+            fputs("SIGNING FAILED ✗\n", out);
+            break;
+        default:
+            break;
+    }
+}
+
+static void write_json(FILE *out, const alog_record_t *rec, const char *id, const char *msg) {
+    const char *event = rec->event < ALOG_EV_COUNT ? k_events[rec->event].name : "unknown";
+    fprintf(out, "{\"ts_us\":%lld,\"level\":\"%s\",\"event\":\"%s\"",
+            (long long)rec->ts_us, k_level_names[rec->level <= ALOG_OFF ? rec->level : ALOG_OFF], event);
+    if (rec->src_ip != 0 || rec->src_port != 0) {
+        char ip[16];
+        format_ip(rec->src_ip, ip, sizeof(ip));
+        fprintf(out, ",\"src\":\"%s:%u\"", ip, rec->src_port);
+    }
+    if (rec->id_len > 0) {
+        fputs(",\"id\":", out);
+        write_json_string(out, id, rec->id_len);
+        fprintf(out, ",\"seq\":%llu", (unsigned long long)rec->seq);
+    }
+    if (rec->payload_len > 0) {
+        fputs(",\"msg\":", out);
+        write_json_string(out, msg, rec->payload_len);
+    }
+    fputs("}\n", out);
+}
+
+// Write out everything currently in one ring; returns the records written
+static uint64_t drain_ring(alog_ring_t *r, uint8_t *scratch) {
+    uint64_t tail = r->tail;
+    uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    uint64_t n = 0;
+    while (tail < head) {
+        alog_record_t *rec = (alog_record_t *)scratch;
+        ring_get(r, tail, rec, sizeof(*rec));
+        ring_get(r, tail + sizeof(*rec), scratch + sizeof(*rec), rec->size - sizeof(*rec));
+        const char *id = (const char *)scratch + sizeof(*rec);
+        const char *msg = id + rec->id_len;
+        switch (g_log.format) {
+            case ALOG_FORMAT_JSON:
+                write_json(g_log.out, rec, id, msg);
+                break;
+            case ALOG_FORMAT_BINARY:
+                fwrite(scratch, 1, rec->size, g_log.out);
+                break;
+            default:
+                write_text(g_log.out, rec, id, msg);
+                break;
+        }
+        tail += rec->size;
+        n++;
+    }
+    __atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+    return n;
+}
+
+static uint64_t drain_all(uint8_t *scratch) {
+    uint64_t n = 0;
+    for (alog_ring_t *r = __atomic_load_n(&g_log.rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+        n += drain_ring(r, scratch);
+    }
+    __atomic_store_n(&g_log.written, g_log.written + n, __ATOMIC_RELAXED);
+    return n;
+}
+
+static void writer_loop(void) {
+    static uint8_t scratch[ALOG_RECORD_MAX];
+    int dirty = 0;
+    while (!g_log.stopping) {
+        if (drain_all(scratch) > 0) {
+            dirty = 1;
+            continue;
+        }
+        if (dirty) {
+            fflush(g_log.out);
+            dirty = 0;
+        }
+        sleep_ms(ALOG_IDLE_MS);
+    }
+    drain_all(scratch);
+    fflush(g_log.out);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI writer_thread(LPVOID arg) {
+    (void)arg;
+    writer_loop();
+    return 0;
+}
+#else
+static void *writer_thread(void *arg) {
+    (void)arg;
+    writer_loop();
+    return NULL;
+}
+#endif
+
+int alog_init(const alog_config_t *cfg) {
+    alog_config_t defaults;
+    if (!cfg) {
+        alog_config_defaults(&defaults);
+        cfg = &defaults;
+    }
+    memset(&g_log, 0, sizeof(g_log));
+    g_log.level = cfg->level;
+    g_log.format = cfg->format;
+    g_log.sample_rejects = cfg->sample_rejects;
+
+    // Power of two so positions wrap with a mask; at least a few full records
+    size_t bytes = ALOG_RECORD_MAX * 4;
+    while (bytes < cfg->ring_bytes || (bytes & (bytes - 1)) != 0) {
+        bytes = (bytes | (bytes - 1)) + 1;
+    }
+    g_log.ring_bytes = bytes;
+
+    if (cfg->path) {
+        g_log.out = fopen(cfg->path, cfg->format == ALOG_FORMAT_BINARY ? "ab" : "a");
+        if (!g_log.out) {
+            fprintf(stderr, "Cannot open log file %s\n", cfg->path);
+            return -1;
+        }
+        g_log.owns_out = 1;
+        setvbuf(g_log.out, NULL, _IOFBF, ALOG_FILE_BUFFER);
+    } else {
+        g_log.out = stdout;
+    }
+    if (cfg->format == ALOG_FORMAT_BINARY) {
+        // Appending to an existing capture keeps its single header
+        fseek(g_log.out, 0, SEEK_END);
+        if (ftell(g_log.out) <= 0) {
+            fwrite(ALOG_BINARY_MAGIC, 1, 8, g_log.out);
+        }
+    }
+
+#ifdef _WIN32
+    InitializeCriticalSection(&g_log.mutex);
+    g_log.thread = CreateThread(NULL, 0, writer_thread, NULL, 0, NULL);
+    int started = g_log.thread != NULL;
+#else
+    pthread_mutex_init(&g_log.mutex, NULL);
+    int started = pthread_create(&g_log.thread, NULL, writer_thread, NULL) == 0;
+#endif
+    if (!started) {
+        fprintf(stderr, "Failed to start log writer\n");
+        if (g_log.owns_out) {
+            fclose(g_log.out);
+        }
+        return -1;
+    }
+    g_log.running = 1;
+    return 0;
+}
+
+void alog_shutdown(void) {
+    if (!g_log.running) {
+        return;
+    }
+    g_log.running = 0;     // new events are ignored from here on
+    g_log.stopping = 1;
+#ifdef _WIN32
+    WaitForSingleObject(g_log.thread, INFINITE);
+    CloseHandle(g_log.thread);
+    DeleteCriticalSection(&g_log.mutex);
+#else
+    pthread_join(g_log.thread, NULL);
+    pthread_mutex_destroy(&g_log.mutex);
+#endif
+    alog_print_stats();
+    if (g_log.owns_out) {
+        fclose(g_log.out);
+    }
+    alog_ring_t *r = g_log.rings;
+    while (r) {
+        alog_ring_t *next = r->next;
+        free(r->buf);
+        free(r);
+        r = next;
+    }
+    g_log.rings = NULL;
+    t_ring = NULL;
+}
+
+void alog_get_stats(alog_stats_t *out) {
+    if (!out) {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    out->written = __atomic_load_n(&g_log.written, __ATOMIC_RELAXED);
+    for (alog_ring_t *r = __atomic_load_n(&g_log.rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+        out->dropped += __atomic_load_n(&r->dropped, __ATOMIC_RELAXED);
+        out->sampled_out += __atomic_load_n(&r->sampled_out, __ATOMIC_RELAXED);
+        out->rings++;
+    }
+}
+
+void alog_print_stats(void) {
+    alog_stats_t st;
+    alog_get_stats(&st);
+    printf("Logger: %llu records written, %llu dropped (ring full), %llu sampled out, %d thread ring%s\n",
+           (unsigned long long)st.written, (unsigned long long)st.dropped,
+           (unsigned long long)st.sampled_out, st.rings, st.rings == 1 ? "" : "s");
+}
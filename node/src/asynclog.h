@@ -0,0 +1,116 @@
+#ifndef ASYNCLOG_H
+#define ASYNCLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "net.h"
+
+// Asynchronous structured logger for the packet path.
+//
+// Each logging thread owns a single-producer ring buffer. A log call copies a
+// fixed header and the raw payload into the ring and returns; it never
+// formats, locks or blocks. If the ring is full, the record is counted as
+// dropped. A background writer thread drains all rings, formats the records
+// and writes them to stdout or a file.
+//
+// Events are a fixed set, so records stay small and the text output matches
+// what the node printed before. Reject events can be sampled (1 in N per
+// thread) so a flood cannot fill the log.
+//
+// Output formats:
+//   text    the node's classic console lines
+//   json    one JSON object per line: ts_us, level, event, src, id, seq, msg
+//   binary  "V2VLOG01" followed by the raw records (alog_record_t + id + msg,
+//           each padded to 8 bytes), in host byte order
+
+typedef enum {
+    ALOG_DEBUG = 0,
+    ALOG_INFO,
+    ALOG_WARN,
+    ALOG_ERROR,
+    ALOG_OFF
+} alog_level_t;
+
+typedef enum {
+    ALOG_FORMAT_TEXT = 0,
+    ALOG_FORMAT_JSON,
+    ALOG_FORMAT_BINARY
+} alog_format_t;
+
+typedef enum {
+    ALOG_EV_RECEIVED = 0,
+    ALOG_EV_MALFORMED,
+    ALOG_EV_REPLAY,
+    ALOG_EV_RATE_LIMITED,
+    ALOG_EV_SIG_VALID,
+    ALOG_EV_SIG_INVALID,
+    ALOG_EV_SENDING,
+    ALOG_EV_SIGNED,
+    ALOG_EV_SIGN_FAILED,
+    ALOG_EV_COUNT
+} alog_event_t;
+
+#define ALOG_DEFAULT_RING_BYTES (256 * 1024)
+#define ALOG_MAX_PAYLOAD 2048
+#define ALOG_MAX_ID 63
+#define ALOG_BINARY_MAGIC "V2VLOG01"
+
+// Header of every record; the id and payload bytes follow it
+typedef struct {
+    uint32_t size;          // whole record, padded to 8 bytes
+    uint16_t event;
+    uint8_t level;
+    uint8_t id_len;
+    uint32_t src_ip;        // network byte order, 0 if none
+    uint16_t src_port;
+    uint16_t payload_len;
+    uint64_t seq;
+    int64_t ts_us;          // wall clock
+} alog_record_t;
+
+typedef struct {
+    alog_level_t level;
+    alog_format_t format;
+    const char *path;           // NULL writes to stdout
+    size_t ring_bytes;          // per thread, rounded up to a power of two
+    unsigned sample_rejects;    // log 1 in N reject events; 0 or 1 logs all
+} alog_config_t;
+
+typedef struct {
+    uint64_t written;
+    uint64_t dropped;           // ring full
+    uint64_t sampled_out;
+    int rings;
+} alog_stats_t;
+
+void alog_config_defaults(alog_config_t *cfg);
+
+/**
+ * Open the output and start the writer thread.
+ * @return 0 on success, -1 on error
+ */
+int alog_init(const alog_config_t *cfg);
+
+// Stop the writer after draining every ring, then close the output.
+// Call once the threads that log have exited.
+void alog_shutdown(void);
+
+/**
+ * Log one event from the calling thread.
+ * @param src Peer address, or NULL
+ * @param id Ephemeral ID, or NULL
+ * @param payload Raw message bytes, or NULL; truncated to ALOG_MAX_PAYLOAD
+ */
+void alog_event(alog_event_t ev, const struct sockaddr_in *src, const char *id, uint64_t seq,
+                const char *payload, size_t payload_len);
+
+// Nonzero if ev would be recorded at the current level
+int alog_enabled(alog_event_t ev);
+
+int alog_parse_level(const char *s, alog_level_t *out);
+int alog_parse_format(const char *s, alog_format_t *out);
+
+void alog_get_stats(alog_stats_t *out);
+void alog_print_stats(void);
+
+#endif // ASYNCLOG_H
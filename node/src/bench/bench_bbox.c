@@ -0,0 +1,172 @@
+// Viewport ("alerts in this map rectangle") query latency.
+//
+// Fills a database with alerts spread over a region roughly the size of a
+// metro area, then times db_query_alerts_in_bbox (R*Tree) against the same
+// predicate evaluated by a full scan of verified_alerts. The database file is
+// reused across runs when it already holds enough rows, since building a
+// multi-million-row table dominates the run time.
+//
+//   ./bench/bench_bbox [-n rows] [-f db_path] [-q queries] [-w viewport_deg]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../db/db.h"
+#include "../timeutil.h"
+
+#define REGION_LAT 40.50
+#define REGION_LON -74.25
+#define REGION_SPAN 0.50        // degrees, about 55 km
+
+// Small deterministic PRNG so runs are comparable
+static uint64_t g_rng = 0x9E3779B97F4A7C15ull;
+
+static double rand_unit(void) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return (double)(g_rng >> 11) / (double)(1ull << 53);
+}
+
+static long long count_rows(void) {
+    sqlite3_stmt *stmt;
+    long long n = 0;
+    if (sqlite3_prepare_v2(g_db, "SELECT MAX(id) FROM verified_alerts;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            n = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    return n;
+}
+
+static void populate(long long have, long long rows) {
+    static const char *types[] = { "debris", "ice_patch", "accident", "road_block" };
+    VerifiedAlert a;
+    memset(&a, 0, sizeof(a));
+    strcpy(a.confirmers_json, "[\"veh_a\",\"veh_b\"]");
+
+    printf("populating %lld rows...\n", rows - have);
+    fflush(stdout);
+    uint64_t start = monotonic_ns();
+    db_begin();
+    for (long long i = have; i < rows; i++) {
+        a.latitude = REGION_LAT + rand_unit() * REGION_SPAN;
+        a.longitude = REGION_LON + rand_unit() * REGION_SPAN;
+        strcpy(a.hazard_type, types[i % 4]);
+        snprintf(a.alert_key, sizeof(a.alert_key), "%s@%.6f,%.6f#%lld",
+                 a.hazard_type, a.latitude, a.longitude, i);
+        a.confidence = 0.9;
+        a.first_seen = 1700000000 + (time_t)i;
+        a.verified_at = a.first_seen + 5;
+        a.confirmations = 2;
+        snprintf(a.raw_payload, sizeof(a.raw_payload),
+                 "{\"hazard_type\":\"%s\",\"location\":[%.6f,%.6f]}",
+                 a.hazard_type, a.latitude, a.longitude);
+        db_insert_verified_alert(&a);
+        if ((i + 1) % 50000 == 0) {
+            db_commit();
+            db_begin();
+        }
+    }
+    db_commit();
+    double secs = (double)(monotonic_ns() - start) / 1e9;
+    printf("populated in %.1f s (%.0f rows/s)\n", secs, (double)(rows - have) / secs);
+}
+
+static int count_row(const db_alert_view_t *row, void *arg) {
+    (void)row;
+    (*(long long *)arg)++;
+    return 0;
+}
+
+static long long scan_bbox(sqlite3_stmt *stmt, double min_lat, double min_lon,
+                           double max_lat, double max_lon) {
+    long long n = 0;
+    sqlite3_bind_double(stmt, 1, min_lat);
+    sqlite3_bind_double(stmt, 2, min_lon);
+    sqlite3_bind_double(stmt, 3, max_lat);
+    sqlite3_bind_double(stmt, 4, max_lon);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        n++;
+    }
+    sqlite3_reset(stmt);
+    return n;
+}
+
+int main(int argc, char **argv) {
+    long long rows = 2000000;
+    const char *path = "bench_bbox.db";
+    int queries = 200;
+    double width = 0.01;        // about 1 km viewport
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            rows = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            queries = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            width = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [-n rows] [-f db_path] [-q queries] [-w viewport_deg]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (queries <= 0) {
+        queries = 1;
+    }
+
+    if (db_init(path) != 0) {
+        return 1;
+    }
+    db_set_verbose(0);
+
+    long long have = count_rows();
+    if (have < rows) {
+        populate(have, rows);
+    }
+    rows = count_rows();
+
+    // Same predicate as the R*Tree query, but forced to scan the table
+    sqlite3_stmt *scan;
+    if (sqlite3_prepare_v2(g_db,
+                           "SELECT id FROM verified_alerts NOT INDEXED "
+                           "WHERE latitude BETWEEN ?1 AND ?3 AND longitude BETWEEN ?2 AND ?4;",
+                           -1, &scan, NULL) != SQLITE_OK) {
+        fprintf(stderr, "prepare failed: %s\n", sqlite3_errmsg(g_db));
+        return 1;
+    }
+
+    printf("bbox benchmark: %lld rows in %s, %d queries, %.3f deg viewport\n",
+           rows, path, queries, width);
+
+    uint64_t rtree_ns = 0, scan_ns = 0;
+    long long rtree_rows = 0, scan_rows = 0;
+    int scan_queries = queries < 20 ? queries : 20;   // full scans are slow
+    for (int q = 0; q < queries; q++) {
+        double min_lat = REGION_LAT + rand_unit() * (REGION_SPAN - width);
+        double min_lon = REGION_LON + rand_unit() * (REGION_SPAN - width);
+
+        uint64_t t0 = monotonic_ns();
+        db_query_alerts_in_bbox(min_lat, min_lon, min_lat + width, min_lon + width,
+                                0, 0, 0, count_row, &rtree_rows);
+        rtree_ns += monotonic_ns() - t0;
+
+        if (q < scan_queries) {
+            t0 = monotonic_ns();
+            scan_rows += scan_bbox(scan, min_lat, min_lon, min_lat + width, min_lon + width);
+            scan_ns += monotonic_ns() - t0;
+        }
+    }
+    sqlite3_finalize(scan);
+
+    printf("%-12s %6d queries  %10.1f us/query  %8.1f rows/query\n", "rtree",
+           queries, (double)rtree_ns / queries / 1e3, (double)rtree_rows / queries);
+    printf("%-12s %6d queries  %10.1f us/query  %8.1f rows/query\n", "full-scan",
+           scan_queries, (double)scan_ns / scan_queries / 1e3, (double)scan_rows / scan_queries);
+
+    db_close();
+    return 0;
+}
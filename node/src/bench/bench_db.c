@@ -0,0 +1,149 @@
+// Insert throughput for the persistence layer.
+//
+// Runs the same workload twice: once preparing and finalizing a statement on
+// every call (how db.c worked before statements were cached) and once through
+// the db_* API, which reuses prepared statements. Rows are inserted inside a
+// single transaction by default so the numbers reflect per-statement CPU
+// rather than fsync latency; pass --autocommit to measure one commit per row.
+//
+//   ./bench/bench_db [-n rows] [-f db_path] [--autocommit]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../db/db.h"
+#include "../timeutil.h"
+
+static void make_alert(VerifiedAlert *a, int i) {
+    memset(a, 0, sizeof(*a));
+    snprintf(a->alert_key, sizeof(a->alert_key), "debris@%.4f,%.4f",
+             40.0 + (i % 1000) * 0.001, -74.0 - (i / 1000) * 0.001);
+    a->latitude = 40.0 + (i % 1000) * 0.001;
+    a->longitude = -74.0 - (i / 1000) * 0.001;
+    strcpy(a->hazard_type, "debris");
+    a->confidence = 0.9;
+    a->first_seen = 1700000000 + i;
+    a->verified_at = 1700000005 + i;
+    a->confirmations = 3;
+    strcpy(a->confirmers_json, "[\"veh_a\",\"veh_b\",\"veh_c\"]");
+    snprintf(a->raw_payload, sizeof(a->raw_payload),
+             "{\"msg_type\":\"hazard_report\",\"ephemeral_id\":\"veh_%d\",\"seq\":%d,"
+             "\"hazard_type\":\"debris\",\"confidence\":0.9}", i, i);
+}
+
+// Baseline: the original prepare/bind/step/finalize sequence
+static int insert_uncached(const VerifiedAlert *alert) {
+    const char *sql =
+        "INSERT OR REPLACE INTO verified_alerts "
+        "(alert_key, latitude, longitude, hazard_type, confidence, "
+        " first_seen, verified_at, confirmations, confirmers, raw_payload) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(g_db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, alert->alert_key, -1, SQLITE_STATIC);
+    sqlite3_bind_double(stmt, 2, alert->latitude);
+    sqlite3_bind_double(stmt, 3, alert->longitude);
+    sqlite3_bind_text(stmt, 4, alert->hazard_type, -1, SQLITE_STATIC);
+    sqlite3_bind_double(stmt, 5, alert->confidence);
+    sqlite3_bind_int64(stmt, 6, alert->first_seen);
+    sqlite3_bind_int64(stmt, 7, alert->verified_at);
+    sqlite3_bind_int(stmt, 8, alert->confirmations);
+    sqlite3_bind_text(stmt, 9, alert->confirmers_json, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 10, alert->raw_payload, -1, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE ? 0 : -1;
+}
+
+static int log_uncached(const char *event_type, const char *payload, const char *details) {
+    const char *sql =
+        "INSERT INTO audit_log (event_type, timestamp, payload, details) "
+        "VALUES (?, strftime('%s', 'now'), ?, ?);";
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(g_db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, event_type, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, payload, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, details, -1, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE ? 0 : -1;
+}
+
+static void clear_tables(void) {
+    sqlite3_exec(g_db, "DELETE FROM verified_alerts; DELETE FROM audit_log;", NULL, NULL, NULL);
+}
+
+static void report(const char *name, int rows, uint64_t ns, int errors) {
+    double secs = (double)ns / 1e9;
+    printf("%-22s %8d rows  %10.0f inserts/s  %8.0f ns/insert  errors=%d\n",
+           name, rows, rows / secs, (double)ns / rows, errors);
+}
+
+static void run(const char *name, int rows, int autocommit, int cached, int events) {
+    VerifiedAlert alert;
+    int errors = 0;
+
+    clear_tables();
+    uint64_t start = monotonic_ns();
+    if (!autocommit) {
+        sqlite3_exec(g_db, "BEGIN", NULL, NULL, NULL);
+    }
+    for (int i = 0; i < rows; i++) {
+        int rc;
+        if (events) {
+            rc = cached ? db_log_event("alert_verified", "{\"bench\":1}", "benchmark row")
+                        : log_uncached("alert_verified", "{\"bench\":1}", "benchmark row");
+        } else {
+            make_alert(&alert, i);
+            rc = cached ? db_insert_verified_alert(&alert) : insert_uncached(&alert);
+        }
+        if (rc != 0) {
+            errors++;
+        }
+    }
+    if (!autocommit) {
+        sqlite3_exec(g_db, "COMMIT", NULL, NULL, NULL);
+    }
+    report(name, rows, monotonic_ns() - start, errors);
+}
+
+int main(int argc, char **argv) {
+    int rows = 50000;
+    const char *path = ":memory:";
+    int autocommit = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            rows = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else if (strcmp(argv[i], "--autocommit") == 0) {
+            autocommit = 1;
+        } else {
+            fprintf(stderr, "Usage: %s [-n rows] [-f db_path] [--autocommit]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (rows <= 0) {
+        rows = 1;
+    }
+
+    if (db_init(path) != 0) {
+        return 1;
+    }
+    db_set_verbose(0);
+
+    printf("db insert benchmark: %s, %s\n", path,
+           autocommit ? "one commit per row" : "single transaction");
+    run("alerts/prepare-each", rows, autocommit, 0, 0);
+    run("alerts/cached", rows, autocommit, 1, 0);
+    run("events/prepare-each", rows, autocommit, 0, 1);
+    run("events/cached", rows, autocommit, 1, 1);
+
+    db_close();
+    return 0;
+}
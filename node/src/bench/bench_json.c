@@ -0,0 +1,163 @@
+// Canonical hazard JSON: printf-based builder vs format_canonical_hazard_json.
+//
+// The baseline is the original builder (snprintf to size, malloc, snprintf
+// again). Before timing, every generated input is checked for byte-identical
+// output, including values on and near rounding ties, since the signatures
+// cover these bytes.
+//
+//   ./bench/bench_json [-n iterations] [-c check_count]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../jsonmsg.h"
+#include "../timeutil.h"
+
+#define CANONICAL_FMT \
+    "{\"msg_type\":\"%s\",\"version\":1,\"ephemeral_id\":\"%s\",\"seq\":%llu,\"timestamp\":%llu," \
+    "\"location\":[%.6f,%.6f],\"speed\":%.2f,\"heading\":%.2f,\"hazard_type\":\"%s\"," \
+    "\"confidence\":%.4f,\"ttl_seconds\":%d}"
+
+typedef struct {
+    uint64_t seq;
+    uint64_t timestamp;
+    double lat, lon, speed, heading, confidence;
+    int ttl;
+} sample_t;
+
+static char *legacy_build(const sample_t *s) {
+    int needed = snprintf(NULL, 0, CANONICAL_FMT, "hazard_report", "veh_4f2a91",
+                          (unsigned long long)s->seq, (unsigned long long)s->timestamp,
+                          s->lat, s->lon, s->speed, s->heading, "ice_patch", s->confidence, s->ttl);
+    if (needed < 0) {
+        return NULL;
+    }
+    char *buf = (char *)malloc((size_t)needed + 1);
+    if (buf) {
+        snprintf(buf, (size_t)needed + 1, CANONICAL_FMT, "hazard_report", "veh_4f2a91",
+                 (unsigned long long)s->seq, (unsigned long long)s->timestamp,
+                 s->lat, s->lon, s->speed, s->heading, "ice_patch", s->confidence, s->ttl);
+    }
+    return buf;
+}
+
+static int fast_build(char *buf, size_t cap, const sample_t *s) {
+    return format_canonical_hazard_json(buf, cap, "hazard_report", "veh_4f2a91", s->seq, s->timestamp,
+                                        s->lat, s->lon, s->speed, s->heading, "ice_patch",
+                                        s->confidence, s->ttl);
+}
+
+static uint64_t g_rng = 0x9E3779B97F4A7C15ull;
+
+static uint64_t rand_u64(void) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+static double rand_range(double lo, double hi) {
+    return lo + (double)(rand_u64() >> 11) / (double)(1ull << 53) * (hi - lo);
+}
+
+// Mix realistic values with ones that sit on or next to a rounding tie
+static void make_sample(sample_t *s, long i) {
+    s->seq = rand_u64() % 10000000000ull;
+    s->timestamp = 1700000000 + (uint64_t)i;
+    s->lat = rand_range(-90, 90);
+    s->lon = rand_range(-180, 180);
+    s->speed = rand_range(0, 200);
+    s->heading = rand_range(0, 360);
+    s->confidence = rand_range(0, 1);
+    s->ttl = (int)(rand_u64() % 600) - 10;
+    switch (i % 8) {
+        case 1:   // exact ties in binary
+            s->speed = (double)(rand_u64() % 100000) / 8.0;
+            s->confidence = (double)(rand_u64() % 65536) / 65536.0;
+            break;
+        case 2:   // decimal ties that are not exact in binary
+            s->lat = (double)(long long)(rand_u64() % 180000000 - 90000000) / 1e6 + 5e-7;
+            s->heading = (double)(rand_u64() % 36000) / 100.0 + 0.005;
+            break;
+        case 3:   // one ulp either side of a tie
+            s->lon = nextafter((double)(rand_u64() % 360000000) / 1e6 - 180.0 + 5e-7, 1e9);
+            s->speed = nextafter((double)(rand_u64() % 20000) / 100.0 + 0.005, -1e9);
+            break;
+        case 4:   // signed zero and tiny negatives
+            s->lat = -0.0;
+            s->lon = -1e-9;
+            s->heading = 0.0;
+            break;
+        case 5:   // whole numbers and carries into the integer part
+            s->speed = (double)(rand_u64() % 200);
+            s->confidence = 0.99996 + rand_range(0, 0.00004);
+            s->lat = 89.9999996;
+            break;
+        default:
+            break;
+    }
+}
+
+int main(int argc, char **argv) {
+    long iterations = 2000000;
+    long checks = 5000000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            checks = atol(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [-n iterations] [-c check_count]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (iterations <= 0) {
+        iterations = 1;
+    }
+
+    char buf[512];
+    sample_t s;
+    long mismatches = 0;
+    for (long i = 0; i < checks; i++) {
+        make_sample(&s, i);
+        char *ref = legacy_build(&s);
+        int n = fast_build(buf, sizeof(buf), &s);
+        if (ref == NULL || n < 0 || strcmp(ref, buf) != 0 || (size_t)n != strlen(ref)) {
+            if (mismatches++ < 5) {
+                fprintf(stderr, "mismatch:\n  printf: %s\n  fast:   %s\n", ref ? ref : "(null)", buf);
+            }
+        }
+        free(ref);
+    }
+    printf("verified %ld inputs, %ld mismatches\n", checks, mismatches);
+
+    // Same inputs for both timings
+    enum { SAMPLES = 4096 };
+    static sample_t samples[SAMPLES];
+    for (long i = 0; i < SAMPLES; i++) {
+        make_sample(&samples[i], i * 8);   // realistic values only
+    }
+
+    size_t sink = 0;
+    uint64_t start = monotonic_ns();
+    for (long i = 0; i < iterations; i++) {
+        char *json = legacy_build(&samples[i % SAMPLES]);
+        sink += (size_t)json[10];
+        free(json);
+    }
+    uint64_t legacy_ns = monotonic_ns() - start;
+
+    start = monotonic_ns();
+    for (long i = 0; i < iterations; i++) {
+        sink += (size_t)fast_build(buf, sizeof(buf), &samples[i % SAMPLES]);
+    }
+    uint64_t fast_ns = monotonic_ns() - start;
+
+    printf("%-22s %10.1f ns/msg  %10.0f msgs/s  1 alloc/msg\n", "snprintf x2 + malloc",
+           (double)legacy_ns / iterations, iterations / ((double)legacy_ns / 1e9));
+    printf("%-22s %10.1f ns/msg  %10.0f msgs/s  0 allocs/msg\n", "fixed-point builder",
+           (double)fast_ns / iterations, iterations / ((double)fast_ns / 1e9));
+    printf("speedup %.1fx (checksum %zu)\n", (double)legacy_ns / (double)fast_ns, sink);
+    return mismatches ? 1 : 0;
+}
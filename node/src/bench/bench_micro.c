@@ -0,0 +1,423 @@
+// Microbenchmarks for the node's per-message hot paths.
+//
+// Each case runs for at least --min-time after a calibration pass, and the
+// result is reported as ns/op, ops/sec and heap allocations per op. Allocations
+// are counted by interposing malloc/calloc/realloc, which needs glibc; elsewhere
+// allocs/op is reported as -1. Results go to stdout as a table and, with -o,
+// to a JSON-lines file that --compare can read back to flag regressions.
+//
+//   ./bench/bench_micro [-f filter] [--min-time ms] [-o results.jsonl]
+//                       [--compare baseline.jsonl] [--threshold pct] [--db path]
+//
+// Exit status is 2 when --compare finds a case slower than the threshold.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../jsonmsg.h"
+#include "../crypto.h"
+#include "../replay.h"
+#include "../ratelimit.h"
+#include "../db/db.h"
+#include "../timeutil.h"
+
+#define BENCH_NAME_MAX 96
+#define BENCH_MAX_RESULTS 64
+#define BENCH_DEFAULT_MIN_TIME_MS 300
+#define BENCH_DEFAULT_THRESHOLD_PCT 10.0
+#define BENCH_DB_COMMIT_EVERY 10000
+
+#if defined(__GLIBC__)
+#define BENCH_COUNTS_ALLOCS 1
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static volatile uint64_t g_allocs = 0;
+
+void *malloc(size_t size) {
+    __atomic_fetch_add(&g_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+    __atomic_fetch_add(&g_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    __atomic_fetch_add(&g_allocs, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(ptr, size);
+}
+
+static uint64_t alloc_count(void) {
+    return __atomic_load_n(&g_allocs, __ATOMIC_RELAXED);
+}
+#else
+#define BENCH_COUNTS_ALLOCS 0
+static uint64_t alloc_count(void) {
+    return 0;
+}
+#endif
+
+typedef void (*bench_op_fn)(void *arg, long i);
+
+typedef struct {
+    char name[BENCH_NAME_MAX];
+    long ops;
+    double ns_per_op;
+    double ops_per_sec;
+    double allocs_per_op;
+} bench_result_t;
+
+static bench_result_t g_results[BENCH_MAX_RESULTS];
+static int g_result_count = 0;
+static const char *g_filter = NULL;
+static uint64_t g_min_time_ns = BENCH_DEFAULT_MIN_TIME_MS * 1000000ull;
+static volatile size_t g_sink = 0;    // keeps results observable to the compiler
+
+static int selected(const char *name) {
+    return g_filter == NULL || strstr(name, g_filter) != NULL;
+}
+
+// Grows the batch until it runs for a tenth of the minimum time, then times a
+// batch sized to the minimum. Op indexes keep increasing across batches so
+// stateful cases (caches, tables) never see the same key twice.
+static void run_bench(const char *name, bench_op_fn op, void *arg) {
+    if (!selected(name) || g_result_count == BENCH_MAX_RESULTS) {
+        return;
+    }
+    long next_index = 0;
+    long batch = 1;
+    uint64_t elapsed = 0;
+    for (;;) {
+        uint64_t start = monotonic_ns();
+        for (long i = 0; i < batch; i++) {
+            op(arg, next_index + i);
+        }
+        elapsed = monotonic_ns() - start;
+        next_index += batch;
+        if (elapsed >= g_min_time_ns / 10 || batch >= (1L << 30)) {
+            break;
+        }
+        batch *= 2;
+    }
+    double per_op = (double)elapsed / (double)batch;
+    long ops = (long)((double)g_min_time_ns / (per_op > 1.0 ? per_op : 1.0));
+    if (ops < 1) {
+        ops = 1;
+    }
+
+    uint64_t allocs_before = alloc_count();
+    uint64_t start = monotonic_ns();
+    for (long i = 0; i < ops; i++) {
+        op(arg, next_index + i);
+    }
+    elapsed = monotonic_ns() - start;
+    uint64_t allocs = alloc_count() - allocs_before;
+
+    bench_result_t *r = &g_results[g_result_count++];
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->ops = ops;
+    r->ns_per_op = (double)elapsed / (double)ops;
+    r->ops_per_sec = r->ns_per_op > 0.0 ? 1e9 / r->ns_per_op : 0.0;
+    r->allocs_per_op = BENCH_COUNTS_ALLOCS ? (double)allocs / (double)ops : -1.0;
+    printf("%-44s %12.1f ns/op %14.0f ops/s %8.2f allocs/op\n",
+           r->name, r->ns_per_op, r->ops_per_sec, r->allocs_per_op);
+    fflush(stdout);
+}
+
+// ---- cases ----
+
+static char g_hazard_json[512];
+
+static void op_parse_json_fields(void *arg, long i) {
+    (void)arg;
+    (void)i;
+    char id[64];
+    uint64_t seq = 0;
+    g_sink += (size_t)parse_json_fields(g_hazard_json, id, &seq) + (size_t)seq;
+}
+
+static void op_parse_hazard_report(void *arg, long i) {
+    (void)arg;
+    (void)i;
+    hazard_report_t report;
+    g_sink += (size_t)parse_hazard_report(g_hazard_json, &report) + (size_t)report.seq;
+}
+
+static void op_build_json(void *arg, long i) {
+    (void)arg;
+    char *json = build_canonical_hazard_json("hazard_report", "veh_4f2a91", (uint64_t)i, 1700000000,
+                                             40.7128 + i * 1e-7, -74.0060, 65.5, 180.0,
+                                             "ice_patch", 0.95, 300);
+    g_sink += (size_t)json[1];
+    free(json);
+}
+
+static void op_format_json(void *arg, long i) {
+    (void)arg;
+    char buf[512];
+    g_sink += (size_t)format_canonical_hazard_json(buf, sizeof(buf), "hazard_report", "veh_4f2a91",
+                                                   (uint64_t)i, 1700000000, 40.7128 + i * 1e-7,
+                                                   -74.0060, 65.5, 180.0, "ice_patch", 0.95, 300);
+}
+
+typedef struct {
+    char (*ids)[32];
+    long senders;
+} sender_set_t;
+
+static int sender_set_init(sender_set_t *s, long senders) {
+    s->senders = senders;
+    s->ids = (char (*)[32])malloc((size_t)senders * sizeof(*s->ids));
+    if (!s->ids) {
+        return -1;
+    }
+    for (long i = 0; i < senders; i++) {
+        snprintf(s->ids[i], sizeof(s->ids[i]), "veh_%08lx", (unsigned long)(i * 2654435761u));
+    }
+    return 0;
+}
+
+static void op_replay(void *arg, long i) {
+    const sender_set_t *s = (const sender_set_t *)arg;
+    g_sink += (size_t)replay_cache_check_and_add(s->ids[i % s->senders], (uint64_t)(i / s->senders));
+}
+
+static void op_ratelimit(void *arg, long i) {
+    const sender_set_t *s = (const sender_set_t *)arg;
+    g_sink += (size_t)ratelimit_allow(s->ids[i % s->senders]);
+}
+
+// ECDSA signatures are ~72 bytes DER; a multiple of 3 avoids padding
+static unsigned char g_sig_bytes[72];
+static char *g_sig_b64 = NULL;
+
+static void op_base64_encode(void *arg, long i) {
+    (void)arg;
+    (void)i;
+    char *out = NULL;
+    base64_encode(g_sig_bytes, sizeof(g_sig_bytes), &out);
+    g_sink += (size_t)out[0];
+    free(out);
+}
+
+static void op_base64_decode(void *arg, long i) {
+    (void)arg;
+    (void)i;
+    unsigned char *out = NULL;
+    size_t len = 0;
+    base64_decode(g_sig_b64, &out, &len);
+    g_sink += len;
+    free(out);
+}
+
+static void op_sign(void *arg, long i) {
+    (void)arg;
+    (void)i;
+    unsigned char *sig = NULL;
+    size_t len = 0;
+    sign_message("node_priv.pem", g_hazard_json, &sig, &len);
+    g_sink += len;
+    free(sig);
+}
+
+static void op_verify(void *arg, long i) {
+    (void)arg;
+    (void)i;
+    g_sink += (size_t)verify_message("peer_pub.pem", g_hazard_json, g_sig_bytes, sizeof(g_sig_bytes));
+}
+
+static void op_db_insert(void *arg, long i) {
+    VerifiedAlert *a = (VerifiedAlert *)arg;
+    snprintf(a->alert_key, sizeof(a->alert_key), "debris@%ld", i);
+    a->latitude = 40.0 + (double)(i % 1000) * 0.001;
+    a->longitude = -74.0 - (double)(i / 1000 % 1000) * 0.001;
+    a->first_seen = 1700000000 + i;
+    a->verified_at = a->first_seen + 5;
+    g_sink += (size_t)db_insert_verified_alert(a);
+    if (i % BENCH_DB_COMMIT_EVERY == BENCH_DB_COMMIT_EVERY - 1) {
+        db_commit();
+        db_begin();
+    }
+}
+
+static void bench_sender_tables(void) {
+    static const long k_senders[] = { 10, 1000, 100000 };
+    char name[BENCH_NAME_MAX];
+    for (size_t k = 0; k < sizeof(k_senders) / sizeof(k_senders[0]); k++) {
+        sender_set_t set;
+        if (sender_set_init(&set, k_senders[k]) != 0) {
+            fprintf(stderr, "out of memory\n");
+            return;
+        }
+        snprintf(name, sizeof(name), "replay_cache_check_and_add/senders=%ld", set.senders);
+        if (selected(name)) {
+            replay_cache_init();
+            run_bench(name, op_replay, &set);
+            replay_cache_cleanup();
+        }
+        snprintf(name, sizeof(name), "ratelimit_allow/senders=%ld", set.senders);
+        if (selected(name)) {
+            ratelimit_init();
+            run_bench(name, op_ratelimit, &set);
+            ratelimit_cleanup();
+        }
+        free(set.ids);
+    }
+}
+
+static void bench_db_insert(const char *path) {
+    if (!selected("db_insert_verified_alert")) {
+        return;
+    }
+    remove(path);
+    if (db_init(path) != 0) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return;
+    }
+    db_set_verbose(0);
+    VerifiedAlert alert;
+    memset(&alert, 0, sizeof(alert));
+    strcpy(alert.hazard_type, "debris");
+    alert.confidence = 0.9;
+    alert.confirmations = 3;
+    strcpy(alert.confirmers_json, "[\"veh_a\",\"veh_b\",\"veh_c\"]");
+    snprintf(alert.raw_payload, sizeof(alert.raw_payload), "%s", g_hazard_json);
+
+    db_begin();
+    run_bench("db_insert_verified_alert", op_db_insert, &alert);
+    db_commit();
+    db_close();
+    remove(path);
+}
+
+// ---- output ----
+
+static int write_results(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return -1;
+    }
+    for (int i = 0; i < g_result_count; i++) {
+        const bench_result_t *r = &g_results[i];
+        fprintf(f, "{\"name\":\"%s\",\"ops\":%ld,\"ns_per_op\":%.2f,\"ops_per_sec\":%.1f,"
+                "\"allocs_per_op\":%.3f}\n",
+                r->name, r->ops, r->ns_per_op, r->ops_per_sec, r->allocs_per_op);
+    }
+    fclose(f);
+    return 0;
+}
+
+// Reads name and ns_per_op back from a file written by write_results()
+static int find_baseline(FILE *f, const char *name, double *ns_per_op) {
+    char line[512];
+    char key[BENCH_NAME_MAX + 16];
+    snprintf(key, sizeof(key), "{\"name\":\"%s\",", name);
+    rewind(f);
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, key, strlen(key)) != 0) {
+            continue;
+        }
+        const char *p = strstr(line, "\"ns_per_op\":");
+        if (p && sscanf(p + 12, "%lf", ns_per_op) == 1) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int compare_results(const char *path, double threshold_pct) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "cannot read baseline %s\n", path);
+        return -1;
+    }
+    int regressions = 0;
+    printf("\ncompared with %s (threshold %.0f%%):\n", path, threshold_pct);
+    for (int i = 0; i < g_result_count; i++) {
+        const bench_result_t *r = &g_results[i];
+        double base = 0.0;
+        if (!find_baseline(f, r->name, &base) || base <= 0.0) {
+            printf("  %-44s (no baseline)\n", r->name);
+            continue;
+        }
+        double delta = (r->ns_per_op - base) / base * 100.0;
+        int slower = delta > threshold_pct;
+        regressions += slower;
+        printf("  %-44s %12.1f -> %12.1f ns/op %+7.1f%%%s\n",
+               r->name, base, r->ns_per_op, delta, slower ? "  REGRESSION" : "");
+    }
+    fclose(f);
+    return regressions;
+}
+
+int main(int argc, char **argv) {
+    const char *out_path = NULL;
+    const char *baseline = NULL;
+    const char *db_path = "bench_micro.db";
+    double threshold = BENCH_DEFAULT_THRESHOLD_PCT;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            g_filter = argv[++i];
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            g_min_time_ns = (uint64_t)atol(argv[++i]) * 1000000ull;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--db") == 0 && i + 1 < argc) {
+            db_path = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [-f filter] [--min-time ms] [-o results.jsonl]\n"
+                    "          [--compare baseline.jsonl] [--threshold pct] [--db path]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (g_min_time_ns == 0) {
+        g_min_time_ns = 1000000ull;
+    }
+
+    format_canonical_hazard_json(g_hazard_json, sizeof(g_hazard_json), "hazard_report", "veh_4f2a91",
+                                 1234567, 1700000000, 40.7128, -74.0060, 65.5, 180.0,
+                                 "ice_patch", 0.95, 300);
+    for (size_t i = 0; i < sizeof(g_sig_bytes); i++) {
+        g_sig_bytes[i] = (unsigned char)(i * 37 + 11);
+    }
+    if (base64_encode(g_sig_bytes, sizeof(g_sig_bytes), &g_sig_b64) != 0) {
+        fprintf(stderr, "base64_encode failed\n");
+        return 1;
+    }
+
+    run_bench("parse_json_fields", op_parse_json_fields, NULL);
+    run_bench("parse_hazard_report", op_parse_hazard_report, NULL);
+    run_bench("build_canonical_hazard_json", op_build_json, NULL);
+    run_bench("format_canonical_hazard_json", op_format_json, NULL);
+    bench_sender_tables();
+    run_bench("base64_encode/72B", op_base64_encode, NULL);
+    run_bench("base64_decode/72B", op_base64_decode, NULL);
+    run_bench("sign_message", op_sign, NULL);
+    run_bench("verify_message", op_verify, NULL);
+    bench_db_insert(db_path);
+    free(g_sig_b64);
+
+    if (out_path && write_results(out_path) != 0) {
+        return 1;
+    }
+    if (baseline) {
+        int regressions = compare_results(baseline, threshold);
+        if (regressions < 0) {
+            return 1;
+        }
+        if (regressions > 0) {
+            printf("%d regression(s)\n", regressions);
+            return 2;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "bundle.h"
+#include <string.h>
+
+static void put_u16(uint8_t *p, size_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static size_t get_u16(const uint8_t *p) {
+    return ((size_t)p[0] << 8) | p[1];
+}
+
+void bundle_writer_init(bundle_writer_t *w, void *buf, size_t cap) {
+    w->buf = (uint8_t *)buf;
+    w->cap = cap;
+    w->len = BUNDLE_HEADER_SIZE;
+    w->count = 0;
+}
+
+int bundle_writer_fits(const bundle_writer_t *w, size_t len) {
+    return len <= 0xFFFF && w->count < 0xFFFF &&
+           w->len + BUNDLE_RECORD_OVERHEAD + len <= w->cap;
+}
+
+int bundle_writer_add(bundle_writer_t *w, const void *msg, size_t len) {
+    if (!bundle_writer_fits(w, len)) {
+        return -1;
+    }
+    put_u16(w->buf + w->len, len);
+    memcpy(w->buf + w->len + BUNDLE_RECORD_OVERHEAD, msg, len);
+    w->len += BUNDLE_RECORD_OVERHEAD + len;
+    w->count++;
+    return 0;
+}
+
+size_t bundle_writer_finish(bundle_writer_t *w) {
+    if (w->count == 0) {
+        return 0;
+    }
+    w->buf[0] = BUNDLE_MAGIC;
+    w->buf[1] = BUNDLE_VERSION;
+    put_u16(w->buf + 2, w->count);
+    return w->len;
+}
+
+int bundle_is_bundle(const void *buf, size_t len) {
+    return buf && len >= BUNDLE_HEADER_SIZE && ((const uint8_t *)buf)[0] == BUNDLE_MAGIC;
+}
+
+int bundle_reader_init(bundle_reader_t *r, const void *buf, size_t len) {
+    const uint8_t *p = (const uint8_t *)buf;
+    if (!bundle_is_bundle(buf, len) || p[1] != BUNDLE_VERSION) {
+        return -1;
+    }
+    r->pos = p + BUNDLE_HEADER_SIZE;
+    r->end = p + len;
+    r->remaining = (unsigned)get_u16(p + 2);
+    return 0;
+}
+
+int bundle_next(bundle_reader_t *r, const char **msg, size_t *len) {
+    if (r->remaining == 0) {
+        return 0;
+    }
+    if ((size_t)(r->end - r->pos) < BUNDLE_RECORD_OVERHEAD) {
+        r->remaining = 0;
+        return -1;
+    }
+    size_t n = get_u16(r->pos);
+    if ((size_t)(r->end - r->pos) - BUNDLE_RECORD_OVERHEAD < n) {
+        r->remaining = 0;
+        return -1;
+    }
+    *msg = (const char *)(r->pos + BUNDLE_RECORD_OVERHEAD);
+    *len = n;
+    r->pos += BUNDLE_RECORD_OVERHEAD + n;
+    r->remaining--;
+    return 1;
+}
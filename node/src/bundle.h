@@ -0,0 +1,73 @@
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Message bundles: several signed messages in one UDP datagram.
+//
+// A bundle is a 4-byte header followed by length-prefixed records:
+//
+//   0xB5 | version (1) | record count (u16, big endian)
+//   { length (u16, big endian) | message bytes } * count
+//
+// The first byte can never start a JSON message, so a receiver tells a bundle
+// from a plain single-message datagram by looking at it. Senders fall back to
+// a plain datagram when only one message is ready, so nodes without bundling
+// still understand everything that carries a single report.
+//
+// Reading is zero-copy: bundle_next() returns pointers into the received
+// buffer. Records are not NUL-terminated.
+
+#define BUNDLE_MAGIC 0xB5
+#define BUNDLE_VERSION 1
+#define BUNDLE_HEADER_SIZE 4
+#define BUNDLE_RECORD_OVERHEAD 2
+#define BUNDLE_DEFAULT_MTU 1400       // fits a 1500-byte Ethernet MTU with IP/UDP headers
+#define BUNDLE_MIN_MTU 256
+
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    unsigned count;
+} bundle_writer_t;
+
+typedef struct {
+    const uint8_t *pos;
+    const uint8_t *end;
+    unsigned remaining;
+} bundle_reader_t;
+
+void bundle_writer_init(bundle_writer_t *w, void *buf, size_t cap);
+
+// Nonzero if a message of len bytes still fits
+int bundle_writer_fits(const bundle_writer_t *w, size_t len);
+
+/**
+ * Append one message.
+ * @return 0 on success, -1 if it does not fit
+ */
+int bundle_writer_add(bundle_writer_t *w, const void *msg, size_t len);
+
+/**
+ * Write the header and return the datagram length (0 if empty).
+ */
+size_t bundle_writer_finish(bundle_writer_t *w);
+
+// Nonzero if the datagram is a bundle rather than a plain message
+int bundle_is_bundle(const void *buf, size_t len);
+
+/**
+ * Start reading a bundle.
+ * @return 0 on success, -1 if buf is not a well-formed bundle header
+ */
+int bundle_reader_init(bundle_reader_t *r, const void *buf, size_t len);
+
+/**
+ * Next record as a view into the datagram.
+ * @return 1 if a record was returned, 0 at the end, -1 if the bundle is truncated
+ */
+int bundle_next(bundle_reader_t *r, const char **msg, size_t *len);
+
+#endif // BUNDLE_H
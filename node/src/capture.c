@@ -0,0 +1,172 @@
+#include "capture.h"
+#include "timeutil.h"
+#include <stdio.h>
+#include <string.h>
+
+#define CAPTURE_FILE_BUFFER (256 * 1024)
+
+typedef struct {
+    FILE *out;
+    char path[512];
+    uint64_t start_ns;
+    capture_stats_t stats;
+} capture_t;
+
+static capture_t g_cap;
+
+static void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void put_u64(uint8_t *p, uint64_t v) {
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+static uint64_t get_u64(const uint8_t *p) {
+    return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+// ---------------------------------------------------------------------------
+// Writer
+
+int capture_open(const char *path) {
+    if (g_cap.out) {
+        return -1;
+    }
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "capture: cannot open %s\n", path);
+        return -1;
+    }
+    setvbuf(f, NULL, _IOFBF, CAPTURE_FILE_BUFFER);
+
+    uint8_t hdr[CAPTURE_HEADER_SIZE];
+    memcpy(hdr, CAPTURE_MAGIC, 8);
+    put_u64(hdr + 8, (uint64_t)wallclock_us());
+    if (fwrite(hdr, 1, sizeof(hdr), f) != sizeof(hdr)) {
+        fprintf(stderr, "capture: cannot write header to %s\n", path);
+        fclose(f);
+        return -1;
+    }
+
+    memset(&g_cap, 0, sizeof(g_cap));
+    g_cap.out = f;
+    g_cap.start_ns = monotonic_ns();
+    strncpy(g_cap.path, path, sizeof(g_cap.path) - 1);
+    return 0;
+}
+
+void capture_close(void) {
+    if (!g_cap.out) {
+        return;
+    }
+    if (fclose(g_cap.out) != 0) {
+        g_cap.stats.errors++;
+    }
+    g_cap.out = NULL;
+}
+
+int capture_is_open(void) {
+    return g_cap.out != NULL;
+}
+
+int capture_write(const void *data, size_t len, const struct sockaddr_in *src) {
+    if (!g_cap.out || len > CAPTURE_MAX_DATAGRAM) {
+        return -1;
+    }
+    uint8_t hdr[CAPTURE_RECORD_SIZE];
+    put_u64(hdr, monotonic_ns() - g_cap.start_ns);
+    // Address bytes are stored as they sit in memory (network order)
+    if (src) {
+        memcpy(hdr + 8, &src->sin_addr.s_addr, 4);
+        memcpy(hdr + 12, &src->sin_port, 2);
+    } else {
+        memset(hdr + 8, 0, 6);
+    }
+    put_u16(hdr + 14, (uint16_t)len);
+    if (fwrite(hdr, 1, sizeof(hdr), g_cap.out) != sizeof(hdr) ||
+        fwrite(data, 1, len, g_cap.out) != len) {
+        g_cap.stats.errors++;
+        return -1;
+    }
+    g_cap.stats.datagrams++;
+    g_cap.stats.bytes += sizeof(hdr) + len;
+    return 0;
+}
+
+void capture_get_stats(capture_stats_t *out) {
+    *out = g_cap.stats;
+}
+
+void capture_print_stats(void) {
+    printf("Capture: %llu datagrams (%llu bytes) written to %s, %llu errors\n",
+           (unsigned long long)g_cap.stats.datagrams, (unsigned long long)g_cap.stats.bytes,
+           g_cap.path, (unsigned long long)g_cap.stats.errors);
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+
+int capture_reader_open(capture_reader_t *r, const char *path) {
+    memset(r, 0, sizeof(*r));
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "capture: cannot open %s\n", path);
+        return -1;
+    }
+    uint8_t hdr[CAPTURE_HEADER_SIZE];
+    if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr) || memcmp(hdr, CAPTURE_MAGIC, 8) != 0) {
+        fprintf(stderr, "capture: %s is not a capture file\n", path);
+        fclose(f);
+        return -1;
+    }
+    r->file = f;
+    r->start_us = (int64_t)get_u64(hdr + 8);
+    return 0;
+}
+
+int capture_reader_next(capture_reader_t *r, capture_record_t *rec) {
+    FILE *f = (FILE *)r->file;
+    uint8_t hdr[CAPTURE_RECORD_SIZE];
+    size_t n = fread(hdr, 1, sizeof(hdr), f);
+    if (n != sizeof(hdr)) {
+        return ferror(f) ? -1 : 0;
+    }
+    rec->t_ns = get_u64(hdr);
+    memcpy(&rec->src_ip, hdr + 8, 4);
+    memcpy(&rec->src_port, hdr + 12, 2);
+    rec->len = get_u16(hdr + 14);
+    if (fread(r->buf, 1, rec->len, f) != rec->len) {
+        return ferror(f) ? -1 : 0;   // torn final record
+    }
+    rec->data = r->buf;
+    r->records++;
+    return 1;
+}
+
+int capture_reader_rewind(capture_reader_t *r) {
+    r->records = 0;
+    return fseek((FILE *)r->file, CAPTURE_HEADER_SIZE, SEEK_SET);
+}
+
+void capture_reader_close(capture_reader_t *r) {
+    if (r->file) {
+        fclose((FILE *)r->file);
+        r->file = NULL;
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "net.h"
+
+// Datagram capture files
+//
+// The node can record every datagram it receives, before bundle splitting or
+// any checks, so a burst seen in the field can be replayed against another
+// build (tools/capreplay). The writer is called only from the receive thread
+// and appends to a buffered file, so recording costs a memcpy per datagram.
+//
+// File layout, all integers little-endian:
+//   header   char   magic[8]     "V2VCAP01"
+//            int64  start_us     wall clock when the capture started
+//   records  uint64 t_ns         receive time, relative to start
+//            uint32 src_ip       network byte order, as in sockaddr_in
+//            uint16 src_port     network byte order
+//            uint16 len
+//            uint8  data[len]
+// A record cut short by a crash ends the file; readers stop there.
+
+#define CAPTURE_MAGIC "V2VCAP01"
+#define CAPTURE_HEADER_SIZE 16
+#define CAPTURE_RECORD_SIZE 16
+#define CAPTURE_MAX_DATAGRAM 65535
+
+typedef struct {
+    uint64_t datagrams;
+    uint64_t bytes;
+    uint64_t errors;
+} capture_stats_t;
+
+// One decoded record; data points into the reader's buffer
+typedef struct {
+    uint64_t t_ns;
+    uint32_t src_ip;
+    uint16_t src_port;
+    uint16_t len;
+    const uint8_t *data;
+} capture_record_t;
+
+typedef struct {
+    void *file;
+    int64_t start_us;
+    uint64_t records;
+    uint8_t buf[CAPTURE_MAX_DATAGRAM];
+} capture_reader_t;
+
+// Writer (one per process)
+
+/**
+ * Create or truncate a capture file and write its header.
+ * @return 0 on success, -1 on error
+ */
+int capture_open(const char *path);
+
+// Flush and close; safe to call when no capture is open
+void capture_close(void);
+int capture_is_open(void);
+
+/**
+ * Append one received datagram. Receive thread only.
+ * @param src Source address, or NULL
+ * @return 0 on success, -1 on error
+ */
+int capture_write(const void *data, size_t len, const struct sockaddr_in *src);
+
+void capture_get_stats(capture_stats_t *out);
+void capture_print_stats(void);
+
+// Reader
+
+/**
+ * Open a capture file and check its header.
+ * @return 0 on success, -1 on error
+ */
+int capture_reader_open(capture_reader_t *r, const char *path);
+
+/**
+ * Read the next record; rec->data stays valid until the next call.
+ * @return 1 if a record was read, 0 at the end of the file, -1 on error
+ */
+int capture_reader_next(capture_reader_t *r, capture_record_t *rec);
+
+// Seek back to the first record
+int capture_reader_rewind(capture_reader_t *r);
+
+void capture_reader_close(capture_reader_t *r);
+
+#endif // CAPTURE_H
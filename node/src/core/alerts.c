@@ -0,0 +1,468 @@
+/**
+ * In-memory alert table
+ * Hazard reports are aggregated per alert_key (hazard_type + rounded
+ * location) and promoted to VERIFIED once enough distinct nodes confirm them.
+ * Alerts live in a fixed-capacity slab pool so memory stays bounded.
+ */
+
+#include "alerts.h"
+#include "alerts_integration.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Global alerts map
+alerts_map_t g_alerts_map = {0};
+
+SLAB_POOL_DECLARE(alert, Alert)
+
+static void alerts_lock(alerts_map_t *map) {
+#ifdef _WIN32
+    EnterCriticalSection((CRITICAL_SECTION *)map->mutex);
+#else
+    pthread_mutex_lock(&map->mutex);
+#endif
+}
+
+static void alerts_unlock(alerts_map_t *map) {
+#ifdef _WIN32
+    LeaveCriticalSection((CRITICAL_SECTION *)map->mutex);
+#else
+    pthread_mutex_unlock(&map->mutex);
+#endif
+}
+
+/**
+ * FNV-1a hash of the alert key
+ */
+static size_t alert_bucket(const alerts_map_t *map, const char *key) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h % map->bucket_count;
+}
+
+static void lru_unlink(alerts_map_t *map, Alert *alert) {
+    if (alert->lru_prev != NULL) {
+        alert->lru_prev->lru_next = alert->lru_next;
+    } else {
+        map->lru_head = alert->lru_next;
+    }
+
+    if (alert->lru_next != NULL) {
+        alert->lru_next->lru_prev = alert->lru_prev;
+    } else {
+        map->lru_tail = alert->lru_prev;
+    }
+
+    alert->lru_prev = NULL;
+    alert->lru_next = NULL;
+}
+
+static void lru_push_front(alerts_map_t *map, Alert *alert) {
+    alert->lru_prev = NULL;
+    alert->lru_next = map->lru_head;
+
+    if (map->lru_head != NULL) {
+        map->lru_head->lru_prev = alert;
+    } else {
+        map->lru_tail = alert;
+    }
+
+    map->lru_head = alert;
+}
+
+static Alert *alert_find(const alerts_map_t *map, const char *key, size_t bucket) {
+    for (Alert *a = map->buckets[bucket]; a != NULL; a = a->next) {
+        if (strcmp(a->alert_key, key) == 0) {
+            return a;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Unlink an alert from its bucket and the recency list, and return its slot
+ */
+static void alert_remove(alerts_map_t *map, Alert *alert) {
+    Alert **link = &map->buckets[alert_bucket(map, alert->alert_key)];
+    while (*link != NULL && *link != alert) {
+        link = &(*link)->next;
+    }
+    if (*link == alert) {
+        *link = alert->next;
+    }
+
+    lru_unlink(map, alert);
+    map->count--;
+    alert_pool_free(&map->pool, alert);
+}
+
+static int alert_has_confirmer(const Alert *alert, const char *ephemeral_id) {
+    int n = alert->confirmations < CONFIRMERS_MAX ? alert->confirmations : CONFIRMERS_MAX;
+    for (int i = 0; i < n; i++) {
+        if (strcmp(alert->confirmers[i], ephemeral_id) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Mark an alert VERIFIED once it has enough confirmations
+ * @return 1 if the alert was promoted by this call
+ */
+static int alert_promote(alerts_map_t *map, Alert *alert) {
+    // Confirmers learnt by sync are unsigned claims of a peer; at least one
+    // report must have been verified here before they can count
+    if (alert == NULL || strcmp(alert->status, "VERIFIED") == 0 || !alert->heard_locally ||
+        alert->confirmations < ALERT_VERIFICATION_THRESHOLD) {
+        return 0;
+    }
+    strcpy(alert->status, "VERIFIED");
+    if (map->on_verified != NULL) {
+        map->on_verified(alert);
+    }
+    return 1;
+}
+
+int alerts_map_init_instance(alerts_map_t *map, size_t capacity, size_t bucket_count) {
+    memset(map, 0, sizeof(*map));
+    map->bucket_count = bucket_count;
+    map->buckets = (Alert **)calloc(bucket_count, sizeof(Alert *));
+    if (!map->buckets) {
+        return -1;
+    }
+    map->evict_policy = POOL_EVICT_OLDEST;
+
+    if (slab_pool_init(&map->pool, "alerts", sizeof(Alert), capacity) != 0) {
+        free(map->buckets);
+        map->buckets = NULL;
+        return -1;
+    }
+
+#ifdef _WIN32
+    map->mutex = malloc(sizeof(CRITICAL_SECTION));
+    if (!map->mutex) {
+        slab_pool_destroy(&map->pool);
+        free(map->buckets);
+        map->buckets = NULL;
+        return -1;
+    }
+    InitializeCriticalSection((CRITICAL_SECTION *)map->mutex);
+#else
+    if (pthread_mutex_init(&map->mutex, NULL) != 0) {
+        slab_pool_destroy(&map->pool);
+        free(map->buckets);
+        map->buckets = NULL;
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+void alerts_map_destroy_instance(alerts_map_t *map) {
+    slab_pool_destroy(&map->pool);
+    free(map->buckets);
+    map->buckets = NULL;
+    map->lru_head = NULL;
+    map->lru_tail = NULL;
+    map->count = 0;
+
+#ifdef _WIN32
+    DeleteCriticalSection((CRITICAL_SECTION *)map->mutex);
+    free(map->mutex);
+    map->mutex = NULL;
+#else
+    pthread_mutex_destroy(&map->mutex);
+#endif
+}
+
+int alerts_map_add_at(alerts_map_t *map, const char *ephemeral_id, const char *hazard_type,
+                      double lat, double lon, double confidence, time_t now) {
+    if (ephemeral_id == NULL || hazard_type == NULL) {
+        return 0;
+    }
+
+    char key[ALERT_KEY_MAX];
+    snprintf(key, sizeof(key), "%s@%.4f,%.4f", hazard_type, lat, lon);
+
+    alerts_lock(map);
+
+    size_t bucket = alert_bucket(map, key);
+    Alert *alert = alert_find(map, key, bucket);
+
+    if (alert == NULL) {
+        // Reclaim the least recently seen alert if the pool is exhausted
+        if (slab_pool_full(&map->pool) &&
+            map->evict_policy == POOL_EVICT_OLDEST &&
+            map->lru_tail != NULL) {
+            alert_remove(map, map->lru_tail);
+            slab_pool_note_eviction(&map->pool);
+        }
+
+        alert = alert_pool_alloc(&map->pool);
+        if (alert == NULL) {
+            alerts_unlock(map);
+            return 0;
+        }
+
+        memcpy(alert->alert_key, key, sizeof(alert->alert_key));
+        strncpy(alert->hazard_type, hazard_type, sizeof(alert->hazard_type) - 1);
+        alert->latitude = lat;
+        alert->longitude = lon;
+        alert->first_seen = now;
+        strcpy(alert->status, "TENTATIVE");
+
+        alert->next = map->buckets[bucket];
+        map->buckets[bucket] = alert;
+        map->count++;
+    } else {
+        lru_unlink(map, alert);
+    }
+
+    lru_push_front(map, alert);
+    alert->last_seen = now;
+    alert->heard_locally = 1;
+
+    // Each distinct node counts once; confidence is the mean of its confirmers
+    if (!alert_has_confirmer(alert, ephemeral_id)) {
+        if (alert->confirmations < CONFIRMERS_MAX) {
+            strncpy(alert->confirmers[alert->confirmations], ephemeral_id,
+                    CONFIRMER_ID_MAX - 1);
+        }
+        alert->confirmations++;
+        alert->confidence += (confidence - alert->confidence) / alert->confirmations;
+    }
+    // Also when the reporter was already listed by a sync record
+    int promoted = alert_promote(map, alert);
+
+    alerts_unlock(map);
+    return promoted;
+}
+
+int alerts_map_expire_at(alerts_map_t *map, time_t now) {
+    int removed = 0;
+
+    alerts_lock(map);
+
+    // The recency list puts the stalest alerts at the tail
+    while (map->lru_tail != NULL && now - map->lru_tail->last_seen > ALERT_TTL) {
+        Alert *alert = map->lru_tail;
+        if (map->on_expired != NULL) {
+            map->on_expired(alert);
+        }
+        alert_remove(map, alert);
+        removed++;
+    }
+
+    alerts_unlock(map);
+    return removed;
+}
+
+void alerts_map_foreach_live(alerts_map_t *map, time_t now, alert_visit_fn fn, void *arg) {
+    alerts_lock(map);
+    for (Alert *a = map->lru_head; a != NULL; a = a->lru_next) {
+        if (now - a->last_seen <= ALERT_TTL) {
+            fn(a, arg);
+        }
+    }
+    alerts_unlock(map);
+}
+
+static uint64_t hash64(const char *s, uint64_t h) {
+    for (const unsigned char *p = (const unsigned char *)s; *p; p++) {
+        h = (h ^ *p) * 1099511628211ull;
+    }
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    return h ^ (h >> 32);
+}
+
+uint64_t alert_fingerprint(const Alert *alert) {
+    uint64_t fp = hash64(alert->alert_key, 1469598103934665603ull);
+    if (alert->confirmations >= ALERT_VERIFICATION_THRESHOLD) {
+        // Who confirmed no longer changes anything. Not keyed on status,
+        // which also depends on whether this node heard the hazard itself
+        return fp ^ 0x5645524946494544ull;
+    }
+    int n = alert->confirmations < CONFIRMERS_MAX ? alert->confirmations : CONFIRMERS_MAX;
+    for (int i = 0; i < n; i++) {
+        fp ^= hash64(alert->confirmers[i], 0x84222325CBF29CE4ull);
+    }
+    return fp;
+}
+
+/**
+ * Keep the recency list ordered by last_seen for a merged alert, whose
+ * last_seen may be older than alerts already at the front
+ */
+static void lru_insert_by_last_seen(alerts_map_t *map, Alert *alert) {
+    Alert *after = NULL;
+    for (Alert *a = map->lru_head; a != NULL && a->last_seen > alert->last_seen; a = a->lru_next) {
+        after = a;
+    }
+    if (after == NULL) {
+        lru_push_front(map, alert);
+        return;
+    }
+    alert->lru_prev = after;
+    alert->lru_next = after->lru_next;
+    if (after->lru_next != NULL) {
+        after->lru_next->lru_prev = alert;
+    } else {
+        map->lru_tail = alert;
+    }
+    after->lru_next = alert;
+}
+
+int alerts_map_merge_at(alerts_map_t *map, const Alert *remote, time_t now) {
+    if (remote == NULL || remote->alert_key[0] == '\0' || now - remote->last_seen > ALERT_TTL) {
+        return -1;
+    }
+    // A peer's clock may not run ahead of ours, or its alerts would never expire
+    time_t last_seen = remote->last_seen < now ? remote->last_seen : now;
+    time_t first_seen = remote->first_seen < last_seen ? remote->first_seen : last_seen;
+
+    alerts_lock(map);
+
+    size_t bucket = alert_bucket(map, remote->alert_key);
+    Alert *alert = alert_find(map, remote->alert_key, bucket);
+    int changed = 0;
+
+    if (alert == NULL) {
+        if (slab_pool_full(&map->pool) &&
+            map->evict_policy == POOL_EVICT_OLDEST &&
+            map->lru_tail != NULL &&
+            map->lru_tail->last_seen < last_seen) {
+            alert_remove(map, map->lru_tail);
+            slab_pool_note_eviction(&map->pool);
+        }
+        alert = alert_pool_alloc(&map->pool);
+        if (alert == NULL) {
+            alerts_unlock(map);
+            return -1;
+        }
+        memcpy(alert->alert_key, remote->alert_key, sizeof(alert->alert_key));
+        alert->alert_key[ALERT_KEY_MAX - 1] = '\0';
+        memcpy(alert->hazard_type, remote->hazard_type, sizeof(alert->hazard_type));
+        alert->hazard_type[HAZARD_TYPE_MAX - 1] = '\0';
+        alert->latitude = remote->latitude;
+        alert->longitude = remote->longitude;
+        alert->confidence = remote->confidence;
+        alert->first_seen = first_seen;
+        alert->last_seen = last_seen;
+        strcpy(alert->status, "TENTATIVE");
+
+        alert->next = map->buckets[bucket];
+        map->buckets[bucket] = alert;
+        map->count++;
+        lru_insert_by_last_seen(map, alert);
+        changed = 1;
+    } else if (last_seen > alert->last_seen) {
+        lru_unlink(map, alert);
+        alert->last_seen = last_seen;
+        lru_insert_by_last_seen(map, alert);
+    }
+    if (first_seen < alert->first_seen) {
+        alert->first_seen = first_seen;
+    }
+
+    // Unite the confirmer sets; only listed ids count, so a peer cannot
+    // claim confirmations without naming them. Confidence stays the mean.
+    // A record adds at most ALERT_MERGE_NEW_CONFIRMERS_MAX new ids; the
+    // rest arrive with later syncs while the buckets still differ.
+    int added = 0;
+    for (int i = 0; i < CONFIRMERS_MAX; i++) {
+        if (remote->confirmers[i][0] == '\0' || alert_has_confirmer(alert, remote->confirmers[i])) {
+            continue;
+        }
+        if (alert->confirmations >= CONFIRMERS_MAX) {
+            break;      // unlisted ids could not be told apart on the next merge
+        }
+        if (added == ALERT_MERGE_NEW_CONFIRMERS_MAX) {
+            break;
+        }
+        added++;
+        strncpy(alert->confirmers[alert->confirmations], remote->confirmers[i],
+                CONFIRMER_ID_MAX - 1);
+        alert->confirmations++;
+        alert->confidence += (remote->confidence - alert->confidence) / alert->confirmations;
+        changed = 1;
+    }
+
+    // Status is derived here from the confirmers we hold, never copied, and
+    // alert_promote() leaves alerts known only from sync TENTATIVE
+    if (alert_promote(map, alert)) {
+        changed = 1;
+    }
+
+    alerts_unlock(map);
+    return changed;
+}
+
+void alerts_map_init(void) {
+    if (alerts_map_init_instance(&g_alerts_map, ALERTS_CAPACITY, ALERTS_BUCKET_COUNT) != 0) {
+        fprintf(stderr, "Failed to initialize alerts map\n");
+        exit(1);
+    }
+    g_alerts_map.on_verified = persist_verified_alert;
+    g_alerts_map.on_expired = log_alert_expired;
+
+    printf("Alerts map initialized (capacity %d alerts)\n", ALERTS_CAPACITY);
+}
+
+void alerts_map_cleanup(void) {
+    alerts_lock(&g_alerts_map);
+    slab_pool_print_stats(&g_alerts_map.pool);
+    alerts_unlock(&g_alerts_map);
+    alerts_map_destroy_instance(&g_alerts_map);
+
+    printf("Alerts map cleaned up\n");
+}
+
+void add_or_update_alert(const char *ephemeral_id, const char *hazard_type,
+                         double lat, double lon, double confidence) {
+    alerts_map_add_at(&g_alerts_map, ephemeral_id, hazard_type, lat, lon, confidence, time(NULL));
+}
+
+void promote_alert_if_threshold(Alert *alert) {
+    alert_promote(&g_alerts_map, alert);
+}
+
+void expire_old_alerts(void) {
+    alerts_map_expire_at(&g_alerts_map, time(NULL));
+}
+
+void print_alerts(void) {
+    alerts_lock(&g_alerts_map);
+
+    printf("Active alerts: %zu\n", g_alerts_map.count);
+    for (Alert *a = g_alerts_map.lru_head; a != NULL; a = a->lru_next) {
+        printf("  %-40s %-9s conf=%.2f confirmations=%d\n",
+               a->alert_key, a->status, a->confidence, a->confirmations);
+    }
+
+    alerts_unlock(&g_alerts_map);
+}
+
+void alerts_set_evict_policy(pool_evict_policy_t policy) {
+    alerts_lock(&g_alerts_map);
+    g_alerts_map.evict_policy = policy;
+    alerts_unlock(&g_alerts_map);
+}
+
+void alerts_get_pool_stats(slab_pool_stats_t *out) {
+    if (out == NULL) {
+        return;
+    }
+    alerts_lock(&g_alerts_map);
+    slab_pool_get_stats(&g_alerts_map.pool, out);
+    alerts_unlock(&g_alerts_map);
+}
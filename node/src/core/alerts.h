@@ -1,7 +1,12 @@
 #ifndef ALERTS_H
 #define ALERTS_H
 
+#include <stdint.h>
 #include <time.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+#include "../pool.h"
 
 #define ALERT_KEY_MAX 128
 #define HAZARD_TYPE_MAX 32
@@ -10,6 +15,11 @@
 #define ALERT_STATUS_MAX 16
 #define ALERT_TTL 600  // seconds
 #define ALERT_VERIFICATION_THRESHOLD 2  // require 2 confirmations to verify
+#define ALERT_MERGE_NEW_CONFIRMERS_MAX 2  // confirmer ids one merged record may add
+#define ALERTS_BUCKET_COUNT 1024
+#ifndef ALERTS_CAPACITY
+#define ALERTS_CAPACITY 4096            // max live alerts held in memory
+#endif
 
 typedef struct Alert {
     char alert_key[ALERT_KEY_MAX];      // rounded lat/lon + hazard_type
@@ -22,13 +32,23 @@ typedef struct Alert {
     int confirmations;                  // unique valid nodes confirming this
     char confirmers[CONFIRMERS_MAX][CONFIRMER_ID_MAX]; // ephemeral IDs
     char status[ALERT_STATUS_MAX];      // "TENTATIVE" or "VERIFIED"
+    int heard_locally;                  // a signed report for it arrived here, not only via sync
     struct Alert *next;                 // hash collision chain
+    struct Alert *lru_prev;             // recency list, most recently seen first
+    struct Alert *lru_next;
 } Alert;
 
 // Hash map for alerts (keyed by alert_key)
 typedef struct {
     Alert **buckets;
     size_t bucket_count;
+    Alert *lru_head;
+    Alert *lru_tail;
+    size_t count;
+    slab_pool_t pool;
+    pool_evict_policy_t evict_policy;
+    void (*on_verified)(const Alert *alert);   // called under the lock; NULL for none
+    void (*on_expired)(const Alert *alert);
 #ifdef _WIN32
     void *mutex;  // CRITICAL_SECTION
 #else
@@ -39,7 +59,8 @@ typedef struct {
 // Global alerts map
 extern alerts_map_t g_alerts_map;
 
-// Function declarations
+// Function declarations for the node's global map, which persists verified
+// alerts and logs expiries through alerts_integration.h
 void alerts_map_init(void);
 void alerts_map_cleanup(void);
 void add_or_update_alert(const char *ephemeral_id, const char *hazard_type,
@@ -47,6 +68,61 @@ void add_or_update_alert(const char *ephemeral_id, const char *hazard_type,
 void promote_alert_if_threshold(Alert *alert);
 void expire_old_alerts(void);
 void print_alerts(void);
+void alerts_set_evict_policy(pool_evict_policy_t policy);
+void alerts_get_pool_stats(slab_pool_stats_t *out);
+
+// Separate maps with their own capacity, hooks and a caller-supplied clock,
+// e.g. one per virtual node in the mesh simulator. Hooks start out NULL.
+
+/**
+ * @param capacity Maximum live alerts
+ * @param bucket_count Hash buckets
+ * @return 0 on success, -1 on error
+ */
+int alerts_map_init_instance(alerts_map_t *map, size_t capacity, size_t bucket_count);
+void alerts_map_destroy_instance(alerts_map_t *map);
+
+/**
+ * Record one report of a hazard.
+ * @param now Current time in seconds
+ * @return 1 if this report promoted the alert to VERIFIED, 0 otherwise
+ */
+int alerts_map_add_at(alerts_map_t *map, const char *ephemeral_id, const char *hazard_type,
+                      double lat, double lon, double confidence, time_t now);
+
+/**
+ * Drop alerts not seen for ALERT_TTL seconds.
+ * @return Number of alerts removed
+ */
+int alerts_map_expire_at(alerts_map_t *map, time_t now);
+
+// Called under the map's lock; must not call back into the map
+typedef void (*alert_visit_fn)(const Alert *alert, void *arg);
+
+// Visit every alert still live at now (not older than ALERT_TTL)
+void alerts_map_foreach_live(alerts_map_t *map, time_t now, alert_visit_fn fn, void *arg);
+
+/**
+ * Fingerprint of the state that matters for agreement between nodes: the
+ * key, and below the verification threshold the set of confirmers. Equal
+ * on two nodes once they hold the same evidence, whatever order it arrived
+ * in, and whether or not either node has promoted the alert.
+ */
+uint64_t alert_fingerprint(const Alert *alert);
+
+/**
+ * Merge an alert received from another node (state sync). Confirmer sets
+ * are united and the later last_seen kept, so merges in any order converge.
+ * remote needs alert_key, hazard_type, position, confidence, times and
+ * confirmers (empty strings past the last); its confirmations and status
+ * are ignored. Status is re-derived from the united confirmers, but only
+ * for an alert this node has also heard a signed report for: remote
+ * confirmers alone never verify it or fire on_verified. Times ahead of now
+ * are clamped to now. Links are ignored.
+ * @return 1 if the local alert changed, 0 if not, -1 if rejected (expired
+ *         or no room)
+ */
+int alerts_map_merge_at(alerts_map_t *map, const Alert *remote, time_t now);
 
 #endif // ALERTS_H
 
@@ -4,6 +4,7 @@
  */
 
 #include "../db/db.h"
+#include "../db/persist.h"
 #include "alerts.h"
 #include <string.h>
 #include <stdio.h>
@@ -26,15 +27,20 @@ static void alert_to_verified(const Alert *alert, VerifiedAlert *verified) {
     verified->verified_at = alert->last_seen;
     verified->confirmations = alert->confirmations;
     
-    // Convert confirmers array to JSON
-    strcpy(verified->confirmers_json, "[");
-    for (int i = 0; i < alert->confirmations && i < 10; i++) {
-        if (i > 0) strcat(verified->confirmers_json, ",");
-        strcat(verified->confirmers_json, "\"");
-        strcat(verified->confirmers_json, alert->confirmers[i]);
-        strcat(verified->confirmers_json, "\"");
+    // Convert confirmers array to JSON; ids that do not fit whole are left
+    // out, keeping room for the closing bracket
+    size_t cap = sizeof(verified->confirmers_json) - 1;
+    size_t len = (size_t)snprintf(verified->confirmers_json, cap, "[");
+    for (int i = 0; i < alert->confirmations && i < CONFIRMERS_MAX; i++) {
+        int n = snprintf(verified->confirmers_json + len, cap - len, i > 0 ? ",\"%s\"" : "\"%s\"",
+                         alert->confirmers[i]);
+        if (n < 0 || (size_t)n >= cap - len) {
+            verified->confirmers_json[len] = '\0';
+            break;
+        }
+        len += (size_t)n;
     }
-    strcat(verified->confirmers_json, "]");
+    strcpy(verified->confirmers_json + len, "]");
     
     // Generate raw_payload JSON (mock for now)
     snprintf(verified->raw_payload, sizeof(verified->raw_payload),
@@ -53,14 +59,23 @@ void persist_verified_alert(const Alert *alert) {
     
     VerifiedAlert verified;
     alert_to_verified(alert, &verified);
-    
+
+    char details[256];
+    snprintf(details, sizeof(details), "Alert '%s' verified with %d confirmations",
+             alert->alert_key, alert->confirmations);
+
+    // Hand off to the write-behind thread; this runs under the alerts lock
+    if (persist_running()) {
+        if (persist_enqueue_alert(&verified, details) == 0) {
+            printf("[alerts] Queued verified alert: %s\n", alert->alert_key);
+        } else {
+            fprintf(stderr, "[alerts] Persistence queue full, dropped alert: %s\n", alert->alert_key);
+        }
+        return;
+    }
+
     // Insert into database
     if (db_insert_verified_alert(&verified) == 0) {
-        // Log the event
-        char details[256];
-        snprintf(details, sizeof(details), "Alert '%s' verified with %d confirmations",
-                 alert->alert_key, alert->confirmations);
-        
         db_log_event("alert_verified", NULL, details);
         printf("[alerts] Persisted verified alert: %s\n", alert->alert_key);
     } else {
@@ -79,9 +94,13 @@ void log_alert_expired(const Alert *alert) {
     
     char details[256];
     snprintf(details, sizeof(details), "Alert '%s' expired after %ld seconds",
-             alert->alert_key, time(NULL) - alert->first_seen);
-    
-    db_log_event("alert_expired", NULL, details);
+             alert->alert_key, (long)(time(NULL) - alert->first_seen));
+
+    if (persist_running()) {
+        persist_enqueue_event("alert_expired", NULL, details);
+    } else {
+        db_log_event("alert_expired", NULL, details);
+    }
 }
 
 /**
@@ -89,11 +108,28 @@ void log_alert_expired(const Alert *alert) {
  */
 void init_alerts_database(void) {
     const char *db_path = "v2v_alerts.db";
-    
+    const char *archive_dir = "v2v_archive";
+
     if (db_init(db_path) != 0) {
         fprintf(stderr, "[alerts] Failed to initialize database\n");
         return;
     }
+
+    // Writes go through the background writer, which also moves rows older
+    // than the hot window into per-day archives. If it cannot start,
+    // persist_verified_alert() falls back to synchronous inserts and
+    // retention only runs here, at startup.
+    persist_config_t cfg;
+    persist_config_defaults(&cfg);
+    cfg.retention_interval_ms = PERSIST_DEFAULT_RETENTION_INTERVAL_MS;
+    db_retention_config_defaults(&cfg.retention, archive_dir);
+    if (persist_start(&cfg) != 0) {
+        fprintf(stderr, "[alerts] Write-behind unavailable, persisting synchronously\n");
+        db_retention_run(&cfg.retention, time(NULL), NULL);
+    } else if (db_open_readers(DB_DEFAULT_READERS) != 0) {
+        // persist_start() enabled WAL; queries fall back to the writer
+        fprintf(stderr, "[alerts] Read pool unavailable, queries share the writer\n");
+    }
     
     printf("[alerts] Database ready for persistence\n");
 }
@@ -102,6 +138,18 @@ void init_alerts_database(void) {
  * Cleanup database connection on shutdown
  */
 void cleanup_alerts_database(void) {
+    // Drains anything still queued before the connection goes away
+    if (persist_running()) {
+        persist_stop();
+        persist_print_stats();
+    }
+
+    db_reader_stats_t readers;
+    db_get_reader_stats(&readers);
+    if (readers.readers > 0) {
+        printf("[alerts] Read pool: %d connections, %llu queries, %llu waited, peak %d in use\n",
+               readers.readers, readers.acquired, readers.waited, readers.max_in_use);
+    }
     db_close();
     printf("[alerts] Database connection closed\n");
 }
@@ -3,10 +3,265 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 
 // Global database connection
 sqlite3 *g_db = NULL;
 
+// Statements kept prepared for the lifetime of the connection. Each call
+// binds, steps and then resets its statement instead of recompiling the SQL.
+typedef enum {
+    DB_STMT_INSERT_ALERT = 0,
+    DB_STMT_LOG_EVENT,
+    DB_STMT_QUERY_ALERTS,
+    DB_STMT_STATS_TOTALS,
+    DB_STMT_STATS_SCOPE,
+    DB_STMT_ROLLUPS,
+    DB_STMT_BEGIN,
+    DB_STMT_COMMIT,
+    DB_STMT_ROLLBACK,
+    DB_STMT_CURSOR,               // one per projection, DB_STMT_CURSOR + columns mask
+    DB_STMT_BBOX = DB_STMT_CURSOR + DB_COL_ALL + 1,
+    DB_STMT_BBOX_SCAN = DB_STMT_BBOX + DB_COL_ALL + 1,  // fallback without R*Tree
+    DB_STMT_COUNT = DB_STMT_BBOX_SCAN + DB_COL_ALL + 1
+} db_stmt_id_t;
+
+static const char *k_stmt_sql[DB_STMT_COUNT] = {
+    [DB_STMT_INSERT_ALERT] =
+        "INSERT OR REPLACE INTO verified_alerts "
+        "(alert_key, latitude, longitude, hazard_type, confidence, "
+        " first_seen, verified_at, confirmations, confirmers, raw_payload) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?);",
+    [DB_STMT_LOG_EVENT] =
+        "INSERT INTO audit_log (event_type, timestamp, payload, details) "
+        "VALUES (?1, COALESCE(?4, strftime('%s', 'now')), ?2, ?3);",
+    [DB_STMT_QUERY_ALERTS] =
+        "SELECT alert_key, latitude, longitude, hazard_type, confidence, "
+        "       first_seen, verified_at, confirmations, confirmers, raw_payload "
+        "FROM verified_alerts WHERE verified_at >= ? ORDER BY verified_at DESC LIMIT ?;",
+    [DB_STMT_STATS_TOTALS] = "SELECT name, count FROM db_stats WHERE scope = 'table';",
+    [DB_STMT_STATS_SCOPE] =
+        "SELECT name, count FROM db_stats WHERE scope = ? AND count > 0 ORDER BY name;",
+    [DB_STMT_ROLLUPS] =
+        "SELECT bucket, name, count FROM db_rollups "
+        "WHERE scope = ?1 AND period = ?2 AND bucket >= ?3 AND bucket < ?4 "
+        "ORDER BY bucket, name;",
+    [DB_STMT_BEGIN] = "BEGIN IMMEDIATE;",
+    [DB_STMT_COMMIT] = "COMMIT;",
+    [DB_STMT_ROLLBACK] = "ROLLBACK;",
+    // Keyset pagination: the row-value bound is satisfied by idx_verified_at,
+    // whose entries are ordered by (verified_at, rowid)
+#define DB_CURSOR_SQL(extra)                                                          \
+        "SELECT id, alert_key, latitude, longitude, hazard_type, confidence, "         \
+        "       first_seen, verified_at, confirmations" extra " "                      \
+        "FROM verified_alerts WHERE verified_at >= ?1 AND (verified_at, id) < (?2, ?3) " \
+        "ORDER BY verified_at DESC, id DESC LIMIT ?4;"
+    [DB_STMT_CURSOR] = DB_CURSOR_SQL(""),
+    [DB_STMT_CURSOR + DB_COL_CONFIRMERS] = DB_CURSOR_SQL(", confirmers"),
+    [DB_STMT_CURSOR + DB_COL_RAW_PAYLOAD] = DB_CURSOR_SQL(", raw_payload"),
+    [DB_STMT_CURSOR + DB_COL_ALL] = DB_CURSOR_SQL(", confirmers, raw_payload"),
+#undef DB_CURSOR_SQL
+    // The R*Tree stores 32-bit floats rounded outwards, so candidates are
+    // re-checked against the exact coordinates in verified_alerts
+#define DB_BBOX_SQL(extra)                                                             \
+        "SELECT a.id, a.alert_key, a.latitude, a.longitude, a.hazard_type, a.confidence, " \
+        "       a.first_seen, a.verified_at, a.confirmations" extra " "                   \
+        "FROM verified_alerts_rtree r JOIN verified_alerts a ON a.id = r.id "             \
+        "WHERE r.max_lat >= ?1 AND r.min_lat <= ?3 AND r.max_lon >= ?2 AND r.min_lon <= ?4 " \
+        "  AND a.latitude BETWEEN ?1 AND ?3 AND a.longitude BETWEEN ?2 AND ?4 "           \
+        "  AND a.verified_at >= ?5 "                                                      \
+        "ORDER BY a.verified_at DESC LIMIT ?6;"
+    [DB_STMT_BBOX] = DB_BBOX_SQL(""),
+    [DB_STMT_BBOX + DB_COL_CONFIRMERS] = DB_BBOX_SQL(", a.confirmers"),
+    [DB_STMT_BBOX + DB_COL_RAW_PAYLOAD] = DB_BBOX_SQL(", a.raw_payload"),
+    [DB_STMT_BBOX + DB_COL_ALL] = DB_BBOX_SQL(", a.confirmers, a.raw_payload"),
+#undef DB_BBOX_SQL
+#define DB_BBOX_SCAN_SQL(extra)                                                        \
+        "SELECT a.id, a.alert_key, a.latitude, a.longitude, a.hazard_type, a.confidence, " \
+        "       a.first_seen, a.verified_at, a.confirmations" extra " "                   \
+        "FROM verified_alerts a "                                                         \
+        "WHERE a.latitude BETWEEN ?1 AND ?3 AND a.longitude BETWEEN ?2 AND ?4 "           \
+        "  AND a.verified_at >= ?5 "                                                      \
+        "ORDER BY a.verified_at DESC LIMIT ?6;"
+    [DB_STMT_BBOX_SCAN] = DB_BBOX_SCAN_SQL(""),
+    [DB_STMT_BBOX_SCAN + DB_COL_CONFIRMERS] = DB_BBOX_SCAN_SQL(", a.confirmers"),
+    [DB_STMT_BBOX_SCAN + DB_COL_RAW_PAYLOAD] = DB_BBOX_SCAN_SQL(", a.raw_payload"),
+    [DB_STMT_BBOX_SCAN + DB_COL_ALL] = DB_BBOX_SCAN_SQL(", a.confirmers, a.raw_payload"),
+#undef DB_BBOX_SCAN_SQL
+};
+
+// A connection and its statement cache. The writer is g_db; readers are
+// read-only connections to the same file, each used by one thread at a time.
+typedef struct {
+    sqlite3 *db;
+    sqlite3_stmt *stmts[DB_STMT_COUNT];
+    int busy[DB_STMT_COUNT];      // held by an open cursor
+} db_conn_t;
+
+static db_conn_t g_writer;
+
+// Read connection pool (see db_open_readers); empty until opened, in which
+// case reads use the writer connection as before
+typedef struct {
+    db_conn_t *conns;
+    int *free_stack;
+    int count;
+    int free_count;
+    db_reader_stats_t stats;
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE available;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t available;
+#endif
+} db_reader_pool_t;
+
+static db_reader_pool_t g_readers;
+static char g_db_path[512];
+
+// Set when the R*Tree module is available and verified_alerts_rtree exists
+static int g_have_rtree = 0;
+
+// Writes made through this process, readable from any thread without
+// touching SQLite
+static atomic_ullong g_alerts_written;
+static atomic_ullong g_events_written;
+static atomic_ullong g_write_errors;
+
+// When set, db_log_event hands events here instead of audit_log
+static db_event_sink_fn g_event_sink = NULL;
+
+// Per-row progress messages ("[db] Inserted ...") are on by default
+static int g_verbose = 1;
+
+void db_set_verbose(int verbose) {
+    g_verbose = verbose;
+}
+
+/**
+ * Get a connection's cached statement, preparing it on first use
+ */
+static sqlite3_stmt *db_conn_stmt(db_conn_t *conn, db_stmt_id_t id) {
+    if (conn->stmts[id] == NULL) {
+        int rc = sqlite3_prepare_v3(conn->db, k_stmt_sql[id], -1, SQLITE_PREPARE_PERSISTENT,
+                                    &conn->stmts[id], NULL);
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "[db] Failed to prepare statement: %s\n", sqlite3_errmsg(conn->db));
+            conn->stmts[id] = NULL;
+        }
+    }
+    return conn->stmts[id];
+}
+
+/**
+ * Get a cached statement on the writer connection
+ */
+static sqlite3_stmt *db_stmt(db_stmt_id_t id) {
+    return db_conn_stmt(&g_writer, id);
+}
+
+/**
+ * Return a cached statement to its initial state for the next caller
+ */
+static void db_stmt_release(sqlite3_stmt *stmt) {
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+}
+
+static void db_finalize_statements(db_conn_t *conn) {
+    for (int i = 0; i < DB_STMT_COUNT; i++) {
+        sqlite3_finalize(conn->stmts[i]);
+        conn->stmts[i] = NULL;
+        conn->busy[i] = 0;
+    }
+}
+
+static void db_pool_lock(void) {
+#ifdef _WIN32
+    EnterCriticalSection(&g_readers.mutex);
+#else
+    pthread_mutex_lock(&g_readers.mutex);
+#endif
+}
+
+static void db_pool_unlock(void) {
+#ifdef _WIN32
+    LeaveCriticalSection(&g_readers.mutex);
+#else
+    pthread_mutex_unlock(&g_readers.mutex);
+#endif
+}
+
+/**
+ * Check out a read connection, waiting if all are in use. Without a pool
+ * this is the writer connection.
+ */
+static db_conn_t *db_reader_acquire(void) {
+    if (g_readers.count == 0) {
+        return &g_writer;
+    }
+
+    db_pool_lock();
+    g_readers.stats.acquired++;
+    if (g_readers.free_count == 0) {
+        g_readers.stats.waited++;
+    }
+    while (g_readers.free_count == 0) {
+#ifdef _WIN32
+        SleepConditionVariableCS(&g_readers.available, &g_readers.mutex, INFINITE);
+#else
+        pthread_cond_wait(&g_readers.available, &g_readers.mutex);
+#endif
+    }
+    db_conn_t *conn = &g_readers.conns[g_readers.free_stack[--g_readers.free_count]];
+    int in_use = g_readers.count - g_readers.free_count;
+    if (in_use > g_readers.stats.max_in_use) {
+        g_readers.stats.max_in_use = in_use;
+    }
+    db_pool_unlock();
+    return conn;
+}
+
+static void db_reader_release(db_conn_t *conn) {
+    if (conn == &g_writer || conn == NULL) {
+        return;
+    }
+    db_pool_lock();
+    g_readers.free_stack[g_readers.free_count++] = (int)(conn - g_readers.conns);
+#ifdef _WIN32
+    WakeConditionVariable(&g_readers.available);
+#else
+    pthread_cond_signal(&g_readers.available);
+#endif
+    db_pool_unlock();
+}
+
+static void db_close_readers(void) {
+    if (g_readers.count == 0) {
+        return;
+    }
+    for (int i = 0; i < g_readers.count; i++) {
+        db_finalize_statements(&g_readers.conns[i]);
+        sqlite3_close(g_readers.conns[i].db);
+    }
+#ifdef _WIN32
+    DeleteCriticalSection(&g_readers.mutex);
+#else
+    pthread_mutex_destroy(&g_readers.mutex);
+    pthread_cond_destroy(&g_readers.available);
+#endif
+    free(g_readers.conns);
+    free(g_readers.free_stack);
+    memset(&g_readers, 0, sizeof(g_readers));
+}
+
 /**
  * Initialize SQLite database connection
  */
@@ -25,13 +280,18 @@ int db_init(const char *db_path) {
         return -1;
     }
 
+    g_writer.db = g_db;
+    strncpy(g_db_path, db_path, sizeof(g_db_path) - 1);
+    g_db_path[sizeof(g_db_path) - 1] = '\0';
     printf("[db] Database opened: %s\n", db_path);
 
     // Initialize schema
     if (db_init_schema() != 0) {
         fprintf(stderr, "[db] Failed to initialize schema\n");
+        db_finalize_statements(&g_writer);
         sqlite3_close(g_db);
         g_db = NULL;
+        g_writer.db = NULL;
         return -1;
     }
 
@@ -47,12 +307,376 @@ int db_close(void) {
         return 0;
     }
 
+    db_close_readers();
+    db_finalize_statements(&g_writer);
     sqlite3_close(g_db);
     g_db = NULL;
+    g_writer.db = NULL;
+    g_have_rtree = 0;
     printf("[db] Database closed\n");
     return 0;
 }
 
+/**
+ * Switch the connection to write-ahead logging
+ */
+int db_enable_wal(void) {
+    if (g_db == NULL) {
+        fprintf(stderr, "[db] Database not initialized\n");
+        return -1;
+    }
+
+    // WAL lets readers proceed during writes; with WAL, synchronous=NORMAL
+    // only syncs at checkpoints and stays durable across application crashes
+    char *err_msg = NULL;
+    int rc = sqlite3_exec(g_db, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;",
+                          NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "[db] Failed to enable WAL: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Open the read connection pool
+ */
+int db_open_readers(int count) {
+    if (g_db == NULL || count <= 0) {
+        fprintf(stderr, "[db] Invalid parameters\n");
+        return -1;
+    }
+    if (g_readers.count != 0) {
+        fprintf(stderr, "[db] Readers already open\n");
+        return -1;
+    }
+
+    // Readers only run alongside the writer in WAL mode; with a rollback
+    // journal they would block commits instead
+    const char *mode = NULL;
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(g_db, "PRAGMA journal_mode;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            mode = (const char *)sqlite3_column_text(stmt, 0);
+        }
+        int wal = mode != NULL && strcmp(mode, "wal") == 0;
+        sqlite3_finalize(stmt);
+        if (!wal) {
+            fprintf(stderr, "[db] Read pool needs WAL mode, reads stay on the writer\n");
+            return -1;
+        }
+    }
+
+    g_readers.conns = (db_conn_t *)calloc((size_t)count, sizeof(db_conn_t));
+    g_readers.free_stack = (int *)calloc((size_t)count, sizeof(int));
+    if (g_readers.conns == NULL || g_readers.free_stack == NULL) {
+        free(g_readers.conns);
+        free(g_readers.free_stack);
+        memset(&g_readers, 0, sizeof(g_readers));
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        // Each reader is used by one thread at a time, so SQLite's own
+        // per-connection mutex is unnecessary
+        int rc = sqlite3_open_v2(g_db_path, &g_readers.conns[i].db,
+                                 SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL);
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "[db] Cannot open reader: %s\n", sqlite3_errmsg(g_readers.conns[i].db));
+            for (int j = 0; j <= i; j++) {
+                sqlite3_close(g_readers.conns[j].db);
+            }
+            free(g_readers.conns);
+            free(g_readers.free_stack);
+            memset(&g_readers, 0, sizeof(g_readers));
+            return -1;
+        }
+        sqlite3_busy_timeout(g_readers.conns[i].db, 1000);
+        g_readers.free_stack[i] = i;
+    }
+
+#ifdef _WIN32
+    InitializeCriticalSection(&g_readers.mutex);
+    InitializeConditionVariable(&g_readers.available);
+#else
+    pthread_mutex_init(&g_readers.mutex, NULL);
+    pthread_cond_init(&g_readers.available, NULL);
+#endif
+    g_readers.free_count = count;
+    g_readers.count = count;
+
+    printf("[db] Opened %d read connections\n", count);
+    return 0;
+}
+
+/**
+ * Read pool usage counters
+ */
+void db_get_reader_stats(db_reader_stats_t *out) {
+    if (out == NULL) {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    if (g_readers.count == 0) {
+        return;
+    }
+    db_pool_lock();
+    *out = g_readers.stats;
+    out->readers = g_readers.count;
+    out->in_use = g_readers.count - g_readers.free_count;
+    db_pool_unlock();
+}
+
+static int db_exec_cached(db_stmt_id_t id) {
+    if (g_db == NULL) {
+        return -1;
+    }
+    sqlite3_stmt *stmt = db_stmt(id);
+    if (stmt == NULL) {
+        return -1;
+    }
+    int rc = sqlite3_step(stmt);
+    db_stmt_release(stmt);
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "[db] %s failed: %s\n", k_stmt_sql[id], sqlite3_errmsg(g_db));
+        return -1;
+    }
+    return 0;
+}
+
+int db_begin(void) {
+    return db_exec_cached(DB_STMT_BEGIN);
+}
+
+int db_commit(void) {
+    return db_exec_cached(DB_STMT_COMMIT);
+}
+
+int db_rollback(void) {
+    return db_exec_cached(DB_STMT_ROLLBACK);
+}
+
+/**
+ * Create the R*Tree over alert positions and the triggers that keep it in
+ * step with verified_alerts. INSERT OR REPLACE deletes the old row without
+ * firing delete triggers, so the BEFORE INSERT trigger drops its entry.
+ * Builds without the R*Tree module fall back to a (latitude, longitude) index.
+ */
+static int db_init_spatial_index(void) {
+    sqlite3_stmt *stmt;
+    int existed = 0;
+    if (sqlite3_prepare_v2(g_db, "SELECT 1 FROM sqlite_master WHERE name = 'verified_alerts_rtree';",
+                           -1, &stmt, NULL) == SQLITE_OK) {
+        existed = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+    }
+
+    const char *rtree_sql =
+        "CREATE VIRTUAL TABLE IF NOT EXISTS verified_alerts_rtree "
+        "    USING rtree(id, min_lat, max_lat, min_lon, max_lon);"
+        "CREATE TRIGGER IF NOT EXISTS verified_alerts_rtree_replace "
+        "BEFORE INSERT ON verified_alerts BEGIN "
+        "    DELETE FROM verified_alerts_rtree WHERE id IN "
+        "        (SELECT id FROM verified_alerts WHERE alert_key = NEW.alert_key);"
+        "END;"
+        "CREATE TRIGGER IF NOT EXISTS verified_alerts_rtree_insert "
+        "AFTER INSERT ON verified_alerts BEGIN "
+        "    INSERT OR REPLACE INTO verified_alerts_rtree "
+        "    VALUES (NEW.id, NEW.latitude, NEW.latitude, NEW.longitude, NEW.longitude);"
+        "END;"
+        "CREATE TRIGGER IF NOT EXISTS verified_alerts_rtree_update "
+        "AFTER UPDATE OF latitude, longitude ON verified_alerts BEGIN "
+        "    UPDATE verified_alerts_rtree SET min_lat = NEW.latitude, max_lat = NEW.latitude, "
+        "        min_lon = NEW.longitude, max_lon = NEW.longitude WHERE id = NEW.id;"
+        "END;"
+        "CREATE TRIGGER IF NOT EXISTS verified_alerts_rtree_delete "
+        "AFTER DELETE ON verified_alerts BEGIN "
+        "    DELETE FROM verified_alerts_rtree WHERE id = OLD.id;"
+        "END;";
+
+    char *err_msg = NULL;
+    if (sqlite3_exec(g_db, rtree_sql, NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "[db] R*Tree unavailable (%s), bbox queries will use a lat/lon index\n",
+                err_msg);
+        sqlite3_free(err_msg);
+        g_have_rtree = 0;
+        if (sqlite3_exec(g_db, "CREATE INDEX IF NOT EXISTS idx_lat_lon "
+                               "ON verified_alerts(latitude, longitude);",
+                         NULL, NULL, &err_msg) != SQLITE_OK) {
+            fprintf(stderr, "[db] SQL error: %s\n", err_msg);
+            sqlite3_free(err_msg);
+            return -1;
+        }
+        return 0;
+    }
+    g_have_rtree = 1;
+
+    // Index rows written before the R*Tree existed
+    if (!existed &&
+        sqlite3_exec(g_db, "INSERT INTO verified_alerts_rtree "
+                           "SELECT id, latitude, latitude, longitude, longitude FROM verified_alerts;",
+                     NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "[db] Failed to backfill R*Tree: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Row counts maintained by triggers, so statistics never scan the tables.
+ * Scopes: 'table' (totals), 'hazard_type', 'event_type'. As with the R*Tree,
+ * a row displaced by INSERT OR REPLACE is uncounted by a BEFORE INSERT
+ * trigger because REPLACE does not fire delete triggers. The one-time
+ * backfill runs until the 'meta' row exists. Keep in sync with
+ * node/db/schema.sql.
+ */
+static const char *k_stats_sql =
+    "BEGIN;"
+    "CREATE TABLE IF NOT EXISTS db_stats ("
+    "    scope TEXT NOT NULL,"
+    "    name TEXT NOT NULL,"
+    "    count INTEGER NOT NULL DEFAULT 0,"
+    "    PRIMARY KEY (scope, name)"
+    ") WITHOUT ROWID;"
+    "CREATE TRIGGER IF NOT EXISTS db_stats_alert_replace "
+    "BEFORE INSERT ON verified_alerts "
+    "WHEN EXISTS (SELECT 1 FROM verified_alerts WHERE alert_key = NEW.alert_key) BEGIN "
+    "    UPDATE db_stats SET count = count - 1 "
+    "    WHERE (scope = 'table' AND name = 'verified_alerts') "
+    "       OR (scope = 'hazard_type' AND name = "
+    "           (SELECT hazard_type FROM verified_alerts WHERE alert_key = NEW.alert_key));"
+    "END;"
+    "CREATE TRIGGER IF NOT EXISTS db_stats_alert_insert "
+    "AFTER INSERT ON verified_alerts BEGIN "
+    "    INSERT INTO db_stats (scope, name, count) VALUES ('table', 'verified_alerts', 1) "
+    "        ON CONFLICT (scope, name) DO UPDATE SET count = count + 1;"
+    "    INSERT INTO db_stats (scope, name, count) VALUES ('hazard_type', NEW.hazard_type, 1) "
+    "        ON CONFLICT (scope, name) DO UPDATE SET count = count + 1;"
+    "END;"
+    "CREATE TRIGGER IF NOT EXISTS db_stats_alert_update "
+    "AFTER UPDATE OF hazard_type ON verified_alerts "
+    "WHEN OLD.hazard_type IS NOT NEW.hazard_type BEGIN "
+    "    UPDATE db_stats SET count = count - 1 WHERE scope = 'hazard_type' AND name = OLD.hazard_type;"
+    "    INSERT INTO db_stats (scope, name, count) VALUES ('hazard_type', NEW.hazard_type, 1) "
+    "        ON CONFLICT (scope, name) DO UPDATE SET count = count + 1;"
+    "END;"
+    "CREATE TRIGGER IF NOT EXISTS db_stats_alert_delete "
+    "AFTER DELETE ON verified_alerts BEGIN "
+    "    UPDATE db_stats SET count = count - 1 "
+    "    WHERE (scope = 'table' AND name = 'verified_alerts') "
+    "       OR (scope = 'hazard_type' AND name = OLD.hazard_type);"
+    "END;"
+    "CREATE TRIGGER IF NOT EXISTS db_stats_event_insert "
+    "AFTER INSERT ON audit_log BEGIN "
+    "    INSERT INTO db_stats (scope, name, count) VALUES ('table', 'audit_log', 1) "
+    "        ON CONFLICT (scope, name) DO UPDATE SET count = count + 1;"
+    "    INSERT INTO db_stats (scope, name, count) VALUES ('event_type', NEW.event_type, 1) "
+    "        ON CONFLICT (scope, name) DO UPDATE SET count = count + 1;"
+    "END;"
+    "CREATE TRIGGER IF NOT EXISTS db_stats_event_delete "
+    "AFTER DELETE ON audit_log BEGIN "
+    "    UPDATE db_stats SET count = count - 1 "
+    "    WHERE (scope = 'table' AND name = 'audit_log') "
+    "       OR (scope = 'event_type' AND name = OLD.event_type);"
+    "END;"
+    "INSERT OR REPLACE INTO db_stats (scope, name, count) "
+    "    SELECT 'table', 'verified_alerts', n FROM (SELECT COUNT(*) AS n FROM verified_alerts) "
+    "    WHERE NOT EXISTS (SELECT 1 FROM db_stats WHERE scope = 'meta');"
+    "INSERT OR REPLACE INTO db_stats (scope, name, count) "
+    "    SELECT 'table', 'audit_log', n FROM (SELECT COUNT(*) AS n FROM audit_log) "
+    "    WHERE NOT EXISTS (SELECT 1 FROM db_stats WHERE scope = 'meta');"
+    "INSERT OR REPLACE INTO db_stats (scope, name, count) "
+    "    SELECT 'hazard_type', hazard_type, COUNT(*) FROM verified_alerts "
+    "    WHERE NOT EXISTS (SELECT 1 FROM db_stats WHERE scope = 'meta') GROUP BY hazard_type;"
+    "INSERT OR REPLACE INTO db_stats (scope, name, count) "
+    "    SELECT 'event_type', event_type, COUNT(*) FROM audit_log "
+    "    WHERE NOT EXISTS (SELECT 1 FROM db_stats WHERE scope = 'meta') GROUP BY event_type;"
+    "INSERT OR IGNORE INTO db_stats (scope, name, count) VALUES ('meta', 'backfilled', 1);"
+    "COMMIT;";
+
+static int db_init_stats(void) {
+    char *err_msg = NULL;
+    if (sqlite3_exec(g_db, k_stats_sql, NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "[db] Failed to initialize stats counters: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        if (!sqlite3_get_autocommit(g_db)) {
+            sqlite3_exec(g_db, "ROLLBACK;", NULL, NULL, NULL);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Per-minute and per-hour counts of audit events by event_type and of
+ * verified alerts by hazard_type, bucketed by timestamp / verified_at. Unlike
+ * db_stats they are not decremented when rows are deleted, so they keep
+ * history after retention removes the raw rows (see retention.h). A replaced
+ * alert is moved from its old buckets to its new ones. Keep in sync with
+ * node/db/schema.sql.
+ */
+#define DB_ROLLUP_UPSERT(scope, period, ts, name) \
+    "    INSERT INTO db_rollups (scope, period, bucket, name, count) " \
+    "    VALUES ('" scope "', " #period ", " ts " - " ts " % " #period ", " name ", 1) " \
+    "        ON CONFLICT (scope, period, bucket, name) DO UPDATE SET count = count + 1;"
+
+static const char *k_rollup_sql =
+    "BEGIN;"
+    "CREATE TABLE IF NOT EXISTS db_rollups ("
+    "    scope TEXT NOT NULL,"
+    "    period INTEGER NOT NULL,"
+    "    bucket INTEGER NOT NULL,"
+    "    name TEXT NOT NULL,"
+    "    count INTEGER NOT NULL DEFAULT 0,"
+    "    PRIMARY KEY (scope, period, bucket, name)"
+    ") WITHOUT ROWID;"
+    "CREATE TRIGGER IF NOT EXISTS db_rollup_alert_replace "
+    "BEFORE INSERT ON verified_alerts "
+    "WHEN EXISTS (SELECT 1 FROM verified_alerts WHERE alert_key = NEW.alert_key) BEGIN "
+    "    UPDATE db_rollups SET count = count - 1 "
+    "    WHERE scope = 'hazard_type' AND period IN (60, 3600) "
+    "      AND (bucket, name) IN (SELECT verified_at - verified_at % period, hazard_type "
+    "                             FROM verified_alerts WHERE alert_key = NEW.alert_key);"
+    "END;"
+    "CREATE TRIGGER IF NOT EXISTS db_rollup_alert_insert "
+    "AFTER INSERT ON verified_alerts BEGIN "
+    DB_ROLLUP_UPSERT("hazard_type", 60, "NEW.verified_at", "NEW.hazard_type")
+    DB_ROLLUP_UPSERT("hazard_type", 3600, "NEW.verified_at", "NEW.hazard_type")
+    "END;"
+    "CREATE TRIGGER IF NOT EXISTS db_rollup_event_insert "
+    "AFTER INSERT ON audit_log BEGIN "
+    DB_ROLLUP_UPSERT("event_type", 60, "NEW.timestamp", "NEW.event_type")
+    DB_ROLLUP_UPSERT("event_type", 3600, "NEW.timestamp", "NEW.event_type")
+    "END;"
+    "INSERT OR REPLACE INTO db_rollups (scope, period, bucket, name, count) "
+    "    SELECT 'hazard_type', p.period, verified_at - verified_at % p.period, hazard_type, COUNT(*) "
+    "    FROM verified_alerts, (SELECT 60 AS period UNION ALL SELECT 3600) AS p "
+    "    WHERE NOT EXISTS (SELECT 1 FROM db_rollups WHERE scope = 'meta') "
+    "    GROUP BY 1, 2, 3, 4;"
+    "INSERT OR REPLACE INTO db_rollups (scope, period, bucket, name, count) "
+    "    SELECT 'event_type', p.period, timestamp - timestamp % p.period, event_type, COUNT(*) "
+    "    FROM audit_log, (SELECT 60 AS period UNION ALL SELECT 3600) AS p "
+    "    WHERE NOT EXISTS (SELECT 1 FROM db_rollups WHERE scope = 'meta') "
+    "    GROUP BY 1, 2, 3, 4;"
+    "INSERT OR IGNORE INTO db_rollups (scope, period, bucket, name, count) "
+    "    VALUES ('meta', 0, 0, 'backfilled', 1);"
+    "COMMIT;";
+
+static int db_init_rollups(void) {
+    char *err_msg = NULL;
+    if (sqlite3_exec(g_db, k_rollup_sql, NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "[db] Failed to initialize rollups: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        if (!sqlite3_get_autocommit(g_db)) {
+            sqlite3_exec(g_db, "ROLLBACK;", NULL, NULL, NULL);
+        }
+        return -1;
+    }
+    return 0;
+}
+
 /**
  * Initialize tables from schema
  */
@@ -79,7 +703,7 @@ int db_init_schema(void) {
         "CREATE TABLE IF NOT EXISTS audit_log ("
         "    id INTEGER PRIMARY KEY AUTOINCREMENT,"
         "    event_type TEXT NOT NULL,"
-        "    timestamp INTEGER NOT NULL DEFAULT (strftime('%%s', 'now')),"
+        "    timestamp INTEGER NOT NULL DEFAULT (strftime('%s', 'now')),"
         "    payload TEXT,"
         "    details TEXT"
         ");"
@@ -97,6 +721,10 @@ int db_init_schema(void) {
         return -1;
     }
 
+    if (db_init_spatial_index() != 0 || db_init_stats() != 0 || db_init_rollups() != 0) {
+        return -1;
+    }
+
     printf("[db] Schema initialized\n");
     return 0;
 }
@@ -110,17 +738,8 @@ int db_insert_verified_alert(const VerifiedAlert *alert) {
         return -1;
     }
 
-    const char *sql = 
-        "INSERT OR REPLACE INTO verified_alerts "
-        "(alert_key, latitude, longitude, hazard_type, confidence, "
-        " first_seen, verified_at, confirmations, confirmers, raw_payload) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
-
-    sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(g_db, sql, -1, &stmt, NULL);
-    
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "[db] Failed to prepare statement: %s\n", sqlite3_errmsg(g_db));
+    sqlite3_stmt *stmt = db_stmt(DB_STMT_INSERT_ALERT);
+    if (stmt == NULL) {
         return -1;
     }
 
@@ -136,36 +755,53 @@ int db_insert_verified_alert(const VerifiedAlert *alert) {
     sqlite3_bind_text(stmt, 9, alert->confirmers_json, -1, SQLITE_STATIC);
     sqlite3_bind_text(stmt, 10, alert->raw_payload, -1, SQLITE_STATIC);
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    db_stmt_release(stmt);
 
     if (rc != SQLITE_DONE) {
         fprintf(stderr, "[db] Failed to insert alert: %s\n", sqlite3_errmsg(g_db));
+        atomic_fetch_add(&g_write_errors, 1);
         return -1;
     }
+    atomic_fetch_add(&g_alerts_written, 1);
 
-    printf("[db] Inserted verified alert: %s\n", alert->alert_key);
+    if (g_verbose) {
+        printf("[db] Inserted verified alert: %s\n", alert->alert_key);
+    }
     return 0;
 }
 
+void db_set_event_sink(db_event_sink_fn fn) {
+    g_event_sink = fn;
+}
+
 /**
  * Log an audit event to the database
  */
 int db_log_event(const char *event_type, const char *payload, const char *details) {
+    if (g_event_sink != NULL && event_type != NULL) {
+        if (g_event_sink(event_type, payload, details) != 0) {
+            atomic_fetch_add(&g_write_errors, 1);
+            return -1;
+        }
+        atomic_fetch_add(&g_events_written, 1);
+        return 0;
+    }
+    return db_log_event_at(event_type, payload, details, 0);
+}
+
+/**
+ * Log an audit event with an explicit timestamp (0 = now), always to audit_log
+ */
+int db_log_event_at(const char *event_type, const char *payload, const char *details,
+                    time_t timestamp) {
     if (g_db == NULL || event_type == NULL) {
         fprintf(stderr, "[db] Database not initialized or invalid event\n");
         return -1;
     }
 
-    const char *sql = 
-        "INSERT INTO audit_log (event_type, timestamp, payload, details) "
-        "VALUES (?, strftime('%%s', 'now'), ?, ?);";
-
-    sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(g_db, sql, -1, &stmt, NULL);
-    
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "[db] Failed to prepare statement: %s\n", sqlite3_errmsg(g_db));
+    sqlite3_stmt *stmt = db_stmt(DB_STMT_LOG_EVENT);
+    if (stmt == NULL) {
         return -1;
     }
 
@@ -184,15 +820,23 @@ int db_log_event(const char *event_type, const char *payload, const char *detail
         sqlite3_bind_null(stmt, 3);
     }
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    if (timestamp != 0) {
+        sqlite3_bind_int64(stmt, 4, timestamp);
+    }
+
+    int rc = sqlite3_step(stmt);
+    db_stmt_release(stmt);
 
     if (rc != SQLITE_DONE) {
         fprintf(stderr, "[db] Failed to log event: %s\n", sqlite3_errmsg(g_db));
+        atomic_fetch_add(&g_write_errors, 1);
         return -1;
     }
+    atomic_fetch_add(&g_events_written, 1);
 
-    printf("[db] Logged event: %s\n", event_type);
+    if (g_verbose) {
+        printf("[db] Logged event: %s\n", event_type);
+    }
     return 0;
 }
 
@@ -205,22 +849,17 @@ int db_query_verified_alerts(time_t since_timestamp, VerifiedAlert *results, int
         return -1;
     }
 
-    const char *sql = 
-        "SELECT alert_key, latitude, longitude, hazard_type, confidence, "
-        "       first_seen, verified_at, confirmations, confirmers, raw_payload "
-        "FROM verified_alerts WHERE verified_at >= ? ORDER BY verified_at DESC LIMIT ?;";
-
-    sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(g_db, sql, -1, &stmt, NULL);
-    
-    if (rc != SQLITE_OK) {
-        fprintf(stderr, "[db] Failed to prepare statement: %s\n", sqlite3_errmsg(g_db));
+    db_conn_t *conn = db_reader_acquire();
+    sqlite3_stmt *stmt = db_conn_stmt(conn, DB_STMT_QUERY_ALERTS);
+    if (stmt == NULL) {
+        db_reader_release(conn);
         return -1;
     }
 
     sqlite3_bind_int64(stmt, 1, since_timestamp);
     sqlite3_bind_int(stmt, 2, max_results);
 
+    int rc;
     int count = 0;
     while ((rc = sqlite3_step(stmt)) == SQLITE_ROW && count < max_results) {
         VerifiedAlert *alert = &results[count];
@@ -261,16 +900,218 @@ int db_query_verified_alerts(time_t since_timestamp, VerifiedAlert *results, int
         count++;
     }
 
-    sqlite3_finalize(stmt);
-    
     if (rc != SQLITE_DONE && rc != SQLITE_ROW) {
-        fprintf(stderr, "[db] Query error: %s\n", sqlite3_errmsg(g_db));
+        fprintf(stderr, "[db] Query error: %s\n", sqlite3_errmsg(conn->db));
+        db_stmt_release(stmt);
+        db_reader_release(conn);
         return -1;
     }
+    db_stmt_release(stmt);
+    db_reader_release(conn);
 
     return count;
 }
 
+/**
+ * Open a streaming cursor over verified alerts
+ */
+int db_alert_cursor_open(db_alert_cursor_t *cursor, const db_alert_query_t *query) {
+    if (cursor == NULL) {
+        return -1;
+    }
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->slot = -1;
+    if (g_db == NULL || query == NULL) {
+        fprintf(stderr, "[db] Invalid parameters\n");
+        return -1;
+    }
+
+    int columns = query->columns & DB_COL_ALL;
+    int slot = DB_STMT_CURSOR + columns;
+
+    // The cursor keeps its read connection until closed. Reuse the cached
+    // statement unless another open cursor on the same connection holds it.
+    db_conn_t *conn = db_reader_acquire();
+    sqlite3_stmt *stmt = NULL;
+    if (!conn->busy[slot]) {
+        stmt = db_conn_stmt(conn, (db_stmt_id_t)slot);
+        if (stmt == NULL) {
+            db_reader_release(conn);
+            return -1;
+        }
+        conn->busy[slot] = 1;
+        cursor->slot = slot;
+    } else if (sqlite3_prepare_v2(conn->db, k_stmt_sql[slot], -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "[db] Failed to prepare statement: %s\n", sqlite3_errmsg(conn->db));
+        db_reader_release(conn);
+        return -1;
+    }
+
+    sqlite3_bind_int64(stmt, 1, query->since);
+    if (query->after != NULL) {
+        sqlite3_bind_int64(stmt, 2, query->after->verified_at);
+        sqlite3_bind_int64(stmt, 3, query->after->id);
+    } else {
+        sqlite3_bind_int64(stmt, 2, INT64_MAX);
+        sqlite3_bind_int64(stmt, 3, INT64_MAX);
+    }
+    sqlite3_bind_int(stmt, 4, query->limit > 0 ? query->limit : -1);
+
+    cursor->conn = conn;
+    cursor->stmt = stmt;
+    cursor->columns = columns;
+    return 0;
+}
+
+static const char *column_view(sqlite3_stmt *stmt, int col, int *len) {
+    const char *text = (const char *)sqlite3_column_text(stmt, col);
+    *len = text ? sqlite3_column_bytes(stmt, col) : 0;
+    return text;
+}
+
+// Column layout shared by the cursor and bbox statements
+static void fill_alert_view(sqlite3_stmt *stmt, int columns, db_alert_view_t *row) {
+    memset(row, 0, sizeof(*row));
+    row->id = sqlite3_column_int64(stmt, 0);
+    row->alert_key = column_view(stmt, 1, &row->alert_key_len);
+    row->latitude = sqlite3_column_double(stmt, 2);
+    row->longitude = sqlite3_column_double(stmt, 3);
+    row->hazard_type = column_view(stmt, 4, &row->hazard_type_len);
+    row->confidence = sqlite3_column_double(stmt, 5);
+    row->first_seen = (time_t)sqlite3_column_int64(stmt, 6);
+    row->verified_at = (time_t)sqlite3_column_int64(stmt, 7);
+    row->confirmations = sqlite3_column_int(stmt, 8);
+
+    int col = 9;
+    if (columns & DB_COL_CONFIRMERS) {
+        row->confirmers_json = column_view(stmt, col++, &row->confirmers_len);
+    }
+    if (columns & DB_COL_RAW_PAYLOAD) {
+        row->raw_payload = column_view(stmt, col++, &row->raw_payload_len);
+    }
+}
+
+/**
+ * Advance a cursor, filling its row with views into the current result row
+ */
+int db_alert_cursor_next(db_alert_cursor_t *cursor) {
+    if (cursor == NULL || cursor->stmt == NULL) {
+        return -1;
+    }
+
+    int rc = sqlite3_step(cursor->stmt);
+    if (rc == SQLITE_DONE) {
+        return 0;
+    }
+    if (rc != SQLITE_ROW) {
+        fprintf(stderr, "[db] Query error: %s\n", sqlite3_errmsg(sqlite3_db_handle(cursor->stmt)));
+        return -1;
+    }
+
+    fill_alert_view(cursor->stmt, cursor->columns, &cursor->row);
+    cursor->rows++;
+    return 1;
+}
+
+/**
+ * Release a cursor's statement back to the cache and its connection back
+ * to the pool
+ */
+void db_alert_cursor_close(db_alert_cursor_t *cursor) {
+    if (cursor == NULL || cursor->stmt == NULL) {
+        return;
+    }
+    db_conn_t *conn = (db_conn_t *)cursor->conn;
+    if (cursor->slot >= 0) {
+        db_stmt_release(cursor->stmt);
+        conn->busy[cursor->slot] = 0;
+    } else {
+        sqlite3_finalize(cursor->stmt);
+    }
+    db_reader_release(conn);
+    cursor->stmt = NULL;
+    cursor->conn = NULL;
+    cursor->slot = -1;
+}
+
+/**
+ * Stream verified alerts through a callback
+ */
+int db_foreach_verified_alert(const db_alert_query_t *query, db_alert_row_fn fn, void *arg,
+                              db_alert_page_t *next) {
+    if (fn == NULL) {
+        return -1;
+    }
+
+    db_alert_cursor_t cursor;
+    if (db_alert_cursor_open(&cursor, query) != 0) {
+        return -1;
+    }
+
+    int rc;
+    while ((rc = db_alert_cursor_next(&cursor)) == 1) {
+        if (next != NULL) {
+            next->verified_at = cursor.row.verified_at;
+            next->id = cursor.row.id;
+        }
+        if (fn(&cursor.row, arg)) {
+            break;
+        }
+    }
+
+    int rows = cursor.rows;
+    db_alert_cursor_close(&cursor);
+    return rc < 0 ? -1 : rows;
+}
+
+/**
+ * Stream alerts whose position lies inside a lat/lon rectangle
+ */
+int db_query_alerts_in_bbox(double min_lat, double min_lon, double max_lat, double max_lon,
+                            time_t since, int columns, int limit,
+                            db_alert_row_fn fn, void *arg) {
+    if (g_db == NULL || fn == NULL || min_lat > max_lat || min_lon > max_lon) {
+        fprintf(stderr, "[db] Invalid parameters\n");
+        return -1;
+    }
+
+    columns &= DB_COL_ALL;
+    db_conn_t *conn = db_reader_acquire();
+    sqlite3_stmt *stmt = db_conn_stmt(conn, (db_stmt_id_t)((g_have_rtree ? DB_STMT_BBOX : DB_STMT_BBOX_SCAN) + columns));
+    if (stmt == NULL) {
+        db_reader_release(conn);
+        return -1;
+    }
+
+    sqlite3_bind_double(stmt, 1, min_lat);
+    sqlite3_bind_double(stmt, 2, min_lon);
+    sqlite3_bind_double(stmt, 3, max_lat);
+    sqlite3_bind_double(stmt, 4, max_lon);
+    sqlite3_bind_int64(stmt, 5, since);
+    sqlite3_bind_int(stmt, 6, limit > 0 ? limit : -1);
+
+    db_alert_view_t row;
+    int rows = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        fill_alert_view(stmt, columns, &row);
+        rows++;
+        if (fn(&row, arg)) {
+            break;
+        }
+    }
+
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+        fprintf(stderr, "[db] Query error: %s\n", sqlite3_errmsg(conn->db));
+        db_stmt_release(stmt);
+        db_reader_release(conn);
+        return -1;
+    }
+    db_stmt_release(stmt);
+    db_reader_release(conn);
+    return rows;
+}
+
 /**
  * Get database statistics
  */
@@ -279,33 +1120,117 @@ int db_get_stats(int *total_alerts, int *total_events) {
         return -1;
     }
 
-    const char *sql = "SELECT COUNT(*) FROM verified_alerts;";
-    sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(g_db, sql, -1, &stmt, NULL);
-    
-    if (rc != SQLITE_OK) {
+    db_conn_t *conn = db_reader_acquire();
+    sqlite3_stmt *stmt = db_conn_stmt(conn, DB_STMT_STATS_TOTALS);
+    if (stmt == NULL) {
+        db_reader_release(conn);
         return -1;
     }
 
-    rc = sqlite3_step(stmt);
-    if (rc == SQLITE_ROW) {
-        *total_alerts = sqlite3_column_int(stmt, 0);
+    *total_alerts = 0;
+    *total_events = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const char *name = (const char *)sqlite3_column_text(stmt, 0);
+        if (name && strcmp(name, "verified_alerts") == 0) {
+            *total_alerts = sqlite3_column_int(stmt, 1);
+        } else if (name && strcmp(name, "audit_log") == 0) {
+            *total_events = sqlite3_column_int(stmt, 1);
+        }
     }
-    sqlite3_finalize(stmt);
+    db_stmt_release(stmt);
+    db_reader_release(conn);
 
-    sql = "SELECT COUNT(*) FROM audit_log;";
-    rc = sqlite3_prepare_v2(g_db, sql, -1, &stmt, NULL);
-    
-    if (rc != SQLITE_OK) {
+    return rc == SQLITE_DONE ? 0 : -1;
+}
+
+static int db_get_scope_counts(const char *scope, db_count_fn fn, void *arg) {
+    if (g_db == NULL || fn == NULL) {
         return -1;
     }
 
-    rc = sqlite3_step(stmt);
-    if (rc == SQLITE_ROW) {
-        *total_events = sqlite3_column_int(stmt, 0);
+    db_conn_t *conn = db_reader_acquire();
+    sqlite3_stmt *stmt = db_conn_stmt(conn, DB_STMT_STATS_SCOPE);
+    if (stmt == NULL) {
+        db_reader_release(conn);
+        return -1;
     }
-    sqlite3_finalize(stmt);
+    sqlite3_bind_text(stmt, 1, scope, -1, SQLITE_STATIC);
 
-    return 0;
+    int rows = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        rows++;
+        if (fn((const char *)sqlite3_column_text(stmt, 0), sqlite3_column_int64(stmt, 1), arg)) {
+            rc = SQLITE_DONE;
+            break;
+        }
+    }
+    db_stmt_release(stmt);
+    db_reader_release(conn);
+
+    return rc == SQLITE_DONE ? rows : -1;
+}
+
+/**
+ * Verified alert counts per hazard type
+ */
+int db_get_hazard_type_counts(db_count_fn fn, void *arg) {
+    return db_get_scope_counts("hazard_type", fn, arg);
+}
+
+/**
+ * Audit event counts per event type
+ */
+int db_get_event_type_counts(db_count_fn fn, void *arg) {
+    return db_get_scope_counts("event_type", fn, arg);
+}
+
+/**
+ * Visit rollup buckets in [from, to) in time order
+ */
+int db_query_rollups(const char *scope, int period, time_t from, time_t to,
+                     db_rollup_fn fn, void *arg) {
+    if (g_db == NULL || scope == NULL || fn == NULL) {
+        return -1;
+    }
+
+    db_conn_t *conn = db_reader_acquire();
+    sqlite3_stmt *stmt = db_conn_stmt(conn, DB_STMT_ROLLUPS);
+    if (stmt == NULL) {
+        db_reader_release(conn);
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, scope, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, period);
+    sqlite3_bind_int64(stmt, 3, (sqlite3_int64)from);
+    sqlite3_bind_int64(stmt, 4, to != 0 ? (sqlite3_int64)to : INT64_MAX);
+
+    int rows = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        rows++;
+        if (fn((time_t)sqlite3_column_int64(stmt, 0), (const char *)sqlite3_column_text(stmt, 1),
+               sqlite3_column_int64(stmt, 2), arg)) {
+            rc = SQLITE_DONE;
+            break;
+        }
+    }
+    db_stmt_release(stmt);
+    db_reader_release(conn);
+
+    return rc == SQLITE_DONE ? rows : -1;
+}
+
+/**
+ * Writes made by this process since start
+ */
+void db_get_write_counters(db_write_counters_t *out) {
+    if (out == NULL) {
+        return;
+    }
+    out->alerts_written = atomic_load(&g_alerts_written);
+    out->events_written = atomic_load(&g_events_written);
+    out->write_errors = atomic_load(&g_write_errors);
 }
 
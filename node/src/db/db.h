@@ -21,6 +21,95 @@ typedef struct {
     char raw_payload[2048];     // Original JSON message
 } VerifiedAlert;
 
+// Optional columns for cursor queries; the fixed columns are always returned
+#define DB_COL_CONFIRMERS   0x1
+#define DB_COL_RAW_PAYLOAD  0x2
+#define DB_COL_ALL          (DB_COL_CONFIRMERS | DB_COL_RAW_PAYLOAD)
+
+// Read connections opened by the alerts integration
+#define DB_DEFAULT_READERS  4
+
+// Rollup bucket widths in seconds
+#define DB_ROLLUP_MINUTE    60
+#define DB_ROLLUP_HOUR      3600
+
+/**
+ * One row from a cursor. Strings point into SQLite's row buffer: they are
+ * NUL-terminated, but only valid until the cursor advances or closes.
+ * Columns left out of the projection are NULL with length 0.
+ */
+typedef struct {
+    long long id;
+    const char *alert_key;
+    int alert_key_len;
+    double latitude;
+    double longitude;
+    const char *hazard_type;
+    int hazard_type_len;
+    double confidence;
+    time_t first_seen;
+    time_t verified_at;
+    int confirmations;
+    const char *confirmers_json;
+    int confirmers_len;
+    const char *raw_payload;
+    int raw_payload_len;
+} db_alert_view_t;
+
+/**
+ * Keyset position: rows strictly after (older than) this one in
+ * (verified_at DESC, id DESC) order
+ */
+typedef struct {
+    time_t verified_at;
+    long long id;
+} db_alert_page_t;
+
+typedef struct {
+    time_t since;                 // only alerts with verified_at >= since
+    int columns;                  // DB_COL_* mask
+    int limit;                    // maximum rows, 0 for no limit
+    const db_alert_page_t *after; // resume point from a previous page, or NULL
+} db_alert_query_t;
+
+typedef struct {
+    sqlite3_stmt *stmt;
+    void *conn;                   // connection held until the cursor is closed
+    int slot;                     // statement cache slot, or -1 if privately prepared
+    int columns;
+    int rows;
+    db_alert_view_t row;
+} db_alert_cursor_t;
+
+// Return nonzero from a row callback to stop early
+typedef int (*db_alert_row_fn)(const db_alert_view_t *row, void *arg);
+
+// Visitor for per-type counts; return nonzero to stop early
+typedef int (*db_count_fn)(const char *name, long long count, void *arg);
+
+// Visitor for rollup buckets; return nonzero to stop early
+typedef int (*db_rollup_fn)(time_t bucket, const char *name, long long count, void *arg);
+
+// Alternative destination for audit events (e.g. the event journal);
+// returns 0 on success
+typedef int (*db_event_sink_fn)(const char *event_type, const char *payload, const char *details);
+
+// Writes made through this process (lock-free to read)
+typedef struct {
+    unsigned long long alerts_written;
+    unsigned long long events_written;
+    unsigned long long write_errors;
+} db_write_counters_t;
+
+// Read connection pool usage
+typedef struct {
+    int readers;
+    int in_use;
+    int max_in_use;
+    unsigned long long acquired;
+    unsigned long long waited;    // acquisitions that found every reader busy
+} db_reader_stats_t;
+
 // Function declarations
 
 /**
@@ -36,6 +125,40 @@ int db_init(const char *db_path);
  */
 int db_close(void);
 
+/**
+ * Enable or disable per-row log lines for inserts and audit events
+ * @param verbose Nonzero to print (default), 0 for silent operation
+ */
+void db_set_verbose(int verbose);
+
+/**
+ * Switch to WAL journal mode with synchronous=NORMAL
+ * @return 0 on success, -1 on error
+ */
+int db_enable_wal(void);
+
+/**
+ * Open a pool of read-only connections to the same file. Afterwards queries
+ * (db_query_*, cursors, stats and rollups) run on a pooled reader with its
+ * own statement cache, so they proceed concurrently with each other and
+ * with writes on the main connection. A caller waits if every reader is
+ * busy. Requires WAL mode (db_enable_wal); without a pool, queries share
+ * the writer connection. Closed by db_close().
+ * @param count Number of read connections
+ * @return 0 on success, -1 on error
+ */
+int db_open_readers(int count);
+
+void db_get_reader_stats(db_reader_stats_t *out);
+
+/**
+ * Explicit transactions, for grouping several inserts into one commit
+ * @return 0 on success, -1 on error
+ */
+int db_begin(void);
+int db_commit(void);
+int db_rollback(void);
+
 /**
  * Initialize tables from schema if they don't exist
  * @return 0 on success, -1 on error
@@ -59,7 +182,23 @@ int db_insert_verified_alert(const VerifiedAlert *alert);
 int db_log_event(const char *event_type, const char *payload, const char *details);
 
 /**
- * Query verified alerts from the database
+ * Log an audit event to audit_log with an explicit timestamp, bypassing any
+ * event sink (used when importing journaled events)
+ * @param timestamp Unix seconds, or 0 for now
+ * @return 0 on success, -1 on error
+ */
+int db_log_event_at(const char *event_type, const char *payload, const char *details,
+                    time_t timestamp);
+
+/**
+ * Route db_log_event() to fn instead of audit_log; NULL restores audit_log
+ */
+void db_set_event_sink(db_event_sink_fn fn);
+
+/**
+ * Query verified alerts from the database into a fixed array. Each element
+ * holds full copies of every column (payloads truncated to the buffer size);
+ * prefer db_foreach_verified_alert() or a cursor for large result sets.
  * @param since_timestamp Only return alerts verified after this timestamp
  * @param results Array to populate (caller allocates)
  * @param max_results Maximum number of results to return
@@ -68,12 +207,77 @@ int db_log_event(const char *event_type, const char *payload, const char *detail
 int db_query_verified_alerts(time_t since_timestamp, VerifiedAlert *results, int max_results);
 
 /**
- * Get database statistics
+ * Open a streaming cursor over verified alerts, newest first
+ * @param cursor Caller-owned cursor state
+ * @param query Filter, projection, limit and optional keyset position
+ * @return 0 on success, -1 on error
+ */
+int db_alert_cursor_open(db_alert_cursor_t *cursor, const db_alert_query_t *query);
+
+/**
+ * Advance to the next row; on success cursor->row holds its column views
+ * @return 1 if a row is available, 0 at the end, -1 on error
+ */
+int db_alert_cursor_next(db_alert_cursor_t *cursor);
+
+/**
+ * Release the cursor's statement (safe to call more than once)
+ */
+void db_alert_cursor_close(db_alert_cursor_t *cursor);
+
+/**
+ * Stream matching alerts through a callback without copying them
+ * @param next If not NULL, receives the keyset position of the last row
+ *             visited, to pass as query->after for the next page
+ * @return Number of rows visited, -1 on error
+ */
+int db_foreach_verified_alert(const db_alert_query_t *query, db_alert_row_fn fn, void *arg,
+                              db_alert_page_t *next);
+
+/**
+ * Stream alerts located inside a lat/lon rectangle (e.g. a map viewport),
+ * newest first. Served by the verified_alerts_rtree R*Tree.
+ * @param since Only alerts with verified_at >= since
+ * @param columns DB_COL_* mask of optional columns to fetch
+ * @param limit Maximum rows, 0 for no limit
+ * @return Number of rows visited, -1 on error (including min > max)
+ */
+int db_query_alerts_in_bbox(double min_lat, double min_lon, double max_lat, double max_lon,
+                            time_t since, int columns, int limit,
+                            db_alert_row_fn fn, void *arg);
+
+/**
+ * Get database statistics. Counts are maintained by triggers in the
+ * db_stats table, so this is O(1) regardless of table size.
  * @param total_alerts Output parameter for total alert count
  * @param total_events Output parameter for total event count
  * @return 0 on success, -1 on error
  */
 int db_get_stats(int *total_alerts, int *total_events);
 
+/**
+ * Visit verified alert counts per hazard type / audit event counts per
+ * event type, in name order. Types with no rows are skipped.
+ * @return Number of types visited, -1 on error
+ */
+int db_get_hazard_type_counts(db_count_fn fn, void *arg);
+int db_get_event_type_counts(db_count_fn fn, void *arg);
+
+/**
+ * Visit per-minute (DB_ROLLUP_MINUTE) or per-hour (DB_ROLLUP_HOUR) counts of
+ * verified alerts by hazard type (scope "hazard_type") or audit events by
+ * event type (scope "event_type"), for buckets starting in [from, to).
+ * Rollups outlive the raw rows, so use them for historical dashboards.
+ * @param to End of the range (exclusive), 0 for no bound
+ * @return Number of buckets visited, -1 on error
+ */
+int db_query_rollups(const char *scope, int period, time_t from, time_t to,
+                     db_rollup_fn fn, void *arg);
+
+/**
+ * Snapshot of this process's write counters; safe from any thread
+ */
+void db_get_write_counters(db_write_counters_t *out);
+
 #endif // DB_H
 
@@ -0,0 +1,698 @@
+#include "journal.h"
+#include "../timeutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define JOURNAL_VERSION 1
+#define ALIGN8(n) (((n) + 7u) & ~(size_t)7u)
+
+typedef struct {
+    journal_config_t cfg;
+    int open;
+    uint32_t segment;
+    unsigned char *map;
+    size_t write_off;
+    size_t synced_off;
+    int pending;                 // records appended since the last sync
+    uint64_t last_sync_ms;
+    journal_stats_t stats;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+    CRITICAL_SECTION mutex;
+#else
+    int fd;
+    pthread_mutex_t mutex;
+#endif
+} journal_t;
+
+static journal_t g_journal;
+
+static void journal_lock(void) {
+#ifdef _WIN32
+    EnterCriticalSection(&g_journal.mutex);
+#else
+    pthread_mutex_lock(&g_journal.mutex);
+#endif
+}
+
+static void journal_unlock(void) {
+#ifdef _WIN32
+    LeaveCriticalSection(&g_journal.mutex);
+#else
+    pthread_mutex_unlock(&g_journal.mutex);
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// CRC-32 (IEEE 802.3, reflected)
+
+static uint32_t g_crc_table[256];
+static int g_crc_ready = 0;
+
+static void crc_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        g_crc_table[i] = c;
+    }
+    g_crc_ready = 1;
+}
+
+uint32_t journal_crc32(uint32_t crc, const void *data, size_t len) {
+    if (!g_crc_ready) {
+        crc_init();
+    }
+    const unsigned char *p = (const unsigned char *)data;
+    crc = ~crc;
+    while (len--) {
+        crc = g_crc_table[(crc ^ *p++) & 0xFFu] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// ---------------------------------------------------------------------------
+// Record framing
+
+typedef struct {
+    uint32_t crc;
+    uint32_t body_len;
+    int64_t timestamp_us;
+    uint16_t type_len;
+    uint16_t flags;
+    uint32_t payload_len;
+} frame_t;
+
+static uint32_t frame_crc(const frame_t *f, const unsigned char *body) {
+    uint32_t crc = journal_crc32(0, (const unsigned char *)f + 4, JOURNAL_FRAME_SIZE - 4);
+    return journal_crc32(crc, body, f->body_len);
+}
+
+// Validate the record at off within buf[0, len). Returns the aligned record
+// length, or 0 at the end of data or on a torn/corrupt record.
+static size_t frame_check(const unsigned char *buf, size_t len, size_t off, frame_t *out) {
+    if (off + JOURNAL_FRAME_SIZE > len) {
+        return 0;
+    }
+    frame_t f;
+    memcpy(&f, buf + off, sizeof(f));
+    if (f.body_len == 0 && f.crc == 0) {
+        return 0;
+    }
+    size_t rec_len = ALIGN8((size_t)JOURNAL_FRAME_SIZE + f.body_len);
+    if (off + JOURNAL_FRAME_SIZE + f.body_len > len ||
+        (size_t)f.type_len + 1 > f.body_len ||
+        (size_t)f.type_len + 1 + f.payload_len + 1 > f.body_len) {
+        return 0;
+    }
+    if (frame_crc(&f, buf + off + JOURNAL_FRAME_SIZE) != f.crc) {
+        return 0;
+    }
+    if (out) {
+        *out = f;
+    }
+    return rec_len;
+}
+
+static void segment_path(char *out, size_t cap, const char *dir, uint32_t segment) {
+    snprintf(out, cap, "%s/journal-%08u.seg", dir, segment);
+}
+
+static void write_header(unsigned char *map, uint32_t segment) {
+    memset(map, 0, JOURNAL_HEADER_SIZE);
+    memcpy(map, JOURNAL_MAGIC, 8);
+    uint32_t version = JOURNAL_VERSION;
+    int64_t created = wallclock_us();
+    memcpy(map + 8, &version, 4);
+    memcpy(map + 12, &segment, 4);
+    memcpy(map + 16, &created, 8);
+}
+
+static int header_valid(const unsigned char *buf, size_t len) {
+    uint32_t version;
+    if (len < JOURNAL_HEADER_SIZE || memcmp(buf, JOURNAL_MAGIC, 8) != 0) {
+        return 0;
+    }
+    memcpy(&version, buf + 8, 4);
+    return version == JOURNAL_VERSION;
+}
+
+// ---------------------------------------------------------------------------
+// Platform file mapping and directory helpers
+
+static int make_dir(const char *dir) {
+#ifdef _WIN32
+    if (!CreateDirectoryA(dir, NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
+        return -1;
+    }
+#else
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Segment numbers present in dir, ascending. Caller frees *out.
+static int list_segments(const char *dir, uint32_t **out, size_t *count) {
+    size_t cap = 16;
+    size_t n = 0;
+    uint32_t *segs = (uint32_t *)malloc(cap * sizeof(uint32_t));
+    if (!segs) {
+        return -1;
+    }
+
+#ifdef _WIN32
+    char pattern[JOURNAL_PATH_MAX + 32];
+    snprintf(pattern, sizeof(pattern), "%s\\journal-*.seg", dir);
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA(pattern, &fd);
+    if (h == INVALID_HANDLE_VALUE) {
+        *out = segs;
+        *count = 0;
+        return GetLastError() == ERROR_FILE_NOT_FOUND ? 0 : -1;
+    }
+    do {
+        const char *name = fd.cFileName;
+#else
+    DIR *d = opendir(dir);
+    if (!d) {
+        free(segs);
+        return -1;
+    }
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        const char *name = ent->d_name;
+#endif
+        unsigned int seg;
+        char tail[8];
+        if (sscanf(name, "journal-%8u.se%1s", &seg, tail) == 2 && strcmp(tail, "g") == 0) {
+            if (n == cap) {
+                uint32_t *grown = (uint32_t *)realloc(segs, cap * 2 * sizeof(uint32_t));
+                if (!grown) {
+                    break;
+                }
+                segs = grown;
+                cap *= 2;
+            }
+            segs[n++] = (uint32_t)seg;
+        }
+#ifdef _WIN32
+    } while (FindNextFileA(h, &fd));
+    FindClose(h);
+#else
+    }
+    closedir(d);
+#endif
+
+    qsort(segs, n, sizeof(uint32_t), cmp_u32);
+    *out = segs;
+    *count = n;
+    return 0;
+}
+
+// Open (creating if needed) and map a segment at full size. Sets *existing
+// to its size before mapping (0 if new).
+static int segment_map(uint32_t segment, size_t *existing) {
+    char path[JOURNAL_PATH_MAX + 32];
+    segment_path(path, sizeof(path), g_journal.cfg.dir, segment);
+    size_t size = g_journal.cfg.segment_bytes;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "[journal] Cannot open %s\n", path);
+        return -1;
+    }
+    LARGE_INTEGER cur;
+    GetFileSizeEx(file, &cur);
+    *existing = (size_t)cur.QuadPart;
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE,
+                                        (DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+    if (mapping == NULL) {
+        fprintf(stderr, "[journal] CreateFileMapping failed for %s\n", path);
+        CloseHandle(file);
+        return -1;
+    }
+    void *map = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+    if (map == NULL) {
+        fprintf(stderr, "[journal] MapViewOfFile failed for %s\n", path);
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return -1;
+    }
+    g_journal.file = file;
+    g_journal.mapping = mapping;
+#else
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "[journal] Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    *existing = (size_t)st.st_size;
+    if ((size_t)st.st_size < size && ftruncate(fd, (off_t)size) != 0) {
+        fprintf(stderr, "[journal] Cannot size %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "[journal] mmap failed for %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    g_journal.fd = fd;
+#endif
+
+    g_journal.map = (unsigned char *)map;
+    g_journal.segment = segment;
+    g_journal.stats.segment = segment;
+    return 0;
+}
+
+// Flush [from, to) of the current mapping to disk
+static int map_flush(size_t from, size_t to) {
+    if (to <= from) {
+        return 0;
+    }
+#ifdef _WIN32
+    if (!FlushViewOfFile(g_journal.map + from, to - from) || !FlushFileBuffers(g_journal.file)) {
+        return -1;
+    }
+#else
+    static long page = 0;
+    if (page == 0) {
+        page = sysconf(_SC_PAGESIZE);
+    }
+    size_t start = from - (from % (size_t)page);
+    if (msync(g_journal.map + start, to - start, MS_SYNC) != 0) {
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+// Unmap the current segment, trimming the file to used bytes if sealing
+static void segment_unmap(int seal) {
+    if (!g_journal.map) {
+        return;
+    }
+    size_t used = g_journal.write_off;
+#ifdef _WIN32
+    UnmapViewOfFile(g_journal.map);
+    CloseHandle(g_journal.mapping);
+    if (seal) {
+        LARGE_INTEGER pos;
+        pos.QuadPart = (LONGLONG)used;
+        SetFilePointerEx(g_journal.file, pos, NULL, FILE_BEGIN);
+        SetEndOfFile(g_journal.file);
+    }
+    CloseHandle(g_journal.file);
+#else
+    munmap(g_journal.map, g_journal.cfg.segment_bytes);
+    if (seal && ftruncate(g_journal.fd, (off_t)used) != 0) {
+        fprintf(stderr, "[journal] Failed to trim segment %u\n", g_journal.segment);
+    }
+    close(g_journal.fd);
+#endif
+    g_journal.map = NULL;
+}
+
+static void apply_retention(void) {
+    if (g_journal.cfg.max_segments <= 0) {
+        return;
+    }
+    uint32_t *segs;
+    size_t n;
+    if (list_segments(g_journal.cfg.dir, &segs, &n) != 0) {
+        return;
+    }
+    for (size_t i = 0; i + (size_t)g_journal.cfg.max_segments < n; i++) {
+        char path[JOURNAL_PATH_MAX + 32];
+        segment_path(path, sizeof(path), g_journal.cfg.dir, segs[i]);
+        if (remove(path) == 0) {
+            g_journal.stats.segments_deleted++;
+        }
+    }
+    free(segs);
+}
+
+static int sync_locked(void) {
+    int rc = map_flush(g_journal.synced_off, g_journal.write_off);
+    if (rc == 0) {
+        g_journal.synced_off = g_journal.write_off;
+        g_journal.stats.syncs++;
+    } else {
+        g_journal.stats.errors++;
+    }
+    g_journal.pending = 0;
+    g_journal.last_sync_ms = monotonic_ms();
+    return rc;
+}
+
+static int start_segment(uint32_t segment) {
+    size_t existing = 0;
+    if (segment_map(segment, &existing) != 0) {
+        return -1;
+    }
+    write_header(g_journal.map, segment);
+    g_journal.write_off = JOURNAL_HEADER_SIZE;
+    g_journal.synced_off = 0;
+    return sync_locked();
+}
+
+static int rotate_locked(void) {
+    sync_locked();
+    segment_unmap(1);
+    g_journal.stats.rotations++;
+    if (start_segment(g_journal.segment + 1) != 0) {
+        return -1;
+    }
+    apply_retention();
+    return 0;
+}
+
+// Map the newest segment and find the end of its valid records, discarding
+// anything after them
+static int recover_tail(uint32_t segment) {
+    size_t existing = 0;
+    if (segment_map(segment, &existing) != 0) {
+        return -1;
+    }
+    size_t size = g_journal.cfg.segment_bytes;
+
+    if (!header_valid(g_journal.map, size)) {
+        // Never got as far as a durable header: start the segment over
+        memset(g_journal.map, 0, size);
+        write_header(g_journal.map, segment);
+        g_journal.write_off = JOURNAL_HEADER_SIZE;
+        g_journal.synced_off = 0;
+        return sync_locked();
+    }
+
+    size_t off = JOURNAL_HEADER_SIZE;
+    size_t rec_len;
+    while ((rec_len = frame_check(g_journal.map, size, off, NULL)) != 0) {
+        off += rec_len;
+        g_journal.stats.recovered_records++;
+    }
+
+    size_t end = size;
+    while (end > off && g_journal.map[end - 1] == 0) {
+        end--;
+    }
+    if (end > off) {
+        g_journal.stats.truncated_bytes = end - off;
+        memset(g_journal.map + off, 0, end - off);
+        fprintf(stderr, "[journal] Discarded %zu bytes of torn tail in segment %u at offset %zu\n",
+                end - off, segment, off);
+    }
+
+    g_journal.write_off = off;
+    g_journal.synced_off = 0;
+    if (sync_locked() != 0) {
+        return -1;
+    }
+
+    // A segment shorter than the configured size was sealed by a clean rotation
+    if (existing != 0 && existing < size) {
+        return rotate_locked();
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Writer API
+
+void journal_config_defaults(journal_config_t *cfg, const char *dir) {
+    if (!cfg) {
+        return;
+    }
+    memset(cfg, 0, sizeof(*cfg));
+    if (dir) {
+        strncpy(cfg->dir, dir, sizeof(cfg->dir) - 1);
+    }
+    cfg->segment_bytes = JOURNAL_DEFAULT_SEGMENT_BYTES;
+    cfg->max_segments = JOURNAL_DEFAULT_MAX_SEGMENTS;
+    cfg->sync_every = JOURNAL_DEFAULT_SYNC_EVERY;
+    cfg->sync_interval_ms = JOURNAL_DEFAULT_SYNC_INTERVAL_MS;
+}
+
+int journal_open(const journal_config_t *cfg) {
+    if (g_journal.open) {
+        fprintf(stderr, "[journal] Already open\n");
+        return -1;
+    }
+    if (!cfg || cfg->dir[0] == '\0' || cfg->segment_bytes < 4096) {
+        fprintf(stderr, "[journal] Invalid configuration\n");
+        return -1;
+    }
+
+    memset(&g_journal, 0, sizeof(g_journal));
+    g_journal.cfg = *cfg;
+    g_journal.cfg.segment_bytes = ALIGN8(cfg->segment_bytes);
+    if (g_journal.cfg.sync_every <= 0) {
+        g_journal.cfg.sync_every = 1;
+    }
+
+    if (make_dir(cfg->dir) != 0) {
+        fprintf(stderr, "[journal] Cannot create directory %s\n", cfg->dir);
+        return -1;
+    }
+
+    uint32_t *segs;
+    size_t n;
+    if (list_segments(cfg->dir, &segs, &n) != 0) {
+        fprintf(stderr, "[journal] Cannot list %s\n", cfg->dir);
+        return -1;
+    }
+    int rc = n > 0 ? recover_tail(segs[n - 1]) : start_segment(1);
+    free(segs);
+    if (rc != 0) {
+        segment_unmap(0);
+        return -1;
+    }
+
+#ifdef _WIN32
+    InitializeCriticalSection(&g_journal.mutex);
+#else
+    pthread_mutex_init(&g_journal.mutex, NULL);
+#endif
+    g_journal.open = 1;
+
+    printf("[journal] Opened %s at segment %u offset %zu (%llu records recovered)\n",
+           cfg->dir, g_journal.segment, g_journal.write_off,
+           (unsigned long long)g_journal.stats.recovered_records);
+    return 0;
+}
+
+void journal_close(void) {
+    if (!g_journal.open) {
+        return;
+    }
+    journal_lock();
+    sync_locked();
+    // Keep the segment at full size so a restart continues appending to it
+    segment_unmap(0);
+    g_journal.open = 0;
+    journal_unlock();
+#ifdef _WIN32
+    DeleteCriticalSection(&g_journal.mutex);
+#else
+    pthread_mutex_destroy(&g_journal.mutex);
+#endif
+    printf("[journal] Closed\n");
+}
+
+int journal_is_open(void) {
+    return g_journal.open;
+}
+
+int journal_append(const char *event_type, const char *payload, const char *details) {
+    if (!g_journal.open || event_type == NULL) {
+        return -1;
+    }
+
+    size_t type_len = strlen(event_type);
+    size_t payload_len = payload ? strlen(payload) : 0;
+    size_t details_len = details ? strlen(details) : 0;
+    size_t body_len = type_len + 1 + payload_len + 1 + details_len + 1;
+    size_t rec_len = ALIGN8((size_t)JOURNAL_FRAME_SIZE + body_len);
+    if (type_len > UINT16_MAX || rec_len > g_journal.cfg.segment_bytes - JOURNAL_HEADER_SIZE) {
+        return -1;
+    }
+
+    journal_lock();
+    if (g_journal.write_off + rec_len > g_journal.cfg.segment_bytes && rotate_locked() != 0) {
+        g_journal.stats.errors++;
+        journal_unlock();
+        return -1;
+    }
+
+    unsigned char *rec = g_journal.map + g_journal.write_off;
+    unsigned char *body = rec + JOURNAL_FRAME_SIZE;
+    memcpy(body, event_type, type_len + 1);
+    if (payload) {
+        memcpy(body + type_len + 1, payload, payload_len + 1);
+    } else {
+        body[type_len + 1] = '\0';
+    }
+    if (details) {
+        memcpy(body + type_len + 1 + payload_len + 1, details, details_len + 1);
+    } else {
+        body[type_len + 1 + payload_len + 1] = '\0';
+    }
+
+    frame_t f;
+    f.body_len = (uint32_t)body_len;
+    f.timestamp_us = wallclock_us();
+    f.type_len = (uint16_t)type_len;
+    f.flags = (uint16_t)((payload ? JOURNAL_HAS_PAYLOAD : 0) | (details ? JOURNAL_HAS_DETAILS : 0));
+    f.payload_len = (uint32_t)payload_len;
+    f.crc = frame_crc(&f, body);
+    memcpy(rec, &f, sizeof(f));
+
+    g_journal.write_off += rec_len;
+    g_journal.stats.appended++;
+    g_journal.stats.bytes += rec_len;
+
+    int rc = 0;
+    if (++g_journal.pending >= g_journal.cfg.sync_every ||
+        monotonic_ms() - g_journal.last_sync_ms >= (uint64_t)g_journal.cfg.sync_interval_ms) {
+        rc = sync_locked();
+    }
+    journal_unlock();
+    return rc;
+}
+
+int journal_sync(void) {
+    if (!g_journal.open) {
+        return -1;
+    }
+    journal_lock();
+    int rc = sync_locked();
+    journal_unlock();
+    return rc;
+}
+
+void journal_get_stats(journal_stats_t *out) {
+    if (!out) {
+        return;
+    }
+    if (!g_journal.open) {
+        *out = g_journal.stats;
+        return;
+    }
+    journal_lock();
+    *out = g_journal.stats;
+    journal_unlock();
+}
+
+void journal_print_stats(void) {
+    journal_stats_t st;
+    journal_get_stats(&st);
+    printf("[journal] %llu records (%llu bytes), %llu syncs, %llu rotations, "
+           "%llu segments deleted, %llu errors, segment %u\n",
+           (unsigned long long)st.appended, (unsigned long long)st.bytes,
+           (unsigned long long)st.syncs, (unsigned long long)st.rotations,
+           (unsigned long long)st.segments_deleted, (unsigned long long)st.errors, st.segment);
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+
+static unsigned char *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char *buf = size > 0 ? (unsigned char *)malloc((size_t)size) : NULL;
+    if (buf && fread(buf, 1, (size_t)size, f) != (size_t)size) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    *len = buf ? (size_t)size : 0;
+    return buf;
+}
+
+long long journal_scan(const char *dir, int64_t from_us, int64_t to_us,
+                       journal_record_fn fn, void *arg) {
+    uint32_t *segs;
+    size_t n;
+    if (!dir || !fn || list_segments(dir, &segs, &n) != 0) {
+        return -1;
+    }
+
+    long long visited = 0;
+    int stop = 0;
+    for (size_t i = 0; i < n && !stop; i++) {
+        char path[JOURNAL_PATH_MAX + 32];
+        segment_path(path, sizeof(path), dir, segs[i]);
+        size_t len;
+        unsigned char *buf = read_file(path, &len);
+        if (!buf) {
+            continue;
+        }
+        if (!header_valid(buf, len)) {
+            free(buf);
+            continue;
+        }
+
+        size_t off = JOURNAL_HEADER_SIZE;
+        size_t rec_len;
+        frame_t f;
+        while ((rec_len = frame_check(buf, len, off, &f)) != 0) {
+            if (to_us != 0 && f.timestamp_us >= to_us) {
+                stop = 1;   // records are in time order
+                break;
+            }
+            if (f.timestamp_us >= from_us) {
+                const char *body = (const char *)buf + off + JOURNAL_FRAME_SIZE;
+                journal_record_t rec;
+                rec.timestamp_us = f.timestamp_us;
+                rec.event_type = body;
+                rec.payload = (f.flags & JOURNAL_HAS_PAYLOAD) ? body + f.type_len + 1 : NULL;
+                rec.details = (f.flags & JOURNAL_HAS_DETAILS)
+                              ? body + f.type_len + 1 + f.payload_len + 1 : NULL;
+                rec.segment = segs[i];
+                rec.offset = off;
+                visited++;
+                if (fn(&rec, arg)) {
+                    stop = 1;
+                    break;
+                }
+            }
+            off += rec_len;
+        }
+        free(buf);
+    }
+    free(segs);
+    return visited;
+}
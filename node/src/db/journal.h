@@ -0,0 +1,93 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Append-only event journal
+//
+// An alternative to the audit_log table for high event rates. Events are
+// appended as CRC-framed records to fixed-size segment files that are
+// memory-mapped while being written, so an append is a memcpy under a
+// mutex. Dirty pages are msync'd in batches: every sync_every records, or on
+// the first append after sync_interval_ms; journal_sync() forces one. A full
+// segment is trimmed to its used length and a new one started; the oldest
+// segments are deleted beyond max_segments.
+//
+// On open, the newest segment is scanned and anything after the last record
+// with a valid CRC (a torn write from a crash) is zeroed and overwritten.
+//
+// Segment layout: a 64-byte header, then records aligned to 8 bytes:
+//   uint32 crc          CRC-32 of the rest of the frame and the body
+//   uint32 body_len
+//   int64  timestamp_us wall clock
+//   uint16 type_len     lengths exclude the NUL stored after each string
+//   uint16 flags        JOURNAL_HAS_PAYLOAD / JOURNAL_HAS_DETAILS
+//   uint32 payload_len
+//   body: event_type\0 payload\0 details\0
+// A zero frame marks the end of written data.
+
+#define JOURNAL_MAGIC "V2VJRNL1"
+#define JOURNAL_HEADER_SIZE 64
+#define JOURNAL_FRAME_SIZE 24
+#define JOURNAL_HAS_PAYLOAD 0x1
+#define JOURNAL_HAS_DETAILS 0x2
+#define JOURNAL_DEFAULT_SEGMENT_BYTES (16u * 1024u * 1024u)
+#define JOURNAL_DEFAULT_MAX_SEGMENTS 64
+#define JOURNAL_DEFAULT_SYNC_EVERY 256
+#define JOURNAL_DEFAULT_SYNC_INTERVAL_MS 200
+#define JOURNAL_PATH_MAX 512
+
+typedef struct {
+    char dir[JOURNAL_PATH_MAX];   // directory holding journal-NNNNNNNN.seg files
+    size_t segment_bytes;
+    int max_segments;             // retention; 0 keeps everything
+    int sync_every;               // records between msyncs; 1 syncs every append
+    int sync_interval_ms;         // longest dirty data may stay unsynced
+} journal_config_t;
+
+typedef struct {
+    uint64_t appended;
+    uint64_t bytes;
+    uint64_t syncs;
+    uint64_t rotations;
+    uint64_t segments_deleted;
+    uint64_t recovered_records;   // valid records found in the tail segment on open
+    uint64_t truncated_bytes;     // torn tail discarded on open
+    uint64_t errors;
+    uint32_t segment;             // current segment number
+} journal_stats_t;
+
+// One decoded record; strings point into the reader's buffer
+typedef struct {
+    int64_t timestamp_us;
+    const char *event_type;
+    const char *payload;          // NULL if absent
+    const char *details;          // NULL if absent
+    uint32_t segment;
+    uint64_t offset;
+} journal_record_t;
+
+// Return nonzero to stop a scan early
+typedef int (*journal_record_fn)(const journal_record_t *rec, void *arg);
+
+void journal_config_defaults(journal_config_t *cfg, const char *dir);
+
+// Writer (one per process)
+int journal_open(const journal_config_t *cfg);
+void journal_close(void);
+int journal_is_open(void);
+int journal_append(const char *event_type, const char *payload, const char *details);
+int journal_sync(void);
+void journal_get_stats(journal_stats_t *out);
+void journal_print_stats(void);
+
+// Reader: visit records with from_us <= timestamp_us < to_us (0 for an open
+// bound) across all segments in order. Safe to run while a writer appends.
+// Returns the number of records visited, -1 if the directory cannot be read.
+long long journal_scan(const char *dir, int64_t from_us, int64_t to_us,
+                       journal_record_fn fn, void *arg);
+
+uint32_t journal_crc32(uint32_t crc, const void *data, size_t len);
+
+#endif // JOURNAL_H
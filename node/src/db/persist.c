@@ -0,0 +1,456 @@
+#include "persist.h"
+#include "../timeutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#define NO_DEADLINE UINT64_MAX
+
+typedef enum {
+    PERSIST_ITEM_ALERT = 0,
+    PERSIST_ITEM_EVENT
+} persist_item_type_t;
+
+typedef struct {
+    persist_item_type_t type;
+    uint64_t enqueued_ns;
+    char event_type[PERSIST_EVENT_TYPE_MAX];
+    char payload[PERSIST_PAYLOAD_MAX];
+    char details[PERSIST_DETAILS_MAX];
+    int has_payload;
+    VerifiedAlert alert;
+} persist_item_t;
+
+typedef struct {
+    persist_config_t cfg;
+    persist_item_t *items;
+    size_t head;
+    size_t count;
+    uint64_t accepted_seq;   // items ever queued
+    uint64_t completed_seq;  // items ever taken off the queue and committed
+    int flush_waiters;
+    uint64_t next_retention_ns;
+    int stopping;
+    int running;
+    persist_stats_t stats;
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE work;
+    CONDITION_VARIABLE done;
+    HANDLE thread;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    pthread_t thread;
+#endif
+} persist_ctx_t;
+
+static persist_ctx_t g_persist;
+
+static void persist_lock(void) {
+#ifdef _WIN32
+    EnterCriticalSection(&g_persist.mutex);
+#else
+    pthread_mutex_lock(&g_persist.mutex);
+#endif
+}
+
+static void persist_unlock(void) {
+#ifdef _WIN32
+    LeaveCriticalSection(&g_persist.mutex);
+#else
+    pthread_mutex_unlock(&g_persist.mutex);
+#endif
+}
+
+#ifdef _WIN32
+typedef CONDITION_VARIABLE persist_cond_t;
+#else
+typedef pthread_cond_t persist_cond_t;
+#endif
+
+static void cond_broadcast(persist_cond_t *cond) {
+#ifdef _WIN32
+    WakeAllConditionVariable(cond);
+#else
+    pthread_cond_broadcast(cond);
+#endif
+}
+
+// Sleep on cond until woken or the monotonic deadline passes
+static void cond_wait_until(persist_cond_t *cond, uint64_t deadline_ns) {
+#ifdef _WIN32
+    DWORD ms = INFINITE;
+    if (deadline_ns != NO_DEADLINE) {
+        uint64_t now = monotonic_ns();
+        ms = deadline_ns > now ? (DWORD)((deadline_ns - now + 999999) / 1000000) : 0;
+    }
+    SleepConditionVariableCS(cond, &g_persist.mutex, ms);
+#else
+    if (deadline_ns == NO_DEADLINE) {
+        pthread_cond_wait(cond, &g_persist.mutex);
+        return;
+    }
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline_ns / 1000000000ull);
+    ts.tv_nsec = (long)(deadline_ns % 1000000000ull);
+    pthread_cond_timedwait(cond, &g_persist.mutex, &ts);
+#endif
+}
+
+void persist_config_defaults(persist_config_t *cfg) {
+    if (!cfg) {
+        return;
+    }
+    cfg->capacity = PERSIST_DEFAULT_CAPACITY;
+    cfg->batch_max = PERSIST_DEFAULT_BATCH_MAX;
+    cfg->batch_window_ms = PERSIST_DEFAULT_BATCH_WINDOW_MS;
+    cfg->wal = 1;
+    cfg->retention_interval_ms = 0;
+    db_retention_config_defaults(&cfg->retention, NULL);
+}
+
+static int write_item(const persist_item_t *item) {
+    if (item->type == PERSIST_ITEM_ALERT) {
+        if (db_insert_verified_alert(&item->alert) != 0) {
+            return -1;
+        }
+        if (item->details[0] != '\0') {
+            return db_log_event("alert_verified", NULL, item->details);
+        }
+        return 0;
+    }
+    return db_log_event(item->event_type, item->has_payload ? item->payload : NULL,
+                        item->details[0] != '\0' ? item->details : NULL);
+}
+
+// Write one batch from the front of the queue as a single transaction.
+// Runs without the lock: producers only touch slots behind the batch.
+static void write_batch(size_t n, uint64_t *failed) {
+    int in_txn = db_begin() == 0;
+    for (size_t i = 0; i < n; i++) {
+        const persist_item_t *item = &g_persist.items[(g_persist.head + i) % g_persist.cfg.capacity];
+        if (write_item(item) != 0) {
+            (*failed)++;
+        }
+    }
+    if (in_txn && db_commit() != 0) {
+        db_rollback();
+        *failed = n;
+    }
+}
+
+// Deadline for the next retention pass, or NO_DEADLINE if disabled
+static uint64_t retention_deadline(void) {
+    return g_persist.cfg.retention_interval_ms > 0 ? g_persist.next_retention_ns : NO_DEADLINE;
+}
+
+// Run retention if it is due. Called with the lock held; drops it while
+// SQLite works so producers keep queueing.
+static void run_retention_if_due(void) {
+    uint64_t now = monotonic_ns();
+    if (retention_deadline() == NO_DEADLINE || now < g_persist.next_retention_ns) {
+        return;
+    }
+    g_persist.next_retention_ns = now + (uint64_t)g_persist.cfg.retention_interval_ms * 1000000ull;
+    persist_unlock();
+    db_retention_run(&g_persist.cfg.retention, time(NULL), NULL);
+    persist_lock();
+    g_persist.stats.retention_runs++;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI persist_thread(LPVOID arg)
+#else
+static void* persist_thread(void* arg)
+#endif
+{
+    (void)arg;
+    uint64_t window_ns = (uint64_t)g_persist.cfg.batch_window_ms * 1000000ull;
+
+    persist_lock();
+    for (;;) {
+        run_retention_if_due();
+        while (g_persist.count == 0 && !g_persist.stopping) {
+            cond_wait_until(&g_persist.work, retention_deadline());
+            run_retention_if_due();
+        }
+        if (g_persist.count == 0) {
+            break;  // stopping and drained
+        }
+
+        // Group commit: give the oldest item up to one window to gather
+        // companions, unless a full batch is ready or someone is waiting
+        uint64_t deadline = g_persist.items[g_persist.head].enqueued_ns + window_ns;
+        while (g_persist.count < g_persist.cfg.batch_max && !g_persist.stopping &&
+               g_persist.flush_waiters == 0 && monotonic_ns() < deadline) {
+            cond_wait_until(&g_persist.work, deadline);
+        }
+
+        size_t n = g_persist.count < g_persist.cfg.batch_max ? g_persist.count
+                                                             : g_persist.cfg.batch_max;
+        persist_unlock();
+
+        uint64_t failed = 0;
+        uint64_t start = monotonic_ns();
+        write_batch(n, &failed);
+        uint64_t elapsed = monotonic_ns() - start;
+
+        persist_lock();
+        g_persist.head = (g_persist.head + n) % g_persist.cfg.capacity;
+        g_persist.count -= n;
+        g_persist.completed_seq += n;
+        g_persist.stats.written += n - failed;
+        g_persist.stats.failed += failed;
+        g_persist.stats.batches++;
+        g_persist.stats.commit_ns_total += elapsed;
+        if (n > g_persist.stats.max_batch) {
+            g_persist.stats.max_batch = n;
+        }
+        cond_broadcast(&g_persist.done);
+    }
+    persist_unlock();
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+int persist_start(const persist_config_t *cfg) {
+    persist_config_t defaults;
+    if (!cfg) {
+        persist_config_defaults(&defaults);
+        cfg = &defaults;
+    }
+    if (g_persist.running) {
+        fprintf(stderr, "[persist] Already running\n");
+        return -1;
+    }
+    if (g_db == NULL || cfg->capacity == 0 || cfg->batch_max == 0 || cfg->batch_window_ms < 0) {
+        fprintf(stderr, "[persist] Invalid configuration or database not initialized\n");
+        return -1;
+    }
+
+    memset(&g_persist, 0, sizeof(g_persist));
+    g_persist.cfg = *cfg;
+    g_persist.items = (persist_item_t *)calloc(cfg->capacity, sizeof(persist_item_t));
+    if (!g_persist.items) {
+        fprintf(stderr, "[persist] Failed to allocate queue (%zu items)\n", cfg->capacity);
+        return -1;
+    }
+
+    g_persist.next_retention_ns = monotonic_ns();   // first pass right away
+
+    if (cfg->wal && db_enable_wal() != 0) {
+        fprintf(stderr, "[persist] Continuing without WAL\n");
+    }
+
+#ifdef _WIN32
+    InitializeCriticalSection(&g_persist.mutex);
+    InitializeConditionVariable(&g_persist.work);
+    InitializeConditionVariable(&g_persist.done);
+    g_persist.thread = CreateThread(NULL, 0, persist_thread, NULL, 0, NULL);
+    if (g_persist.thread == NULL) {
+        fprintf(stderr, "[persist] CreateThread failed\n");
+        DeleteCriticalSection(&g_persist.mutex);
+        free(g_persist.items);
+        g_persist.items = NULL;
+        return -1;
+    }
+#else
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (pthread_mutex_init(&g_persist.mutex, NULL) != 0 ||
+        pthread_cond_init(&g_persist.work, &attr) != 0 ||
+        pthread_cond_init(&g_persist.done, &attr) != 0) {
+        pthread_condattr_destroy(&attr);
+        fprintf(stderr, "[persist] Failed to initialize locks\n");
+        free(g_persist.items);
+        g_persist.items = NULL;
+        return -1;
+    }
+    pthread_condattr_destroy(&attr);
+    if (pthread_create(&g_persist.thread, NULL, persist_thread, NULL) != 0) {
+        fprintf(stderr, "[persist] pthread_create failed\n");
+        pthread_mutex_destroy(&g_persist.mutex);
+        pthread_cond_destroy(&g_persist.work);
+        pthread_cond_destroy(&g_persist.done);
+        free(g_persist.items);
+        g_persist.items = NULL;
+        return -1;
+    }
+#endif
+    g_persist.running = 1;
+
+    printf("[persist] Write-behind started (%zu slots, batch %zu items / %d ms%s)\n",
+           cfg->capacity, cfg->batch_max, cfg->batch_window_ms, cfg->wal ? ", WAL" : "");
+    return 0;
+}
+
+void persist_stop(void) {
+    if (!g_persist.running) {
+        return;
+    }
+
+    persist_lock();
+    g_persist.stopping = 1;
+    cond_broadcast(&g_persist.work);
+    persist_unlock();
+
+#ifdef _WIN32
+    WaitForSingleObject(g_persist.thread, INFINITE);
+    CloseHandle(g_persist.thread);
+    DeleteCriticalSection(&g_persist.mutex);
+#else
+    pthread_join(g_persist.thread, NULL);
+    pthread_mutex_destroy(&g_persist.mutex);
+    pthread_cond_destroy(&g_persist.work);
+    pthread_cond_destroy(&g_persist.done);
+#endif
+
+    free(g_persist.items);
+    g_persist.items = NULL;
+    g_persist.running = 0;
+    printf("[persist] Write-behind stopped\n");
+}
+
+int persist_running(void) {
+    return g_persist.running;
+}
+
+// Claim the next free slot, or NULL if full/stopped. Called with the lock held.
+static persist_item_t *claim_slot(void) {
+    if (g_persist.stopping) {
+        return NULL;
+    }
+    if (g_persist.count == g_persist.cfg.capacity) {
+        g_persist.stats.dropped++;
+        return NULL;
+    }
+    persist_item_t *item = &g_persist.items[(g_persist.head + g_persist.count) % g_persist.cfg.capacity];
+    item->enqueued_ns = monotonic_ns();
+    return item;
+}
+
+// Publish the slot returned by claim_slot. Called with the lock held.
+static void publish_slot(void) {
+    g_persist.count++;
+    g_persist.accepted_seq++;
+    g_persist.stats.enqueued++;
+    if (g_persist.count > g_persist.stats.high_water) {
+        g_persist.stats.high_water = g_persist.count;
+    }
+    cond_broadcast(&g_persist.work);
+}
+
+static void copy_text(char *dst, size_t cap, const char *src) {
+    if (src == NULL) {
+        dst[0] = '\0';
+        return;
+    }
+    size_t len = strlen(src);
+    if (len >= cap) {
+        len = cap - 1;
+    }
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+int persist_enqueue_alert(const VerifiedAlert *alert, const char *details) {
+    if (alert == NULL || !g_persist.running) {
+        return -1;
+    }
+
+    persist_lock();
+    persist_item_t *item = claim_slot();
+    if (item == NULL) {
+        persist_unlock();
+        return -1;
+    }
+    item->type = PERSIST_ITEM_ALERT;
+    item->alert = *alert;
+    copy_text(item->details, sizeof(item->details), details);
+    publish_slot();
+    persist_unlock();
+    return 0;
+}
+
+int persist_enqueue_event(const char *event_type, const char *payload, const char *details) {
+    if (event_type == NULL || !g_persist.running) {
+        return -1;
+    }
+
+    persist_lock();
+    persist_item_t *item = claim_slot();
+    if (item == NULL) {
+        persist_unlock();
+        return -1;
+    }
+    item->type = PERSIST_ITEM_EVENT;
+    copy_text(item->event_type, sizeof(item->event_type), event_type);
+    copy_text(item->payload, sizeof(item->payload), payload);
+    item->has_payload = payload != NULL;
+    copy_text(item->details, sizeof(item->details), details);
+    publish_slot();
+    persist_unlock();
+    return 0;
+}
+
+int persist_flush(int timeout_ms) {
+    if (!g_persist.running) {
+        return 0;
+    }
+
+    uint64_t deadline = timeout_ms < 0 ? NO_DEADLINE
+                                       : monotonic_ns() + (uint64_t)timeout_ms * 1000000ull;
+    persist_lock();
+    uint64_t target = g_persist.accepted_seq;
+    g_persist.flush_waiters++;
+    cond_broadcast(&g_persist.work);  // skip the rest of the batch window
+    while (g_persist.completed_seq < target &&
+           (deadline == NO_DEADLINE || monotonic_ns() < deadline)) {
+        cond_wait_until(&g_persist.done, deadline);
+    }
+    g_persist.flush_waiters--;
+    int ok = g_persist.completed_seq >= target;
+    persist_unlock();
+    return ok ? 0 : -1;
+}
+
+void persist_get_stats(persist_stats_t *out) {
+    if (!out) {
+        return;
+    }
+    if (!g_persist.running) {
+        *out = g_persist.stats;
+        return;
+    }
+    persist_lock();
+    *out = g_persist.stats;
+    out->queued = g_persist.count;
+    persist_unlock();
+}
+
+void persist_print_stats(void) {
+    persist_stats_t st;
+    persist_get_stats(&st);
+    double avg_batch = st.batches ? (double)(st.written + st.failed) / (double)st.batches : 0.0;
+    double avg_commit_ms = st.batches ? (double)st.commit_ns_total / (double)st.batches / 1e6 : 0.0;
+    printf("[persist] %llu queued, %llu written, %llu failed, %llu dropped; "
+           "%llu transactions (avg %.1f items, max %llu, %.2f ms each), peak queue %zu, "
+           "%llu retention passes\n",
+           (unsigned long long)st.enqueued, (unsigned long long)st.written,
+           (unsigned long long)st.failed, (unsigned long long)st.dropped,
+           (unsigned long long)st.batches, avg_batch, (unsigned long long)st.max_batch,
+           avg_commit_ms, st.high_water, (unsigned long long)st.retention_runs);
+}
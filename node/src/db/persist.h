@@ -0,0 +1,86 @@
+#ifndef PERSIST_H
+#define PERSIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "db.h"
+#include "retention.h"
+
+// Write-behind persistence
+//
+// Verified alerts and audit events are copied into a bounded queue and
+// written by a dedicated thread, so the thread that promoted an alert never
+// waits on SQLite. The writer groups whatever is pending into one
+// transaction, committing once batch_max items are queued or batch_window_ms
+// after the first one arrived, whichever comes first. Because it is the only
+// writer, it also runs partition retention (retention.h) between batches.
+
+#define PERSIST_DEFAULT_CAPACITY 1024
+#define PERSIST_DEFAULT_BATCH_MAX 64
+#define PERSIST_DEFAULT_BATCH_WINDOW_MS 50
+#define PERSIST_DEFAULT_RETENTION_INTERVAL_MS 60000
+#define PERSIST_EVENT_TYPE_MAX 32
+#define PERSIST_PAYLOAD_MAX 512
+#define PERSIST_DETAILS_MAX 256
+
+typedef struct {
+    size_t capacity;         // queued items before enqueue starts failing
+    size_t batch_max;        // items per transaction
+    int batch_window_ms;     // longest an item waits for companions
+    int wal;                 // switch the database to WAL mode on start
+    int retention_interval_ms;   // how often to run retention; 0 disables it
+    db_retention_config_t retention;
+} persist_config_t;
+
+typedef struct {
+    uint64_t enqueued;
+    uint64_t dropped;        // queue full
+    uint64_t written;
+    uint64_t failed;         // rows rejected by SQLite
+    uint64_t batches;        // committed transactions
+    uint64_t max_batch;
+    uint64_t commit_ns_total;
+    uint64_t retention_runs;
+    size_t queued;
+    size_t high_water;
+} persist_stats_t;
+
+void persist_config_defaults(persist_config_t *cfg);
+
+/**
+ * Start the writer thread. db_init() must already have succeeded.
+ * @return 0 on success, -1 on error
+ */
+int persist_start(const persist_config_t *cfg);
+
+/**
+ * Write everything still queued, then stop and join the writer thread
+ */
+void persist_stop(void);
+
+int persist_running(void);
+
+/**
+ * Queue a verified alert; details, if given, is logged as its
+ * "alert_verified" audit event in the same transaction.
+ * Never blocks. @return 0 if queued, -1 if the queue is full or stopped
+ */
+int persist_enqueue_alert(const VerifiedAlert *alert, const char *details);
+
+/**
+ * Queue an audit event (see db_log_event). Never blocks.
+ * @return 0 if queued, -1 if the queue is full or stopped
+ */
+int persist_enqueue_event(const char *event_type, const char *payload, const char *details);
+
+/**
+ * Barrier: wait until everything queued before this call is committed
+ * @param timeout_ms Maximum wait, or a negative value to wait indefinitely
+ * @return 0 when flushed, -1 on timeout
+ */
+int persist_flush(int timeout_ms);
+
+void persist_get_stats(persist_stats_t *out);
+void persist_print_stats(void);
+
+#endif // PERSIST_H
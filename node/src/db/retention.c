@@ -0,0 +1,318 @@
+#include "retention.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <sys/stat.h>
+#endif
+
+#define DAY_SECONDS 86400
+
+#define ALERT_COLUMNS \
+    "id, alert_key, latitude, longitude, hazard_type, confidence, first_seen, " \
+    "verified_at, confirmations, confirmers, raw_payload"
+#define EVENT_COLUMNS "id, event_type, timestamp, payload, details"
+
+// Same layout as the main tables; ids are kept so rows can be correlated
+static const char *k_archive_schema_sql =
+    "CREATE TABLE IF NOT EXISTS arc.verified_alerts ("
+    "    id INTEGER PRIMARY KEY,"
+    "    alert_key TEXT NOT NULL UNIQUE,"
+    "    latitude REAL NOT NULL,"
+    "    longitude REAL NOT NULL,"
+    "    hazard_type TEXT NOT NULL,"
+    "    confidence REAL NOT NULL,"
+    "    first_seen INTEGER NOT NULL,"
+    "    verified_at INTEGER NOT NULL,"
+    "    confirmations INTEGER NOT NULL,"
+    "    confirmers TEXT,"
+    "    raw_payload TEXT"
+    ");"
+    "CREATE TABLE IF NOT EXISTS arc.audit_log ("
+    "    id INTEGER PRIMARY KEY,"
+    "    event_type TEXT NOT NULL,"
+    "    timestamp INTEGER NOT NULL,"
+    "    payload TEXT,"
+    "    details TEXT"
+    ");"
+    "CREATE INDEX IF NOT EXISTS arc.idx_verified_at ON verified_alerts(verified_at);"
+    "CREATE INDEX IF NOT EXISTS arc.idx_timestamp ON audit_log(timestamp);";
+
+static const char *k_partitions_sql =
+    "CREATE TABLE IF NOT EXISTS db_partitions ("
+    "    day INTEGER PRIMARY KEY,"      // UTC midnight
+    "    path TEXT NOT NULL,"
+    "    alerts INTEGER NOT NULL DEFAULT 0,"
+    "    events INTEGER NOT NULL DEFAULT 0,"
+    "    archived_at INTEGER NOT NULL"
+    ");";
+
+void db_retention_config_defaults(db_retention_config_t *cfg, const char *archive_dir) {
+    if (!cfg) {
+        return;
+    }
+    memset(cfg, 0, sizeof(*cfg));
+    if (archive_dir) {
+        strncpy(cfg->archive_dir, archive_dir, sizeof(cfg->archive_dir) - 1);
+    }
+    cfg->hot_days = RETENTION_DEFAULT_HOT_DAYS;
+    cfg->archive_days = RETENTION_DEFAULT_ARCHIVE_DAYS;
+    cfg->minute_rollup_days = RETENTION_DEFAULT_MINUTE_ROLLUP_DAYS;
+    cfg->hour_rollup_days = RETENTION_DEFAULT_HOUR_ROLLUP_DAYS;
+}
+
+static int make_dir(const char *dir) {
+#ifdef _WIN32
+    if (!CreateDirectoryA(dir, NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
+        return -1;
+    }
+#else
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+static void format_day(char *out, size_t cap, time_t day) {
+    struct tm tm;
+#ifdef _WIN32
+    gmtime_s(&tm, &day);
+#else
+    gmtime_r(&day, &tm);
+#endif
+    strftime(out, cap, "%Y%m%d", &tm);
+}
+
+// Run a statement taking up to two integer parameters. These run a few times
+// per day at most, so they are prepared on demand rather than cached.
+// @return Rows changed, -1 on error
+static long long exec_range(const char *sql, sqlite3_int64 a, sqlite3_int64 b) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(g_db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "[db] Retention prepare failed: %s\n", sqlite3_errmsg(g_db));
+        return -1;
+    }
+    sqlite3_bind_int64(stmt, 1, a);
+    sqlite3_bind_int64(stmt, 2, b);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE && rc != SQLITE_ROW) {
+        fprintf(stderr, "[db] Retention step failed: %s\n", sqlite3_errmsg(g_db));
+        return -1;
+    }
+    return sqlite3_changes(g_db);
+}
+
+// Oldest timestamp in either main table, or -1 if both are empty
+static sqlite3_int64 oldest_row(void) {
+    sqlite3_stmt *stmt;
+    sqlite3_int64 oldest = -1;
+    if (sqlite3_prepare_v2(g_db,
+                           "SELECT MIN(t) FROM ("
+                           "    SELECT MIN(verified_at) AS t FROM verified_alerts"
+                           "    UNION ALL SELECT MIN(timestamp) FROM audit_log);",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+        oldest = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return oldest;
+}
+
+static int attach_archive(const char *path) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(g_db, "ATTACH DATABASE ?1 AS arc;", -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, path, -1, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "[db] Cannot attach archive %s: %s\n", path, sqlite3_errmsg(g_db));
+        return -1;
+    }
+
+    char *err_msg = NULL;
+    if (sqlite3_exec(g_db, k_archive_schema_sql, NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "[db] Cannot create archive tables in %s: %s\n", path, err_msg);
+        sqlite3_free(err_msg);
+        sqlite3_exec(g_db, "DETACH DATABASE arc;", NULL, NULL, NULL);
+        return -1;
+    }
+    return 0;
+}
+
+// Catalog the attached archive with its current row counts
+static int record_partition(time_t day, const char *path, time_t now) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(g_db,
+                           "INSERT OR REPLACE INTO db_partitions (day, path, alerts, events, archived_at) "
+                           "VALUES (?1, ?2, (SELECT COUNT(*) FROM arc.verified_alerts), "
+                           "        (SELECT COUNT(*) FROM arc.audit_log), ?3);",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)day);
+    sqlite3_bind_text(stmt, 2, path, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 3, (sqlite3_int64)now);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE ? 0 : -1;
+}
+
+/**
+ * Move one UTC day of rows out of the main tables. Copy and delete share a
+ * transaction; with WAL the commit is atomic per file, so after a crash a
+ * day can be both archived and still present, and is copied again with
+ * INSERT OR REPLACE by the next run.
+ */
+static int rotate_day(const db_retention_config_t *cfg, time_t day, time_t now,
+                      db_retention_result_t *result) {
+    char path[RETENTION_PATH_MAX + 32];
+    int archive = cfg->archive_dir[0] != '\0';
+    if (archive) {
+        char date[16];
+        format_day(date, sizeof(date), day);
+        snprintf(path, sizeof(path), "%s/v2v-%s.db", cfg->archive_dir, date);
+        if (attach_archive(path) != 0) {
+            return -1;
+        }
+    }
+
+    sqlite3_int64 from = (sqlite3_int64)day;
+    sqlite3_int64 to = from + DAY_SECONDS;
+    long long alerts = 0, events = 0;
+    int ok = db_begin() == 0;
+    if (ok && archive) {
+        alerts = exec_range("INSERT OR REPLACE INTO arc.verified_alerts (" ALERT_COLUMNS ") "
+                            "SELECT " ALERT_COLUMNS " FROM main.verified_alerts "
+                            "WHERE verified_at >= ?1 AND verified_at < ?2;", from, to);
+        events = exec_range("INSERT OR REPLACE INTO arc.audit_log (" EVENT_COLUMNS ") "
+                            "SELECT " EVENT_COLUMNS " FROM main.audit_log "
+                            "WHERE timestamp >= ?1 AND timestamp < ?2;", from, to);
+        ok = alerts >= 0 && events >= 0 && record_partition(day, path, now) == 0;
+    }
+    if (ok) {
+        long long deleted_alerts = exec_range("DELETE FROM main.verified_alerts "
+                                              "WHERE verified_at >= ?1 AND verified_at < ?2;", from, to);
+        long long deleted_events = exec_range("DELETE FROM main.audit_log "
+                                              "WHERE timestamp >= ?1 AND timestamp < ?2;", from, to);
+        ok = deleted_alerts >= 0 && deleted_events >= 0;
+        if (!archive) {
+            alerts = deleted_alerts;
+            events = deleted_events;
+        }
+    }
+    if (ok && db_commit() != 0) {
+        ok = 0;
+    }
+    if (!ok && !sqlite3_get_autocommit(g_db)) {
+        db_rollback();
+    }
+    if (archive) {
+        sqlite3_exec(g_db, "DETACH DATABASE arc;", NULL, NULL, NULL);
+    }
+    if (!ok) {
+        fprintf(stderr, "[db] Failed to rotate day %lld\n", (long long)day);
+        return -1;
+    }
+
+    char date[16];
+    format_day(date, sizeof(date), day);
+    printf("[db] Rotated %s: %lld alerts, %lld events%s%s\n", date, alerts, events,
+           archive ? " -> " : " deleted", archive ? path : "");
+    if (result) {
+        result->days_rotated++;
+        result->alerts_moved += alerts;
+        result->events_moved += events;
+    }
+    return 0;
+}
+
+static int prune_archives(time_t cutoff, db_retention_result_t *result) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(g_db, "SELECT path FROM db_partitions WHERE day < ?1;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)cutoff);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *path = (const char *)sqlite3_column_text(stmt, 0);
+        if (path && remove(path) == 0) {
+            printf("[db] Deleted archive %s\n", path);
+            if (result) {
+                result->archives_deleted++;
+            }
+        }
+    }
+    sqlite3_finalize(stmt);
+    return exec_range("DELETE FROM db_partitions WHERE day < ?1;",
+                      (sqlite3_int64)cutoff, 0) >= 0 ? 0 : -1;
+}
+
+static int prune_rollups(int period, time_t cutoff, db_retention_result_t *result) {
+    long long n = exec_range("DELETE FROM db_rollups "
+                             "WHERE scope IN ('hazard_type', 'event_type') "
+                             "  AND period = ?1 AND bucket < ?2;",
+                             period, (sqlite3_int64)cutoff);
+    if (n > 0 && result) {
+        result->rollups_pruned += n;
+    }
+    return n >= 0 ? 0 : -1;
+}
+
+int db_retention_run(const db_retention_config_t *cfg, time_t now, db_retention_result_t *result) {
+    if (g_db == NULL || cfg == NULL || cfg->hot_days < 1) {
+        return -1;
+    }
+    if (result) {
+        memset(result, 0, sizeof(*result));
+    }
+
+    char *err_msg = NULL;
+    if (sqlite3_exec(g_db, k_partitions_sql, NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "[db] Failed to create db_partitions: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+    if (cfg->archive_dir[0] != '\0' && make_dir(cfg->archive_dir) != 0) {
+        fprintf(stderr, "[db] Cannot create archive directory %s\n", cfg->archive_dir);
+        return -1;
+    }
+
+    time_t today = now - now % DAY_SECONDS;
+    time_t hot_start = today - (time_t)(cfg->hot_days - 1) * DAY_SECONDS;
+    int rc = 0;
+
+    // Oldest day first, re-reading the oldest row so empty days are skipped
+    for (int i = 0; i < RETENTION_MAX_DAYS_PER_RUN; i++) {
+        sqlite3_int64 oldest = oldest_row();
+        if (oldest < 0 || oldest >= (sqlite3_int64)hot_start) {
+            break;
+        }
+        if (rotate_day(cfg, (time_t)(oldest - oldest % DAY_SECONDS), now, result) != 0) {
+            rc = -1;
+            break;
+        }
+    }
+
+    if (cfg->archive_days > 0 &&
+        prune_archives(today - (time_t)cfg->archive_days * DAY_SECONDS, result) != 0) {
+        rc = -1;
+    }
+    if (cfg->minute_rollup_days > 0 &&
+        prune_rollups(DB_ROLLUP_MINUTE, today - (time_t)cfg->minute_rollup_days * DAY_SECONDS, result) != 0) {
+        rc = -1;
+    }
+    if (cfg->hour_rollup_days > 0 &&
+        prune_rollups(DB_ROLLUP_HOUR, today - (time_t)cfg->hour_rollup_days * DAY_SECONDS, result) != 0) {
+        rc = -1;
+    }
+    return rc;
+}
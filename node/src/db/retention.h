@@ -0,0 +1,57 @@
+#ifndef RETENTION_H
+#define RETENTION_H
+
+#include <time.h>
+#include "db.h"
+
+// Time partitioning and retention
+//
+// The main verified_alerts and audit_log tables only hold the most recent
+// hot_days of raw rows, so their indexes stay small and inserts stay
+// fast. Older rows are moved one UTC day at a time into per-day archive
+// databases (archive_dir/v2v-YYYYMMDD.db, same table layout). These are
+// listed in the db_partitions table and can be ATTACHed for ad-hoc queries.
+// When archive_days is set, archives older than that are deleted as whole
+// files. Rollups (db_query_rollups) are kept for minute_rollup_days /
+// hour_rollup_days and are not affected when raw rows are moved.
+//
+// db_retention_run() must run on the thread that writes to the database.
+// The write-behind writer (persist.h) calls it between batches when
+// retention is configured.
+
+#define RETENTION_DEFAULT_HOT_DAYS 2
+#define RETENTION_DEFAULT_ARCHIVE_DAYS 30
+#define RETENTION_DEFAULT_MINUTE_ROLLUP_DAYS 7
+#define RETENTION_DEFAULT_HOUR_ROLLUP_DAYS 400
+#define RETENTION_MAX_DAYS_PER_RUN 7      // bounds the work done by one call
+#define RETENTION_PATH_MAX 512
+
+typedef struct {
+    char archive_dir[RETENTION_PATH_MAX];  // empty: aged-out rows are deleted
+    int hot_days;                 // UTC days of raw rows kept in the main tables, >= 1
+    int archive_days;             // day archives kept; 0 keeps all
+    int minute_rollup_days;       // 0 keeps all
+    int hour_rollup_days;         // 0 keeps all
+} db_retention_config_t;
+
+typedef struct {
+    int days_rotated;
+    long long alerts_moved;
+    long long events_moved;
+    int archives_deleted;
+    long long rollups_pruned;
+} db_retention_result_t;
+
+void db_retention_config_defaults(db_retention_config_t *cfg, const char *archive_dir);
+
+/**
+ * Move rows older than the hot window into day archives, then apply
+ * archive and rollup retention. Idempotent: a run interrupted by a crash
+ * is completed by the next one.
+ * @param now Current time; day boundaries are UTC
+ * @param result Optional summary of the work done
+ * @return 0 on success, -1 on error
+ */
+int db_retention_run(const db_retention_config_t *cfg, time_t now, db_retention_result_t *result);
+
+#endif // RETENTION_H
@@ -0,0 +1,297 @@
+#include "dcc.h"
+#include "timeutil.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// Distinct senders are estimated with linear counting over a hashed bitmap,
+// which costs one bit per slot instead of a table of IDs.
+#define DCC_SENDER_BITS 4096
+#define DCC_EWMA_ALPHA 0.5
+
+// Load ratio (measured / target) at which each state is entered
+static const double k_state_threshold[DCC_STATE_COUNT] = { 0.0, 0.5, 0.8, 1.0 };
+
+typedef struct {
+    dcc_config_t cfg;
+    int interval_ms[DCC_STATE_COUNT];
+    uint64_t window_start_ns;
+    uint64_t window_packets;
+    uint64_t window_bytes;
+    uint8_t senders[DCC_SENDER_BITS / 8];
+    int low_windows;
+    uint64_t routine_gate;
+    size_t (*neighbor_count)(void);
+    dcc_status_t status;
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+#else
+    pthread_mutex_t mutex;
+#endif
+} dcc_ctx_t;
+
+static dcc_ctx_t g_dcc;
+
+static void dcc_lock(void) {
+#ifdef _WIN32
+    EnterCriticalSection(&g_dcc.mutex);
+#else
+    pthread_mutex_lock(&g_dcc.mutex);
+#endif
+}
+
+static void dcc_unlock(void) {
+#ifdef _WIN32
+    LeaveCriticalSection(&g_dcc.mutex);
+#else
+    pthread_mutex_unlock(&g_dcc.mutex);
+#endif
+}
+
+void dcc_config_defaults(dcc_config_t *cfg) {
+    if (!cfg) {
+        return;
+    }
+    cfg->enabled = 0;
+    cfg->min_interval_ms = 1000;
+    cfg->max_interval_ms = 10000;
+    cfg->target_pps = 400.0;
+    cfg->eval_window_ms = 1000;
+    cfg->down_hold_windows = 5;
+}
+
+int dcc_init(const dcc_config_t *cfg) {
+    dcc_config_t defaults;
+    if (!cfg) {
+        dcc_config_defaults(&defaults);
+        cfg = &defaults;
+    }
+    if (cfg->min_interval_ms <= 0 || cfg->max_interval_ms < cfg->min_interval_ms ||
+        cfg->target_pps <= 0.0 || cfg->eval_window_ms <= 0) {
+        fprintf(stderr, "Invalid DCC configuration\n");
+        return -1;
+    }
+
+    memset(&g_dcc, 0, sizeof(g_dcc));
+    g_dcc.cfg = *cfg;
+
+    // Spread state intervals geometrically between the configured bounds
+    double ratio = (double)cfg->max_interval_ms / (double)cfg->min_interval_ms;
+    for (int s = 0; s < DCC_STATE_COUNT; s++) {
+        double f = (double)s / (double)(DCC_STATE_COUNT - 1);
+        g_dcc.interval_ms[s] = (int)((double)cfg->min_interval_ms * pow(ratio, f) + 0.5);
+    }
+
+    g_dcc.window_start_ns = monotonic_ns();
+    g_dcc.status.state = DCC_RELAXED;
+    g_dcc.status.tx_interval_ms = g_dcc.interval_ms[DCC_RELAXED];
+
+#ifdef _WIN32
+    InitializeCriticalSection(&g_dcc.mutex);
+#else
+    if (pthread_mutex_init(&g_dcc.mutex, NULL) != 0) {
+        fprintf(stderr, "Failed to initialize DCC mutex\n");
+        return -1;
+    }
+#endif
+
+    if (cfg->enabled) {
+        printf("DCC enabled (interval %d-%d ms, target %.0f pkt/s)\n",
+               cfg->min_interval_ms, cfg->max_interval_ms, cfg->target_pps);
+    }
+    return 0;
+}
+
+void dcc_cleanup(void) {
+#ifdef _WIN32
+    DeleteCriticalSection(&g_dcc.mutex);
+#else
+    pthread_mutex_destroy(&g_dcc.mutex);
+#endif
+}
+
+void dcc_on_receive(size_t bytes) {
+    dcc_lock();
+    g_dcc.window_packets++;
+    g_dcc.window_bytes += bytes;
+    dcc_unlock();
+}
+
+void dcc_note_sender(const char *ephemeral_id) {
+    if (!ephemeral_id) {
+        return;
+    }
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)ephemeral_id; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    h %= DCC_SENDER_BITS;
+
+    dcc_lock();
+    g_dcc.senders[h >> 3] |= (uint8_t)(1u << (h & 7));
+    dcc_unlock();
+}
+
+void dcc_set_neighbor_source(size_t (*count_fn)(void)) {
+    dcc_lock();
+    g_dcc.neighbor_count = count_fn;
+    dcc_unlock();
+}
+
+static double estimate_senders(void) {
+    size_t zeros = 0;
+    for (size_t i = 0; i < sizeof(g_dcc.senders); i++) {
+        uint8_t b = (uint8_t)~g_dcc.senders[i];
+        while (b) {
+            zeros += b & 1u;
+            b >>= 1;
+        }
+    }
+    if (zeros == 0) {
+        zeros = 1;   // saturated; report the bitmap's upper bound
+    }
+    return -(double)DCC_SENDER_BITS * log((double)zeros / (double)DCC_SENDER_BITS);
+}
+
+static dcc_state_t state_for_ratio(double ratio) {
+    dcc_state_t s = DCC_RELAXED;
+    for (int i = 0; i < DCC_STATE_COUNT; i++) {
+        if (ratio >= k_state_threshold[i]) {
+            s = (dcc_state_t)i;
+        }
+    }
+    return s;
+}
+
+// Called with the lock held once a window has elapsed
+static void evaluate(uint64_t now) {
+    double secs = (double)(now - g_dcc.window_start_ns) / 1e9;
+    double pps = (double)g_dcc.window_packets / secs;
+    double bps = (double)g_dcc.window_bytes / secs;
+    dcc_status_t *st = &g_dcc.status;
+
+    if (st->evaluations == 0) {
+        st->load_pps = pps;
+        st->load_bps = bps;
+    } else {
+        st->load_pps += DCC_EWMA_ALPHA * (pps - st->load_pps);
+        st->load_bps += DCC_EWMA_ALPHA * (bps - st->load_bps);
+    }
+    st->neighbors = estimate_senders();
+    if (g_dcc.neighbor_count) {
+        double known = (double)g_dcc.neighbor_count();
+        if (known > st->neighbors) {
+            st->neighbors = known;
+        }
+    }
+    st->evaluations++;
+
+    dcc_state_t target = state_for_ratio(st->load_pps / g_dcc.cfg.target_pps);
+    if (target > st->state) {
+        st->state = target;
+        st->state_changes++;
+        g_dcc.low_windows = 0;
+    } else if (target < st->state) {
+        // Relax one state at a time, and only after sustained low load
+        if (++g_dcc.low_windows >= g_dcc.cfg.down_hold_windows) {
+            st->state = (dcc_state_t)(st->state - 1);
+            st->state_changes++;
+            g_dcc.low_windows = 0;
+        }
+    } else {
+        g_dcc.low_windows = 0;
+    }
+
+    // Never exceed our fair share of the target: (neighbours + self) nodes
+    // splitting target_pps between them
+    int interval = g_dcc.interval_ms[st->state];
+    double fair_ms = (st->neighbors + 1.0) / g_dcc.cfg.target_pps * 1000.0;
+    if (fair_ms > interval) {
+        interval = (int)fair_ms;
+    }
+    if (interval > g_dcc.cfg.max_interval_ms) {
+        interval = g_dcc.cfg.max_interval_ms;
+    }
+    st->tx_interval_ms = interval;
+
+    g_dcc.window_start_ns = now;
+    g_dcc.window_packets = 0;
+    g_dcc.window_bytes = 0;
+    memset(g_dcc.senders, 0, sizeof(g_dcc.senders));
+}
+
+void dcc_tick(void) {
+    if (!g_dcc.cfg.enabled) {
+        return;
+    }
+    uint64_t now = monotonic_ns();
+    dcc_lock();
+    if (now - g_dcc.window_start_ns >= (uint64_t)g_dcc.cfg.eval_window_ms * 1000000ull) {
+        evaluate(now);
+    }
+    dcc_unlock();
+}
+
+int dcc_tx_interval_ms(void) {
+    dcc_lock();
+    int ms = g_dcc.status.tx_interval_ms;
+    dcc_unlock();
+    return ms;
+}
+
+int dcc_class_allowed(msg_priority_t prio) {
+    if (!g_dcc.cfg.enabled || prio != MSG_PRIO_ROUTINE) {
+        return 1;
+    }
+
+    int allowed = 1;
+    dcc_lock();
+    if (g_dcc.status.state == DCC_RESTRICTIVE) {
+        allowed = 0;
+    } else if (g_dcc.status.state == DCC_ACTIVE_2) {
+        allowed = (g_dcc.routine_gate++ % 2) == 0;
+    }
+    if (!allowed) {
+        g_dcc.status.suppressed++;
+    }
+    dcc_unlock();
+    return allowed;
+}
+
+void dcc_get_status(dcc_status_t *out) {
+    if (!out) {
+        return;
+    }
+    dcc_lock();
+    *out = g_dcc.status;
+    dcc_unlock();
+}
+
+const char *dcc_state_name(dcc_state_t state) {
+    switch (state) {
+    case DCC_RELAXED:     return "relaxed";
+    case DCC_ACTIVE_1:    return "active1";
+    case DCC_ACTIVE_2:    return "active2";
+    case DCC_RESTRICTIVE: return "restrictive";
+    default:              return "unknown";
+    }
+}
+
+void dcc_print_status(void) {
+    if (!g_dcc.cfg.enabled) {
+        return;
+    }
+    dcc_status_t st;
+    dcc_get_status(&st);
+    printf("DCC: state=%s load=%.1f pkt/s (%.0f B/s) neighbors~%.0f interval=%d ms "
+           "changes=%llu suppressed=%llu\n",
+           dcc_state_name(st.state), st.load_pps, st.load_bps, st.neighbors,
+           st.tx_interval_ms, (unsigned long long)st.state_changes,
+           (unsigned long long)st.suppressed);
+}
@@ -0,0 +1,69 @@
+#ifndef DCC_H
+#define DCC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "priority.h"
+
+// Decentralized congestion control, modelled on the ETSI DCC reactive
+// approach. The receive path reports every datagram and every sender it
+// sees; once per evaluation window the measured channel load (packets per
+// second, smoothed) is mapped to a state, and each state has its own
+// transmit interval. Load increases are acted on immediately, decreases
+// only after the load has stayed low for several windows.
+
+typedef enum {
+    DCC_RELAXED = 0,
+    DCC_ACTIVE_1,
+    DCC_ACTIVE_2,
+    DCC_RESTRICTIVE,
+    DCC_STATE_COUNT
+} dcc_state_t;
+
+typedef struct {
+    int enabled;
+    int min_interval_ms;     // interval in RELAXED
+    int max_interval_ms;     // interval in RESTRICTIVE, also the freshness bound
+    double target_pps;       // channel load the neighbourhood should stay under
+    int eval_window_ms;      // measurement window
+    int down_hold_windows;   // low-load windows required before relaxing a state
+} dcc_config_t;
+
+typedef struct {
+    dcc_state_t state;
+    double load_pps;         // smoothed incoming packet rate
+    double load_bps;         // smoothed incoming byte rate
+    double neighbors;        // estimated distinct senders in the last window
+    int tx_interval_ms;
+    uint64_t evaluations;
+    uint64_t state_changes;
+    uint64_t suppressed;     // own messages withheld by the state's class gate
+} dcc_status_t;
+
+void dcc_config_defaults(dcc_config_t *cfg);
+int dcc_init(const dcc_config_t *cfg);
+void dcc_cleanup(void);
+
+// Receive path hooks
+void dcc_on_receive(size_t bytes);
+void dcc_note_sender(const char *ephemeral_id);
+
+// Optional exact neighbour count (e.g. the neighbour table); the estimate
+// used for the fair-share interval is the larger of this and the bitmap
+void dcc_set_neighbor_source(size_t (*count_fn)(void));
+
+// Re-evaluate the state if the window has elapsed (safe to call often)
+void dcc_tick(void);
+
+// Current transmit interval for periodic reports
+int dcc_tx_interval_ms(void);
+
+// Whether an own message of this class may be sent in the current state.
+// Emergency traffic is never gated. Returns 1 to send, 0 to withhold.
+int dcc_class_allowed(msg_priority_t prio);
+
+void dcc_get_status(dcc_status_t *out);
+const char *dcc_state_name(dcc_state_t state);
+void dcc_print_status(void);
+
+#endif // DCC_H
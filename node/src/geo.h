@@ -0,0 +1,34 @@
+#ifndef GEO_H
+#define GEO_H
+
+#include <math.h>
+
+#define GEO_EARTH_RADIUS_M 6371000.0
+#define GEO_DEG_TO_RAD (3.14159265358979323846 / 180.0)
+
+// Great-circle distance in metres (haversine)
+static inline double geo_distance_m(double lat1, double lon1, double lat2, double lon2) {
+    double dlat = (lat2 - lat1) * GEO_DEG_TO_RAD;
+    double dlon = (lon2 - lon1) * GEO_DEG_TO_RAD;
+    double a = sin(dlat / 2) * sin(dlat / 2) +
+               cos(lat1 * GEO_DEG_TO_RAD) * cos(lat2 * GEO_DEG_TO_RAD) *
+               sin(dlon / 2) * sin(dlon / 2);
+    return 2.0 * GEO_EARTH_RADIUS_M * atan2(sqrt(a), sqrt(1.0 - a));
+}
+
+// Cheap pre-filter: true if the point is certainly farther than radius_m
+// along latitude or longitude alone, so haversine can be skipped
+static inline int geo_outside_box(double lat1, double lon1, double lat2, double lon2,
+                                  double radius_m) {
+    double dlat_m = fabs(lat2 - lat1) * GEO_DEG_TO_RAD * GEO_EARTH_RADIUS_M;
+    if (dlat_m > radius_m) {
+        return 1;
+    }
+    // Use the latitude nearer the pole so the estimate never overshoots
+    double lat_far = fabs(lat1) > fabs(lat2) ? lat1 : lat2;
+    double dlon_m = fabs(lon2 - lon1) * GEO_DEG_TO_RAD * GEO_EARTH_RADIUS_M *
+                    cos(lat_far * GEO_DEG_TO_RAD);
+    return dlon_m > radius_m;
+}
+
+#endif // GEO_H
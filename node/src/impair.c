@@ -0,0 +1,586 @@
+#include "impair.h"
+#include "timeutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#define IMPAIR_NAME_MAX 16
+
+// One delayed datagram
+typedef struct {
+    uint64_t due_ns;
+    uint64_t order;             // FIFO among equal due times
+    int sock;
+    struct sockaddr_in addr;
+    size_t len;
+    char *buf;                  // len + 1 bytes, NUL-terminated
+} impair_item_t;
+
+struct impair {
+    char name[IMPAIR_NAME_MAX];
+    impair_config_t cfg;
+    impair_deliver_fn deliver;
+    void *arg;
+    uint64_t rng;
+    int ge_bad;                 // Gilbert-Elliott state
+    impair_item_t *heap;        // min-heap on (due_ns, order)
+    size_t count;
+    size_t cap;
+    uint64_t next_order;
+    impair_stats_t stats;
+    int stopping;
+    int threaded;
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE wake;
+    HANDLE thread;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_t thread;
+#endif
+};
+
+static void impair_lock(impair_t *im) {
+#ifdef _WIN32
+    EnterCriticalSection(&im->mutex);
+#else
+    pthread_mutex_lock(&im->mutex);
+#endif
+}
+
+static void impair_unlock(impair_t *im) {
+#ifdef _WIN32
+    LeaveCriticalSection(&im->mutex);
+#else
+    pthread_mutex_unlock(&im->mutex);
+#endif
+}
+
+static void impair_signal(impair_t *im) {
+#ifdef _WIN32
+    WakeConditionVariable(&im->wake);
+#else
+    pthread_cond_signal(&im->wake);
+#endif
+}
+
+// Sleep on the condition variable until woken or the monotonic deadline
+// passes; deadline 0 waits indefinitely
+static void impair_wait_until(impair_t *im, uint64_t deadline_ns) {
+#ifdef _WIN32
+    DWORD ms = INFINITE;
+    if (deadline_ns != 0) {
+        uint64_t now = monotonic_ns();
+        ms = deadline_ns > now ? (DWORD)((deadline_ns - now + 999999) / 1000000) : 0;
+    }
+    SleepConditionVariableCS(&im->wake, &im->mutex, ms);
+#else
+    if (deadline_ns == 0) {
+        pthread_cond_wait(&im->wake, &im->mutex);
+        return;
+    }
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline_ns / 1000000000ull);
+    ts.tv_nsec = (long)(deadline_ns % 1000000000ull);
+    pthread_cond_timedwait(&im->wake, &im->mutex, &ts);
+#endif
+}
+
+static uint64_t rng_next(uint64_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+// Uniform in [0, 1)
+static double rng_unit(uint64_t *s) {
+    return (double)(rng_next(s) >> 11) / (double)(1ull << 53);
+}
+
+static double rng_normal(uint64_t *s) {
+    double u1 = rng_unit(s), u2 = rng_unit(s);
+    if (u1 < 1e-300) {
+        u1 = 1e-300;
+    }
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * 3.14159265358979323846 * u2);
+}
+
+static int item_before(const impair_item_t *a, const impair_item_t *b) {
+    return a->due_ns < b->due_ns || (a->due_ns == b->due_ns && a->order < b->order);
+}
+
+// Caller holds the lock
+static int heap_push(impair_t *im, const impair_item_t *item) {
+    if (im->count == im->cap) {
+        size_t cap = im->cap ? im->cap * 2 : 256;
+        if (cap > im->cfg.max_pending) {
+            cap = im->cfg.max_pending;
+        }
+        if (cap <= im->count) {
+            return -1;
+        }
+        impair_item_t *heap = (impair_item_t *)realloc(im->heap, cap * sizeof(impair_item_t));
+        if (!heap) {
+            return -1;
+        }
+        im->heap = heap;
+        im->cap = cap;
+    }
+    size_t i = im->count++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!item_before(item, &im->heap[parent])) {
+            break;
+        }
+        im->heap[i] = im->heap[parent];
+        i = parent;
+    }
+    im->heap[i] = *item;
+    return 0;
+}
+
+// Caller holds the lock and has checked count > 0
+static void heap_pop(impair_t *im, impair_item_t *out) {
+    *out = im->heap[0];
+    impair_item_t last = im->heap[--im->count];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= im->count) {
+            break;
+        }
+        if (child + 1 < im->count && item_before(&im->heap[child + 1], &im->heap[child])) {
+            child++;
+        }
+        if (!item_before(&im->heap[child], &last)) {
+            break;
+        }
+        im->heap[i] = im->heap[child];
+        i = child;
+    }
+    if (im->count > 0) {
+        im->heap[i] = last;
+    }
+}
+
+// Caller holds the lock
+static int decide_loss(impair_t *im) {
+    const impair_config_t *c = &im->cfg;
+    switch (c->loss_model) {
+    case IMPAIR_LOSS_BERNOULLI:
+        return rng_unit(&im->rng) < c->loss;
+    case IMPAIR_LOSS_GILBERT_ELLIOTT:
+        // Move between states first, then lose with the new state's probability
+        if (im->ge_bad) {
+            if (rng_unit(&im->rng) < c->ge_r) {
+                im->ge_bad = 0;
+            }
+        } else if (rng_unit(&im->rng) < c->ge_p) {
+            im->ge_bad = 1;
+        }
+        if (im->ge_bad) {
+            im->stats.bad_state++;
+        }
+        return rng_unit(&im->rng) < (im->ge_bad ? c->ge_loss_bad : c->ge_loss_good);
+    default:
+        return 0;
+    }
+}
+
+// Caller holds the lock
+static uint64_t sample_delay_ns(impair_t *im) {
+    const impair_config_t *c = &im->cfg;
+    double ms = c->delay_ms;
+    switch (c->delay_dist) {
+    case IMPAIR_DELAY_UNIFORM:
+        ms += (2.0 * rng_unit(&im->rng) - 1.0) * c->jitter_ms;
+        break;
+    case IMPAIR_DELAY_NORMAL:
+        ms += rng_normal(&im->rng) * c->jitter_ms;
+        break;
+    case IMPAIR_DELAY_PARETO: {
+        double u = 1.0 - rng_unit(&im->rng);   // (0, 1]
+        ms += c->jitter_ms * (pow(u, -1.0 / IMPAIR_PARETO_SHAPE) - 1.0);
+        break;
+    }
+    default:
+        break;
+    }
+    return ms > 0.0 ? (uint64_t)(ms * 1e6) : 0;
+}
+
+static void deliver_copy(impair_t *im, int sock, const struct sockaddr_in *addr, const void *buf, size_t len) {
+    char *copy = (char *)malloc(len + 1);
+    if (!copy) {
+        return;
+    }
+    memcpy(copy, buf, len);
+    copy[len] = '\0';
+    im->deliver(im->arg, sock, addr, copy, len);
+    free(copy);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI impair_thread(LPVOID arg) {
+#else
+static void *impair_thread(void *arg) {
+#endif
+    impair_t *im = (impair_t *)arg;
+    impair_lock(im);
+    while (!im->stopping) {
+        if (im->count == 0) {
+            impair_wait_until(im, 0);
+            continue;
+        }
+        uint64_t now = monotonic_ns();
+        if (im->heap[0].due_ns > now) {
+            impair_wait_until(im, im->heap[0].due_ns);
+            continue;
+        }
+        impair_item_t item;
+        heap_pop(im, &item);
+        im->stats.pending = im->count;
+        impair_unlock(im);
+        im->deliver(im->arg, item.sock, &item.addr, item.buf, item.len);
+        free(item.buf);
+        impair_lock(im);
+    }
+    impair_unlock(im);
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+void impair_config_defaults(impair_config_t *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->loss_model = IMPAIR_LOSS_NONE;
+    cfg->ge_loss_bad = 1.0;
+    cfg->delay_dist = IMPAIR_DELAY_UNIFORM;
+    cfg->max_pending = IMPAIR_DEFAULT_MAX_PENDING;
+    cfg->seed = 1;
+}
+
+// A probability as a fraction ("0.02") or a percentage ("2%")
+static int parse_prob(const char *s, double *out) {
+    char *end;
+    double v = strtod(s, &end);
+    if (end == s) {
+        return -1;
+    }
+    if (*end == '%') {
+        v /= 100.0;
+        end++;
+    }
+    if (*end != '\0' || v < 0.0 || v > 1.0) {
+        return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+static int parse_ms(const char *s, double *out) {
+    char *end;
+    double v = strtod(s, &end);
+    if (end == s || *end != '\0' || v < 0.0) {
+        return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+static int parse_item(const char *key, const char *val, impair_config_t *cfg) {
+    if (strcmp(key, "loss") == 0) {
+        cfg->loss_model = IMPAIR_LOSS_BERNOULLI;
+        return parse_prob(val, &cfg->loss);
+    }
+    if (strcmp(key, "ge") == 0) {
+        // p:r[:loss_bad[:loss_good]]
+        char parts[4][32] = {{0}};
+        int n = 0;
+        const char *p = val;
+        while (n < 4) {
+            const char *colon = strchr(p, ':');
+            size_t len = colon ? (size_t)(colon - p) : strlen(p);
+            if (len == 0 || len >= sizeof(parts[0])) {
+                return -1;
+            }
+            memcpy(parts[n++], p, len);
+            if (!colon) {
+                break;
+            }
+            p = colon + 1;
+        }
+        if (n < 2 || parse_prob(parts[0], &cfg->ge_p) != 0 || parse_prob(parts[1], &cfg->ge_r) != 0 ||
+            (n > 2 && parse_prob(parts[2], &cfg->ge_loss_bad) != 0) ||
+            (n > 3 && parse_prob(parts[3], &cfg->ge_loss_good) != 0)) {
+            return -1;
+        }
+        cfg->loss_model = IMPAIR_LOSS_GILBERT_ELLIOTT;
+        return 0;
+    }
+    if (strcmp(key, "delay") == 0) {
+        return parse_ms(val, &cfg->delay_ms);
+    }
+    if (strcmp(key, "jitter") == 0) {
+        return parse_ms(val, &cfg->jitter_ms);
+    }
+    if (strcmp(key, "dist") == 0) {
+        if (strcmp(val, "constant") == 0) cfg->delay_dist = IMPAIR_DELAY_CONSTANT;
+        else if (strcmp(val, "uniform") == 0) cfg->delay_dist = IMPAIR_DELAY_UNIFORM;
+        else if (strcmp(val, "normal") == 0) cfg->delay_dist = IMPAIR_DELAY_NORMAL;
+        else if (strcmp(val, "pareto") == 0) cfg->delay_dist = IMPAIR_DELAY_PARETO;
+        else return -1;
+        return 0;
+    }
+    if (strcmp(key, "dup") == 0) {
+        return parse_prob(val, &cfg->duplicate);
+    }
+    if (strcmp(key, "reorder") == 0) {
+        return parse_prob(val, &cfg->reorder);
+    }
+    if (strcmp(key, "limit") == 0) {
+        int v = atoi(val);
+        if (v <= 0) {
+            return -1;
+        }
+        cfg->max_pending = (size_t)v;
+        return 0;
+    }
+    if (strcmp(key, "seed") == 0) {
+        cfg->seed = strtoull(val, NULL, 10);
+        return 0;
+    }
+    return -1;
+}
+
+int impair_parse(const char *spec, impair_config_t *cfg) {
+    if (!spec || !cfg) {
+        return -1;
+    }
+    const char *p = spec;
+    while (*p) {
+        const char *comma = strchr(p, ',');
+        size_t len = comma ? (size_t)(comma - p) : strlen(p);
+        char item[96];
+        if (len == 0 || len >= sizeof(item)) {
+            return -1;
+        }
+        memcpy(item, p, len);
+        item[len] = '\0';
+        char *eq = strchr(item, '=');
+        if (!eq) {
+            return -1;
+        }
+        *eq = '\0';
+        if (parse_item(item, eq + 1, cfg) != 0) {
+            fprintf(stderr, "impair: bad setting '%s=%s'\n", item, eq + 1);
+            return -1;
+        }
+        p = comma ? comma + 1 : p + len;
+    }
+    return 0;
+}
+
+impair_t *impair_create(const char *name, const impair_config_t *cfg,
+                        impair_deliver_fn deliver, void *arg) {
+    if (!cfg || !deliver || cfg->max_pending == 0) {
+        return NULL;
+    }
+    impair_t *im = (impair_t *)calloc(1, sizeof(impair_t));
+    if (!im) {
+        return NULL;
+    }
+    strncpy(im->name, name ? name : "impair", sizeof(im->name) - 1);
+    im->cfg = *cfg;
+    im->deliver = deliver;
+    im->arg = arg;
+    im->rng = cfg->seed * 0x9E3779B97F4A7C15ull + 1;
+
+#ifdef _WIN32
+    InitializeCriticalSection(&im->mutex);
+    InitializeConditionVariable(&im->wake);
+    im->thread = CreateThread(NULL, 0, impair_thread, im, 0, NULL);
+    if (im->thread == NULL) {
+        fprintf(stderr, "impair: CreateThread failed\n");
+        DeleteCriticalSection(&im->mutex);
+        free(im);
+        return NULL;
+    }
+#else
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (pthread_mutex_init(&im->mutex, NULL) != 0 ||
+        pthread_cond_init(&im->wake, &attr) != 0) {
+        pthread_condattr_destroy(&attr);
+        free(im);
+        return NULL;
+    }
+    pthread_condattr_destroy(&attr);
+    if (pthread_create(&im->thread, NULL, impair_thread, im) != 0) {
+        perror("pthread_create impair");
+        pthread_cond_destroy(&im->wake);
+        pthread_mutex_destroy(&im->mutex);
+        free(im);
+        return NULL;
+    }
+#endif
+    im->threaded = 1;
+    return im;
+}
+
+int impair_submit(impair_t *im, int sock, const struct sockaddr_in *addr, const void *buf, size_t len) {
+    if (!im || !addr || !buf) {
+        return 0;
+    }
+    const impair_config_t *c = &im->cfg;
+    int delayed = c->delay_ms > 0.0 || c->jitter_ms > 0.0;
+    uint64_t due[2];
+    int immediate[2] = { 0, 0 };
+    int copies = 0;
+    int queued = 0;
+
+    impair_lock(im);
+    im->stats.offered++;
+    if (decide_loss(im)) {
+        im->stats.lost++;
+        impair_unlock(im);
+        return 0;
+    }
+    copies = 1;
+    if (c->duplicate > 0.0 && rng_unit(&im->rng) < c->duplicate) {
+        im->stats.duplicated++;
+        copies = 2;
+    }
+
+    uint64_t now = monotonic_ns();
+    for (int i = 0; i < copies; i++) {
+        if (!delayed) {
+            immediate[i] = 1;
+            continue;
+        }
+        if (c->reorder > 0.0 && rng_unit(&im->rng) < c->reorder) {
+            im->stats.reordered++;
+            immediate[i] = 1;
+            continue;
+        }
+        uint64_t d = sample_delay_ns(im);
+        due[i] = now + d;
+        impair_item_t item;
+        item.due_ns = due[i];
+        item.order = im->next_order++;
+        item.sock = sock;
+        item.addr = *addr;
+        item.len = len;
+        item.buf = (char *)malloc(len + 1);
+        if (!item.buf || heap_push(im, &item) != 0) {
+            free(item.buf);
+            im->stats.overflow++;
+            continue;
+        }
+        memcpy(item.buf, buf, len);
+        item.buf[len] = '\0';
+        im->stats.delay_sum_us += d / 1000;
+        if (d / 1000 > im->stats.delay_max_us) {
+            im->stats.delay_max_us = d / 1000;
+        }
+        im->stats.passed++;
+        queued++;
+    }
+    for (int i = 0; i < copies; i++) {
+        if (immediate[i]) {
+            im->stats.passed++;
+        }
+    }
+    im->stats.pending = im->count;
+    if (queued) {
+        impair_signal(im);
+    }
+    impair_unlock(im);
+
+    int sent = queued;
+    for (int i = 0; i < copies; i++) {
+        if (immediate[i]) {
+            deliver_copy(im, sock, addr, buf, len);
+            sent++;
+        }
+    }
+    return sent > 0;
+}
+
+void impair_destroy(impair_t *im) {
+    if (!im) {
+        return;
+    }
+    if (im->threaded) {
+        impair_lock(im);
+        im->stopping = 1;
+        impair_signal(im);
+        impair_unlock(im);
+#ifdef _WIN32
+        WaitForSingleObject(im->thread, INFINITE);
+        CloseHandle(im->thread);
+#else
+        pthread_join(im->thread, NULL);
+#endif
+    }
+    for (size_t i = 0; i < im->count; i++) {
+        free(im->heap[i].buf);
+    }
+    free(im->heap);
+#ifdef _WIN32
+    DeleteCriticalSection(&im->mutex);
+#else
+    pthread_cond_destroy(&im->wake);
+    pthread_mutex_destroy(&im->mutex);
+#endif
+    free(im);
+}
+
+void impair_get_stats(impair_t *im, impair_stats_t *out) {
+    if (!im || !out) {
+        return;
+    }
+    impair_lock(im);
+    *out = im->stats;
+    impair_unlock(im);
+}
+
+void impair_print_stats(impair_t *im) {
+    if (!im) {
+        return;
+    }
+    impair_stats_t st;
+    impair_get_stats(im, &st);
+    uint64_t delayed = st.passed > st.reordered ? st.passed - st.reordered : 0;
+    printf("Impairment %s: %llu offered, %llu passed, %llu lost (%.1f%%), %llu duplicated, "
+           "%llu reordered, %llu overflow, avg delay %.2fms (max %.2fms)",
+           im->name, (unsigned long long)st.offered, (unsigned long long)st.passed,
+           (unsigned long long)st.lost,
+           st.offered ? (double)st.lost * 100.0 / (double)st.offered : 0.0,
+           (unsigned long long)st.duplicated, (unsigned long long)st.reordered,
+           (unsigned long long)st.overflow,
+           delayed ? (double)st.delay_sum_us / (double)delayed / 1000.0 : 0.0,
+           (double)st.delay_max_us / 1000.0);
+    if (im->cfg.loss_model == IMPAIR_LOSS_GILBERT_ELLIOTT) {
+        printf(", %llu in bad state", (unsigned long long)st.bad_state);
+    }
+    printf("\n");
+}
+
+int impair_send_shim(void *arg, int sock, const struct sockaddr_in *dst, const void *buf, size_t len) {
+    // A lost datagram still counts as sent, as it would on a real radio
+    impair_submit((impair_t *)arg, sock, dst, buf, len);
+    return (int)len;
+}
@@ -0,0 +1,112 @@
+#ifndef IMPAIR_H
+#define IMPAIR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "net.h"
+
+// Network impairment emulator
+//
+// Sits between the node and its socket (see --impair-tx / --impair-rx) and
+// degrades traffic the way a DSRC/C-V2X radio link does, so loopback tests
+// see loss, delay, jitter, duplication and reordering. Each datagram:
+//   1. may be lost: Bernoulli, or a Gilbert-Elliott two-state chain for
+//      bursty loss (good/bad states with their own loss probabilities)
+//   2. may be duplicated; each copy is delayed independently
+//   3. is delayed by a sample from the delay distribution, or, with the
+//      reorder probability, sent at once so it overtakes queued datagrams
+// Delayed datagrams wait in a heap and are released by a per-instance
+// thread, so jitter larger than the gap between datagrams also reorders.
+// Without delay or jitter, datagrams are passed on in the caller's thread.
+//
+// Configured from a comma-separated spec, e.g.
+//   loss=2%,delay=20,jitter=5,dist=normal,dup=0.5%,reorder=1%
+//   ge=0.01:0.3:0.9:0.001,delay=5,jitter=20,dist=pareto,seed=7
+// Probabilities accept a fraction or a percentage; delays are milliseconds.
+
+#define IMPAIR_DEFAULT_MAX_PENDING 8192
+#define IMPAIR_PARETO_SHAPE 2.5
+
+typedef enum {
+    IMPAIR_LOSS_NONE = 0,
+    IMPAIR_LOSS_BERNOULLI,
+    IMPAIR_LOSS_GILBERT_ELLIOTT
+} impair_loss_model_t;
+
+typedef enum {
+    IMPAIR_DELAY_CONSTANT = 0,  // delay; jitter ignored
+    IMPAIR_DELAY_UNIFORM,       // delay +- jitter
+    IMPAIR_DELAY_NORMAL,        // mean delay, standard deviation jitter, clamped at 0
+    IMPAIR_DELAY_PARETO         // delay plus a heavy tail with scale jitter
+} impair_delay_dist_t;
+
+typedef struct {
+    impair_loss_model_t loss_model;
+    double loss;                // Bernoulli loss probability
+    double ge_p;                // Gilbert-Elliott: good -> bad transition per datagram
+    double ge_r;                // bad -> good
+    double ge_loss_bad;         // loss probability in the bad state
+    double ge_loss_good;        // loss probability in the good state
+    impair_delay_dist_t delay_dist;
+    double delay_ms;
+    double jitter_ms;
+    double duplicate;           // probability of one extra copy
+    double reorder;             // probability a datagram skips the delay
+    size_t max_pending;         // delayed datagrams beyond this are dropped
+    uint64_t seed;
+} impair_config_t;
+
+typedef struct {
+    uint64_t offered;
+    uint64_t passed;            // handed on, duplicates included
+    uint64_t lost;
+    uint64_t duplicated;
+    uint64_t reordered;
+    uint64_t overflow;          // dropped because max_pending were waiting
+    uint64_t bad_state;         // datagrams seen in the Gilbert-Elliott bad state
+    uint64_t delay_sum_us;
+    uint64_t delay_max_us;
+    size_t pending;
+} impair_stats_t;
+
+// Receives each datagram that survives. buf is writable and buf[len] is a
+// NUL the callee may overwrite.
+typedef void (*impair_deliver_fn)(void *arg, int sock, const struct sockaddr_in *addr,
+                                  char *buf, size_t len);
+
+typedef struct impair impair_t;
+
+void impair_config_defaults(impair_config_t *cfg);
+
+/**
+ * Parse a spec such as "loss=2%,delay=20,jitter=5" on top of cfg.
+ * @return 0 on success, -1 on an unknown key or bad value
+ */
+int impair_parse(const char *spec, impair_config_t *cfg);
+
+/**
+ * Create an impairment stage and start its delay thread.
+ * @param name Label for statistics, e.g. "tx"
+ * @param deliver Called for every datagram that survives
+ * @return Instance, or NULL on error
+ */
+impair_t *impair_create(const char *name, const impair_config_t *cfg,
+                        impair_deliver_fn deliver, void *arg);
+
+/**
+ * Apply the impairments to one datagram; thread-safe.
+ * @return 0 if it was lost or dropped, 1 if at least one copy was passed on
+ *         or queued
+ */
+int impair_submit(impair_t *im, int sock, const struct sockaddr_in *addr, const void *buf, size_t len);
+
+// Stop the delay thread; datagrams still waiting are discarded
+void impair_destroy(impair_t *im);
+
+void impair_get_stats(impair_t *im, impair_stats_t *out);
+void impair_print_stats(impair_t *im);
+
+// udp_send_shim_fn that routes udp_send_buf() through an impair_t (arg)
+int impair_send_shim(void *arg, int sock, const struct sockaddr_in *dst, const void *buf, size_t len);
+
+#endif // IMPAIR_H
@@ -0,0 +1,325 @@
+#include "ingest.h"
+#include "timeutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// Per-class FIFO of queued slots
+typedef struct {
+    ingest_msg_t **ring;
+    size_t head;
+    size_t count;
+} class_queue_t;
+
+typedef struct {
+    ingest_msg_t *slots;
+    ingest_msg_t **free_stack;
+    size_t free_top;
+    class_queue_t queues[MSG_PRIO_COUNT];
+    size_t high_wm[MSG_PRIO_COUNT];
+    size_t low_wm[MSG_PRIO_COUNT];
+    ingest_stats_t stats;
+    int stopping;
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE nonempty;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t nonempty;
+#endif
+} ingest_queue_t;
+
+static ingest_queue_t g_ingest;
+
+static void ingest_lock(void) {
+#ifdef _WIN32
+    EnterCriticalSection(&g_ingest.mutex);
+#else
+    pthread_mutex_lock(&g_ingest.mutex);
+#endif
+}
+
+static void ingest_unlock(void) {
+#ifdef _WIN32
+    LeaveCriticalSection(&g_ingest.mutex);
+#else
+    pthread_mutex_unlock(&g_ingest.mutex);
+#endif
+}
+
+void ingest_config_defaults(ingest_config_t *cfg) {
+    if (!cfg) {
+        return;
+    }
+    cfg->capacity = INGEST_DEFAULT_CAPACITY;
+    cfg->high_pct[MSG_PRIO_EMERGENCY] = 101;   // only dropped when the queue is full
+    cfg->low_pct[MSG_PRIO_EMERGENCY] = 100;
+    cfg->high_pct[MSG_PRIO_HAZARD] = 85;
+    cfg->low_pct[MSG_PRIO_HAZARD] = 60;
+    cfg->high_pct[MSG_PRIO_ROUTINE] = 50;
+    cfg->low_pct[MSG_PRIO_ROUTINE] = 25;
+}
+
+int ingest_init(const ingest_config_t *cfg) {
+    ingest_config_t defaults;
+    if (!cfg) {
+        ingest_config_defaults(&defaults);
+        cfg = &defaults;
+    }
+    if (cfg->capacity == 0) {
+        fprintf(stderr, "Ingest queue capacity must be positive\n");
+        return -1;
+    }
+
+    memset(&g_ingest, 0, sizeof(g_ingest));
+    size_t cap = cfg->capacity;
+
+    g_ingest.slots = (ingest_msg_t *)calloc(cap, sizeof(ingest_msg_t));
+    g_ingest.free_stack = (ingest_msg_t **)calloc(cap, sizeof(ingest_msg_t *));
+    if (!g_ingest.slots || !g_ingest.free_stack) {
+        fprintf(stderr, "Failed to allocate ingest queue (%zu slots)\n", cap);
+        ingest_cleanup();
+        return -1;
+    }
+    for (int c = 0; c < MSG_PRIO_COUNT; c++) {
+        g_ingest.queues[c].ring = (ingest_msg_t **)calloc(cap, sizeof(ingest_msg_t *));
+        if (!g_ingest.queues[c].ring) {
+            fprintf(stderr, "Failed to allocate ingest queue ring\n");
+            ingest_cleanup();
+            return -1;
+        }
+        if (cfg->high_pct[c] > 100) {
+            g_ingest.high_wm[c] = cap + 1;   // never reached
+            continue;
+        }
+        g_ingest.high_wm[c] = cap * (size_t)cfg->high_pct[c] / 100;
+        g_ingest.low_wm[c] = cap * (size_t)cfg->low_pct[c] / 100;
+        if (g_ingest.low_wm[c] >= g_ingest.high_wm[c] && g_ingest.high_wm[c] > 0) {
+            g_ingest.low_wm[c] = g_ingest.high_wm[c] - 1;
+        }
+    }
+    for (size_t i = 0; i < cap; i++) {
+        g_ingest.free_stack[i] = &g_ingest.slots[i];
+    }
+    g_ingest.free_top = cap;
+    g_ingest.stats.capacity = cap;
+
+#ifdef _WIN32
+    InitializeCriticalSection(&g_ingest.mutex);
+    InitializeConditionVariable(&g_ingest.nonempty);
+#else
+    if (pthread_mutex_init(&g_ingest.mutex, NULL) != 0 ||
+        pthread_cond_init(&g_ingest.nonempty, NULL) != 0) {
+        fprintf(stderr, "Failed to initialize ingest queue locks\n");
+        ingest_cleanup();
+        return -1;
+    }
+#endif
+
+    printf("Ingest queue initialized (%zu slots, shed routine at %zu/%zu, hazard at %zu/%zu)\n",
+           cap, g_ingest.high_wm[MSG_PRIO_ROUTINE], g_ingest.low_wm[MSG_PRIO_ROUTINE],
+           g_ingest.high_wm[MSG_PRIO_HAZARD], g_ingest.low_wm[MSG_PRIO_HAZARD]);
+    return 0;
+}
+
+void ingest_cleanup(void) {
+    free(g_ingest.slots);
+    free(g_ingest.free_stack);
+    for (int c = 0; c < MSG_PRIO_COUNT; c++) {
+        free(g_ingest.queues[c].ring);
+    }
+    if (g_ingest.stats.capacity > 0) {
+#ifdef _WIN32
+        DeleteCriticalSection(&g_ingest.mutex);
+#else
+        pthread_mutex_destroy(&g_ingest.mutex);
+        pthread_cond_destroy(&g_ingest.nonempty);
+#endif
+    }
+    memset(&g_ingest, 0, sizeof(g_ingest));
+}
+
+static void queue_push(class_queue_t *q, ingest_msg_t *msg) {
+    size_t cap = g_ingest.stats.capacity;
+    q->ring[(q->head + q->count) % cap] = msg;
+    q->count++;
+}
+
+static ingest_msg_t *queue_pop(class_queue_t *q) {
+    if (q->count == 0) {
+        return NULL;
+    }
+    ingest_msg_t *msg = q->ring[q->head];
+    q->head = (q->head + 1) % g_ingest.stats.capacity;
+    q->count--;
+    return msg;
+}
+
+// Re-evaluate shedding state for every class against the current depth
+static void update_shedding(void) {
+    size_t depth = g_ingest.stats.depth;
+    for (int c = 0; c < MSG_PRIO_COUNT; c++) {
+        if (g_ingest.high_wm[c] > g_ingest.stats.capacity) {
+            continue;
+        }
+        if (!g_ingest.stats.shedding[c] && depth >= g_ingest.high_wm[c]) {
+            g_ingest.stats.shedding[c] = 1;
+            g_ingest.stats.shed_episodes++;
+            fprintf(stderr, "Load shedding %s messages (queue depth %zu/%zu)\n",
+                    msg_priority_name((msg_priority_t)c), depth, g_ingest.stats.capacity);
+        } else if (g_ingest.stats.shedding[c] && depth <= g_ingest.low_wm[c]) {
+            g_ingest.stats.shedding[c] = 0;
+            fprintf(stderr, "Resumed %s messages (queue depth %zu/%zu)\n",
+                    msg_priority_name((msg_priority_t)c), depth, g_ingest.stats.capacity);
+        }
+    }
+}
+
+// Evict the oldest queued message of the lowest class below prio
+static ingest_msg_t *displace_lower(msg_priority_t prio) {
+    for (int c = MSG_PRIO_COUNT - 1; c > (int)prio; c--) {
+        ingest_msg_t *victim = queue_pop(&g_ingest.queues[c]);
+        if (victim) {
+            g_ingest.stats.cls[c].displaced++;
+            g_ingest.stats.depth--;
+            return victim;
+        }
+    }
+    return NULL;
+}
+
+int ingest_enqueue(const char *data, int len, const struct sockaddr_in *src) {
+    if (!data || len <= 0) {
+        return 0;
+    }
+    if (len >= INGEST_MSG_MAX) {
+        len = INGEST_MSG_MAX - 1;
+    }
+
+    // Classify outside the lock; it only scans the payload
+    msg_priority_t prio = msg_classify(data);
+    uint64_t now = monotonic_ns();
+
+    ingest_lock();
+    ingest_class_stats_t *cs = &g_ingest.stats.cls[prio];
+    cs->received++;
+
+    if (g_ingest.stats.shedding[prio]) {
+        cs->shed++;
+        ingest_unlock();
+        return 0;
+    }
+
+    ingest_msg_t *slot = NULL;
+    if (g_ingest.free_top > 0) {
+        slot = g_ingest.free_stack[--g_ingest.free_top];
+    } else {
+        slot = displace_lower(prio);
+    }
+    if (!slot) {
+        cs->overflow++;
+        ingest_unlock();
+        return 0;
+    }
+
+    memcpy(slot->data, data, (size_t)len);
+    slot->data[len] = '\0';
+    slot->len = len;
+    slot->prio = prio;
+    slot->received_ns = now;
+    if (src) {
+        slot->src = *src;
+    } else {
+        memset(&slot->src, 0, sizeof(slot->src));
+    }
+
+    queue_push(&g_ingest.queues[prio], slot);
+    cs->enqueued++;
+    g_ingest.stats.depth++;
+    if (g_ingest.stats.depth > g_ingest.stats.peak_depth) {
+        g_ingest.stats.peak_depth = g_ingest.stats.depth;
+    }
+    update_shedding();
+
+#ifdef _WIN32
+    WakeConditionVariable(&g_ingest.nonempty);
+#else
+    pthread_cond_signal(&g_ingest.nonempty);
+#endif
+    ingest_unlock();
+    return 1;
+}
+
+ingest_msg_t *ingest_dequeue(void) {
+    ingest_lock();
+    for (;;) {
+        if (g_ingest.stopping) {
+            ingest_unlock();
+            return NULL;
+        }
+        for (int c = 0; c < MSG_PRIO_COUNT; c++) {
+            ingest_msg_t *msg = queue_pop(&g_ingest.queues[c]);
+            if (msg) {
+                g_ingest.stats.cls[c].processed++;
+                g_ingest.stats.depth--;
+                update_shedding();
+                ingest_unlock();
+                return msg;
+            }
+        }
+#ifdef _WIN32
+        SleepConditionVariableCS(&g_ingest.nonempty, &g_ingest.mutex, INFINITE);
+#else
+        pthread_cond_wait(&g_ingest.nonempty, &g_ingest.mutex);
+#endif
+    }
+}
+
+void ingest_release(ingest_msg_t *msg) {
+    if (!msg) {
+        return;
+    }
+    ingest_lock();
+    g_ingest.free_stack[g_ingest.free_top++] = msg;
+    ingest_unlock();
+}
+
+void ingest_shutdown(void) {
+    ingest_lock();
+    g_ingest.stopping = 1;
+#ifdef _WIN32
+    WakeAllConditionVariable(&g_ingest.nonempty);
+#else
+    pthread_cond_broadcast(&g_ingest.nonempty);
+#endif
+    ingest_unlock();
+}
+
+void ingest_get_stats(ingest_stats_t *out) {
+    if (!out) {
+        return;
+    }
+    ingest_lock();
+    *out = g_ingest.stats;
+    ingest_unlock();
+}
+
+void ingest_print_stats(void) {
+    ingest_stats_t st;
+    ingest_get_stats(&st);
+    printf("Ingest queue: depth %zu/%zu (peak %zu), %llu shedding episodes\n",
+           st.depth, st.capacity, st.peak_depth, (unsigned long long)st.shed_episodes);
+    for (int c = 0; c < MSG_PRIO_COUNT; c++) {
+        const ingest_class_stats_t *cs = &st.cls[c];
+        printf("  %-9s received=%llu processed=%llu shed=%llu displaced=%llu overflow=%llu%s\n",
+               msg_priority_name((msg_priority_t)c),
+               (unsigned long long)cs->received, (unsigned long long)cs->processed,
+               (unsigned long long)cs->shed, (unsigned long long)cs->displaced,
+               (unsigned long long)cs->overflow, st.shedding[c] ? " [shedding]" : "");
+    }
+}
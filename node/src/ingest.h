@@ -0,0 +1,73 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "net.h"
+#include "priority.h"
+
+// Ingest queue between the socket reader and the verification pipeline.
+//
+// The receive thread drains the socket as fast as it can and hands every
+// datagram to ingest_enqueue(). Processing threads pull from the queue in
+// priority order. When the queue backs up, lower classes are shed according
+// to per-class watermarks with hysteresis, so emergency traffic keeps flowing
+// while routine beacons are dropped first.
+
+#define INGEST_MSG_MAX 2048
+#define INGEST_DEFAULT_CAPACITY 1024
+
+typedef struct {
+    char data[INGEST_MSG_MAX];
+    int len;
+    struct sockaddr_in src;
+    msg_priority_t prio;
+    uint64_t received_ns;   // monotonic time it was queued
+} ingest_msg_t;
+
+// Watermarks are percentages of capacity. A class starts being shed when
+// queue depth reaches high_pct and stops once depth falls to low_pct.
+// A high_pct above 100 means the class is never shed by watermark.
+typedef struct {
+    size_t capacity;
+    int high_pct[MSG_PRIO_COUNT];
+    int low_pct[MSG_PRIO_COUNT];
+} ingest_config_t;
+
+typedef struct {
+    uint64_t received;      // datagrams offered to the queue
+    uint64_t enqueued;      // accepted into the queue
+    uint64_t processed;     // handed to a processing thread
+    uint64_t shed;          // dropped by watermark shedding
+    uint64_t displaced;     // queued, then evicted to make room for a higher class
+    uint64_t overflow;      // dropped because the queue was full
+} ingest_class_stats_t;
+
+typedef struct {
+    size_t capacity;
+    size_t depth;
+    size_t peak_depth;
+    int shedding[MSG_PRIO_COUNT];
+    uint64_t shed_episodes;
+    ingest_class_stats_t cls[MSG_PRIO_COUNT];
+} ingest_stats_t;
+
+void ingest_config_defaults(ingest_config_t *cfg);
+int ingest_init(const ingest_config_t *cfg);
+void ingest_cleanup(void);
+
+// Classify and queue a datagram. Returns 1 if queued, 0 if it was dropped.
+int ingest_enqueue(const char *data, int len, const struct sockaddr_in *src);
+
+// Block until a message is available. Returns NULL after ingest_shutdown().
+// The caller must hand the message back with ingest_release().
+ingest_msg_t *ingest_dequeue(void);
+void ingest_release(ingest_msg_t *msg);
+
+// Wake all blocked consumers and make ingest_dequeue() return NULL
+void ingest_shutdown(void);
+
+void ingest_get_stats(ingest_stats_t *out);
+void ingest_print_stats(void);
+
+#endif // INGEST_H
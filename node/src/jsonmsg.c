@@ -2,9 +2,72 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
-// Returns heap-allocated canonical JSON string. Caller must free().
-char *build_canonical_hazard_json(
+// Fixed-point formatting for the canonical form. printf("%.Nf") rounds the
+// exact binary value, so x * 10^N is only trusted when it is small enough
+// that the multiplication error (under 1e-7) cannot move it across a
+// rounding boundary; values near a .5 tie, and anything else unusual, go
+// through snprintf so the output stays byte-identical.
+#define FIXED_MAX_SCALED 1e9
+#define FIXED_TIE_MARGIN 1e-6
+
+static const double k_pow10[] = { 1.0, 10.0, 100.0, 1000.0, 10000.0, 100000.0, 1000000.0 };
+
+// Appends the decimal digits of v at p; returns the new end
+static char *put_u64(char *p, uint64_t v) {
+	char tmp[20];
+	int n = 0;
+	do {
+		tmp[n++] = (char)('0' + v % 10);
+		v /= 10;
+	} while (v);
+	while (n) *p++ = tmp[--n];
+	return p;
+}
+
+// Values put_fixed can handle in 32 bytes (printf spells out every integer
+// digit, so huge values and non-finite ones take the snprintf path)
+static int fixed_ok(double x) {
+	return isfinite(x) && fabs(x) < 1e15;
+}
+
+// Appends x as printf("%.*f", decimals, x) would; returns the new end.
+// Requires fixed_ok(x); the caller guarantees 32 bytes of room.
+static char *put_fixed(char *p, double x, int decimals) {
+	double scaled = fabs(x) * k_pow10[decimals];
+	double whole = floor(scaled);
+	double frac = scaled - whole;
+	if (!(scaled < FIXED_MAX_SCALED) || fabs(frac - 0.5) < FIXED_TIE_MARGIN) {
+		return p + snprintf(p, 32, "%.*f", decimals, x);
+	}
+
+	uint64_t v = (uint64_t)whole + (frac > 0.5 ? 1 : 0);
+	uint64_t unit = (uint64_t)k_pow10[decimals];
+	if (signbit(x)) *p++ = '-';
+	p = put_u64(p, v / unit);
+	*p++ = '.';
+	uint64_t rem = v % unit;
+	for (int i = decimals - 1; i >= 0; i--) {
+		p[i] = (char)('0' + rem % 10);
+		rem /= 10;
+	}
+	return p + decimals;
+}
+
+static char *put_str(char *p, const char *s, size_t len) {
+	memcpy(p, s, len);
+	return p + len;
+}
+
+#define PUT_LIT(p, lit) put_str((p), (lit), sizeof(lit) - 1)
+
+// Room needed beyond the three strings: fixed keys and punctuation (~150
+// bytes), two 20-digit integers, five numbers of at most 32 bytes, an int
+#define CANONICAL_FIXED_MAX 400
+
+int format_canonical_hazard_json(
+	char *buf, size_t cap,
 	const char *msg_type,
 	const char *ephemeral_id,
 	uint64_t seq,
@@ -15,50 +78,186 @@ char *build_canonical_hazard_json(
 	double confidence,
 	int ttl_seconds
 ) {
+	if (!buf) return -1;
 	if (!msg_type) msg_type = "hazard_report";
 	if (!ephemeral_id) ephemeral_id = "unknown";
 	if (!hazard_type) hazard_type = "unknown";
 
-	// Construct with snprintf into a dynamically sized buffer.
-	// First, compute required size.
-	char preview[1];
-	int needed = snprintf(
-		preview, sizeof(preview),
-		"{\"msg_type\":\"%s\",\"version\":1,\"ephemeral_id\":\"%s\",\"seq\":%llu,\"timestamp\":%llu,\"location\":[%.6f,%.6f],\"speed\":%.2f,\"heading\":%.2f,\"hazard_type\":\"%s\",\"confidence\":%.4f,\"ttl_seconds\":%d}",
-		msg_type,
-		ephemeral_id,
-		(unsigned long long)seq,
-		(unsigned long long)timestamp,
-		lat, lon,
-		speed, heading,
-		hazard_type,
-		confidence,
-		ttl_seconds
-	);
-	if (needed < 0) return NULL;
-
-	char *buf = (char *)malloc((size_t)needed + 1);
-	if (!buf) return NULL;
+	size_t type_len = strlen(msg_type);
+	size_t id_len = strlen(ephemeral_id);
+	size_t hazard_len = strlen(hazard_type);
+	if (cap < type_len + id_len + hazard_len + CANONICAL_FIXED_MAX ||
+	    !fixed_ok(lat) || !fixed_ok(lon) || !fixed_ok(speed) || !fixed_ok(heading) ||
+	    !fixed_ok(confidence)) {
+		// Worst case may not fit, or a value is out of range; let snprintf
+		// decide exactly
+		int n = snprintf(buf, cap,
+			"{\"msg_type\":\"%s\",\"version\":1,\"ephemeral_id\":\"%s\",\"seq\":%llu,\"timestamp\":%llu,\"location\":[%.6f,%.6f],\"speed\":%.2f,\"heading\":%.2f,\"hazard_type\":\"%s\",\"confidence\":%.4f,\"ttl_seconds\":%d}",
+			msg_type, ephemeral_id, (unsigned long long)seq, (unsigned long long)timestamp,
+			lat, lon, speed, heading, hazard_type, confidence, ttl_seconds);
+		return (n < 0 || (size_t)n >= cap) ? -1 : n;
+	}
 
-	int written = snprintf(
-		buf, (size_t)needed + 1,
-		"{\"msg_type\":\"%s\",\"version\":1,\"ephemeral_id\":\"%s\",\"seq\":%llu,\"timestamp\":%llu,\"location\":[%.6f,%.6f],\"speed\":%.2f,\"heading\":%.2f,\"hazard_type\":\"%s\",\"confidence\":%.4f,\"ttl_seconds\":%d}",
-		msg_type,
-		ephemeral_id,
-		(unsigned long long)seq,
-		(unsigned long long)timestamp,
-		lat, lon,
-		speed, heading,
-		hazard_type,
-		confidence,
-		ttl_seconds
-	);
-	if (written < 0 || written > needed) {
+	char *p = buf;
+	p = PUT_LIT(p, "{\"msg_type\":\"");
+	p = put_str(p, msg_type, type_len);
+	p = PUT_LIT(p, "\",\"version\":1,\"ephemeral_id\":\"");
+	p = put_str(p, ephemeral_id, id_len);
+	p = PUT_LIT(p, "\",\"seq\":");
+	p = put_u64(p, seq);
+	p = PUT_LIT(p, ",\"timestamp\":");
+	p = put_u64(p, timestamp);
+	p = PUT_LIT(p, ",\"location\":[");
+	p = put_fixed(p, lat, 6);
+	*p++ = ',';
+	p = put_fixed(p, lon, 6);
+	p = PUT_LIT(p, "],\"speed\":");
+	p = put_fixed(p, speed, 2);
+	p = PUT_LIT(p, ",\"heading\":");
+	p = put_fixed(p, heading, 2);
+	p = PUT_LIT(p, ",\"hazard_type\":\"");
+	p = put_str(p, hazard_type, hazard_len);
+	p = PUT_LIT(p, "\",\"confidence\":");
+	p = put_fixed(p, confidence, 4);
+	p = PUT_LIT(p, ",\"ttl_seconds\":");
+	if (ttl_seconds < 0) {
+		*p++ = '-';
+		p = put_u64(p, (uint64_t)(-(int64_t)ttl_seconds));
+	} else {
+		p = put_u64(p, (uint64_t)ttl_seconds);
+	}
+	*p++ = '}';
+	*p = '\0';
+	return (int)(p - buf);
+}
+
+// Returns heap-allocated canonical JSON string. Caller must free().
+char *build_canonical_hazard_json(
+	const char *msg_type,
+	const char *ephemeral_id,
+	uint64_t seq,
+	uint64_t timestamp,
+	double lat, double lon,
+	double speed, double heading,
+	const char *hazard_type,
+	double confidence,
+	int ttl_seconds
+) {
+	size_t cap = CANONICAL_FIXED_MAX + 1 +
+	             (msg_type ? strlen(msg_type) : 0) +
+	             (ephemeral_id ? strlen(ephemeral_id) : 0) +
+	             (hazard_type ? strlen(hazard_type) : 0) +
+	             32;   // defaults substituted for NULL strings
+	char *buf = (char *)malloc(cap);
+	if (!buf) return NULL;
+	if (format_canonical_hazard_json(buf, cap, msg_type, ephemeral_id, seq, timestamp,
+	                                 lat, lon, speed, heading, hazard_type,
+	                                 confidence, ttl_seconds) < 0) {
 		free(buf);
 		return NULL;
 	}
 	return buf;
 }
 
+// Simple JSON parser to extract ephemeral_id and seq
+int parse_json_fields(const char *json, char *ephemeral_id, uint64_t *seq) {
+	if (!json || !ephemeral_id || !seq) return 0;
+	
+	// Look for ephemeral_id field
+	const char* id_start = strstr(json, "\"ephemeral_id\":\"");
+	if (id_start) {
+		id_start += 16; // Skip "ephemeral_id":"
+		const char* id_end = strchr(id_start, '"');
+		if (id_end) {
+			size_t id_len = id_end - id_start;
+			if (id_len < 64) {
+				strncpy(ephemeral_id, id_start, id_len);
+				ephemeral_id[id_len] = '\0';
+			} else {
+				return 0;
+			}
+		} else {
+			return 0;
+		}
+	} else {
+		return 0;
+	}
+	
+	// Look for seq field
+	const char* seq_start = strstr(json, "\"seq\":");
+	if (seq_start) {
+		seq_start += 6; // Skip "seq":
+		*seq = strtoull(seq_start, NULL, 10);
+		return 1;
+	}
+	
+	return 0;
+}
 
+// Copies the string value of "key":"..." into out. Returns 1 if found.
+static int json_get_string(const char *json, const char *key, char *out, size_t out_size) {
+	const char *p = strstr(json, key);
+	if (!p) return 0;
+	p += strlen(key);
+	const char *end = strchr(p, '"');
+	if (!end) return 0;
+	size_t len = (size_t)(end - p);
+	if (len >= out_size) return 0;
+	memcpy(out, p, len);
+	out[len] = '\0';
+	return 1;
+}
 
+// Parses the number following "key": into out. Returns 1 if found.
+static int json_get_number(const char *json, const char *key, double *out) {
+	const char *p = strstr(json, key);
+	if (!p) return 0;
+	p += strlen(key);
+	char *end = NULL;
+	double v = strtod(p, &end);
+	if (end == p) return 0;
+	*out = v;
+	return 1;
+}
+
+int parse_hazard_report(const char *json, hazard_report_t *out) {
+	if (!json || !out) return 0;
+	memset(out, 0, sizeof(*out));
+	
+	if (!parse_json_fields(json, out->ephemeral_id, &out->seq)) {
+		return 0;
+	}
+	
+	json_get_string(json, "\"msg_type\":\"", out->msg_type, sizeof(out->msg_type));
+	json_get_string(json, "\"hazard_type\":\"", out->hazard_type, sizeof(out->hazard_type));
+	
+	double v;
+	if (json_get_number(json, "\"timestamp\":", &v)) out->timestamp = (uint64_t)v;
+	if (json_get_number(json, "\"confidence\":", &v)) out->confidence = v;
+	if (json_get_number(json, "\"ttl_seconds\":", &v)) out->ttl_seconds = (int)v;
+	
+	// Canonical form is "location":[lat,lon]; the Python simulator also
+	// sends separate latitude/longitude keys
+	const char *loc = strstr(json, "\"location\":[");
+	if (loc) {
+		char *end = NULL;
+		loc += 12;
+		out->lat = strtod(loc, &end);
+		if (end != loc && *end == ',') {
+			const char *lon_start = end + 1;
+			out->lon = strtod(lon_start, &end);
+			out->has_location = (end != lon_start);
+		}
+	}
+	if (!out->has_location &&
+	    json_get_number(json, "\"latitude\":", &out->lat) &&
+	    json_get_number(json, "\"longitude\":", &out->lon)) {
+		out->has_location = 1;
+	}
+	
+	int has_speed = json_get_number(json, "\"speed\":", &out->speed);
+	int has_heading = json_get_number(json, "\"heading\":", &out->heading);
+	out->has_kinematics = has_speed && has_heading;
+	
+	return 1;
+}
@@ -1,8 +1,26 @@
 #ifndef JSONMSG_H
 #define JSONMSG_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+// Writes the canonical hazard JSON into buf without allocating. Returns its
+// length (excluding the NUL), or -1 if it does not fit in cap bytes. The
+// output is byte-identical to the printf-based form the signatures cover.
+int format_canonical_hazard_json(
+	char *buf, size_t cap,
+	const char *msg_type,
+	const char *ephemeral_id,
+	uint64_t seq,
+	uint64_t timestamp,
+	double lat, double lon,
+	double speed, double heading,
+	const char *hazard_type,
+	double confidence,
+	int ttl_seconds
+);
+
+// Same, returned in a malloc'd buffer the caller must free()
 char *build_canonical_hazard_json(
 	const char *msg_type,
 	const char *ephemeral_id,
@@ -15,6 +33,28 @@ char *build_canonical_hazard_json(
 	int ttl_seconds
 );
 
+// Fields of a received hazard report. Missing fields are left zeroed.
+typedef struct {
+	char msg_type[32];
+	char ephemeral_id[64];
+	uint64_t seq;
+	uint64_t timestamp;
+	double lat, lon;
+	double speed, heading;
+	char hazard_type[32];
+	double confidence;
+	int ttl_seconds;
+	int has_location;
+	int has_kinematics;
+} hazard_report_t;
+
+// Extracts ephemeral_id and seq. Returns 1 if both were found, 0 otherwise.
+int parse_json_fields(const char *json, char *ephemeral_id, uint64_t *seq);
+
+// Extracts every known hazard report field. Returns 1 if ephemeral_id and
+// seq were found (the minimum for replay/rate checks), 0 otherwise.
+int parse_hazard_report(const char *json, hazard_report_t *out);
+
 #endif // JSONMSG_H
 
 
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <time.h>
+#include <signal.h>
 #ifdef _WIN32
 #include <windows.h>
 #else
@@ -11,6 +12,7 @@
 #ifndef _WIN32
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <sys/socket.h>
 #endif
 
 #ifndef INET_ADDRSTRLEN
@@ -22,9 +24,25 @@
 #include "crypto.h"
 #include "replay.h"
 #include "ratelimit.h"
+#include "ingest.h"
+#include "sendsched.h"
+#include "bundle.h"
+#include "dcc.h"
+#include "neighbor.h"
+#include "stagestats.h"
+#include "metrics.h"
+#include "asynclog.h"
+#include "capture.h"
+#include "impair.h"
+#include "relay.h"
+#include "alertsync.h"
+#include "timeutil.h"
+#include "db/db.h"
+#include "db/journal.h"
+#include "core/alerts.h"
+#include "core/alerts_integration.h"
 
 // Forward declarations
-static int parse_json_fields(const char* json, char* ephemeral_id, uint64_t* seq);
 static int parse_ip_port(const char* s, char* out_ip, int* out_port);
 
 typedef struct {
@@ -34,229 +52,363 @@ typedef struct {
 	int peer_port;
 } app_config_t;
 
+// Set on SIGINT/SIGTERM (Ctrl+C on Windows) so threads wind down and print stats
+static volatile sig_atomic_t g_stop = 0;
+static int g_sockfd = -1;
+static impair_t* g_impair_rx = NULL;
+static int g_group_member = 0;
+
+// Our identity and position as reported in emit_hazard_report(); --id and
+// --position override them
+#ifdef _WIN32
+static const char* g_node_id = "node_001";
+static double g_lat = 40.7128, g_lon = -74.0060;  // NYC coordinates
+#else
+static const char* g_node_id = "node_002";
+static double g_lat = 40.7589, g_lon = -73.9851;  // Different NYC coordinates
+#endif
+
+// One sequence for everything sent under g_node_id (reports and alert
+// sync), so receivers' replay checks never see a pair twice
+static uint64_t g_tx_seq = 0;
+
+static uint64_t next_tx_seq(void) {
+	return __atomic_add_fetch(&g_tx_seq, 1, __ATOMIC_RELAXED);
+}
+
 #ifdef _WIN32
+static BOOL WINAPI on_console_ctrl(DWORD type) {
+	(void)type;
+	g_stop = 1;
+	closesocket(g_sockfd);  // unblocks recvfrom
+	return TRUE;
+}
+#else
+static void on_signal(int sig) {
+	(void)sig;
+	g_stop = 1;
+	shutdown(g_sockfd, SHUT_RDWR);  // unblocks recvfrom
+}
+#endif
+
+// Verification pipeline for one queued datagram (runs on the process thread)
+static void process_message(const ingest_msg_t* msg) {
+	const char* buf = msg->data;
+	
+	// Log the received message; formatting happens on the log writer thread
+	alog_event(ALOG_EV_RECEIVED, &msg->src, NULL, 0, buf, (size_t)msg->len);
+	
+	// Relayed reports carry a header in front of the signed JSON
+	relay_header_t relay_hdr;
+	int relayed = relay_parse(buf, (size_t)msg->len, &relay_hdr, &buf);
+	size_t len = (size_t)msg->len - (size_t)(buf - msg->data);
+	
+	// Extract ephemeral_id and seq from JSON
+	char ephemeral_id[64] = {0};
+	uint64_t seq = 0;
+	
+	uint64_t t = monotonic_ns();
+	int parsed = parse_json_fields(buf, ephemeral_id, &seq);
+	t = stage_lap(STAGE_PARSE, t);
+	if (!parsed || relayed < 0) {
+		stage_reject(REJECT_MALFORMED);
+		alog_event(ALOG_EV_MALFORMED, &msg->src, NULL, 0, msg->data, (size_t)msg->len);
+		return;
+	}
+	// Our own report, looped back by the multicast group
+	if (g_group_member && strcmp(ephemeral_id, g_node_id) == 0) {
+		return;
+	}
+	dcc_note_sender(ephemeral_id);
+	
+	// Any copy, even one the replay check drops, means a neighbour has
+	// already sent this report on, so a relay we have pending is not needed
+	relay_overheard(ephemeral_id, seq);
+	
+	// Check for replay attacks
+	int fresh = replay_cache_check_and_add(ephemeral_id, seq);
+	t = stage_lap(STAGE_REPLAY, t);
+	if (!fresh) {
+		stage_reject(REJECT_REPLAY);
+		alog_event(ALOG_EV_REPLAY, &msg->src, ephemeral_id, seq, NULL, 0);
+		return;
+	}
+	
+	// Alert table sync; a sync burst answers our own request, so instead
+	// of the sender's report rate it is charged to alertsync's own budget
+	if (alertsync_is_sync(buf)) {
+		if (verify_message("peer_pub.pem", buf, NULL, 0) != 0) {
+			stage_reject(REJECT_BAD_SIGNATURE);
+			alog_event(ALOG_EV_SIG_INVALID, &msg->src, ephemeral_id, seq, NULL, 0);
+		} else {
+			int handled = alertsync_handle(buf);
+			if (handled > 0) {
+				stage_reject(REJECT_RATE_LIMITED);
+				alog_event(ALOG_EV_RATE_LIMITED, &msg->src, ephemeral_id, seq, NULL, 0);
+			} else if (handled < 0) {
+				stage_reject(REJECT_MALFORMED);
+			}
+		}
+		return;
+	}
+	
+	// Check rate limiting
+	int allowed = ratelimit_allow(ephemeral_id);
+	t = stage_lap(STAGE_RATELIMIT, t);
+	if (!allowed) {
+		stage_reject(REJECT_RATE_LIMITED);
+		alog_event(ALOG_EV_RATE_LIMITED, &msg->src, ephemeral_id, seq, NULL, 0);
+		return;
+	}
+	
+	// Verify signature (stub implementation always succeeds)
+	int verify_result = verify_message("peer_pub.pem", buf, NULL, 0);
+	stage_lap(STAGE_VERIFY, t);
+	if (verify_result == 0) {
+		alog_event(ALOG_EV_SIG_VALID, &msg->src, ephemeral_id, seq, NULL, 0);
+	} else {
+		stage_reject(REJECT_BAD_SIGNATURE);
+		alog_event(ALOG_EV_SIG_INVALID, &msg->src, ephemeral_id, seq, NULL, 0);
+		return;
+	}
+
+	// Track the sender's position and link quality
+	t = monotonic_ns();
+	hazard_report_t report;
+	if (!parse_hazard_report(buf, &report)) {
+		stage_lap(STAGE_NEIGHBOR, t);
+		stage_reject(REJECT_INCOMPLETE);
+		return;
+	}
+	// A relayed copy comes from the relay, not from a neighbour at the
+	// reported position
+	if (relayed == 0 || relay_hdr.hops == 0) {
+		neighbor_update(&report, &msg->src, msg->len);
+	}
+	t = stage_lap(STAGE_NEIGHBOR, t);
+
+	// Corroborate hazards; enough distinct reporters promote an alert to
+	// VERIFIED, which is persisted by the write-behind thread
+	if (report.has_location && report.hazard_type[0] != '\0' &&
+	    strcmp(report.msg_type, "hazard_report") == 0) {
+		add_or_update_alert(report.ephemeral_id, report.hazard_type,
+		                    report.lat, report.lon, report.confidence);
+		stage_lap(STAGE_ALERT, t);
+	}
+
+	relay_consider(relayed == 1 ? &relay_hdr : NULL, &report, buf, len);
+}
+
+// Signs and queues an alert sync message for alertsync.c
+static int send_alert_sync(const char* payload) {
+	// Sync is routine traffic; congestion control withholds it first
+	if (!dcc_class_allowed(MSG_PRIO_ROUTINE)) {
+		return -1;
+	}
+	unsigned char* sig = NULL;
+	size_t sig_len = 0;
+	if (sign_message("node_priv.pem", payload, &sig, &sig_len) != 0) {
+		return -1;
+	}
+	if (sig) free(sig);
+	return send_sched_submit(MSG_PRIO_ROUTINE, payload);
+}
+
+// Periodic hazard report, invoked by the send scheduler on its own thread
+static void emit_hazard_report(void* arg) {
+	const dcc_config_t* dcc_cfg = (const dcc_config_t*)arg;
+	uint64_t seq = next_tx_seq();
+
+	// Housekeeping rides on the periodic tick
+	expire_old_alerts();
+	
+	// Let congestion control stretch or shrink the interval to the next report
+	if (dcc_cfg && dcc_cfg->enabled) {
+		dcc_tick();
+		send_sched_set_interval(dcc_tx_interval_ms());
+	}
+	
+	// Generate hazard report JSON message
+	char json_msg[INGEST_MSG_MAX];
+#ifdef _WIN32
+	int json_len = format_canonical_hazard_json(
+		json_msg, sizeof(json_msg),
+		"hazard_report",
+		g_node_id,
+		seq,
+		(uint64_t)time(NULL),
+		g_lat, g_lon,
+		65.5, 180.0,        // speed and heading
+		"ice_patch",
+		0.95,
+		300                 // ttl_seconds: the hazard's lifetime
+	);
+#else
+	int json_len = format_canonical_hazard_json(
+		json_msg, sizeof(json_msg),
+		"hazard_report",
+		g_node_id,
+		seq,
+		(uint64_t)time(NULL),
+		g_lat, g_lon,
+		55.0, 270.0,        // speed and heading
+		"debris",
+		0.88,
+		300                 // ttl_seconds: the hazard's lifetime
+	);
+#endif
+	if (json_len < 0) return;
+	
+	msg_priority_t prio = msg_classify(json_msg);
+	if (!dcc_class_allowed(prio)) {
+		return;
+	}
+	
+	alog_event(ALOG_EV_SENDING, NULL, NULL, 0, json_msg, (size_t)json_len);
+	
+	// Sign the message
+	unsigned char* sig = NULL;
+	size_t sig_len = 0;
+	int sign_result = sign_message("node_priv.pem", json_msg, &sig, &sig_len);
+	
+	if (sign_result == 0) {
+		alog_event(ALOG_EV_SIGNED, NULL, NULL, seq, NULL, 0);
+		if (sig) free(sig);
+	} else {
+		alog_event(ALOG_EV_SIGN_FAILED, NULL, NULL, seq, NULL, 0);
+	}
+	
+	// With relaying on, our reports carry their hop limit and relevance area
+	if (relay_enabled()) {
+		char wrapped[INGEST_MSG_MAX];
+		if (relay_wrap_origin(wrapped, sizeof(wrapped), json_msg, (size_t)json_len) >= 0) {
+			send_sched_submit(prio, wrapped);
+			return;
+		}
+	}
+	send_sched_submit(prio, json_msg);
+}
+
+// Hands a datagram to the ingest queue. Bundles are split in place: each
+// record goes straight from the receive buffer into its own ingest slot, so
+// it is classified and shed on its own priority. Records are NUL-terminated
+// in place for the string scans, by briefly overwriting the byte after them.
+static void enqueue_datagram(char* buf, int n, const struct sockaddr_in* src) {
+	bundle_reader_t br;
+	if (!bundle_is_bundle(buf, (size_t)n)) {
+		ingest_enqueue(buf, n, src);
+		return;
+	}
+	if (bundle_reader_init(&br, buf, (size_t)n) != 0) {
+		return;
+	}
+	const char* msg;
+	size_t len;
+	while (bundle_next(&br, &msg, &len) == 1) {
+		char* end = (char*)msg + len;   // inside buf; udp_recv leaves room for the final NUL
+		char saved = *end;
+		*end = '\0';
+		ingest_enqueue(msg, (int)len, src);
+		*end = saved;
+	}
+}
+
+// impair_deliver_fn for --impair-rx; runs on the impairment delay thread
+// for delayed datagrams, ingest_enqueue() is safe from any thread
+static void deliver_impaired(void* arg, int sock, const struct sockaddr_in* src, char* buf, size_t len) {
+	(void)arg;
+	(void)sock;
+	enqueue_datagram(buf, (int)len, src);
+}
+
+// With --capture, the datagram is recorded as received, before any of this
+// and before --impair-rx, so a capture can be replayed under new impairments.
+static void deliver_datagram(char* buf, int n, const struct sockaddr_in* src) {
+	if (capture_is_open()) {
+		capture_write(buf, (size_t)n, src);
+	}
+	if (g_impair_rx) {
+		impair_submit(g_impair_rx, g_sockfd, src, buf, (size_t)n);
+		return;
+	}
+	enqueue_datagram(buf, n, src);
+}
+
+// impair_deliver_fn for --impair-tx
+static void send_impaired(void* arg, int sock, const struct sockaddr_in* dst, char* buf, size_t len) {
+	(void)arg;
+	udp_sendto(sock, dst, buf, len);
+}
+
+#ifdef _WIN32
+// Drains the socket as fast as possible; all checks happen on process_thread
 DWORD WINAPI recv_thread(LPVOID arg) {
 	app_config_t* cfg = (app_config_t*)arg;
-	char buf[2048];
+	char buf[INGEST_MSG_MAX];
 	struct sockaddr_in src;
-	for (;;) {
-		int n = udp_recv(cfg->sockfd, buf, sizeof(buf) - 1, &src);
+	while (!g_stop) {
+		int n = udp_recv(cfg->sockfd, buf, sizeof(buf), &src);
 		if (n > 0) {
-			buf[n] = '\0';
-			char ipstr[INET_ADDRSTRLEN];
-			inet_ntop(AF_INET, &src.sin_addr, ipstr, sizeof(ipstr));
-			
-			// Print received JSON message
-			printf("RECEIVED from %s:%d -> %s\n", ipstr, ntohs(src.sin_port), buf);
-			
-			// Extract ephemeral_id and seq from JSON
-			char ephemeral_id[64] = {0};
-			uint64_t seq = 0;
-			
-			if (!parse_json_fields(buf, ephemeral_id, &seq)) {
-				printf("❌ Invalid JSON format - missing ephemeral_id or seq\n");
-				fflush(stdout);
-				continue;
-			}
-			
-			// Check for replay attacks
-			if (!replay_cache_check_and_add(ephemeral_id, seq)) {
-				printf("⛔ Replay detected from %s (ephemeral_id: %s, seq: %llu)\n", 
-				       ipstr, ephemeral_id, (unsigned long long)seq);
-				fflush(stdout);
-				continue;
-			}
-			
-			// Check rate limiting
-			if (!ratelimit_allow(ephemeral_id)) {
-				printf("🚫 Rate limit exceeded from %s (ephemeral_id: %s)\n", 
-				       ipstr, ephemeral_id);
-				fflush(stdout);
-				continue;
-			}
-			
-			// Verify signature (stub implementation always succeeds)
-			int verify_result = verify_message("peer_pub.pem", buf, NULL, 0);
-			if (verify_result == 0) {
-				printf("SIGNATURE VERIFICATION: VALID ✓\n");
-			} else {
-				printf("SIGNATURE VERIFICATION: INVALID ✗\n");
-			}
-			fflush(stdout);
+			dcc_on_receive((size_t)n);
+			dcc_tick();
+			deliver_datagram(buf, n, &src);
 		}
 	}
 	return 0;
 }
 
-DWORD WINAPI send_thread(LPVOID arg) {
-	app_config_t* cfg = (app_config_t*)arg;
-	static uint64_t seq = 0;
-	
-	for (;;) {
-		// Generate hazard report JSON message
-		char* json_msg = build_canonical_hazard_json(
-			"hazard_report",
-			"node_001",
-			++seq,
-			(uint64_t)time(NULL),
-			40.7128, -74.0060,  // NYC coordinates
-			65.5, 180.0,        // speed and heading
-			"ice_patch",
-			0.95,
-			300
-		);
-		
-		if (json_msg) {
-			printf("SENDING: %s\n", json_msg);
-			
-			// Sign the message
-			unsigned char* sig = NULL;
-			size_t sig_len = 0;
-			int sign_result = sign_message("node_priv.pem", json_msg, &sig, &sig_len);
-			
-			if (sign_result == 0) {
-				printf("MESSAGE SIGNED ✓\n");
-				if (sig) free(sig);
-			} else {
-				printf("SIGNING FAILED ✗\n");
-			}
-			
-			udp_send(cfg->sockfd, cfg->peer_ip, cfg->peer_port, json_msg);
-			free(json_msg);
-		}
-		Sleep(3000);
+DWORD WINAPI process_thread(LPVOID arg) {
+	(void)arg;
+	ingest_msg_t* msg;
+	while ((msg = ingest_dequeue()) != NULL) {
+		uint64_t start = stage_lap(STAGE_QUEUE, msg->received_ns);
+		process_message(msg);
+		stage_lap(STAGE_TOTAL, start);
+		ingest_release(msg);
 	}
 	return 0;
 }
+
+DWORD WINAPI send_thread(LPVOID arg) {
+	(void)arg;
+	send_sched_run();
+	return 0;
+}
 #else
+// Drains the socket as fast as possible; all checks happen on process_thread
 void* recv_thread(void* arg) {
 	app_config_t* cfg = (app_config_t*)arg;
-	char buf[2048];
+	char buf[INGEST_MSG_MAX];
 	struct sockaddr_in src;
-	for (;;) {
+	while (!g_stop) {
 		int n = udp_recv(cfg->sockfd, buf, sizeof(buf), &src);
 		if (n > 0) {
-			char ipstr[INET_ADDRSTRLEN];
-			inet_ntop(AF_INET, &src.sin_addr, ipstr, sizeof(ipstr));
-			
-			// Print received JSON message
-			printf("RECEIVED from %s:%d -> %s\n", ipstr, ntohs(src.sin_port), buf);
-			
-			// Extract ephemeral_id and seq from JSON
-			char ephemeral_id[64] = {0};
-			uint64_t seq = 0;
-			
-			if (!parse_json_fields(buf, ephemeral_id, &seq)) {
-				printf("❌ Invalid JSON format - missing ephemeral_id or seq\n");
-				fflush(stdout);
-				continue;
-			}
-			
-			// Check for replay attacks
-			if (!replay_cache_check_and_add(ephemeral_id, seq)) {
-				printf("⛔ Replay detected from %s (ephemeral_id: %s, seq: %llu)\n", 
-				       ipstr, ephemeral_id, (unsigned long long)seq);
-				fflush(stdout);
-				continue;
-			}
-			
-			// Check rate limiting
-			if (!ratelimit_allow(ephemeral_id)) {
-				printf("🚫 Rate limit exceeded from %s (ephemeral_id: %s)\n", 
-				       ipstr, ephemeral_id);
-				fflush(stdout);
-				continue;
-			}
-			
-			// Verify signature (stub implementation always succeeds)
-			int verify_result = verify_message("peer_pub.pem", buf, NULL, 0);
-			if (verify_result == 0) {
-				printf("SIGNATURE VERIFICATION: VALID ✓\n");
-			} else {
-				printf("SIGNATURE VERIFICATION: INVALID ✗\n");
-			}
-			fflush(stdout);
+			dcc_on_receive((size_t)n);
+			dcc_tick();
+			deliver_datagram(buf, n, &src);
 		}
 	}
 	return NULL;
 }
 
-void* send_thread(void* arg) {
-	app_config_t* cfg = (app_config_t*)arg;
-	static uint64_t seq = 0;
-	
-	for (;;) {
-		// Generate hazard report JSON message
-		char* json_msg = build_canonical_hazard_json(
-			"hazard_report",
-			"node_002",
-			++seq,
-			(uint64_t)time(NULL),
-			40.7589, -73.9851,  // Different NYC coordinates
-			55.0, 270.0,        // speed and heading
-			"debris",
-			0.88,
-			300
-		);
-		
-		if (json_msg) {
-			printf("SENDING: %s\n", json_msg);
-			
-			// Sign the message
-			unsigned char* sig = NULL;
-			size_t sig_len = 0;
-			int sign_result = sign_message("node_priv.pem", json_msg, &sig, &sig_len);
-			
-			if (sign_result == 0) {
-				printf("MESSAGE SIGNED ✓\n");
-				if (sig) free(sig);
-			} else {
-				printf("SIGNING FAILED ✗\n");
-			}
-			
-			udp_send(cfg->sockfd, cfg->peer_ip, cfg->peer_port, json_msg);
-			free(json_msg);
-		}
-		sleep(3);
+void* process_thread(void* arg) {
+	(void)arg;
+	ingest_msg_t* msg;
+	while ((msg = ingest_dequeue()) != NULL) {
+		uint64_t start = stage_lap(STAGE_QUEUE, msg->received_ns);
+		process_message(msg);
+		stage_lap(STAGE_TOTAL, start);
+		ingest_release(msg);
 	}
 	return NULL;
 }
-#endif
 
-// Simple JSON parser to extract ephemeral_id and seq
-static int parse_json_fields(const char* json, char* ephemeral_id, uint64_t* seq) {
-	if (!json || !ephemeral_id || !seq) return 0;
-	
-	// Look for ephemeral_id field
-	const char* id_start = strstr(json, "\"ephemeral_id\":\"");
-	if (id_start) {
-		id_start += 15; // Skip "ephemeral_id":"
-		const char* id_end = strchr(id_start, '"');
-		if (id_end) {
-			size_t id_len = id_end - id_start;
-			if (id_len < 64) {
-				strncpy(ephemeral_id, id_start, id_len);
-				ephemeral_id[id_len] = '\0';
-			} else {
-				return 0;
-			}
-		} else {
-			return 0;
-		}
-	} else {
-		return 0;
-	}
-	
-	// Look for seq field
-	const char* seq_start = strstr(json, "\"seq\":");
-	if (seq_start) {
-		seq_start += 6; // Skip "seq":
-		*seq = strtoull(seq_start, NULL, 10);
-		return 1;
-	}
-	
-	return 0;
+void* send_thread(void* arg) {
+	(void)arg;
+	send_sched_run();
+	return NULL;
 }
+#endif
 
 static int parse_ip_port(const char* s, char* out_ip, int* out_port) {
 	const char* colon = strchr(s, ':');
@@ -269,11 +421,57 @@ static int parse_ip_port(const char* s, char* out_ip, int* out_port) {
 	return (*out_port > 0 && *out_port < 65536) ? 0 : -1;
 }
 
+// Parses a "HIGH:LOW" watermark pair given in percent of queue capacity
+static int parse_watermarks(const char* s, int* high, int* low) {
+	int h = 0, l = 0;
+	if (sscanf(s, "%d:%d", &h, &l) != 2) return -1;
+	if (h <= 0 || l < 0 || l >= h) return -1;
+	*high = h;
+	*low = l;
+	return 0;
+}
+
+// Stops --impair-rx once the receive thread has exited. Datagrams still
+// delayed are discarded, so none reach ingest after its shutdown
+static void stop_rx_impairment(void) {
+	if (!g_impair_rx) return;
+	impair_print_stats(g_impair_rx);
+	impair_destroy(g_impair_rx);
+	g_impair_rx = NULL;
+}
+
 int main(int argc, char** argv) {
 	int port = 0;
 	char peer_ip[64] = {0};
 	int peer_port = 0;
 	const char* peer = NULL;
+	const char* group = NULL;
+	const char* ifaces[NET_MAX_IFACES];
+	int iface_count = 0;
+	int mcast_ttl = 1;
+	int mcast_loop = 1;
+	int rcvbuf = 1 << 20;
+	int report_interval_ms = 3000;
+	int neighbor_timeout_ms = NEIGHBOR_DEFAULT_TIMEOUT_MS;
+	const char* journal_dir = NULL;
+	int metrics_port = 0;
+	const char* capture_path = NULL;
+	const char* impair_tx_spec = NULL;
+	const char* impair_rx_spec = NULL;
+	int relay_on = 0;
+	relay_config_t relay_cfg;
+	relay_config_defaults(&relay_cfg);
+	int alert_sync_on = 0;
+	alertsync_config_t alert_sync_cfg;
+	alertsync_config_defaults(&alert_sync_cfg);
+	alog_config_t log_cfg;
+	alog_config_defaults(&log_cfg);
+	send_sched_config_t sched_cfg;
+	send_sched_config_defaults(&sched_cfg);
+	dcc_config_t dcc_cfg;
+	dcc_config_defaults(&dcc_cfg);
+	ingest_config_t ingest_cfg;
+	ingest_config_defaults(&ingest_cfg);
 
 	// Simple argument parsing: expect --port <port> --peer <ip:port>
 	for (int i = 1; i < argc; ++i) {
@@ -281,28 +479,265 @@ int main(int argc, char** argv) {
 			port = atoi(argv[++i]);
 		} else if (strcmp(argv[i], "--peer") == 0 && i + 1 < argc) {
 			peer = argv[++i];
+		} else if (strcmp(argv[i], "--group") == 0 && i + 1 < argc) {
+			group = argv[++i];
+		} else if (strcmp(argv[i], "--iface") == 0 && i + 1 < argc) {
+			if (iface_count == NET_MAX_IFACES) {
+				fprintf(stderr, "at most %d --iface options\n", NET_MAX_IFACES);
+				return 1;
+			}
+			ifaces[iface_count++] = argv[++i];
+		} else if (strcmp(argv[i], "--mcast-ttl") == 0 && i + 1 < argc) {
+			mcast_ttl = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--mcast-loop") == 0 && i + 1 < argc) {
+			mcast_loop = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--id") == 0 && i + 1 < argc) {
+			g_node_id = argv[++i];
+		} else if (strcmp(argv[i], "--ingest-queue") == 0 && i + 1 < argc) {
+			ingest_cfg.capacity = (size_t)atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--shed-routine") == 0 && i + 1 < argc) {
+			if (parse_watermarks(argv[++i], &ingest_cfg.high_pct[MSG_PRIO_ROUTINE],
+			                     &ingest_cfg.low_pct[MSG_PRIO_ROUTINE]) != 0) {
+				fprintf(stderr, "invalid --shed-routine, expected HIGH:LOW percent\n");
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--shed-hazard") == 0 && i + 1 < argc) {
+			if (parse_watermarks(argv[++i], &ingest_cfg.high_pct[MSG_PRIO_HAZARD],
+			                     &ingest_cfg.low_pct[MSG_PRIO_HAZARD]) != 0) {
+				fprintf(stderr, "invalid --shed-hazard, expected HIGH:LOW percent\n");
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--rcvbuf") == 0 && i + 1 < argc) {
+			rcvbuf = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--report-interval") == 0 && i + 1 < argc) {
+			report_interval_ms = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--neighbor-timeout") == 0 && i + 1 < argc) {
+			neighbor_timeout_ms = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--event-journal") == 0 && i + 1 < argc) {
+			journal_dir = argv[++i];
+		} else if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+			metrics_port = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+			capture_path = argv[++i];
+		} else if (strcmp(argv[i], "--position") == 0 && i + 1 < argc) {
+			if (sscanf(argv[++i], "%lf:%lf", &g_lat, &g_lon) != 2) {
+				fprintf(stderr, "invalid --position, expected LAT:LON\n");
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--relay") == 0 && i + 1 < argc) {
+			relay_cfg.hop_limit = atoi(argv[++i]);
+			relay_on = 1;
+		} else if (strcmp(argv[i], "--relay-radius") == 0 && i + 1 < argc) {
+			relay_cfg.radius_m = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--relay-range") == 0 && i + 1 < argc) {
+			relay_cfg.range_m = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--relay-window") == 0 && i + 1 < argc) {
+			relay_cfg.max_delay_ms = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--alert-sync") == 0 && i + 1 < argc) {
+			if (sscanf(argv[++i], "%d:%d", &alert_sync_cfg.interval_ms, &alert_sync_cfg.max_interval_ms) < 1) {
+				fprintf(stderr, "invalid --alert-sync, expected MIN[:MAX] ms\n");
+				return 1;
+			}
+			alert_sync_on = 1;
+		} else if (strcmp(argv[i], "--impair-tx") == 0 && i + 1 < argc) {
+			impair_tx_spec = argv[++i];
+		} else if (strcmp(argv[i], "--impair-rx") == 0 && i + 1 < argc) {
+			impair_rx_spec = argv[++i];
+		} else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc) {
+			if (alog_parse_level(argv[++i], &log_cfg.level) != 0) {
+				fprintf(stderr, "invalid --log-level, expected debug|info|warn|error|off\n");
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--log-format") == 0 && i + 1 < argc) {
+			if (alog_parse_format(argv[++i], &log_cfg.format) != 0) {
+				fprintf(stderr, "invalid --log-format, expected text|json|binary\n");
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--log-file") == 0 && i + 1 < argc) {
+			log_cfg.path = argv[++i];
+		} else if (strcmp(argv[i], "--log-sample-rejects") == 0 && i + 1 < argc) {
+			log_cfg.sample_rejects = (unsigned)atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--dcc") == 0 && i + 1 < argc) {
+			if (sscanf(argv[++i], "%d:%d", &dcc_cfg.min_interval_ms, &dcc_cfg.max_interval_ms) != 2) {
+				fprintf(stderr, "invalid --dcc, expected MIN:MAX ms\n");
+				return 1;
+			}
+			dcc_cfg.enabled = 1;
+		} else if (strcmp(argv[i], "--dcc-target") == 0 && i + 1 < argc) {
+			dcc_cfg.target_pps = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--pace") == 0 && i + 1 < argc) {
+			if (sscanf(argv[++i], "%d:%d:%d", &sched_cfg.min_gap_ms[MSG_PRIO_EMERGENCY],
+			           &sched_cfg.min_gap_ms[MSG_PRIO_HAZARD],
+			           &sched_cfg.min_gap_ms[MSG_PRIO_ROUTINE]) != 3) {
+				fprintf(stderr, "invalid --pace, expected EMERGENCY:HAZARD:ROUTINE ms\n");
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--bundle") == 0 && i + 1 < argc) {
+			sched_cfg.bundle_mtu = (size_t)atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--bundle-window") == 0 && i + 1 < argc) {
+			if (sscanf(argv[++i], "%d:%d:%d", &sched_cfg.bundle_window_ms[MSG_PRIO_EMERGENCY],
+			           &sched_cfg.bundle_window_ms[MSG_PRIO_HAZARD],
+			           &sched_cfg.bundle_window_ms[MSG_PRIO_ROUTINE]) != 3) {
+				fprintf(stderr, "invalid --bundle-window, expected EMERGENCY:HAZARD:ROUTINE ms\n");
+				return 1;
+			}
 		}
 	}
 
-	if (port <= 0 || !peer) {
-		fprintf(stderr, "Usage: %s --port <port> --peer <ip:port>\n", argv[0]);
+	// A group replaces the peer and its port is the one every member binds
+	if (group && !peer) {
+		if (parse_ip_port(group, peer_ip, &peer_port) != 0 || !udp_is_multicast(peer_ip)) {
+			fprintf(stderr, "invalid --group, expected a multicast IP:PORT\n");
+			return 1;
+		}
+		if (port == 0) {
+			port = peer_port;
+		} else if (port != peer_port) {
+			fprintf(stderr, "--port must match the --group port\n");
+			return 1;
+		}
+	}
+
+	if (port <= 0 || (!peer == !group) || strlen(g_node_id) >= 64) {
+		fprintf(stderr, "Usage: %s --port <port> --peer <ip:port> [--ingest-queue <slots>]\n"
+		                "       %s --group <multicast ip:port> [--iface <ip>]... [--mcast-ttl <n>]\n"
+		                "          [--mcast-loop 0|1] [--ingest-queue <slots>]\n"
+		                "          [--shed-routine HIGH:LOW] [--shed-hazard HIGH:LOW] [--rcvbuf <bytes>]\n"
+		                "          [--report-interval <ms>] [--pace E:H:R ms]\n"
+		                "          [--bundle <mtu bytes>] [--bundle-window E:H:R ms]\n"
+		                "          [--dcc MIN:MAX ms] [--dcc-target <pkt/s>] [--neighbor-timeout <ms>]\n"
+		                "          [--event-journal <dir>] [--metrics-port <port>]\n"
+		                "          [--log-level debug|info|warn|error|off] [--log-format text|json|binary]\n"
+		                "          [--log-file <path>] [--log-sample-rejects <N>] [--capture <file>]\n"
+		                "          [--impair-tx SPEC] [--impair-rx SPEC] [--position LAT:LON]\n"
+		                "          [--relay <hop limit>] [--relay-radius <m>] [--relay-range <m>]\n"
+		                "          [--relay-window <ms>] [--id <ephemeral id>] [--alert-sync MIN[:MAX] ms]\n"
+		                "  SPEC: loss=P,ge=P:R[:BAD[:GOOD]],delay=MS,jitter=MS,\n"
+		                "        dist=constant|uniform|normal|pareto,dup=P,reorder=P,seed=N\n",
+		        argv[0], argv[0]);
 		return 1;
 	}
 
-	if (parse_ip_port(peer, peer_ip, &peer_port) != 0) {
+	if (peer && parse_ip_port(peer, peer_ip, &peer_port) != 0) {
 		fprintf(stderr, "invalid --peer, expected IP:PORT\n");
 		return 1;
 	}
 
-	int sockfd = udp_socket_bind(port);
+	int sockfd = group ? udp_socket_bind_shared(port) : udp_socket_bind(port);
 	if (sockfd < 0) {
 		fprintf(stderr, "failed to bind UDP socket on port %d\n", port);
 		return 1;
 	}
+	if (rcvbuf > 0) {
+		udp_set_recv_buffer(sockfd, rcvbuf);
+	}
+	if (group) {
+		// Join on every chosen interface and send from the first one
+		int joined = 0;
+		for (int i = 0; i < (iface_count ? iface_count : 1); i++) {
+			if (udp_join_group(sockfd, peer_ip, iface_count ? ifaces[i] : NULL) == 0) {
+				joined++;
+			}
+		}
+		if (joined == 0 ||
+		    udp_set_multicast_ttl(sockfd, mcast_ttl) != 0 ||
+		    udp_set_multicast_loop(sockfd, mcast_loop) != 0 ||
+		    (iface_count && udp_set_multicast_if(sockfd, ifaces[0]) != 0)) {
+			fprintf(stderr, "failed to set up multicast group %s\n", group);
+			return 1;
+		}
+		g_group_member = 1;
+		printf("Joined multicast group %s on %d interface(s), ttl %d, loopback %s\n",
+		       group, joined, mcast_ttl, mcast_loop ? "on" : "off");
+	}
+	g_sockfd = sockfd;
+#ifdef _WIN32
+	SetConsoleCtrlHandler(on_console_ctrl, TRUE);
+#else
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+#endif
 
 	// Initialize replay protection and rate limiting
+	if (alog_init(&log_cfg) != 0) {
+		return 1;
+	}
+	stage_stats_init();
 	replay_cache_init();
 	ratelimit_init();
+	alerts_map_init();
+	if (journal_dir) {
+		// Audit events go to the mmap journal instead of the audit_log table
+		journal_config_t journal_cfg;
+		journal_config_defaults(&journal_cfg, journal_dir);
+		if (journal_open(&journal_cfg) != 0) {
+			return 1;
+		}
+		db_set_event_sink(journal_append);
+	}
+	init_alerts_database();
+	if (ingest_init(&ingest_cfg) != 0) {
+		return 1;
+	}
+	if (send_sched_init(&sched_cfg, sockfd, peer_ip, peer_port) != 0) {
+		return 1;
+	}
+	if (neighbor_table_init(NEIGHBOR_CAPACITY, neighbor_timeout_ms) != 0) {
+		return 1;
+	}
+	if (relay_on) {
+		if (relay_cfg.hop_limit <= 0 || relay_cfg.radius_m <= 0.0 || relay_cfg.max_delay_ms < 0) {
+			fprintf(stderr, "invalid --relay settings\n");
+			return 1;
+		}
+		if (relay_init(&relay_cfg, g_lat, g_lon) != 0) {
+			return 1;
+		}
+	}
+	if (alert_sync_on && alertsync_init(&alert_sync_cfg, &g_alerts_map, g_node_id, next_tx_seq, send_alert_sync) != 0) {
+		fprintf(stderr, "invalid --alert-sync settings\n");
+		return 1;
+	}
+	if (dcc_init(&dcc_cfg) != 0) {
+		return 1;
+	}
+	dcc_set_neighbor_source(neighbor_count);
+	if (dcc_cfg.enabled) {
+		report_interval_ms = dcc_tx_interval_ms();
+	}
+	send_sched_set_periodic(report_interval_ms, emit_hazard_report, &dcc_cfg);
+	if (metrics_port > 0 && metrics_server_start(metrics_port) != 0) {
+		return 1;
+	}
+	if (capture_path && capture_open(capture_path) != 0) {
+		return 1;
+	}
+	impair_t* impair_tx = NULL;
+	if (impair_tx_spec) {
+		impair_config_t impair_cfg;
+		impair_config_defaults(&impair_cfg);
+		if (impair_parse(impair_tx_spec, &impair_cfg) != 0) {
+			fprintf(stderr, "invalid --impair-tx\n");
+			return 1;
+		}
+		impair_tx = impair_create("tx", &impair_cfg, send_impaired, NULL);
+		if (!impair_tx) {
+			return 1;
+		}
+		udp_set_send_shim(impair_send_shim, impair_tx);
+	}
+	if (impair_rx_spec) {
+		impair_config_t impair_cfg;
+		impair_config_defaults(&impair_cfg);
+		if (impair_parse(impair_rx_spec, &impair_cfg) != 0) {
+			fprintf(stderr, "invalid --impair-rx\n");
+			return 1;
+		}
+		g_impair_rx = impair_create("rx", &impair_cfg, deliver_impaired, NULL);
+		if (!g_impair_rx) {
+			return 1;
+		}
+	}
 
 	app_config_t cfg;
 	cfg.sockfd = sockfd;
@@ -316,32 +751,95 @@ int main(int argc, char** argv) {
 		fprintf(stderr, "CreateThread recv failed\n");
 		return 1;
 	}
+	HANDLE th_proc = CreateThread(NULL, 0, process_thread, &cfg, 0, NULL);
+	if (th_proc == NULL) {
+		fprintf(stderr, "CreateThread process failed\n");
+		return 1;
+	}
 	HANDLE th_send = CreateThread(NULL, 0, send_thread, &cfg, 0, NULL);
 	if (th_send == NULL) {
 		fprintf(stderr, "CreateThread send failed\n");
 		return 1;
 	}
 	WaitForSingleObject(th_recv, INFINITE);
+	stop_rx_impairment();
+	ingest_shutdown();
+	send_sched_shutdown();
+	WaitForSingleObject(th_proc, INFINITE);
 	WaitForSingleObject(th_send, INFINITE);
+	relay_shutdown();
+	alertsync_shutdown();
 	CloseHandle(th_recv);
+	CloseHandle(th_proc);
 	CloseHandle(th_send);
 #else
-	pthread_t th_recv, th_send;
+	pthread_t th_recv, th_proc, th_send;
 	if (pthread_create(&th_recv, NULL, recv_thread, &cfg) != 0) {
 		perror("pthread_create recv");
 		return 1;
 	}
+	if (pthread_create(&th_proc, NULL, process_thread, &cfg) != 0) {
+		perror("pthread_create process");
+		return 1;
+	}
 	if (pthread_create(&th_send, NULL, send_thread, &cfg) != 0) {
 		perror("pthread_create send");
 		return 1;
 	}
 	pthread_join(th_recv, NULL);
+	stop_rx_impairment();
+	ingest_shutdown();
+	send_sched_shutdown();
+	pthread_join(th_proc, NULL);
 	pthread_join(th_send, NULL);
+	relay_shutdown();
+	alertsync_shutdown();
 #endif
 
-	// Cleanup replay protection and rate limiting
+	// Cleanup queues, replay protection and rate limiting
+	metrics_server_stop();
+	alog_shutdown();
+	if (capture_is_open()) {
+		capture_close();
+		capture_print_stats();
+	}
+	if (impair_tx) {
+		// The send thread has exited; nothing else goes through the shim
+		udp_set_send_shim(NULL, NULL);
+		impair_print_stats(impair_tx);
+		impair_destroy(impair_tx);
+	}
+	ingest_print_stats();
+	stage_stats_print();
+	send_sched_print_stats();
+	dcc_print_status();
+	neighbor_print_stats();
+	relay_print_stats();
+	alertsync_print_stats();
+	ingest_cleanup();
+	send_sched_cleanup();
+	dcc_cleanup();
+	neighbor_table_cleanup();
+	relay_cleanup();
+	alertsync_cleanup();
+#ifndef _WIN32
+	// Closing the socket on Ctrl+C already dropped the memberships on Windows
+	if (group) {
+		for (int i = 0; i < (iface_count ? iface_count : 1); i++) {
+			udp_leave_group(sockfd, peer_ip, iface_count ? ifaces[i] : NULL);
+		}
+	}
+#endif
+	cleanup_alerts_database();
+	if (journal_is_open()) {
+		db_set_event_sink(NULL);
+		journal_print_stats();
+		journal_close();
+	}
+	alerts_map_cleanup();
 	replay_cache_cleanup();
 	ratelimit_cleanup();
+	stage_stats_cleanup();
 
 	return 0;
 }
@@ -0,0 +1,308 @@
+#include "metrics.h"
+#include "stagestats.h"
+#include "ingest.h"
+#include "sendsched.h"
+#include "net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#endif
+
+#define METRICS_INITIAL_BUF 16384
+#define METRICS_POLL_MS 250
+#define METRICS_CLIENT_TIMEOUT_MS 2000  // per recv/send on a scrape connection
+
+typedef struct {
+    char *buf;
+    size_t cap;
+    size_t len;
+} metrics_out_t;
+
+static int g_listen_fd = -1;
+static volatile int g_stopping = 0;
+#ifdef _WIN32
+static HANDLE g_thread = NULL;
+#else
+static pthread_t g_thread;
+static int g_thread_started = 0;
+#endif
+
+static void out_printf(metrics_out_t *o, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    size_t room = o->len < o->cap ? o->cap - o->len : 0;
+    int n = vsnprintf(room ? o->buf + o->len : NULL, room, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        o->len += (size_t)n;
+    }
+}
+
+static void render_stages(metrics_out_t *o) {
+    static const double k_quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    stage_stats_t st;
+    stage_stats_snapshot(&st);
+
+    out_printf(o, "# HELP v2v_stage_latency_seconds Time spent per message in each pipeline stage.\n"
+                  "# TYPE v2v_stage_latency_seconds summary\n");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const stage_hist_t *h = &st.stage[s];
+        const char *name = stage_name((stage_t)s);
+        for (size_t q = 0; q < sizeof(k_quantiles) / sizeof(k_quantiles[0]); q++) {
+            out_printf(o, "v2v_stage_latency_seconds{stage=\"%s\",quantile=\"%g\"} %.9f\n",
+                       name, k_quantiles[q], (double)stage_hist_quantile(h, k_quantiles[q]) / 1e9);
+        }
+        out_printf(o, "v2v_stage_latency_seconds_sum{stage=\"%s\"} %.9f\n", name, (double)h->sum_ns / 1e9);
+        out_printf(o, "v2v_stage_latency_seconds_count{stage=\"%s\"} %llu\n", name,
+                   (unsigned long long)h->count);
+    }
+    out_printf(o, "# HELP v2v_stage_latency_max_seconds Slowest message seen in each stage.\n"
+                  "# TYPE v2v_stage_latency_max_seconds gauge\n");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        out_printf(o, "v2v_stage_latency_max_seconds{stage=\"%s\"} %.9f\n",
+                   stage_name((stage_t)s), (double)st.stage[s].max_ns / 1e9);
+    }
+    out_printf(o, "# HELP v2v_rejects_total Messages rejected, by stage and reason.\n"
+                  "# TYPE v2v_rejects_total counter\n");
+    for (int r = 0; r < REJECT_COUNT; r++) {
+        out_printf(o, "v2v_rejects_total{stage=\"%s\",reason=\"%s\"} %llu\n",
+                   stage_name(reject_reason_stage((reject_reason_t)r)),
+                   reject_reason_name((reject_reason_t)r), (unsigned long long)st.rejects[r]);
+    }
+}
+
+static void render_ingest(metrics_out_t *o) {
+    ingest_stats_t st;
+    ingest_get_stats(&st);
+    out_printf(o, "# HELP v2v_ingest_messages_total Datagrams through the ingest queue, by class and outcome.\n"
+                  "# TYPE v2v_ingest_messages_total counter\n");
+    for (int c = 0; c < MSG_PRIO_COUNT; c++) {
+        const ingest_class_stats_t *cs = &st.cls[c];
+        const char *cls = msg_priority_name((msg_priority_t)c);
+        const struct { const char *outcome; uint64_t value; } rows[] = {
+            { "received", cs->received }, { "enqueued", cs->enqueued },
+            { "processed", cs->processed }, { "shed", cs->shed },
+            { "displaced", cs->displaced }, { "overflow", cs->overflow },
+        };
+        for (size_t i = 0; i < sizeof(rows) / sizeof(rows[0]); i++) {
+            out_printf(o, "v2v_ingest_messages_total{class=\"%s\",outcome=\"%s\"} %llu\n",
+                       cls, rows[i].outcome, (unsigned long long)rows[i].value);
+        }
+    }
+    out_printf(o, "# HELP v2v_ingest_queue_depth Messages waiting in the ingest queue.\n"
+                  "# TYPE v2v_ingest_queue_depth gauge\n"
+                  "v2v_ingest_queue_depth %zu\n"
+                  "# HELP v2v_ingest_queue_capacity Ingest queue slots.\n"
+                  "# TYPE v2v_ingest_queue_capacity gauge\n"
+                  "v2v_ingest_queue_capacity %zu\n",
+               st.depth, st.capacity);
+}
+
+static void render_send(metrics_out_t *o) {
+    send_sched_stats_t st;
+    send_sched_get_stats(&st);
+    out_printf(o, "# HELP v2v_send_messages_total Outgoing messages, by class and outcome.\n"
+                  "# TYPE v2v_send_messages_total counter\n");
+    for (int c = 0; c < MSG_PRIO_COUNT; c++) {
+        const send_class_stats_t *cs = &st.cls[c];
+        const char *cls = msg_priority_name((msg_priority_t)c);
+        out_printf(o, "v2v_send_messages_total{class=\"%s\",outcome=\"sent\"} %llu\n"
+                      "v2v_send_messages_total{class=\"%s\",outcome=\"dropped\"} %llu\n"
+                      "v2v_send_messages_total{class=\"%s\",outcome=\"error\"} %llu\n",
+                   cls, (unsigned long long)cs->sent, cls, (unsigned long long)cs->dropped,
+                   cls, (unsigned long long)cs->send_errors);
+    }
+    out_printf(o, "# HELP v2v_send_datagrams_total Datagrams transmitted.\n"
+                  "# TYPE v2v_send_datagrams_total counter\n"
+                  "v2v_send_datagrams_total %llu\n",
+               (unsigned long long)st.datagrams);
+}
+
+size_t metrics_render(char *buf, size_t cap) {
+    metrics_out_t o = { buf, cap, 0 };
+    render_stages(&o);
+    render_ingest(&o);
+    render_send(&o);
+    return o.len;
+}
+
+static void close_socket(int fd) {
+#ifdef _WIN32
+    closesocket(fd);
+#else
+    close(fd);
+#endif
+}
+
+// Bound each recv/send, so a client that connects and goes quiet cannot
+// hold the server thread (and metrics_server_stop()) indefinitely
+static void set_client_timeouts(int fd) {
+#ifdef _WIN32
+    DWORD ms = METRICS_CLIENT_TIMEOUT_MS;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&ms, sizeof(ms));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, (const char *)&ms, sizeof(ms));
+#else
+    struct timeval tv;
+    tv.tv_sec = METRICS_CLIENT_TIMEOUT_MS / 1000;
+    tv.tv_usec = (METRICS_CLIENT_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+#endif
+}
+
+static void send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        int n = send(fd, data, (int)len, 0);
+        if (n <= 0) {
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+static void serve_client(int fd, char **body, size_t *body_cap) {
+    char req[1024];
+    int n = recv(fd, req, sizeof(req) - 1, 0);
+    if (n <= 0) {
+        return;
+    }
+    req[n] = '\0';
+
+    char header[256];
+    if (strncmp(req, "GET /metrics", 12) != 0 && strncmp(req, "GET / ", 6) != 0) {
+        static const char k_not_found[] =
+            "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 10\r\n"
+            "Connection: close\r\n\r\nnot found\n";
+        send_all(fd, k_not_found, sizeof(k_not_found) - 1);
+        return;
+    }
+
+    size_t len = metrics_render(*body, *body_cap);
+    if (len >= *body_cap) {
+        char *bigger = (char *)realloc(*body, len + 1);
+        if (!bigger) {
+            return;
+        }
+        *body = bigger;
+        *body_cap = len + 1;
+        len = metrics_render(*body, *body_cap);
+        if (len >= *body_cap) {
+            len = *body_cap - 1;   // grew between renders; serve what fits
+        }
+    }
+    int hlen = snprintf(header, sizeof(header),
+                        "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                        "Content-Length: %zu\r\nConnection: close\r\n\r\n", len);
+    send_all(fd, header, (size_t)hlen);
+    send_all(fd, *body, len);
+}
+
+static void server_loop(void) {
+    size_t body_cap = METRICS_INITIAL_BUF;
+    char *body = (char *)malloc(body_cap);
+    if (!body) {
+        return;
+    }
+    while (!g_stopping) {
+        // Poll so a stop request is noticed without closing the socket under accept()
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(g_listen_fd, &fds);
+        struct timeval tv;
+        tv.tv_sec = 0;
+        tv.tv_usec = METRICS_POLL_MS * 1000;
+        if (select(g_listen_fd + 1, &fds, NULL, NULL, &tv) <= 0) {
+            continue;
+        }
+        int fd = (int)accept(g_listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        set_client_timeouts(fd);
+        serve_client(fd, &body, &body_cap);
+        close_socket(fd);
+    }
+    free(body);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI server_thread(LPVOID arg) {
+    (void)arg;
+    server_loop();
+    return 0;
+}
+#else
+static void *server_thread(void *arg) {
+    (void)arg;
+    server_loop();
+    return NULL;
+}
+#endif
+
+int metrics_server_start(int port) {
+    int fd = (int)socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("metrics socket");
+        return -1;
+    }
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char *)&opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)port);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+        perror("metrics bind");
+        close_socket(fd);
+        return -1;
+    }
+
+    g_listen_fd = fd;
+    g_stopping = 0;
+    int started;
+#ifdef _WIN32
+    g_thread = CreateThread(NULL, 0, server_thread, NULL, 0, NULL);
+    started = g_thread != NULL;
+#else
+    g_thread_started = pthread_create(&g_thread, NULL, server_thread, NULL) == 0;
+    started = g_thread_started;
+#endif
+    if (!started) {
+        fprintf(stderr, "Failed to start metrics thread\n");
+        close_socket(fd);
+        g_listen_fd = -1;
+        return -1;
+    }
+    printf("Metrics endpoint: http://127.0.0.1:%d/metrics\n", port);
+    return 0;
+}
+
+void metrics_server_stop(void) {
+    if (g_listen_fd < 0) {
+        return;
+    }
+    g_stopping = 1;
+#ifdef _WIN32
+    WaitForSingleObject(g_thread, INFINITE);
+    CloseHandle(g_thread);
+    g_thread = NULL;
+#else
+    if (g_thread_started) {
+        pthread_join(g_thread, NULL);
+        g_thread_started = 0;
+    }
+#endif
+    close_socket(g_listen_fd);
+    g_listen_fd = -1;
+}
@@ -0,0 +1,27 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+
+// Local metrics endpoint in the Prometheus text format.
+//
+// A small HTTP server on 127.0.0.1 answers GET /metrics with the pipeline
+// stage latencies and rejects (stagestats.h), the ingest queue counters and
+// the send scheduler counters. Everything is merged when a scrape arrives;
+// nothing is computed on the packet path.
+
+/**
+ * Render all metrics into buf.
+ * @return Length of the full output; if it is >= cap the text was truncated
+ */
+size_t metrics_render(char *buf, size_t cap);
+
+/**
+ * Start the HTTP endpoint on its own thread.
+ * @param port TCP port on the loopback interface
+ * @return 0 on success, -1 on error
+ */
+int metrics_server_start(int port);
+void metrics_server_stop(void);
+
+#endif // METRICS_H
@@ -0,0 +1,407 @@
+#include "neighbor.h"
+#include "geo.h"
+#include "timeutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#define NIL UINT32_MAX
+
+typedef struct {
+    neighbor_t n;
+    uint32_t hash;
+    uint32_t lru_prev;      // towards more recently seen
+    uint32_t lru_next;      // towards less recently seen
+    uint32_t live_pos;      // position in the dense live array
+} neighbor_slot_t;
+
+typedef struct {
+    neighbor_slot_t *slots;
+    uint32_t *free_stack;
+    size_t free_top;
+    uint32_t *live;         // dense array of occupied slot indices
+    uint32_t *index;        // open addressing, slot + 1 (0 = empty)
+    size_t index_mask;
+    uint32_t lru_head;
+    uint32_t lru_tail;
+    uint64_t timeout_ms;
+    neighbor_stats_t stats;
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+#else
+    pthread_mutex_t mutex;
+#endif
+} neighbor_table_t;
+
+static neighbor_table_t g_nt;
+
+static void nt_lock(void) {
+#ifdef _WIN32
+    EnterCriticalSection(&g_nt.mutex);
+#else
+    pthread_mutex_lock(&g_nt.mutex);
+#endif
+}
+
+static void nt_unlock(void) {
+#ifdef _WIN32
+    LeaveCriticalSection(&g_nt.mutex);
+#else
+    pthread_mutex_unlock(&g_nt.mutex);
+#endif
+}
+
+static uint32_t id_hash(const char *id) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)id; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+int neighbor_table_init(size_t capacity, int timeout_ms) {
+    if (capacity == 0 || capacity >= NIL) {
+        fprintf(stderr, "Invalid neighbor table capacity %zu\n", capacity);
+        return -1;
+    }
+
+    memset(&g_nt, 0, sizeof(g_nt));
+
+    // Keep the index at most half full so probe chains stay short
+    size_t index_size = 1;
+    while (index_size < capacity * 2) {
+        index_size <<= 1;
+    }
+
+    g_nt.slots = (neighbor_slot_t *)calloc(capacity, sizeof(neighbor_slot_t));
+    g_nt.free_stack = (uint32_t *)calloc(capacity, sizeof(uint32_t));
+    g_nt.live = (uint32_t *)calloc(capacity, sizeof(uint32_t));
+    g_nt.index = (uint32_t *)calloc(index_size, sizeof(uint32_t));
+    if (!g_nt.slots || !g_nt.free_stack || !g_nt.live || !g_nt.index) {
+        fprintf(stderr, "Failed to allocate neighbor table (%zu entries)\n", capacity);
+        neighbor_table_cleanup();
+        return -1;
+    }
+
+    for (size_t i = 0; i < capacity; i++) {
+        g_nt.free_stack[i] = (uint32_t)(capacity - 1 - i);
+    }
+    g_nt.free_top = capacity;
+    g_nt.index_mask = index_size - 1;
+    g_nt.lru_head = NIL;
+    g_nt.lru_tail = NIL;
+    g_nt.timeout_ms = (uint64_t)(timeout_ms > 0 ? timeout_ms : NEIGHBOR_DEFAULT_TIMEOUT_MS);
+    g_nt.stats.capacity = capacity;
+
+#ifdef _WIN32
+    InitializeCriticalSection(&g_nt.mutex);
+#else
+    if (pthread_mutex_init(&g_nt.mutex, NULL) != 0) {
+        fprintf(stderr, "Failed to initialize neighbor table mutex\n");
+        neighbor_table_cleanup();
+        return -1;
+    }
+#endif
+
+    printf("Neighbor table initialized (%zu entries, timeout %llu ms)\n",
+           capacity, (unsigned long long)g_nt.timeout_ms);
+    return 0;
+}
+
+void neighbor_table_cleanup(void) {
+    if (g_nt.stats.capacity > 0 && g_nt.slots) {
+#ifdef _WIN32
+        DeleteCriticalSection(&g_nt.mutex);
+#else
+        pthread_mutex_destroy(&g_nt.mutex);
+#endif
+    }
+    free(g_nt.slots);
+    free(g_nt.free_stack);
+    free(g_nt.live);
+    free(g_nt.index);
+    memset(&g_nt, 0, sizeof(g_nt));
+}
+
+static uint32_t index_find(const char *id, uint32_t hash, size_t *pos_out) {
+    size_t pos = hash & g_nt.index_mask;
+    while (g_nt.index[pos] != 0) {
+        uint32_t slot = g_nt.index[pos] - 1;
+        if (g_nt.slots[slot].hash == hash && strcmp(g_nt.slots[slot].n.id, id) == 0) {
+            if (pos_out) {
+                *pos_out = pos;
+            }
+            return slot;
+        }
+        pos = (pos + 1) & g_nt.index_mask;
+    }
+    if (pos_out) {
+        *pos_out = pos;
+    }
+    return NIL;
+}
+
+// Backward-shift deletion keeps probe chains intact without tombstones
+static void index_remove_at(size_t hole) {
+    size_t i = hole;
+    size_t j = hole;
+    for (;;) {
+        j = (j + 1) & g_nt.index_mask;
+        if (g_nt.index[j] == 0) {
+            break;
+        }
+        size_t home = g_nt.slots[g_nt.index[j] - 1].hash & g_nt.index_mask;
+        // Move j into the hole unless its home lies cyclically in (i, j]
+        int in_range = (i <= j) ? (home > i && home <= j) : (home > i || home <= j);
+        if (!in_range) {
+            g_nt.index[i] = g_nt.index[j];
+            i = j;
+        }
+    }
+    g_nt.index[i] = 0;
+}
+
+static void lru_unlink(uint32_t s) {
+    neighbor_slot_t *e = &g_nt.slots[s];
+    if (e->lru_prev != NIL) {
+        g_nt.slots[e->lru_prev].lru_next = e->lru_next;
+    } else {
+        g_nt.lru_head = e->lru_next;
+    }
+    if (e->lru_next != NIL) {
+        g_nt.slots[e->lru_next].lru_prev = e->lru_prev;
+    } else {
+        g_nt.lru_tail = e->lru_prev;
+    }
+    e->lru_prev = NIL;
+    e->lru_next = NIL;
+}
+
+static void lru_push_front(uint32_t s) {
+    neighbor_slot_t *e = &g_nt.slots[s];
+    e->lru_prev = NIL;
+    e->lru_next = g_nt.lru_head;
+    if (g_nt.lru_head != NIL) {
+        g_nt.slots[g_nt.lru_head].lru_prev = s;
+    } else {
+        g_nt.lru_tail = s;
+    }
+    g_nt.lru_head = s;
+}
+
+static void remove_slot(uint32_t s) {
+    neighbor_slot_t *e = &g_nt.slots[s];
+
+    size_t pos = 0;
+    if (index_find(e->n.id, e->hash, &pos) == s) {
+        index_remove_at(pos);
+    }
+    lru_unlink(s);
+
+    // Swap the last live slot into this one's position
+    size_t last = g_nt.stats.count - 1;
+    uint32_t moved = g_nt.live[last];
+    g_nt.live[e->live_pos] = moved;
+    g_nt.slots[moved].live_pos = e->live_pos;
+    g_nt.stats.count--;
+
+    g_nt.free_stack[g_nt.free_top++] = s;
+}
+
+static size_t expire_locked(uint64_t now_ms) {
+    size_t n = 0;
+    while (g_nt.lru_tail != NIL &&
+           now_ms - g_nt.slots[g_nt.lru_tail].n.last_seen_ms > g_nt.timeout_ms) {
+        remove_slot(g_nt.lru_tail);
+        n++;
+    }
+    g_nt.stats.expired += n;
+    return n;
+}
+
+int neighbor_update(const hazard_report_t *report, const struct sockaddr_in *src, size_t bytes) {
+    if (!report || report->ephemeral_id[0] == '\0' || !g_nt.slots) {
+        return -1;
+    }
+
+    uint64_t now = monotonic_ms();
+    uint32_t hash = id_hash(report->ephemeral_id);
+
+    nt_lock();
+    expire_locked(now);
+
+    size_t pos = 0;
+    uint32_t s = index_find(report->ephemeral_id, hash, &pos);
+    neighbor_t *n;
+
+    if (s == NIL) {
+        if (g_nt.free_top == 0) {
+            // Full: reclaim the neighbour heard from least recently
+            remove_slot(g_nt.lru_tail);
+            g_nt.stats.evicted++;
+            index_find(report->ephemeral_id, hash, &pos);
+        }
+        s = g_nt.free_stack[--g_nt.free_top];
+        neighbor_slot_t *e = &g_nt.slots[s];
+        memset(e, 0, sizeof(*e));
+        e->hash = hash;
+        memcpy(e->n.id, report->ephemeral_id, sizeof(e->n.id));
+        e->n.id[sizeof(e->n.id) - 1] = '\0';
+        e->n.first_seen_ms = now;
+        e->n.last_seq = report->seq;
+
+        g_nt.index[pos] = s + 1;
+        e->live_pos = (uint32_t)g_nt.stats.count;
+        g_nt.live[g_nt.stats.count++] = s;
+        lru_push_front(s);
+
+        g_nt.stats.inserts++;
+        if (g_nt.stats.count > g_nt.stats.high_water) {
+            g_nt.stats.high_water = g_nt.stats.count;
+        }
+        n = &e->n;
+    } else {
+        lru_unlink(s);
+        lru_push_front(s);
+        g_nt.stats.updates++;
+        n = &g_nt.slots[s].n;
+
+        if (report->seq > n->last_seq) {
+            n->seq_gaps += report->seq - n->last_seq - 1;
+            n->last_seq = report->seq;
+        } else {
+            n->out_of_order++;
+        }
+
+        double gap = (double)(now - n->last_seen_ms);
+        n->interarrival_ms = n->interarrival_ms == 0.0
+                             ? gap : n->interarrival_ms + 0.125 * (gap - n->interarrival_ms);
+    }
+
+    n->last_seen_ms = now;
+    n->rx_packets++;
+    n->rx_bytes += bytes;
+    if (report->timestamp) {
+        n->msg_timestamp = report->timestamp;
+    }
+    if (src) {
+        n->addr = *src;
+    }
+    if (report->has_location) {
+        n->lat = report->lat;
+        n->lon = report->lon;
+        n->has_position = 1;
+    }
+    if (report->has_kinematics) {
+        n->speed = report->speed;
+        n->heading = report->heading;
+    }
+
+    nt_unlock();
+    return 0;
+}
+
+int neighbor_lookup(const char *id, neighbor_t *out) {
+    if (!id || !g_nt.slots) {
+        return 0;
+    }
+    nt_lock();
+    uint32_t s = index_find(id, id_hash(id), NULL);
+    if (s != NIL && out) {
+        *out = g_nt.slots[s].n;
+    }
+    nt_unlock();
+    return s != NIL;
+}
+
+size_t neighbor_expire(void) {
+    if (!g_nt.slots) {
+        return 0;
+    }
+    nt_lock();
+    size_t n = expire_locked(monotonic_ms());
+    nt_unlock();
+    return n;
+}
+
+size_t neighbor_count(void) {
+    if (!g_nt.slots) {
+        return 0;
+    }
+    nt_lock();
+    size_t n = g_nt.stats.count;
+    nt_unlock();
+    return n;
+}
+
+size_t neighbor_foreach(neighbor_visit_fn fn, void *arg) {
+    if (!fn || !g_nt.slots) {
+        return 0;
+    }
+    size_t visited = 0;
+    nt_lock();
+    for (size_t i = 0; i < g_nt.stats.count; i++) {
+        visited++;
+        if (fn(&g_nt.slots[g_nt.live[i]].n, arg)) {
+            break;
+        }
+    }
+    nt_unlock();
+    return visited;
+}
+
+size_t neighbor_within(double lat, double lon, double radius_m, neighbor_visit_fn fn, void *arg) {
+    if (!fn || !g_nt.slots) {
+        return 0;
+    }
+    size_t visited = 0;
+    nt_lock();
+    for (size_t i = 0; i < g_nt.stats.count; i++) {
+        const neighbor_t *n = &g_nt.slots[g_nt.live[i]].n;
+        if (!n->has_position || geo_outside_box(lat, lon, n->lat, n->lon, radius_m)) {
+            continue;
+        }
+        if (geo_distance_m(lat, lon, n->lat, n->lon) > radius_m) {
+            continue;
+        }
+        visited++;
+        if (fn(n, arg)) {
+            break;
+        }
+    }
+    nt_unlock();
+    return visited;
+}
+
+double neighbor_delivery_ratio(const neighbor_t *n) {
+    if (!n || n->rx_packets == 0) {
+        return 0.0;
+    }
+    return (double)n->rx_packets / (double)(n->rx_packets + n->seq_gaps);
+}
+
+void neighbor_get_stats(neighbor_stats_t *out) {
+    if (!out || !g_nt.slots) {
+        return;
+    }
+    nt_lock();
+    *out = g_nt.stats;
+    nt_unlock();
+}
+
+void neighbor_print_stats(void) {
+    neighbor_stats_t st;
+    memset(&st, 0, sizeof(st));
+    neighbor_get_stats(&st);
+    printf("Neighbor table: %zu/%zu live (peak %zu), %llu inserts, %llu updates, "
+           "%llu expired, %llu evicted\n",
+           st.count, st.capacity, st.high_water,
+           (unsigned long long)st.inserts, (unsigned long long)st.updates,
+           (unsigned long long)st.expired, (unsigned long long)st.evicted);
+}
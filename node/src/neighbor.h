@@ -0,0 +1,80 @@
+#ifndef NEIGHBOR_H
+#define NEIGHBOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "net.h"
+#include "jsonmsg.h"
+
+// Neighbor table
+//
+// One entry per sender (ephemeral_id) holding its last reported position and
+// kinematics plus link statistics. Entries live in a fixed array; an
+// open-addressing index gives O(1) lookup, a recency list gives O(1) timeout
+// and capacity eviction, and a dense list of live slots makes iteration a
+// straight array walk for geo-targeted forwarding and load estimation.
+
+#ifndef NEIGHBOR_CAPACITY
+#define NEIGHBOR_CAPACITY 8192      // sized for ~5k concurrent neighbours at an RSU
+#endif
+#define NEIGHBOR_DEFAULT_TIMEOUT_MS 10000
+
+typedef struct {
+    char id[64];
+    double lat, lon;
+    double speed, heading;
+    int has_position;
+    uint64_t last_seq;
+    uint64_t msg_timestamp;         // sender's timestamp from the last report
+    uint64_t first_seen_ms;         // monotonic
+    uint64_t last_seen_ms;          // monotonic
+    struct sockaddr_in addr;        // last source address
+    // Link statistics
+    uint64_t rx_packets;
+    uint64_t rx_bytes;
+    uint64_t seq_gaps;              // sequence numbers skipped (estimated loss)
+    uint64_t out_of_order;
+    double interarrival_ms;         // smoothed gap between reports
+} neighbor_t;
+
+typedef struct {
+    size_t capacity;
+    size_t count;
+    size_t high_water;
+    uint64_t inserts;
+    uint64_t updates;
+    uint64_t expired;
+    uint64_t evicted;               // dropped to make room while full
+} neighbor_stats_t;
+
+// Return nonzero from a visitor to stop iteration early
+typedef int (*neighbor_visit_fn)(const neighbor_t *n, void *arg);
+
+int neighbor_table_init(size_t capacity, int timeout_ms);
+void neighbor_table_cleanup(void);
+
+// Record a report from a sender; creates the entry if needed
+int neighbor_update(const hazard_report_t *report, const struct sockaddr_in *src, size_t bytes);
+
+// Copy a neighbour's entry into out. Returns 1 if found.
+int neighbor_lookup(const char *id, neighbor_t *out);
+
+// Drop neighbours not heard from within the timeout; returns how many
+size_t neighbor_expire(void);
+
+size_t neighbor_count(void);
+
+// Visit every live neighbour. Returns the number visited.
+size_t neighbor_foreach(neighbor_visit_fn fn, void *arg);
+
+// Visit neighbours with a known position within radius_m of (lat, lon)
+size_t neighbor_within(double lat, double lon, double radius_m, neighbor_visit_fn fn, void *arg);
+
+// Estimated packet delivery ratio from sequence gaps (1.0 = no loss seen)
+double neighbor_delivery_ratio(const neighbor_t *n);
+
+void neighbor_get_stats(neighbor_stats_t *out);
+void neighbor_print_stats(void);
+
+#endif // NEIGHBOR_H
@@ -39,7 +39,7 @@ int inet_pton(int af, const char* src, void* dst) {
 }
 #endif
 
-int udp_socket_bind(int port) {
+static int socket_bind(int port, int shared) {
 #ifdef _WIN32
 	WSADATA wsaData;
 	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
@@ -65,6 +65,14 @@ int udp_socket_bind(int port) {
 		perror("setsockopt");
 		// continue; non-fatal
 	}
+#ifdef SO_REUSEPORT
+	// BSD and macOS only deliver to several sockets on one port with this
+	if (shared && setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, (const char*)&opt, sizeof(opt)) < 0) {
+		perror("setsockopt SO_REUSEPORT");
+	}
+#else
+	(void)shared;
+#endif
 
 	if (bind(sockfd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
 		perror("bind");
@@ -79,8 +87,32 @@ int udp_socket_bind(int port) {
 	return sockfd;
 }
 
+int udp_socket_bind(int port) {
+	return socket_bind(port, 0);
+}
+
+// For a multicast group port, which every node on the host binds
+int udp_socket_bind_shared(int port) {
+	return socket_bind(port, 1);
+}
+
 int udp_send(int sock, const char* ip, int port, const char* msg) {
-	if (!ip || !msg) return -1;
+	if (!msg) return -1;
+	return udp_send_buf(sock, ip, port, msg, strlen(msg));
+}
+
+static udp_send_shim_fn send_shim = NULL;
+static void* send_shim_arg = NULL;
+
+// Set before the send thread starts; not synchronised with senders
+void udp_set_send_shim(udp_send_shim_fn fn, void* arg) {
+	send_shim = fn;
+	send_shim_arg = arg;
+}
+
+// Binary-safe send; bundles contain length prefixes and NUL bytes
+int udp_send_buf(int sock, const char* ip, int port, const void* buf, size_t len) {
+	if (!ip || !buf) return -1;
 	struct sockaddr_in dst;
 	memset(&dst, 0, sizeof(dst));
 	dst.sin_family = AF_INET;
@@ -89,7 +121,15 @@ int udp_send(int sock, const char* ip, int port, const char* msg) {
 		perror("inet_pton");
 		return -1;
 	}
-	int n = sendto(sock, msg, (int)strlen(msg), 0, (struct sockaddr*)&dst, sizeof(dst));
+	if (send_shim) {
+		return send_shim(send_shim_arg, sock, &dst, buf, len);
+	}
+	return udp_sendto(sock, &dst, buf, len);
+}
+
+int udp_sendto(int sock, const struct sockaddr_in* dst, const void* buf, size_t len) {
+	if (!dst || !buf) return -1;
+	int n = sendto(sock, (const char*)buf, (int)len, 0, (const struct sockaddr*)dst, sizeof(*dst));
 	if (n < 0) {
 		perror("sendto");
 		return -1;
@@ -115,4 +155,91 @@ int udp_recv(int sock, char* buf, int buflen, struct sockaddr_in* src) {
 	return n;
 }
 
+// Enlarge the kernel receive buffer so bursts queue in the socket instead of
+// being dropped before the ingest queue can apply priority shedding.
+int udp_set_recv_buffer(int sock, int bytes) {
+	if (bytes <= 0) return -1;
+	if (setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (const char*)&bytes, sizeof(bytes)) < 0) {
+		perror("setsockopt SO_RCVBUF");
+		return -1;
+	}
+	return 0;
+}
+
+int udp_is_multicast(const char* ip) {
+	struct in_addr a;
+	if (!ip || inet_pton(AF_INET, ip, &a) != 1) return 0;
+	return IN_MULTICAST(ntohl(a.s_addr));
+}
+
+// group_ip must be a multicast address; iface_ip NULL lets the kernel pick
+static int group_membership(int sock, const char* group_ip, const char* iface_ip, int option) {
+	struct ip_mreq mreq;
+	memset(&mreq, 0, sizeof(mreq));
+	if (!udp_is_multicast(group_ip) || inet_pton(AF_INET, group_ip, &mreq.imr_multiaddr) != 1) {
+		fprintf(stderr, "not a multicast group: %s\n", group_ip ? group_ip : "(null)");
+		return -1;
+	}
+	if (iface_ip) {
+		if (inet_pton(AF_INET, iface_ip, &mreq.imr_interface) != 1) {
+			fprintf(stderr, "invalid interface address: %s\n", iface_ip);
+			return -1;
+		}
+	} else {
+		mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+	}
+	if (setsockopt(sock, IPPROTO_IP, option, (const char*)&mreq, sizeof(mreq)) < 0) {
+		perror(option == IP_ADD_MEMBERSHIP ? "setsockopt IP_ADD_MEMBERSHIP" : "setsockopt IP_DROP_MEMBERSHIP");
+		return -1;
+	}
+	return 0;
+}
+
+int udp_join_group(int sock, const char* group_ip, const char* iface_ip) {
+	return group_membership(sock, group_ip, iface_ip, IP_ADD_MEMBERSHIP);
+}
+
+int udp_leave_group(int sock, const char* group_ip, const char* iface_ip) {
+	return group_membership(sock, group_ip, iface_ip, IP_DROP_MEMBERSHIP);
+}
+
+// Winsock takes a DWORD for these options; BSD insists on an unsigned char
+int udp_set_multicast_ttl(int sock, int ttl) {
+	if (ttl < 0 || ttl > 255) return -1;
+#ifdef _WIN32
+	DWORD v = (DWORD)ttl;
+#else
+	unsigned char v = (unsigned char)ttl;
+#endif
+	if (setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, (const char*)&v, sizeof(v)) < 0) {
+		perror("setsockopt IP_MULTICAST_TTL");
+		return -1;
+	}
+	return 0;
+}
 
+int udp_set_multicast_loop(int sock, int enable) {
+#ifdef _WIN32
+	DWORD v = enable ? 1 : 0;
+#else
+	unsigned char v = enable ? 1 : 0;
+#endif
+	if (setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, (const char*)&v, sizeof(v)) < 0) {
+		perror("setsockopt IP_MULTICAST_LOOP");
+		return -1;
+	}
+	return 0;
+}
+
+int udp_set_multicast_if(int sock, const char* iface_ip) {
+	struct in_addr a;
+	if (!iface_ip || inet_pton(AF_INET, iface_ip, &a) != 1) {
+		fprintf(stderr, "invalid interface address: %s\n", iface_ip ? iface_ip : "(null)");
+		return -1;
+	}
+	if (setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, (const char*)&a, sizeof(a)) < 0) {
+		perror("setsockopt IP_MULTICAST_IF");
+		return -1;
+	}
+	return 0;
+}
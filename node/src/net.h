@@ -7,16 +7,39 @@
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <stdint.h>
+#include <stddef.h>
 #pragma comment(lib, "ws2_32.lib")
 #else
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <stdint.h>
+#include <stddef.h>
 #endif
 
 int udp_socket_bind(int port);
+int udp_socket_bind_shared(int port);
 int udp_send(int sock, const char* ip, int port, const char* msg);
+int udp_send_buf(int sock, const char* ip, int port, const void* buf, size_t len);
+int udp_sendto(int sock, const struct sockaddr_in* dst, const void* buf, size_t len);
 int udp_recv(int sock, char* buf, int buflen, struct sockaddr_in* src);
+int udp_set_recv_buffer(int sock, int bytes);
+
+// Hook that udp_send_buf() calls instead of sending, e.g. an impairment
+// stage; it sends with udp_sendto() when it wants the datagram to go out
+typedef int (*udp_send_shim_fn)(void* arg, int sock, const struct sockaddr_in* dst, const void* buf, size_t len);
+void udp_set_send_shim(udp_send_shim_fn fn, void* arg);
+
+// IP multicast: one sendto() to a group reaches every member on the
+// segment, as a radio broadcast does. iface_ip selects the interface by its
+// address; NULL leaves the choice to the routing table.
+#define NET_MAX_IFACES 8
+
+int udp_is_multicast(const char* ip);
+int udp_join_group(int sock, const char* group_ip, const char* iface_ip);
+int udp_leave_group(int sock, const char* group_ip, const char* iface_ip);
+int udp_set_multicast_ttl(int sock, int ttl);
+int udp_set_multicast_loop(int sock, int enable);   // hear our own sends and other local members
+int udp_set_multicast_if(int sock, const char* iface_ip);
 
 #endif // NET_H
 
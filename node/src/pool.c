@@ -0,0 +1,131 @@
+#include "pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Free slots store the next-free pointer in their first bytes
+typedef struct free_slot {
+    struct free_slot *next;
+} free_slot_t;
+
+int slab_pool_init(slab_pool_t *pool, const char *name, size_t elem_size, size_t capacity) {
+    if (!pool || elem_size == 0 || capacity == 0) {
+        return -1;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+
+    // Round up so every slot is pointer-aligned and can hold a free-list link
+    size_t align = sizeof(void *) > sizeof(double) ? sizeof(void *) : sizeof(double);
+    if (elem_size < sizeof(free_slot_t)) {
+        elem_size = sizeof(free_slot_t);
+    }
+    elem_size = (elem_size + align - 1) & ~(align - 1);
+
+    pool->slab = (unsigned char *)calloc(capacity, elem_size);
+    if (!pool->slab) {
+        fprintf(stderr, "Failed to allocate %s pool (%zu x %zu bytes)\n",
+                name ? name : "slab", capacity, elem_size);
+        return -1;
+    }
+
+    pool->name = name ? name : "slab";
+    pool->elem_size = elem_size;
+    pool->stats.capacity = capacity;
+
+    // Thread the free list in address order so early allocations stay dense
+    free_slot_t *head = NULL;
+    for (size_t i = capacity; i > 0; i--) {
+        free_slot_t *slot = (free_slot_t *)(pool->slab + (i - 1) * elem_size);
+        slot->next = head;
+        head = slot;
+    }
+    pool->free_list = head;
+
+    return 0;
+}
+
+void slab_pool_destroy(slab_pool_t *pool) {
+    if (!pool) {
+        return;
+    }
+    free(pool->slab);
+    memset(pool, 0, sizeof(*pool));
+}
+
+void *slab_pool_alloc(slab_pool_t *pool) {
+    if (!pool || !pool->free_list) {
+        if (pool) {
+            pool->stats.failures++;
+        }
+        return NULL;
+    }
+
+    free_slot_t *slot = (free_slot_t *)pool->free_list;
+    pool->free_list = slot->next;
+    memset(slot, 0, pool->elem_size);
+
+    pool->stats.in_use++;
+    pool->stats.allocs++;
+    if (pool->stats.in_use > pool->stats.high_water) {
+        pool->stats.high_water = pool->stats.in_use;
+    }
+    return slot;
+}
+
+void slab_pool_free(slab_pool_t *pool, void *elem) {
+    if (!pool || !elem) {
+        return;
+    }
+    if (!slab_pool_owns(pool, elem)) {
+        fprintf(stderr, "%s pool: free of foreign pointer %p ignored\n", pool->name, elem);
+        return;
+    }
+
+    free_slot_t *slot = (free_slot_t *)elem;
+    slot->next = (free_slot_t *)pool->free_list;
+    pool->free_list = slot;
+
+    pool->stats.in_use--;
+    pool->stats.frees++;
+}
+
+void slab_pool_note_eviction(slab_pool_t *pool) {
+    if (pool) {
+        pool->stats.evictions++;
+    }
+}
+
+int slab_pool_full(const slab_pool_t *pool) {
+    return pool == NULL || pool->free_list == NULL;
+}
+
+int slab_pool_owns(const slab_pool_t *pool, const void *elem) {
+    if (!pool || !pool->slab || !elem) {
+        return 0;
+    }
+    const unsigned char *p = (const unsigned char *)elem;
+    const unsigned char *end = pool->slab + pool->stats.capacity * pool->elem_size;
+    if (p < pool->slab || p >= end) {
+        return 0;
+    }
+    return ((size_t)(p - pool->slab) % pool->elem_size) == 0;
+}
+
+void slab_pool_get_stats(const slab_pool_t *pool, slab_pool_stats_t *out) {
+    if (!pool || !out) {
+        return;
+    }
+    *out = pool->stats;
+}
+
+void slab_pool_print_stats(const slab_pool_t *pool) {
+    if (!pool) {
+        return;
+    }
+    printf("%s pool: %zu/%zu in use (peak %zu), %llu allocs, %llu frees, "
+           "%llu full, %llu evicted\n",
+           pool->name, pool->stats.in_use, pool->stats.capacity, pool->stats.high_water,
+           (unsigned long long)pool->stats.allocs, (unsigned long long)pool->stats.frees,
+           (unsigned long long)pool->stats.failures, (unsigned long long)pool->stats.evictions);
+}
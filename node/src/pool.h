@@ -0,0 +1,64 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-capacity slab pool.
+//
+// All elements are carved out of one contiguous allocation made at init time,
+// so alloc/free are O(1) pointer pops/pushes on an intrusive free list and the
+// pool never touches the heap afterwards. The pool is NOT thread-safe: owners
+// (replay cache, rate limiter, alerts map) call it with their own mutex held.
+
+// What an owner does when its pool is full and a new entry arrives
+typedef enum {
+    POOL_EVICT_OLDEST = 0,  // reclaim the least recently used/added entry
+    POOL_EVICT_REJECT       // keep existing entries, refuse the new one
+} pool_evict_policy_t;
+
+// Occupancy counters exposed to callers
+typedef struct {
+    size_t capacity;        // total slots
+    size_t in_use;          // slots currently allocated
+    size_t high_water;      // peak in_use since init
+    uint64_t allocs;        // successful allocations
+    uint64_t frees;         // returned slots
+    uint64_t failures;      // alloc attempts while full
+    uint64_t evictions;     // slots reclaimed by the owner's eviction policy
+} slab_pool_stats_t;
+
+typedef struct slab_pool {
+    const char *name;
+    unsigned char *slab;
+    size_t elem_size;
+    void *free_list;
+    slab_pool_stats_t stats;
+} slab_pool_t;
+
+int slab_pool_init(slab_pool_t *pool, const char *name, size_t elem_size, size_t capacity);
+void slab_pool_destroy(slab_pool_t *pool);
+
+// Returns a zeroed slot, or NULL when the pool is full
+void *slab_pool_alloc(slab_pool_t *pool);
+void slab_pool_free(slab_pool_t *pool, void *elem);
+
+// Record that the owner reclaimed a live slot to make room for a new one
+void slab_pool_note_eviction(slab_pool_t *pool);
+
+int slab_pool_full(const slab_pool_t *pool);
+int slab_pool_owns(const slab_pool_t *pool, const void *elem);
+void slab_pool_get_stats(const slab_pool_t *pool, slab_pool_stats_t *out);
+void slab_pool_print_stats(const slab_pool_t *pool);
+
+// Declares a typed wrapper around slab_pool_t so call sites keep their
+// element type instead of passing void pointers around.
+#define SLAB_POOL_DECLARE(prefix, type)                                        \
+    static inline type *prefix##_pool_alloc(slab_pool_t *p) {                  \
+        return (type *)slab_pool_alloc(p);                                     \
+    }                                                                          \
+    static inline void prefix##_pool_free(slab_pool_t *p, type *e) {           \
+        slab_pool_free(p, e);                                                  \
+    }
+
+#endif // POOL_H
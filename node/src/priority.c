@@ -0,0 +1,79 @@
+#include "priority.h"
+#include <string.h>
+
+static const char *const k_emergency_msg_types[] = {
+    "emergency", "emergency_vehicle", NULL
+};
+
+static const char *const k_emergency_hazards[] = {
+    "ambulance", "accident", "emergency_vehicle", "collision", NULL
+};
+
+static int in_list(const char *value, size_t len, const char *const *list) {
+    for (; *list != NULL; list++) {
+        if (strlen(*list) == len && strncmp(value, *list, len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Locate the string value of "key":"..." and return its length, or -1
+static int find_string_field(const char *json, const char *key, const char **value) {
+    const char *p = strstr(json, key);
+    if (!p) {
+        return -1;
+    }
+    p += strlen(key);
+    const char *end = strchr(p, '"');
+    if (!end) {
+        return -1;
+    }
+    *value = p;
+    return (int)(end - p);
+}
+
+msg_priority_t msg_classify(const char *json) {
+    if (!json) {
+        return MSG_PRIO_ROUTINE;
+    }
+
+    const char *msg_type = NULL;
+    const char *hazard_type = NULL;
+    int msg_len = find_string_field(json, "\"msg_type\":\"", &msg_type);
+    int hazard_len = find_string_field(json, "\"hazard_type\":\"", &hazard_type);
+
+    if (msg_len >= 0 && in_list(msg_type, (size_t)msg_len, k_emergency_msg_types)) {
+        return MSG_PRIO_EMERGENCY;
+    }
+    if (hazard_len >= 0 && in_list(hazard_type, (size_t)hazard_len, k_emergency_hazards)) {
+        return MSG_PRIO_EMERGENCY;
+    }
+    if (msg_len >= 0 && (size_t)msg_len == strlen("hazard_report") &&
+        strncmp(msg_type, "hazard_report", (size_t)msg_len) == 0) {
+        return MSG_PRIO_HAZARD;
+    }
+    return MSG_PRIO_ROUTINE;
+}
+
+msg_priority_t msg_classify_fields(const char *msg_type, const char *hazard_type) {
+    if (msg_type && in_list(msg_type, strlen(msg_type), k_emergency_msg_types)) {
+        return MSG_PRIO_EMERGENCY;
+    }
+    if (hazard_type && in_list(hazard_type, strlen(hazard_type), k_emergency_hazards)) {
+        return MSG_PRIO_EMERGENCY;
+    }
+    if (msg_type && strcmp(msg_type, "hazard_report") == 0) {
+        return MSG_PRIO_HAZARD;
+    }
+    return MSG_PRIO_ROUTINE;
+}
+
+const char *msg_priority_name(msg_priority_t prio) {
+    switch (prio) {
+    case MSG_PRIO_EMERGENCY: return "emergency";
+    case MSG_PRIO_HAZARD:    return "hazard";
+    case MSG_PRIO_ROUTINE:   return "routine";
+    default:                 return "unknown";
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef PRIORITY_H
+#define PRIORITY_H
+
+// Message urgency classes, most urgent first. Used by the ingest queue to
+// decide what to shed under load and by the send path to decide what goes
+// out first.
+typedef enum {
+    MSG_PRIO_EMERGENCY = 0,  // emergency vehicles, accidents
+    MSG_PRIO_HAZARD,         // other hazard reports
+    MSG_PRIO_ROUTINE,        // beacons and anything unrecognized
+    MSG_PRIO_COUNT
+} msg_priority_t;
+
+// Classify a raw JSON message without fully parsing it
+msg_priority_t msg_classify(const char *json);
+
+// Classify from already-extracted fields (either may be NULL)
+msg_priority_t msg_classify_fields(const char *msg_type, const char *hazard_type);
+
+const char *msg_priority_name(msg_priority_t prio);
+
+#endif // PRIORITY_H
@@ -12,86 +12,160 @@
 // Global rate limiter instance
 rate_limiter_t g_rate_limiter = {0};
 
-void ratelimit_init(void) {
-    g_rate_limiter.entries = NULL;
-    g_rate_limiter.count = 0;
-    
+SLAB_POOL_DECLARE(rate_entry, rate_entry_t)
+
+static void ratelimit_lock(rate_limiter_t *rl) {
 #ifdef _WIN32
-    InitializeCriticalSection(&g_rate_limiter.mutex);
+    EnterCriticalSection(&rl->mutex);
 #else
-    if (pthread_mutex_init(&g_rate_limiter.mutex, NULL) != 0) {
-        fprintf(stderr, "Failed to initialize rate limiter mutex\n");
-        exit(1);
-    }
+    pthread_mutex_lock(&rl->mutex);
 #endif
-    
-    printf("Rate limiter initialized (max %d messages per %d seconds)\n", 
-           MAX_PER_WINDOW, WINDOW_SECONDS);
 }
 
-int ratelimit_allow(const char *ephemeral_id) {
-    if (!ephemeral_id) {
-        return 0; // Invalid input
+static void ratelimit_unlock(rate_limiter_t *rl) {
+#ifdef _WIN32
+    LeaveCriticalSection(&rl->mutex);
+#else
+    pthread_mutex_unlock(&rl->mutex);
+#endif
+}
+
+static void ratelimit_unlink(rate_limiter_t *rl, rate_entry_t *entry) {
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    } else {
+        rl->entries = entry->next;
+    }
+
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    } else {
+        rl->tail = entry->prev;
     }
-    
-    time_t now = time(NULL);
-    
-    // Lock the rate limiter
+
+    entry->next = NULL;
+    entry->prev = NULL;
+}
+
+static void ratelimit_push_front(rate_limiter_t *rl, rate_entry_t *entry) {
+    entry->prev = NULL;
+    entry->next = rl->entries;
+
+    if (rl->entries != NULL) {
+        rl->entries->prev = entry;
+    } else {
+        rl->tail = entry;
+    }
+
+    rl->entries = entry;
+}
+
+static void ratelimit_remove(rate_limiter_t *rl, rate_entry_t *entry) {
+    ratelimit_unlink(rl, entry);
+    rl->count--;
+    rate_entry_pool_free(&rl->pool, entry);
+}
+
+// Least recently active senders sit at the tail; stop at the first active one
+static void ratelimit_expire(rate_limiter_t *rl, time_t now) {
+    while (rl->tail != NULL) {
+        rate_entry_t *current = rl->tail;
+
+        // Check if sender has been inactive for more than 2 windows
+        int has_recent_activity = 0;
+        for (int i = 0; i < MAX_PER_WINDOW; i++) {
+            if (current->timestamps[i] != 0 &&
+                (now - current->timestamps[i]) <= (WINDOW_SECONDS * 2)) {
+                has_recent_activity = 1;
+                break;
+            }
+        }
+
+        if (has_recent_activity) {
+            break;
+        }
+
+        ratelimit_remove(rl, current);
+    }
+}
+
+int ratelimit_init_instance(rate_limiter_t *rl, size_t capacity) {
+    memset(rl, 0, sizeof(*rl));
+    rl->evict_policy = POOL_EVICT_OLDEST;
+
+    if (slab_pool_init(&rl->pool, "ratelimit", sizeof(rate_entry_t), capacity) != 0) {
+        return -1;
+    }
+
 #ifdef _WIN32
-    EnterCriticalSection(&g_rate_limiter.mutex);
+    InitializeCriticalSection(&rl->mutex);
 #else
-    if (pthread_mutex_lock(&g_rate_limiter.mutex) != 0) {
-        fprintf(stderr, "Failed to lock rate limiter mutex\n");
-        return 0;
+    if (pthread_mutex_init(&rl->mutex, NULL) != 0) {
+        slab_pool_destroy(&rl->pool);
+        return -1;
     }
 #endif
-    
+    return 0;
+}
+
+void ratelimit_destroy_instance(rate_limiter_t *rl) {
+    slab_pool_destroy(&rl->pool);
+    rl->entries = NULL;
+    rl->tail = NULL;
+    rl->count = 0;
+#ifdef _WIN32
+    DeleteCriticalSection(&rl->mutex);
+#else
+    pthread_mutex_destroy(&rl->mutex);
+#endif
+}
+
+int ratelimit_allow_at(rate_limiter_t *rl, const char *ephemeral_id, time_t now) {
+    if (!ephemeral_id) {
+        return 0; // Invalid input
+    }
+
+    ratelimit_lock(rl);
+
     // First, clean up inactive senders
-    ratelimit_expire_inactive_senders();
-    
+    ratelimit_expire(rl, now);
+
     // Find existing entry for this sender
-    rate_entry_t *entry = g_rate_limiter.entries;
+    rate_entry_t *entry = rl->entries;
     while (entry != NULL) {
         if (strcmp(entry->id, ephemeral_id) == 0) {
             break;
         }
         entry = entry->next;
     }
-    
-    // If no entry exists, create one
+
+    // If no entry exists, create one, reclaiming the least active sender if full
     if (entry == NULL) {
-        entry = (rate_entry_t*)malloc(sizeof(rate_entry_t));
+        if (slab_pool_full(&rl->pool) &&
+            rl->evict_policy == POOL_EVICT_OLDEST &&
+            rl->tail != NULL) {
+            ratelimit_remove(rl, rl->tail);
+            slab_pool_note_eviction(&rl->pool);
+        }
+
+        entry = rate_entry_pool_alloc(&rl->pool);
         if (!entry) {
-#ifdef _WIN32
-            LeaveCriticalSection(&g_rate_limiter.mutex);
-#else
-            pthread_mutex_unlock(&g_rate_limiter.mutex);
-#endif
-            fprintf(stderr, "Failed to allocate memory for rate limit entry\n");
-            return 0;
+            ratelimit_unlock(rl);
+            return 0; // Table full and policy is to reject unknown senders
         }
-        
+
         strncpy(entry->id, ephemeral_id, sizeof(entry->id) - 1);
         entry->id[sizeof(entry->id) - 1] = '\0';
         entry->count = 0;
-        memset(entry->timestamps, 0, sizeof(entry->timestamps));
-        
-        // Add to the beginning of the list
-        entry->next = g_rate_limiter.entries;
-        entry->prev = NULL;
-        
-        if (g_rate_limiter.entries != NULL) {
-            g_rate_limiter.entries->prev = entry;
-        }
-        
-        g_rate_limiter.entries = entry;
-        g_rate_limiter.count++;
+
+        ratelimit_push_front(rl, entry);
+        rl->count++;
     }
-    
+
     // Remove timestamps older than the window
     int valid_count = 0;
     for (int i = 0; i < MAX_PER_WINDOW; i++) {
-        if (entry->timestamps[i] != 0 && 
+        if (entry->timestamps[i] != 0 &&
             (now - entry->timestamps[i]) <= WINDOW_SECONDS) {
             // Keep this timestamp
             if (valid_count != i) {
@@ -103,94 +177,64 @@ int ratelimit_allow(const char *ephemeral_id) {
             entry->timestamps[i] = 0;
         }
     }
-    
+
     // Check if we're at the limit
     if (valid_count >= MAX_PER_WINDOW) {
-#ifdef _WIN32
-        LeaveCriticalSection(&g_rate_limiter.mutex);
-#else
-        pthread_mutex_unlock(&g_rate_limiter.mutex);
-#endif
+        ratelimit_unlock(rl);
         return 0; // Rate limit exceeded
     }
-    
-    // Add current timestamp
+
+    // Add current timestamp and keep the list ordered by last activity
     entry->timestamps[valid_count] = now;
     entry->count = valid_count + 1;
-    
-#ifdef _WIN32
-    LeaveCriticalSection(&g_rate_limiter.mutex);
-#else
-    pthread_mutex_unlock(&g_rate_limiter.mutex);
-#endif
+    if (entry != rl->entries) {
+        ratelimit_unlink(rl, entry);
+        ratelimit_push_front(rl, entry);
+    }
+
+    ratelimit_unlock(rl);
     return 1; // Allowed
 }
 
-void ratelimit_expire_inactive_senders(void) {
-    time_t now = time(NULL);
-    rate_entry_t *current = g_rate_limiter.entries;
-    
-    while (current != NULL) {
-        rate_entry_t *next = current->next;
-        
-        // Check if sender has been inactive for more than 2 windows
-        int has_recent_activity = 0;
-        for (int i = 0; i < MAX_PER_WINDOW; i++) {
-            if (current->timestamps[i] != 0 && 
-                (now - current->timestamps[i]) <= (WINDOW_SECONDS * 2)) {
-                has_recent_activity = 1;
-                break;
-            }
-        }
-        
-        if (!has_recent_activity) {
-            // Remove inactive sender
-            if (current->prev != NULL) {
-                current->prev->next = current->next;
-            } else {
-                g_rate_limiter.entries = current->next;
-            }
-            
-            if (current->next != NULL) {
-                current->next->prev = current->prev;
-            }
-            
-            g_rate_limiter.count--;
-            free(current);
-        }
-        
-        current = next;
+void ratelimit_init(void) {
+    if (ratelimit_init_instance(&g_rate_limiter, RATELIMIT_CAPACITY) != 0) {
+        fprintf(stderr, "Failed to initialize rate limiter\n");
+        exit(1);
     }
+    printf("Rate limiter initialized (max %d messages per %d seconds, %d senders)\n",
+           MAX_PER_WINDOW, WINDOW_SECONDS, RATELIMIT_CAPACITY);
 }
 
-void ratelimit_cleanup(void) {
-#ifdef _WIN32
-    EnterCriticalSection(&g_rate_limiter.mutex);
-#else
-    if (pthread_mutex_lock(&g_rate_limiter.mutex) != 0) {
-        fprintf(stderr, "Failed to lock rate limiter mutex for cleanup\n");
+int ratelimit_allow(const char *ephemeral_id) {
+    return ratelimit_allow_at(&g_rate_limiter, ephemeral_id, time(NULL));
+}
+
+// Caller holds the limiter mutex
+void ratelimit_expire_inactive_senders(void) {
+    ratelimit_expire(&g_rate_limiter, time(NULL));
+}
+
+void ratelimit_set_evict_policy(pool_evict_policy_t policy) {
+    ratelimit_lock(&g_rate_limiter);
+    g_rate_limiter.evict_policy = policy;
+    ratelimit_unlock(&g_rate_limiter);
+}
+
+void ratelimit_get_pool_stats(slab_pool_stats_t *out) {
+    if (!out) {
         return;
     }
-#endif
-    
-    // Free all entries
-    rate_entry_t *current = g_rate_limiter.entries;
-    while (current != NULL) {
-        rate_entry_t *next = current->next;
-        free(current);
-        current = next;
-    }
-    
-    g_rate_limiter.entries = NULL;
-    g_rate_limiter.count = 0;
-    
-#ifdef _WIN32
-    LeaveCriticalSection(&g_rate_limiter.mutex);
-    DeleteCriticalSection(&g_rate_limiter.mutex);
-#else
-    pthread_mutex_unlock(&g_rate_limiter.mutex);
-    pthread_mutex_destroy(&g_rate_limiter.mutex);
-#endif
-    
+    ratelimit_lock(&g_rate_limiter);
+    slab_pool_get_stats(&g_rate_limiter.pool, out);
+    ratelimit_unlock(&g_rate_limiter);
+}
+
+void ratelimit_cleanup(void) {
+    // Release all entries at once with the backing slab
+    ratelimit_lock(&g_rate_limiter);
+    slab_pool_print_stats(&g_rate_limiter.pool);
+    ratelimit_unlock(&g_rate_limiter);
+    ratelimit_destroy_instance(&g_rate_limiter);
+
     printf("Rate limiter cleaned up\n");
 }
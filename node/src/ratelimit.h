@@ -8,10 +8,14 @@
 #else
 #include <pthread.h>
 #endif
+#include "pool.h"
 
 // Rate limiting configuration
 #define MAX_PER_WINDOW 6      // Maximum messages per window
 #define WINDOW_SECONDS 10      // Window size in seconds
+#ifndef RATELIMIT_CAPACITY
+#define RATELIMIT_CAPACITY 8192  // Maximum tracked senders
+#endif
 
 // Rate limit entry structure
 typedef struct rate_entry {
@@ -24,7 +28,10 @@ typedef struct rate_entry {
 
 // Rate limiter structure
 typedef struct {
-    rate_entry_t *entries;
+    rate_entry_t *entries;     // most recently active sender first
+    rate_entry_t *tail;        // least recently active sender
+    slab_pool_t pool;
+    pool_evict_policy_t evict_policy;
 #ifdef _WIN32
     CRITICAL_SECTION mutex;
 #else
@@ -36,10 +43,29 @@ typedef struct {
 // Global rate limiter instance
 extern rate_limiter_t g_rate_limiter;
 
-// Function declarations
+// Function declarations for the node's global limiter
 void ratelimit_init(void);
 int ratelimit_allow(const char *ephemeral_id);
 void ratelimit_cleanup(void);
 void ratelimit_expire_inactive_senders(void);
+void ratelimit_set_evict_policy(pool_evict_policy_t policy);
+void ratelimit_get_pool_stats(slab_pool_stats_t *out);
+
+// Separate limiters with their own capacity and a caller-supplied clock, e.g.
+// one per virtual node in the mesh simulator. The global functions above
+// wrap these with g_rate_limiter and time(NULL).
+
+/**
+ * @param capacity Maximum tracked senders
+ * @return 0 on success, -1 on error
+ */
+int ratelimit_init_instance(rate_limiter_t *rl, size_t capacity);
+void ratelimit_destroy_instance(rate_limiter_t *rl);
+
+/**
+ * @param now Current time in seconds, on the clock earlier calls used
+ * @return 1 if the sender is within MAX_PER_WINDOW per WINDOW_SECONDS
+ */
+int ratelimit_allow_at(rate_limiter_t *rl, const char *ephemeral_id, time_t now);
 
 #endif // RATELIMIT_H
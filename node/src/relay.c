@@ -0,0 +1,520 @@
+#include "relay.h"
+#include "geo.h"
+#include "sendsched.h"
+#include "timeutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+static const char *const k_verdict_names[RELAY_VERDICT_COUNT] = {
+    "scheduled", "not_hazard", "hop_limit", "out_of_area", "duplicate"
+};
+
+void relay_config_defaults(relay_config_t *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->hop_limit = RELAY_DEFAULT_HOP_LIMIT;
+    cfg->radius_m = RELAY_DEFAULT_RADIUS_M;
+    cfg->range_m = RELAY_DEFAULT_RANGE_M;
+    cfg->max_delay_ms = RELAY_DEFAULT_MAX_DELAY_MS;
+    cfg->filter_bits = RELAY_DEFAULT_FILTER_BITS;
+    cfg->filter_window_s = RELAY_DEFAULT_FILTER_WINDOW_S;
+}
+
+int relay_parse(const char *buf, size_t len, relay_header_t *hdr, const char **inner) {
+    size_t magic_len = sizeof(RELAY_MAGIC) - 1;
+    *inner = buf;
+    if (len < magic_len || memcmp(buf, RELAY_MAGIC, magic_len) != 0) {
+        return 0;
+    }
+    const char *nl = memchr(buf, '\n', len < RELAY_HEADER_MAX ? len : RELAY_HEADER_MAX);
+    if (!nl) {
+        return -1;
+    }
+    char line[RELAY_HEADER_MAX];
+    size_t line_len = (size_t)(nl - buf) - magic_len;
+    memcpy(line, buf + magic_len, line_len);
+    line[line_len] = '\0';
+    // A NaN would slip past every comparison in relay_decide(), so only
+    // finite, in-range values are accepted
+    if (sscanf(line, "%d/%d %lf %lf,%lf", &hdr->hops, &hdr->hop_limit, &hdr->radius_m,
+               &hdr->lat, &hdr->lon) != 5 ||
+        hdr->hops < 0 || hdr->hop_limit < 0 || hdr->hops > hdr->hop_limit ||
+        !isfinite(hdr->radius_m) || hdr->radius_m < 0.0 ||
+        !isfinite(hdr->lat) || hdr->lat < -90.0 || hdr->lat > 90.0 ||
+        !isfinite(hdr->lon) || hdr->lon < -180.0 || hdr->lon > 180.0) {
+        return -1;
+    }
+    *inner = nl + 1;
+    return 1;
+}
+
+int relay_format(char *buf, size_t cap, const relay_header_t *hdr, const char *msg, size_t len) {
+    int n = snprintf(buf, cap, RELAY_MAGIC "%d/%d %.0f %.6f,%.6f\n", hdr->hops, hdr->hop_limit,
+                     hdr->radius_m, hdr->lat, hdr->lon);
+    if (n < 0 || (size_t)n + len + 1 > cap) {
+        return -1;
+    }
+    memcpy(buf + n, msg, len);
+    buf[n + len] = '\0';
+    return n + (int)len;
+}
+
+uint64_t relay_key(const char *ephemeral_id, uint64_t seq) {
+    // FNV-1a over the id, then a splitmix finaliser with the sequence number
+    uint64_t h = 1469598103934665603ull;
+    for (const unsigned char *p = (const unsigned char *)ephemeral_id; *p; p++) {
+        h = (h ^ *p) * 1099511628211ull;
+    }
+    h ^= seq + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+    return h ^ (h >> 31);
+}
+
+int relay_filter_init(relay_filter_t *f, size_t bits, int window_s) {
+    memset(f, 0, sizeof(*f));
+    size_t n = 64;
+    while (n < bits) {
+        n <<= 1;
+    }
+    f->bits[0] = (uint64_t *)calloc(n / 64, sizeof(uint64_t));
+    f->bits[1] = (uint64_t *)calloc(n / 64, sizeof(uint64_t));
+    if (!f->bits[0] || !f->bits[1]) {
+        relay_filter_destroy(f);
+        return -1;
+    }
+    f->mask = n - 1;
+    f->window_ns = (uint64_t)(window_s > 0 ? window_s : 1) * 1000000000ull;
+    return 0;
+}
+
+void relay_filter_destroy(relay_filter_t *f) {
+    free(f->bits[0]);
+    free(f->bits[1]);
+    memset(f, 0, sizeof(*f));
+}
+
+static int filter_test(const uint64_t *bits, size_t mask, uint64_t key) {
+    uint64_t h1 = key, h2 = (key >> 32) | 1;
+    for (int i = 0; i < RELAY_FILTER_HASHES; i++) {
+        size_t b = (size_t)(h1 + (uint64_t)i * h2) & mask;
+        if (!(bits[b / 64] & (1ull << (b % 64)))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int relay_filter_test_and_add(relay_filter_t *f, uint64_t key, uint64_t now_ns) {
+    if (now_ns - f->rotated_ns >= f->window_ns) {
+        // Forget the older generation; two windows without activity clear both
+        int old = f->cur ^ 1;
+        size_t words = (f->mask + 1) / 64;
+        memset(f->bits[old], 0, words * sizeof(uint64_t));
+        if (now_ns - f->rotated_ns >= 2 * f->window_ns) {
+            memset(f->bits[f->cur], 0, words * sizeof(uint64_t));
+        }
+        f->cur = old;
+        f->rotated_ns = now_ns;
+    }
+    if (filter_test(f->bits[f->cur], f->mask, key) || filter_test(f->bits[f->cur ^ 1], f->mask, key)) {
+        return 1;
+    }
+    uint64_t h1 = key, h2 = (key >> 32) | 1;
+    for (int i = 0; i < RELAY_FILTER_HASHES; i++) {
+        size_t b = (size_t)(h1 + (uint64_t)i * h2) & f->mask;
+        f->bits[f->cur][b / 64] |= 1ull << (b % 64);
+    }
+    return 0;
+}
+
+relay_verdict_t relay_decide(const relay_config_t *cfg, relay_filter_t *f,
+                             double own_lat, double own_lon,
+                             const relay_header_t *hdr, const hazard_report_t *report,
+                             double rand01, uint64_t now_ns,
+                             uint64_t *delay_ns, relay_header_t *out) {
+    if (!report->has_location || !isfinite(report->lat) || !isfinite(report->lon) ||
+        msg_classify_fields(report->msg_type, report->hazard_type) == MSG_PRIO_ROUTINE) {
+        return RELAY_SKIP_CLASS;
+    }
+    relay_header_t in;
+    if (hdr) {
+        // The header is outside the signature, so it may only narrow our
+        // own scope, never widen it
+        in = *hdr;
+        if (in.hop_limit > cfg->hop_limit) {
+            in.hop_limit = cfg->hop_limit;
+        }
+        if (in.radius_m > cfg->radius_m) {
+            in.radius_m = cfg->radius_m;
+        }
+    } else {
+        in.hops = 0;
+        in.hop_limit = cfg->hop_limit;
+        in.radius_m = cfg->radius_m;
+        in.lat = report->lat;
+        in.lon = report->lon;
+    }
+    if (in.hops + 1 > in.hop_limit) {
+        return RELAY_SKIP_HOP_LIMIT;
+    }
+    if (geo_outside_box(report->lat, report->lon, own_lat, own_lon, in.radius_m) ||
+        geo_distance_m(report->lat, report->lon, own_lat, own_lon) > in.radius_m) {
+        return RELAY_SKIP_OUT_OF_AREA;
+    }
+    if (relay_filter_test_and_add(f, relay_key(report->ephemeral_id, report->seq), now_ns)) {
+        return RELAY_SKIP_DUPLICATE;
+    }
+
+    // Farther from the transmitter means a shorter wait; a tenth of the
+    // window is random so nodes at the same distance do not collide
+    double d = geo_distance_m(in.lat, in.lon, own_lat, own_lon);
+    double closeness = d >= cfg->range_m || cfg->range_m <= 0.0 ? 0.0 : 1.0 - d / cfg->range_m;
+    double ms = cfg->max_delay_ms * (0.9 * closeness + 0.1 * rand01);
+    *delay_ns = (uint64_t)(ms * 1e6);
+
+    out->hops = in.hops + 1;
+    out->hop_limit = in.hop_limit;
+    out->radius_m = in.radius_m;
+    out->lat = own_lat;
+    out->lon = own_lon;
+    return RELAY_SCHEDULE;
+}
+
+const char *relay_verdict_name(relay_verdict_t v) {
+    return v < RELAY_VERDICT_COUNT ? k_verdict_names[v] : "unknown";
+}
+
+// Node relay
+
+typedef struct {
+    uint64_t key;
+    uint64_t due_ns;
+    msg_priority_t prio;
+    char payload[SEND_MSG_MAX];
+} relay_pending_t;
+
+typedef struct {
+    relay_config_t cfg;
+    double lat, lon;
+    relay_filter_t filter;
+    relay_pending_t *pending;
+    size_t pending_count;
+    uint64_t rng;
+    relay_stats_t stats;
+    int stopping;
+    int initialized;
+    int thread_running;
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE wake;
+    HANDLE thread;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_t thread;
+#endif
+} relay_t;
+
+static relay_t g_relay;
+
+static void relay_lock(void) {
+#ifdef _WIN32
+    EnterCriticalSection(&g_relay.mutex);
+#else
+    pthread_mutex_lock(&g_relay.mutex);
+#endif
+}
+
+static void relay_unlock(void) {
+#ifdef _WIN32
+    LeaveCriticalSection(&g_relay.mutex);
+#else
+    pthread_mutex_unlock(&g_relay.mutex);
+#endif
+}
+
+static void relay_signal(void) {
+#ifdef _WIN32
+    WakeConditionVariable(&g_relay.wake);
+#else
+    pthread_cond_signal(&g_relay.wake);
+#endif
+}
+
+// Wait on the condition variable until woken or the monotonic deadline;
+// deadline 0 waits indefinitely
+static void relay_wait_until(uint64_t deadline_ns) {
+#ifdef _WIN32
+    DWORD ms = INFINITE;
+    if (deadline_ns != 0) {
+        uint64_t now = monotonic_ns();
+        ms = deadline_ns > now ? (DWORD)((deadline_ns - now + 999999) / 1000000) : 0;
+    }
+    SleepConditionVariableCS(&g_relay.wake, &g_relay.mutex, ms);
+#else
+    if (deadline_ns == 0) {
+        pthread_cond_wait(&g_relay.wake, &g_relay.mutex);
+        return;
+    }
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline_ns / 1000000000ull);
+    ts.tv_nsec = (long)(deadline_ns % 1000000000ull);
+    pthread_cond_timedwait(&g_relay.wake, &g_relay.mutex, &ts);
+#endif
+}
+
+static double relay_random(void) {
+    uint64_t *s = &g_relay.rng;
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return (double)(*s >> 11) / (double)(1ull << 53);
+}
+
+// Remove pending[i]; caller holds the lock
+static void pending_remove(size_t i) {
+    if (i != --g_relay.pending_count) {
+        g_relay.pending[i] = g_relay.pending[g_relay.pending_count];
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI relay_thread(LPVOID arg) {
+#else
+static void *relay_thread(void *arg) {
+#endif
+    (void)arg;
+    relay_pending_t due;
+    relay_lock();
+    while (!g_relay.stopping) {
+        // The list is short; a scan for the earliest is cheaper than a heap
+        // that also has to support cancellation
+        size_t first = 0;
+        for (size_t i = 1; i < g_relay.pending_count; i++) {
+            if (g_relay.pending[i].due_ns < g_relay.pending[first].due_ns) {
+                first = i;
+            }
+        }
+        if (g_relay.pending_count == 0) {
+            relay_wait_until(0);
+            continue;
+        }
+        if (g_relay.pending[first].due_ns > monotonic_ns()) {
+            relay_wait_until(g_relay.pending[first].due_ns);
+            continue;
+        }
+        due = g_relay.pending[first];
+        pending_remove(first);
+        relay_unlock();
+        int ok = send_sched_submit(due.prio, due.payload) == 0;
+        relay_lock();
+        if (ok) {
+            g_relay.stats.relayed++;
+        } else {
+            g_relay.stats.dropped++;
+        }
+    }
+    relay_unlock();
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+int relay_init(const relay_config_t *cfg, double own_lat, double own_lon) {
+    memset(&g_relay, 0, sizeof(g_relay));
+    g_relay.cfg = *cfg;
+    g_relay.lat = own_lat;
+    g_relay.lon = own_lon;
+    g_relay.rng = monotonic_ns() | 1;
+    g_relay.pending = (relay_pending_t *)calloc(RELAY_MAX_PENDING, sizeof(relay_pending_t));
+    if (!g_relay.pending || relay_filter_init(&g_relay.filter, cfg->filter_bits, cfg->filter_window_s) != 0) {
+        fprintf(stderr, "Failed to allocate relay state\n");
+        free(g_relay.pending);
+        g_relay.pending = NULL;
+        return -1;
+    }
+
+#ifdef _WIN32
+    InitializeCriticalSection(&g_relay.mutex);
+    InitializeConditionVariable(&g_relay.wake);
+    g_relay.thread = CreateThread(NULL, 0, relay_thread, NULL, 0, NULL);
+    if (g_relay.thread == NULL) {
+        fprintf(stderr, "CreateThread relay failed\n");
+        DeleteCriticalSection(&g_relay.mutex);
+        relay_filter_destroy(&g_relay.filter);
+        free(g_relay.pending);
+        g_relay.pending = NULL;
+        return -1;
+    }
+#else
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (pthread_mutex_init(&g_relay.mutex, NULL) != 0 ||
+        pthread_cond_init(&g_relay.wake, &attr) != 0) {
+        fprintf(stderr, "Failed to initialize relay locks\n");
+        pthread_condattr_destroy(&attr);
+        relay_filter_destroy(&g_relay.filter);
+        free(g_relay.pending);
+        g_relay.pending = NULL;
+        return -1;
+    }
+    pthread_condattr_destroy(&attr);
+    if (pthread_create(&g_relay.thread, NULL, relay_thread, NULL) != 0) {
+        perror("pthread_create relay");
+        pthread_cond_destroy(&g_relay.wake);
+        pthread_mutex_destroy(&g_relay.mutex);
+        relay_filter_destroy(&g_relay.filter);
+        free(g_relay.pending);
+        g_relay.pending = NULL;
+        return -1;
+    }
+#endif
+    g_relay.thread_running = 1;
+    g_relay.initialized = 1;
+    printf("Relay enabled (hop limit %d, radius %.0fm, range %.0fm, window %dms, filter %zu bits)\n",
+           cfg->hop_limit, cfg->radius_m, cfg->range_m, cfg->max_delay_ms, g_relay.filter.mask + 1);
+    return 0;
+}
+
+void relay_shutdown(void) {
+    if (!g_relay.initialized || !g_relay.thread_running) {
+        return;
+    }
+    relay_lock();
+    g_relay.stopping = 1;
+    relay_signal();
+    relay_unlock();
+#ifdef _WIN32
+    WaitForSingleObject(g_relay.thread, INFINITE);
+    CloseHandle(g_relay.thread);
+#else
+    pthread_join(g_relay.thread, NULL);
+#endif
+    g_relay.thread_running = 0;
+}
+
+void relay_cleanup(void) {
+    if (!g_relay.initialized) {
+        return;
+    }
+    relay_shutdown();
+    relay_filter_destroy(&g_relay.filter);
+    free(g_relay.pending);
+#ifdef _WIN32
+    DeleteCriticalSection(&g_relay.mutex);
+#else
+    pthread_cond_destroy(&g_relay.wake);
+    pthread_mutex_destroy(&g_relay.mutex);
+#endif
+    memset(&g_relay, 0, sizeof(g_relay));
+}
+
+int relay_enabled(void) {
+    return g_relay.initialized;
+}
+
+int relay_wrap_origin(char *buf, size_t cap, const char *msg, size_t len) {
+    relay_header_t hdr;
+    hdr.hops = 0;
+    hdr.hop_limit = g_relay.cfg.hop_limit;
+    hdr.radius_m = g_relay.cfg.radius_m;
+    hdr.lat = g_relay.lat;
+    hdr.lon = g_relay.lon;
+    int n = relay_format(buf, cap, &hdr, msg, len);
+    char id[64] = {0};
+    uint64_t seq = 0;
+    if (n >= 0 && g_relay.initialized && parse_json_fields(msg, id, &seq)) {
+        relay_lock();
+        relay_filter_test_and_add(&g_relay.filter, relay_key(id, seq), monotonic_ns());
+        g_relay.stats.originated++;
+        relay_unlock();
+    }
+    return n;
+}
+
+void relay_overheard(const char *ephemeral_id, uint64_t seq) {
+    if (!g_relay.initialized) {
+        return;
+    }
+    uint64_t key = relay_key(ephemeral_id, seq);
+    relay_lock();
+    for (size_t i = 0; i < g_relay.pending_count; i++) {
+        if (g_relay.pending[i].key == key) {
+            pending_remove(i);
+            g_relay.stats.suppressed++;
+            break;
+        }
+    }
+    relay_unlock();
+}
+
+void relay_consider(const relay_header_t *hdr, const hazard_report_t *report,
+                    const char *msg, size_t len) {
+    if (!g_relay.initialized) {
+        return;
+    }
+    relay_header_t out;
+    uint64_t delay_ns = 0;
+    relay_lock();
+    g_relay.stats.considered++;
+    uint64_t now = monotonic_ns();
+    relay_verdict_t v = relay_decide(&g_relay.cfg, &g_relay.filter, g_relay.lat, g_relay.lon, hdr,
+                                     report, relay_random(), now, &delay_ns, &out);
+    g_relay.stats.verdicts[v]++;
+    if (v == RELAY_SCHEDULE) {
+        relay_pending_t *p = g_relay.pending_count < RELAY_MAX_PENDING
+            ? &g_relay.pending[g_relay.pending_count] : NULL;
+        if (!p || relay_format(p->payload, sizeof(p->payload), &out, msg, len) < 0) {
+            g_relay.stats.dropped++;
+        } else {
+            p->key = relay_key(report->ephemeral_id, report->seq);
+            p->due_ns = now + delay_ns;
+            p->prio = msg_classify_fields(report->msg_type, report->hazard_type);
+            g_relay.pending_count++;
+            relay_signal();
+        }
+    }
+    relay_unlock();
+}
+
+void relay_get_stats(relay_stats_t *out) {
+    if (!out) {
+        return;
+    }
+    if (!g_relay.initialized) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    relay_lock();
+    *out = g_relay.stats;
+    relay_unlock();
+}
+
+void relay_print_stats(void) {
+    if (!g_relay.initialized) {
+        return;
+    }
+    relay_stats_t st;
+    relay_get_stats(&st);
+    printf("Relay: %llu considered, %llu relayed, %llu suppressed by overheard copies, "
+           "%llu dropped, %llu own reports\n",
+           (unsigned long long)st.considered, (unsigned long long)st.relayed,
+           (unsigned long long)st.suppressed, (unsigned long long)st.dropped,
+           (unsigned long long)st.originated);
+    printf("  verdicts:");
+    for (int v = 0; v < RELAY_VERDICT_COUNT; v++) {
+        printf(" %s=%llu", relay_verdict_name((relay_verdict_t)v), (unsigned long long)st.verdicts[v]);
+    }
+    printf("\n");
+}
@@ -0,0 +1,178 @@
+#ifndef RELAY_H
+#define RELAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "jsonmsg.h"
+#include "priority.h"
+
+// Geo-scoped multi-hop relay of hazard reports
+//
+// A node rebroadcasts a hazard or emergency report only if
+//   - it lies inside the report's relevance area (radius_m around the hazard),
+//   - the report has hops left (hops < hop_limit), and
+//   - it has not relayed that (ephemeral_id, seq) before.
+// Relays are contention based: the node waits up to max_delay_ms, shorter
+// the farther it is from the transmitter it heard, so the nodes that extend
+// coverage most go first. Hearing another copy of the report while waiting
+// cancels the relay, so in a dense area a handful of nodes forward each
+// report instead of all of them.
+//
+// Relayed reports carry a one-line text header in front of the signed JSON,
+// which is passed on unchanged:
+//
+//   ~R1 <hops>/<hop limit> <radius m> <lat>,<lon>\n{...}
+//
+// lat,lon is the position of the node that transmitted this copy. The '~'
+// can never start JSON or a bundle, and the JSON field scans used for
+// classification still see the report behind it. With relaying enabled a
+// node also puts the header (hops 0) on its own reports, so receivers learn
+// their scope; a report without one is treated as hops 0 with the
+// receiver's defaults, sent from the hazard's position. The header is not
+// signed, so a receiver caps its hop limit and radius at its own settings.
+//
+// Relayed (id, seq) pairs are remembered in two rotating Bloom filters of
+// filter_bits bits each, so the duplicate check costs a few bit tests and a
+// fixed 2 * filter_bits / 8 bytes however many reports pass through. A pair
+// is remembered for one to two filter windows.
+
+#define RELAY_MAGIC "~R1 "
+#define RELAY_HEADER_MAX 80
+#define RELAY_DEFAULT_HOP_LIMIT 5
+#define RELAY_DEFAULT_RADIUS_M 2000.0
+#define RELAY_DEFAULT_RANGE_M 300.0
+#define RELAY_DEFAULT_MAX_DELAY_MS 100
+#define RELAY_DEFAULT_FILTER_BITS 16384
+#define RELAY_DEFAULT_FILTER_WINDOW_S 30
+#define RELAY_FILTER_HASHES 4
+#define RELAY_MAX_PENDING 128
+
+typedef struct {
+    int hop_limit;              // for our own reports and those without a header;
+                                // also the most a received header may ask for
+    double radius_m;            // relevance radius, likewise
+    double range_m;             // radio range; transmitters this far away relay at once
+    int max_delay_ms;           // contention window
+    size_t filter_bits;         // per generation, rounded up to a power of two
+    int filter_window_s;
+} relay_config_t;
+
+typedef struct {
+    int hops;                   // transmissions so far; 0 for the originator's copy
+    int hop_limit;
+    double radius_m;
+    double lat, lon;            // transmitter of this copy
+} relay_header_t;
+
+typedef enum {
+    RELAY_SCHEDULE = 0,
+    RELAY_SKIP_CLASS,           // beacon or incomplete report
+    RELAY_SKIP_HOP_LIMIT,
+    RELAY_SKIP_OUT_OF_AREA,
+    RELAY_SKIP_DUPLICATE,       // relayed or originated here already
+    RELAY_VERDICT_COUNT
+} relay_verdict_t;
+
+// Duplicate-suppression filter: current and previous generation
+typedef struct {
+    uint64_t *bits[2];
+    size_t mask;                // filter_bits - 1
+    int cur;
+    uint64_t window_ns;
+    uint64_t rotated_ns;
+} relay_filter_t;
+
+void relay_config_defaults(relay_config_t *cfg);
+
+/**
+ * Split a received message into relay header and report.
+ * @param inner Set to the report behind the header, or to buf if none
+ * @return 1 if a header was parsed, 0 if there is none, -1 if malformed
+ */
+int relay_parse(const char *buf, size_t len, relay_header_t *hdr, const char **inner);
+
+/**
+ * Write header + msg into buf as a NUL-terminated string.
+ * @return Length written, or -1 if it does not fit in cap bytes
+ */
+int relay_format(char *buf, size_t cap, const relay_header_t *hdr, const char *msg, size_t len);
+
+// Key for a report in the filter and pending lists
+uint64_t relay_key(const char *ephemeral_id, uint64_t seq);
+
+/**
+ * @param bits Bits per generation, rounded up to a power of two
+ * @return 0 on success, -1 on error
+ */
+int relay_filter_init(relay_filter_t *f, size_t bits, int window_s);
+void relay_filter_destroy(relay_filter_t *f);
+
+/**
+ * Add key, rotating generations as time passes.
+ * @return 1 if key was (probably) present already, 0 if it is new
+ */
+int relay_filter_test_and_add(relay_filter_t *f, uint64_t key, uint64_t now_ns);
+
+/**
+ * Decide whether a verified report should be relayed by a node at
+ * (own_lat, own_lon), and record it in the filter if so.
+ * @param hdr Header it arrived with, or NULL for none
+ * @param rand01 Uniform sample in [0, 1) that breaks ties between equally
+ *        distant nodes
+ * @param delay_ns Contention delay before relaying
+ * @param out Header to send the relayed copy with
+ */
+relay_verdict_t relay_decide(const relay_config_t *cfg, relay_filter_t *f,
+                             double own_lat, double own_lon,
+                             const relay_header_t *hdr, const hazard_report_t *report,
+                             double rand01, uint64_t now_ns,
+                             uint64_t *delay_ns, relay_header_t *out);
+
+const char *relay_verdict_name(relay_verdict_t v);
+
+// The node's relay (--relay). Relays are handed to the send scheduler by a
+// timer thread once their contention delay passes. All calls are no-ops
+// until relay_init().
+
+typedef struct {
+    uint64_t considered;
+    uint64_t verdicts[RELAY_VERDICT_COUNT];
+    uint64_t relayed;           // handed to the send scheduler
+    uint64_t suppressed;        // cancelled by an overheard copy
+    uint64_t dropped;           // pending list or send queue full
+    uint64_t originated;        // own reports sent with a header
+} relay_stats_t;
+
+/**
+ * Start relaying; own position as reported in our hazard reports.
+ * @return 0 on success, -1 on error
+ */
+int relay_init(const relay_config_t *cfg, double own_lat, double own_lon);
+
+// Stop the timer thread; relays still waiting are discarded
+void relay_shutdown(void);
+void relay_cleanup(void);
+int relay_enabled(void);
+
+/**
+ * Put a relay header (hops 0) on one of our own reports and remember it,
+ * so copies relayed back to us are not relayed again.
+ * @return Length written to buf, or -1 if it does not fit
+ */
+int relay_wrap_origin(char *buf, size_t cap, const char *msg, size_t len);
+
+// Note any received copy of a report; cancels a pending relay of it
+void relay_overheard(const char *ephemeral_id, uint64_t seq);
+
+/**
+ * Consider relaying a verified report.
+ * @param hdr Header it arrived with, or NULL
+ * @param msg The signed report, without header
+ */
+void relay_consider(const relay_header_t *hdr, const hazard_report_t *report,
+                    const char *msg, size_t len);
+
+void relay_get_stats(relay_stats_t *out);
+void relay_print_stats(void);
+
+#endif // RELAY_H
@@ -12,150 +12,212 @@
 // Global replay cache instance
 replay_cache_t g_replay_cache = {0};
 
-void replay_cache_init(void) {
-    g_replay_cache.entries = NULL;
-    g_replay_cache.count = 0;
-    
+SLAB_POOL_DECLARE(replay_entry, replay_entry_t)
+
+static void replay_lock(replay_cache_t *cache) {
 #ifdef _WIN32
-    InitializeCriticalSection(&g_replay_cache.mutex);
+    EnterCriticalSection(&cache->mutex);
 #else
-    if (pthread_mutex_init(&g_replay_cache.mutex, NULL) != 0) {
-        fprintf(stderr, "Failed to initialize replay cache mutex\n");
-        exit(1);
-    }
+    pthread_mutex_lock(&cache->mutex);
 #endif
-    
-    printf("Replay cache initialized\n");
 }
 
-int replay_cache_check_and_add(const char *ephemeral_id, uint64_t seq) {
-    if (!ephemeral_id) {
-        return 0; // Invalid input
+static void replay_unlock(replay_cache_t *cache) {
+#ifdef _WIN32
+    LeaveCriticalSection(&cache->mutex);
+#else
+    pthread_mutex_unlock(&cache->mutex);
+#endif
+}
+
+// FNV-1a over the id, then the seq folded in
+static size_t replay_bucket(const replay_cache_t *cache, const char *ephemeral_id, uint64_t seq) {
+    uint64_t h = 1469598103934665603ull;
+    for (const unsigned char *p = (const unsigned char *)ephemeral_id; *p; p++) {
+        h = (h ^ *p) * 1099511628211ull;
+    }
+    h ^= seq * 0x9E3779B97F4A7C15ull;
+    h ^= h >> 29;
+    return (size_t)h & cache->bucket_mask;
+}
+
+static void replay_cache_unlink(replay_cache_t *cache, replay_entry_t *entry) {
+    replay_entry_t **link = &cache->buckets[replay_bucket(cache, entry->ephemeral_id, entry->seq)];
+    while (*link != entry) {
+        link = &(*link)->hnext;
+    }
+    *link = entry->hnext;
+
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    } else {
+        cache->entries = entry->next;
+    }
+
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    } else {
+        cache->tail = entry->prev;
+    }
+
+    cache->count--;
+    replay_entry_pool_free(&cache->pool, entry);
+}
+
+// Entries are kept in insertion order, so expired ones sit at the tail
+static void replay_cache_expire(replay_cache_t *cache, time_t now) {
+    while (cache->tail != NULL && now - cache->tail->timestamp > REPLAY_CACHE_TTL) {
+        replay_cache_unlink(cache, cache->tail);
+    }
+}
+
+int replay_cache_init_instance(replay_cache_t *cache, size_t capacity) {
+    memset(cache, 0, sizeof(*cache));
+    cache->evict_policy = POOL_EVICT_OLDEST;
+
+    if (slab_pool_init(&cache->pool, "replay", sizeof(replay_entry_t), capacity) != 0) {
+        return -1;
     }
-    
-    time_t now = time(NULL);
-    
-    // Lock the cache
+
+    // At least one bucket per entry keeps chains about one long
+    size_t bucket_count = 1;
+    while (bucket_count < capacity) {
+        bucket_count <<= 1;
+    }
+    cache->buckets = (replay_entry_t **)calloc(bucket_count, sizeof(replay_entry_t *));
+    if (cache->buckets == NULL) {
+        slab_pool_destroy(&cache->pool);
+        return -1;
+    }
+    cache->bucket_mask = bucket_count - 1;
+
 #ifdef _WIN32
-    EnterCriticalSection(&g_replay_cache.mutex);
+    InitializeCriticalSection(&cache->mutex);
 #else
-    if (pthread_mutex_lock(&g_replay_cache.mutex) != 0) {
-        fprintf(stderr, "Failed to lock replay cache mutex\n");
-        return 0;
+    if (pthread_mutex_init(&cache->mutex, NULL) != 0) {
+        free(cache->buckets);
+        cache->buckets = NULL;
+        slab_pool_destroy(&cache->pool);
+        return -1;
     }
 #endif
-    
-    // First, clean up expired entries
-    replay_cache_expire_old_entries();
-    
-    // Check if this (ephemeral_id, seq) combination already exists
-    replay_entry_t *current = g_replay_cache.entries;
-    while (current != NULL) {
-        if (strcmp(current->ephemeral_id, ephemeral_id) == 0 && 
-            current->seq == seq) {
-            // Duplicate found - reject
+    return 0;
+}
+
+void replay_cache_destroy_instance(replay_cache_t *cache) {
+    slab_pool_destroy(&cache->pool);
+    free(cache->buckets);
+    cache->buckets = NULL;
+    cache->entries = NULL;
+    cache->tail = NULL;
+    cache->count = 0;
 #ifdef _WIN32
-            LeaveCriticalSection(&g_replay_cache.mutex);
+    DeleteCriticalSection(&cache->mutex);
 #else
-            pthread_mutex_unlock(&g_replay_cache.mutex);
+    pthread_mutex_destroy(&cache->mutex);
 #endif
+}
+
+int replay_cache_check_at(replay_cache_t *cache, const char *ephemeral_id, uint64_t seq, time_t now) {
+    if (!ephemeral_id) {
+        return 0; // Invalid input
+    }
+
+    replay_lock(cache);
+
+    // First, clean up expired entries
+    replay_cache_expire(cache, now);
+
+    // Check if this (ephemeral_id, seq) combination already exists. Ids are
+    // stored truncated, so compare the truncated form.
+    char id[sizeof(((replay_entry_t *)0)->ephemeral_id)];
+    strncpy(id, ephemeral_id, sizeof(id) - 1);
+    id[sizeof(id) - 1] = '\0';
+    size_t bucket = replay_bucket(cache, id, seq);
+    for (replay_entry_t *current = cache->buckets[bucket]; current != NULL; current = current->hnext) {
+        if (current->seq == seq && strcmp(current->ephemeral_id, id) == 0) {
+            // Duplicate found - reject
+            replay_unlock(cache);
             return 0;
         }
-        current = current->next;
     }
-    
-    // Not a duplicate - add new entry
-    replay_entry_t *new_entry = (replay_entry_t*)malloc(sizeof(replay_entry_t));
+
+    // Not a duplicate - add new entry, reclaiming the oldest slot if full
+    if (slab_pool_full(&cache->pool) &&
+        cache->evict_policy == POOL_EVICT_OLDEST &&
+        cache->tail != NULL) {
+        replay_cache_unlink(cache, cache->tail);
+        slab_pool_note_eviction(&cache->pool);
+    }
+
+    replay_entry_t *new_entry = replay_entry_pool_alloc(&cache->pool);
     if (!new_entry) {
-#ifdef _WIN32
-        LeaveCriticalSection(&g_replay_cache.mutex);
-#else
-        pthread_mutex_unlock(&g_replay_cache.mutex);
-#endif
-        fprintf(stderr, "Failed to allocate memory for replay entry\n");
-        return 0;
+        replay_unlock(cache);
+        return 0; // Cache full and policy is to reject
     }
-    
-    strncpy(new_entry->ephemeral_id, ephemeral_id, sizeof(new_entry->ephemeral_id) - 1);
-    new_entry->ephemeral_id[sizeof(new_entry->ephemeral_id) - 1] = '\0';
+
+    memcpy(new_entry->ephemeral_id, id, sizeof(new_entry->ephemeral_id));
     new_entry->seq = seq;
     new_entry->timestamp = now;
-    
+    new_entry->hnext = cache->buckets[bucket];
+    cache->buckets[bucket] = new_entry;
+
     // Add to the beginning of the list
-    new_entry->next = g_replay_cache.entries;
+    new_entry->next = cache->entries;
     new_entry->prev = NULL;
-    
-    if (g_replay_cache.entries != NULL) {
-        g_replay_cache.entries->prev = new_entry;
-    }
-    
-    g_replay_cache.entries = new_entry;
-    g_replay_cache.count++;
-    
-#ifdef _WIN32
-    LeaveCriticalSection(&g_replay_cache.mutex);
-#else
-    pthread_mutex_unlock(&g_replay_cache.mutex);
-#endif
+
+    if (cache->entries != NULL) {
+        cache->entries->prev = new_entry;
+    } else {
+        cache->tail = new_entry;
+    }
+
+    cache->entries = new_entry;
+    cache->count++;
+
+    replay_unlock(cache);
     return 1; // Accepted
 }
 
-void replay_cache_expire_old_entries(void) {
-    time_t now = time(NULL);
-    replay_entry_t *current = g_replay_cache.entries;
-    
-    while (current != NULL) {
-        replay_entry_t *next = current->next;
-        
-        // Check if entry is expired
-        if (now - current->timestamp > REPLAY_CACHE_TTL) {
-            // Remove from list
-            if (current->prev != NULL) {
-                current->prev->next = current->next;
-            } else {
-                g_replay_cache.entries = current->next;
-            }
-            
-            if (current->next != NULL) {
-                current->next->prev = current->prev;
-            }
-            
-            g_replay_cache.count--;
-            free(current);
-        }
-        
-        current = next;
+void replay_cache_init(void) {
+    if (replay_cache_init_instance(&g_replay_cache, REPLAY_CACHE_CAPACITY) != 0) {
+        fprintf(stderr, "Failed to initialize replay cache\n");
+        exit(1);
     }
+    printf("Replay cache initialized (capacity %d entries)\n", REPLAY_CACHE_CAPACITY);
 }
 
-void replay_cache_cleanup(void) {
-#ifdef _WIN32
-    EnterCriticalSection(&g_replay_cache.mutex);
-#else
-    if (pthread_mutex_lock(&g_replay_cache.mutex) != 0) {
-        fprintf(stderr, "Failed to lock replay cache mutex for cleanup\n");
+int replay_cache_check_and_add(const char *ephemeral_id, uint64_t seq) {
+    return replay_cache_check_at(&g_replay_cache, ephemeral_id, seq, time(NULL));
+}
+
+void replay_cache_expire_old_entries(void) {
+    replay_lock(&g_replay_cache);
+    replay_cache_expire(&g_replay_cache, time(NULL));
+    replay_unlock(&g_replay_cache);
+}
+
+void replay_cache_set_evict_policy(pool_evict_policy_t policy) {
+    replay_lock(&g_replay_cache);
+    g_replay_cache.evict_policy = policy;
+    replay_unlock(&g_replay_cache);
+}
+
+void replay_cache_get_pool_stats(slab_pool_stats_t *out) {
+    if (!out) {
         return;
     }
-#endif
-    
-    // Free all entries
-    replay_entry_t *current = g_replay_cache.entries;
-    while (current != NULL) {
-        replay_entry_t *next = current->next;
-        free(current);
-        current = next;
-    }
-    
-    g_replay_cache.entries = NULL;
-    g_replay_cache.count = 0;
-    
-#ifdef _WIN32
-    LeaveCriticalSection(&g_replay_cache.mutex);
-    DeleteCriticalSection(&g_replay_cache.mutex);
-#else
-    pthread_mutex_unlock(&g_replay_cache.mutex);
-    pthread_mutex_destroy(&g_replay_cache.mutex);
-#endif
-    
+    replay_lock(&g_replay_cache);
+    slab_pool_get_stats(&g_replay_cache.pool, out);
+    replay_unlock(&g_replay_cache);
+}
+
+void replay_cache_cleanup(void) {
+    // Release all entries at once with the backing slab
+    replay_lock(&g_replay_cache);
+    slab_pool_print_stats(&g_replay_cache.pool);
+    replay_unlock(&g_replay_cache);
+    replay_cache_destroy_instance(&g_replay_cache);
+
     printf("Replay cache cleaned up\n");
 }
@@ -8,9 +8,13 @@
 #else
 #include <pthread.h>
 #endif
+#include "pool.h"
 
 // Replay cache configuration
 #define REPLAY_CACHE_TTL 600  // 10 minutes in seconds
+#ifndef REPLAY_CACHE_CAPACITY
+#define REPLAY_CACHE_CAPACITY 16384  // max tracked (ephemeral_id, seq) pairs
+#endif
 
 // Replay cache entry structure
 typedef struct replay_entry {
@@ -19,11 +23,17 @@ typedef struct replay_entry {
     time_t timestamp;
     struct replay_entry *next;
     struct replay_entry *prev;
+    struct replay_entry *hnext;    // hash chain
 } replay_entry_t;
 
 // Replay cache structure
 typedef struct {
-    replay_entry_t *entries;
+    replay_entry_t *entries;   // newest first
+    replay_entry_t *tail;      // oldest entry, first to expire or be evicted
+    replay_entry_t **buckets;  // index on (ephemeral_id, seq)
+    size_t bucket_mask;        // bucket count - 1
+    slab_pool_t pool;
+    pool_evict_policy_t evict_policy;
 #ifdef _WIN32
     CRITICAL_SECTION mutex;
 #else
@@ -35,10 +45,30 @@ typedef struct {
 // Global replay cache instance
 extern replay_cache_t g_replay_cache;
 
-// Function declarations
+// Function declarations for the node's global cache
 void replay_cache_init(void);
 int replay_cache_check_and_add(const char *ephemeral_id, uint64_t seq);
 void replay_cache_cleanup(void);
 void replay_cache_expire_old_entries(void);
+void replay_cache_set_evict_policy(pool_evict_policy_t policy);
+void replay_cache_get_pool_stats(slab_pool_stats_t *out);
+
+// Separate caches with their own capacity and a caller-supplied clock, e.g.
+// one per virtual node in the mesh simulator. The global functions above
+// wrap these with g_replay_cache and time(NULL).
+
+/**
+ * @param capacity Maximum tracked (ephemeral_id, seq) pairs
+ * @return 0 on success, -1 on error
+ */
+int replay_cache_init_instance(replay_cache_t *cache, size_t capacity);
+void replay_cache_destroy_instance(replay_cache_t *cache);
+
+/**
+ * Accept (ephemeral_id, seq) once per TTL.
+ * @param now Current time in seconds, on the clock entries were added with
+ * @return 1 if fresh and recorded, 0 if a replay or the cache refused it
+ */
+int replay_cache_check_at(replay_cache_t *cache, const char *ephemeral_id, uint64_t seq, time_t now);
 
 #endif // REPLAY_H
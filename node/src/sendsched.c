@@ -0,0 +1,486 @@
+#include "sendsched.h"
+#include "bundle.h"
+#include "net.h"
+#include "timeutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#define NO_DEADLINE UINT64_MAX
+
+typedef struct {
+    char data[SEND_MSG_MAX];
+    size_t len;
+    uint64_t enqueued_ns;
+} send_slot_t;
+
+typedef struct {
+    send_slot_t *slots;
+    size_t head;
+    size_t count;
+    size_t bytes;       // payload bytes queued
+} send_queue_t;
+
+// What went into one datagram, for the stats once it is sent
+typedef struct {
+    int cls;
+    uint64_t enqueued_ns;
+} sent_record_t;
+
+typedef struct {
+    send_queue_t queues[MSG_PRIO_COUNT];
+    size_t capacity;
+    uint64_t gap_ns[MSG_PRIO_COUNT];
+    uint64_t last_sent_ns[MSG_PRIO_COUNT];
+    size_t bundle_mtu;
+    uint64_t window_ns[MSG_PRIO_COUNT];
+    int sockfd;
+    char peer_ip[64];
+    int peer_port;
+    send_sched_periodic_fn periodic_fn;
+    void *periodic_arg;
+    int periodic_interval_ms;
+    uint64_t next_periodic_ns;
+    send_sched_stats_t stats;
+    int stopping;
+    int initialized;
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE wake;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+#endif
+} send_sched_t;
+
+static send_sched_t g_sched;
+
+static void sched_lock(void) {
+#ifdef _WIN32
+    EnterCriticalSection(&g_sched.mutex);
+#else
+    pthread_mutex_lock(&g_sched.mutex);
+#endif
+}
+
+static void sched_unlock(void) {
+#ifdef _WIN32
+    LeaveCriticalSection(&g_sched.mutex);
+#else
+    pthread_mutex_unlock(&g_sched.mutex);
+#endif
+}
+
+static void sched_signal(void) {
+#ifdef _WIN32
+    WakeConditionVariable(&g_sched.wake);
+#else
+    pthread_cond_signal(&g_sched.wake);
+#endif
+}
+
+// Sleep on the condition variable until woken or the monotonic deadline passes
+static void sched_wait_until(uint64_t deadline_ns) {
+#ifdef _WIN32
+    DWORD ms = INFINITE;
+    if (deadline_ns != NO_DEADLINE) {
+        uint64_t now = monotonic_ns();
+        ms = deadline_ns > now ? (DWORD)((deadline_ns - now + 999999) / 1000000) : 0;
+    }
+    SleepConditionVariableCS(&g_sched.wake, &g_sched.mutex, ms);
+#else
+    if (deadline_ns == NO_DEADLINE) {
+        pthread_cond_wait(&g_sched.wake, &g_sched.mutex);
+        return;
+    }
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline_ns / 1000000000ull);
+    ts.tv_nsec = (long)(deadline_ns % 1000000000ull);
+    pthread_cond_timedwait(&g_sched.wake, &g_sched.mutex, &ts);
+#endif
+}
+
+void send_sched_config_defaults(send_sched_config_t *cfg) {
+    if (!cfg) {
+        return;
+    }
+    cfg->queue_capacity = SEND_QUEUE_DEFAULT_CAPACITY;
+    cfg->min_gap_ms[MSG_PRIO_EMERGENCY] = 0;
+    cfg->min_gap_ms[MSG_PRIO_HAZARD] = 50;
+    cfg->min_gap_ms[MSG_PRIO_ROUTINE] = 100;
+    cfg->bundle_mtu = 0;
+    cfg->bundle_window_ms[MSG_PRIO_EMERGENCY] = 0;
+    cfg->bundle_window_ms[MSG_PRIO_HAZARD] = 5;
+    cfg->bundle_window_ms[MSG_PRIO_ROUTINE] = 20;
+}
+
+int send_sched_init(const send_sched_config_t *cfg, int sockfd, const char *peer_ip, int peer_port) {
+    send_sched_config_t defaults;
+    if (!cfg) {
+        send_sched_config_defaults(&defaults);
+        cfg = &defaults;
+    }
+    if (cfg->queue_capacity == 0 || !peer_ip ||
+        (cfg->bundle_mtu > 0 && (cfg->bundle_mtu < BUNDLE_MIN_MTU || cfg->bundle_mtu > SEND_MSG_MAX))) {
+        fprintf(stderr, "Invalid send scheduler configuration\n");
+        return -1;
+    }
+
+    memset(&g_sched, 0, sizeof(g_sched));
+    g_sched.capacity = cfg->queue_capacity;
+    g_sched.sockfd = sockfd;
+    strncpy(g_sched.peer_ip, peer_ip, sizeof(g_sched.peer_ip) - 1);
+    g_sched.peer_port = peer_port;
+    g_sched.bundle_mtu = cfg->bundle_mtu;
+
+    for (int c = 0; c < MSG_PRIO_COUNT; c++) {
+        g_sched.queues[c].slots = (send_slot_t *)calloc(g_sched.capacity, sizeof(send_slot_t));
+        if (!g_sched.queues[c].slots) {
+            fprintf(stderr, "Failed to allocate send queue\n");
+            send_sched_cleanup();
+            return -1;
+        }
+        g_sched.gap_ns[c] = (uint64_t)(cfg->min_gap_ms[c] > 0 ? cfg->min_gap_ms[c] : 0) * 1000000ull;
+        g_sched.window_ns[c] = (uint64_t)(cfg->bundle_window_ms[c] > 0 ? cfg->bundle_window_ms[c] : 0) * 1000000ull;
+    }
+
+#ifdef _WIN32
+    InitializeCriticalSection(&g_sched.mutex);
+    InitializeConditionVariable(&g_sched.wake);
+#else
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (pthread_mutex_init(&g_sched.mutex, NULL) != 0 ||
+        pthread_cond_init(&g_sched.wake, &attr) != 0) {
+        pthread_condattr_destroy(&attr);
+        fprintf(stderr, "Failed to initialize send scheduler locks\n");
+        send_sched_cleanup();
+        return -1;
+    }
+    pthread_condattr_destroy(&attr);
+#endif
+    g_sched.initialized = 1;
+
+    printf("Send scheduler initialized (%zu slots/class, pacing %d/%d/%d ms)\n",
+           g_sched.capacity, cfg->min_gap_ms[MSG_PRIO_EMERGENCY],
+           cfg->min_gap_ms[MSG_PRIO_HAZARD], cfg->min_gap_ms[MSG_PRIO_ROUTINE]);
+    if (cfg->bundle_mtu > 0) {
+        printf("Message bundling: MTU %zu bytes, window %d/%d/%d ms\n", cfg->bundle_mtu,
+               cfg->bundle_window_ms[MSG_PRIO_EMERGENCY], cfg->bundle_window_ms[MSG_PRIO_HAZARD],
+               cfg->bundle_window_ms[MSG_PRIO_ROUTINE]);
+    }
+    return 0;
+}
+
+void send_sched_cleanup(void) {
+    for (int c = 0; c < MSG_PRIO_COUNT; c++) {
+        free(g_sched.queues[c].slots);
+    }
+    if (g_sched.initialized) {
+#ifdef _WIN32
+        DeleteCriticalSection(&g_sched.mutex);
+#else
+        pthread_mutex_destroy(&g_sched.mutex);
+        pthread_cond_destroy(&g_sched.wake);
+#endif
+    }
+    memset(&g_sched, 0, sizeof(g_sched));
+}
+
+int send_sched_submit(msg_priority_t prio, const char *payload) {
+    if (!payload || prio >= MSG_PRIO_COUNT) {
+        return -1;
+    }
+    size_t len = strlen(payload);
+    if (len >= SEND_MSG_MAX) {
+        fprintf(stderr, "Send scheduler: payload too large (%zu bytes)\n", len);
+        return -1;
+    }
+
+    sched_lock();
+    send_queue_t *q = &g_sched.queues[prio];
+    send_class_stats_t *cs = &g_sched.stats.cls[prio];
+    cs->submitted++;
+
+    if (q->count == g_sched.capacity) {
+        cs->dropped++;
+        sched_unlock();
+        return -1;
+    }
+
+    send_slot_t *slot = &q->slots[(q->head + q->count) % g_sched.capacity];
+    memcpy(slot->data, payload, len + 1);
+    slot->len = len;
+    slot->enqueued_ns = monotonic_ns();
+    q->count++;
+    q->bytes += len;
+
+    sched_signal();
+    sched_unlock();
+    return 0;
+}
+
+void send_sched_set_periodic(int interval_ms, send_sched_periodic_fn fn, void *arg) {
+    sched_lock();
+    g_sched.periodic_fn = fn;
+    g_sched.periodic_arg = arg;
+    g_sched.periodic_interval_ms = interval_ms;
+    g_sched.stats.periodic_interval_ms = interval_ms;
+    g_sched.next_periodic_ns = monotonic_ns();   // fire once right away
+    sched_signal();
+    sched_unlock();
+}
+
+void send_sched_set_interval(int interval_ms) {
+    sched_lock();
+    if (interval_ms != g_sched.periodic_interval_ms) {
+        // Re-anchor the next report on the new interval rather than the old one
+        uint64_t last = monotonic_ns();
+        if (g_sched.periodic_interval_ms > 0) {
+            last = g_sched.next_periodic_ns - (uint64_t)g_sched.periodic_interval_ms * 1000000ull;
+        }
+        g_sched.periodic_interval_ms = interval_ms;
+        g_sched.stats.periodic_interval_ms = interval_ms;
+        g_sched.next_periodic_ns = last + (uint64_t)(interval_ms > 0 ? interval_ms : 0) * 1000000ull;
+        sched_signal();
+    }
+    sched_unlock();
+}
+
+static void record_latency(send_class_stats_t *cs, uint64_t ns) {
+    int bucket = 0;
+    while (bucket < SEND_LATENCY_BUCKETS - 1 && (ns >> (bucket + 1)) != 0) {
+        bucket++;
+    }
+    cs->latency_buckets[bucket]++;
+    cs->latency_total_ns += ns;
+    if (ns > cs->latency_max_ns) {
+        cs->latency_max_ns = ns;
+    }
+}
+
+// When class c may go out: immediately without bundling, otherwise once its
+// queued messages fill a datagram or the oldest has waited its window.
+// Called with the lock held and c non-empty.
+static uint64_t bundle_ready_ns(int c) {
+    const send_queue_t *q = &g_sched.queues[c];
+    if (g_sched.bundle_mtu == 0 || g_sched.stopping) {
+        return 0;
+    }
+    if (BUNDLE_HEADER_SIZE + q->bytes + q->count * BUNDLE_RECORD_OVERHEAD >= g_sched.bundle_mtu ||
+        q->count >= SEND_BUNDLE_MAX_RECORDS) {
+        return 0;
+    }
+    return q->slots[q->head].enqueued_ns + g_sched.window_ns[c];
+}
+
+static void dequeue_head(int c, sent_record_t *rec) {
+    send_queue_t *q = &g_sched.queues[c];
+    rec->cls = c;
+    rec->enqueued_ns = q->slots[q->head].enqueued_ns;
+    q->bytes -= q->slots[q->head].len;
+    q->head = (q->head + 1) % g_sched.capacity;
+    q->count--;
+}
+
+// Copy the next datagram into out and dequeue what it carries: the head of
+// class pick, and with bundling as many further messages as fit, from pick
+// first and then from the other classes whose pacing gap has elapsed.
+// Called with the lock held; returns the datagram length.
+static size_t fill_datagram(int pick, uint64_t now, uint8_t *out, sent_record_t *recs, int *nrecs) {
+    send_queue_t *q = &g_sched.queues[pick];
+    const send_slot_t *slot = &q->slots[q->head];
+    bundle_writer_t w;
+    bundle_writer_init(&w, out, g_sched.bundle_mtu);
+
+    if (g_sched.bundle_mtu == 0 || !bundle_writer_fits(&w, slot->len)) {
+        size_t len = slot->len;
+        memcpy(out, slot->data, len);
+        dequeue_head(pick, &recs[0]);
+        *nrecs = 1;
+        return len;
+    }
+
+    int n = 0;
+    for (int step = 0; step <= MSG_PRIO_COUNT && n < SEND_BUNDLE_MAX_RECORDS; step++) {
+        // step 0 is the picked class, then every class in priority order
+        int c = step == 0 ? pick : step - 1;
+        if (step > 0 && c == pick) {
+            continue;
+        }
+        q = &g_sched.queues[c];
+        if (step > 0 && g_sched.last_sent_ns[c] != 0 &&
+            now < g_sched.last_sent_ns[c] + g_sched.gap_ns[c]) {
+            continue;
+        }
+        while (q->count > 0 && n < SEND_BUNDLE_MAX_RECORDS) {
+            slot = &q->slots[q->head];
+            if (bundle_writer_add(&w, slot->data, slot->len) != 0) {
+                break;
+            }
+            dequeue_head(c, &recs[n++]);
+        }
+    }
+    *nrecs = n;
+
+    if (n == 1) {
+        // Nothing to share the datagram with; send it plain
+        size_t len = w.len - BUNDLE_HEADER_SIZE - BUNDLE_RECORD_OVERHEAD;
+        memmove(out, out + BUNDLE_HEADER_SIZE + BUNDLE_RECORD_OVERHEAD, len);
+        return len;
+    }
+    return bundle_writer_finish(&w);
+}
+
+void send_sched_run(void) {
+    uint8_t out[SEND_MSG_MAX];
+
+    sched_lock();
+    while (!g_sched.stopping) {
+        uint64_t now = monotonic_ns();
+
+        // Periodic report due? Run it unlocked; it will submit() like anyone else
+        if (g_sched.periodic_fn && g_sched.periodic_interval_ms > 0 &&
+            now >= g_sched.next_periodic_ns) {
+            send_sched_periodic_fn fn = g_sched.periodic_fn;
+            void *arg = g_sched.periodic_arg;
+            g_sched.next_periodic_ns = now + (uint64_t)g_sched.periodic_interval_ms * 1000000ull;
+            sched_unlock();
+            fn(arg);
+            sched_lock();
+            continue;
+        }
+
+        // Most urgent class whose pacing gap has elapsed and, when bundling,
+        // whose bundle is full or has waited long enough
+        int pick = -1;
+        uint64_t wake = (g_sched.periodic_fn && g_sched.periodic_interval_ms > 0)
+                        ? g_sched.next_periodic_ns : NO_DEADLINE;
+        for (int c = 0; c < MSG_PRIO_COUNT; c++) {
+            if (g_sched.queues[c].count == 0) {
+                continue;
+            }
+            uint64_t eligible = g_sched.last_sent_ns[c] + g_sched.gap_ns[c];
+            if (g_sched.last_sent_ns[c] != 0 && now < eligible) {
+                if (eligible < wake) {
+                    wake = eligible;
+                }
+                continue;
+            }
+            uint64_t ready = bundle_ready_ns(c);
+            if (now >= ready) {
+                pick = c;
+                break;
+            }
+            if (ready < wake) {
+                wake = ready;
+            }
+        }
+
+        if (pick < 0) {
+            sched_wait_until(wake);
+            continue;
+        }
+
+        sent_record_t recs[SEND_BUNDLE_MAX_RECORDS];
+        int nrecs = 0;
+        size_t out_len = fill_datagram(pick, now, out, recs, &nrecs);
+        sched_unlock();
+
+        int rc = udp_send_buf(g_sched.sockfd, g_sched.peer_ip, g_sched.peer_port, out, out_len);
+        uint64_t sent_ns = monotonic_ns();
+
+        sched_lock();
+        g_sched.stats.datagrams++;
+        if (rc >= 0) {
+            g_sched.stats.bytes_sent += out_len;
+        }
+        if (nrecs > 1) {
+            g_sched.stats.bundles++;
+            g_sched.stats.bundled_msgs += (uint64_t)nrecs;
+        }
+        for (int i = 0; i < nrecs; i++) {
+            send_class_stats_t *cs = &g_sched.stats.cls[recs[i].cls];
+            g_sched.last_sent_ns[recs[i].cls] = sent_ns;
+            if (rc < 0) {
+                cs->send_errors++;
+            } else {
+                cs->sent++;
+                record_latency(cs, sent_ns - recs[i].enqueued_ns);
+            }
+        }
+    }
+    sched_unlock();
+}
+
+void send_sched_shutdown(void) {
+    sched_lock();
+    g_sched.stopping = 1;
+#ifdef _WIN32
+    WakeAllConditionVariable(&g_sched.wake);
+#else
+    pthread_cond_broadcast(&g_sched.wake);
+#endif
+    sched_unlock();
+}
+
+void send_sched_get_stats(send_sched_stats_t *out) {
+    if (!out) {
+        return;
+    }
+    sched_lock();
+    *out = g_sched.stats;
+    sched_unlock();
+}
+
+uint64_t send_sched_latency_percentile(const send_class_stats_t *cs, double pct) {
+    if (!cs || cs->sent == 0) {
+        return 0;
+    }
+    uint64_t target = (uint64_t)((double)cs->sent * pct / 100.0);
+    if (target >= cs->sent) {
+        target = cs->sent - 1;
+    }
+    uint64_t seen = 0;
+    for (int b = 0; b < SEND_LATENCY_BUCKETS; b++) {
+        seen += cs->latency_buckets[b];
+        if (seen > target) {
+            uint64_t upper = 1ull << (b + 1);
+            return upper < cs->latency_max_ns ? upper : cs->latency_max_ns;
+        }
+    }
+    return cs->latency_max_ns;
+}
+
+void send_sched_print_stats(void) {
+    send_sched_stats_t st;
+    send_sched_get_stats(&st);
+    printf("Send scheduler (report interval %d ms): datagrams=%llu bytes=%llu",
+           st.periodic_interval_ms, (unsigned long long)st.datagrams,
+           (unsigned long long)st.bytes_sent);
+    if (st.bundles > 0) {
+        printf(" bundles=%llu (%.1f msgs/bundle)", (unsigned long long)st.bundles,
+               (double)st.bundled_msgs / (double)st.bundles);
+    }
+    printf("\n");
+    for (int c = 0; c < MSG_PRIO_COUNT; c++) {
+        const send_class_stats_t *cs = &st.cls[c];
+        double avg_us = cs->sent ? (double)cs->latency_total_ns / (double)cs->sent / 1000.0 : 0.0;
+        printf("  %-9s submitted=%llu sent=%llu dropped=%llu errors=%llu "
+               "latency avg=%.1fus p50<=%.1fus p99<=%.1fus max=%.1fus\n",
+               msg_priority_name((msg_priority_t)c),
+               (unsigned long long)cs->submitted, (unsigned long long)cs->sent,
+               (unsigned long long)cs->dropped, (unsigned long long)cs->send_errors,
+               avg_us,
+               (double)send_sched_latency_percentile(cs, 50.0) / 1000.0,
+               (double)send_sched_latency_percentile(cs, 99.0) / 1000.0,
+               (double)cs->latency_max_ns / 1000.0);
+    }
+}
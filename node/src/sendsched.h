@@ -0,0 +1,81 @@
+#ifndef SENDSCHED_H
+#define SENDSCHED_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "priority.h"
+
+// Priority send scheduler.
+//
+// Outgoing messages are queued per urgency class and transmitted by a single
+// scheduler thread, most urgent class first. Each class has a minimum gap
+// between transmissions (pacing) so a burst of routine traffic cannot starve
+// the channel. The scheduler thread sleeps on a condition variable rather than
+// a fixed sleep(), so submitting an urgent message wakes it immediately, and
+// the periodic report is driven from the same timed wait.
+//
+// With bundling enabled (bundle_mtu > 0), a class is not sent until its
+// queued messages fill a datagram of bundle_mtu bytes or its oldest message
+// has waited bundle_window_ms. The datagram is then packed with that class
+// and any other class whose pacing gap has elapsed, most urgent first, in the
+// bundle.h format. A bundle holding a single message goes out as a plain
+// datagram.
+
+#define SEND_MSG_MAX 2048
+#define SEND_QUEUE_DEFAULT_CAPACITY 256
+#define SEND_LATENCY_BUCKETS 40   // log2(ns) buckets, up to ~18 minutes
+#define SEND_BUNDLE_MAX_RECORDS 64
+
+typedef struct {
+    size_t queue_capacity;              // per class
+    int min_gap_ms[MSG_PRIO_COUNT];     // pacing between sends of one class
+    size_t bundle_mtu;                  // max datagram size; 0 disables bundling
+    int bundle_window_ms[MSG_PRIO_COUNT];  // max wait for a bundle to fill
+} send_sched_config_t;
+
+typedef struct {
+    uint64_t submitted;
+    uint64_t sent;
+    uint64_t dropped;       // class queue full
+    uint64_t send_errors;
+    uint64_t latency_total_ns;
+    uint64_t latency_max_ns;
+    uint64_t latency_buckets[SEND_LATENCY_BUCKETS];
+} send_class_stats_t;
+
+typedef struct {
+    send_class_stats_t cls[MSG_PRIO_COUNT];
+    uint64_t datagrams;
+    uint64_t bundles;           // datagrams carrying more than one message
+    uint64_t bundled_msgs;      // messages carried in those
+    uint64_t bytes_sent;
+    int periodic_interval_ms;
+} send_sched_stats_t;
+
+// Called on the scheduler thread whenever the periodic interval elapses
+typedef void (*send_sched_periodic_fn)(void *arg);
+
+void send_sched_config_defaults(send_sched_config_t *cfg);
+int send_sched_init(const send_sched_config_t *cfg, int sockfd, const char *peer_ip, int peer_port);
+void send_sched_cleanup(void);
+
+// Queue a NUL-terminated payload; returns 0 if queued, -1 if dropped
+int send_sched_submit(msg_priority_t prio, const char *payload);
+
+// Install (or replace) the periodic callback; interval_ms <= 0 disables it
+void send_sched_set_periodic(int interval_ms, send_sched_periodic_fn fn, void *arg);
+
+// Change the periodic interval without replacing the callback
+void send_sched_set_interval(int interval_ms);
+
+// Transmit loop; returns after send_sched_shutdown()
+void send_sched_run(void);
+void send_sched_shutdown(void);
+
+void send_sched_get_stats(send_sched_stats_t *out);
+
+// Approximate latency percentile (0-100) for a class, in nanoseconds
+uint64_t send_sched_latency_percentile(const send_class_stats_t *cs, double pct);
+void send_sched_print_stats(void);
+
+#endif // SENDSCHED_H
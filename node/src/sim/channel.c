@@ -0,0 +1,155 @@
+#include "channel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define CHANNEL_FADE_START 0.8      // fraction of range where edge loss starts to apply
+
+typedef struct {
+    channel_config_t cfg;
+    int nodes;
+    int cells_per_side;
+    double cell_m;
+    int *cell_head;             // first node in each cell, -1 if empty
+    int *next;                  // next node in the same cell
+    uint64_t candidates;        // in range
+    uint64_t delivered;
+    uint64_t lost;
+} channel_t;
+
+static int cell_of(const channel_t *ch, double v) {
+    int c = (int)(v / ch->cell_m);
+    if (c < 0) {
+        return 0;
+    }
+    return c >= ch->cells_per_side ? ch->cells_per_side - 1 : c;
+}
+
+static void channel_positions_changed(mesh_transport_t *t, mesh_sim_t *sim) {
+    channel_t *ch = (channel_t *)t->ctx;
+    size_t cells = (size_t)ch->cells_per_side * (size_t)ch->cells_per_side;
+    for (size_t c = 0; c < cells; c++) {
+        ch->cell_head[c] = -1;
+    }
+    for (int i = 0; i < ch->nodes; i++) {
+        const mesh_node_t *n = &sim->nodes[i];
+        size_t c = (size_t)cell_of(ch, n->y) * (size_t)ch->cells_per_side + (size_t)cell_of(ch, n->x);
+        ch->next[i] = ch->cell_head[c];
+        ch->cell_head[c] = i;
+    }
+}
+
+static double loss_at(const channel_t *ch, double d2) {
+    double fade = ch->cfg.range_m * CHANNEL_FADE_START;
+    if (ch->cfg.edge_loss <= ch->cfg.loss || d2 <= fade * fade) {
+        return ch->cfg.loss;
+    }
+    double f = (sqrt(d2) - fade) / (ch->cfg.range_m - fade);
+    return ch->cfg.loss + (ch->cfg.edge_loss - ch->cfg.loss) * f;
+}
+
+static void channel_broadcast(mesh_transport_t *t, mesh_sim_t *sim, mesh_msg_t *msg) {
+    channel_t *ch = (channel_t *)t->ctx;
+    const mesh_node_t *src = &sim->nodes[msg->src];
+    double r2 = ch->cfg.range_m * ch->cfg.range_m;
+    uint64_t airtime_ns = ch->cfg.bitrate_bps > 0.0
+        ? (uint64_t)((double)msg->len * 8.0 / ch->cfg.bitrate_bps * 1e9) : 0;
+    // Deliveries are scheduled relative to now; the message leaves when the
+    // sender has finished building it
+    uint64_t base_ns = msg->sent_ns - sim->now_ns + ch->cfg.delay_us * 1000ull + airtime_ns;
+
+    int cx = cell_of(ch, src->x), cy = cell_of(ch, src->y);
+    for (int y = cy - 1; y <= cy + 1; y++) {
+        if (y < 0 || y >= ch->cells_per_side) {
+            continue;
+        }
+        for (int x = cx - 1; x <= cx + 1; x++) {
+            if (x < 0 || x >= ch->cells_per_side) {
+                continue;
+            }
+            for (int j = ch->cell_head[y * ch->cells_per_side + x]; j >= 0; j = ch->next[j]) {
+                if (j == msg->src) {
+                    continue;
+                }
+                double dx = sim->nodes[j].x - src->x, dy = sim->nodes[j].y - src->y;
+                double d2 = dx * dx + dy * dy;
+                if (d2 > r2) {
+                    continue;
+                }
+                ch->candidates++;
+                if (mesh_random(sim) < loss_at(ch, d2)) {
+                    ch->lost++;
+                    continue;
+                }
+                uint64_t jitter = ch->cfg.jitter_us
+                    ? (uint64_t)(mesh_random(sim) * (double)ch->cfg.jitter_us * 1000.0) : 0;
+                mesh_deliver(sim, j, msg, base_ns + jitter);
+                ch->delivered++;
+            }
+        }
+    }
+}
+
+static void channel_print_stats(mesh_transport_t *t) {
+    const channel_t *ch = (const channel_t *)t->ctx;
+    printf("  channel: range %.0fm, %llu in range, %llu delivered, %llu lost (%.1f%%)\n",
+           ch->cfg.range_m, (unsigned long long)ch->candidates, (unsigned long long)ch->delivered,
+           (unsigned long long)ch->lost,
+           ch->candidates ? (double)ch->lost * 100.0 / (double)ch->candidates : 0.0);
+}
+
+static void channel_destroy(mesh_transport_t *t) {
+    channel_t *ch = (channel_t *)t->ctx;
+    if (ch) {
+        free(ch->cell_head);
+        free(ch->next);
+        free(ch);
+    }
+    free(t);
+}
+
+void channel_config_defaults(channel_config_t *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->range_m = 300.0;
+    cfg->loss = 0.02;
+    cfg->edge_loss = 0.3;
+    cfg->delay_us = 200;
+    cfg->jitter_us = 500;
+    cfg->bitrate_bps = 6e6;     // 802.11p default data rate
+}
+
+mesh_transport_t *channel_create(const channel_config_t *cfg, int nodes, double area_m) {
+    if (cfg->range_m <= 0.0 || nodes <= 0 || area_m <= 0.0) {
+        return NULL;
+    }
+    mesh_transport_t *t = (mesh_transport_t *)calloc(1, sizeof(mesh_transport_t));
+    channel_t *ch = (channel_t *)calloc(1, sizeof(channel_t));
+    if (!t || !ch) {
+        free(t);
+        free(ch);
+        return NULL;
+    }
+    ch->cfg = *cfg;
+    ch->nodes = nodes;
+    // Cells at least one range wide, so the 3x3 around a sender covers it
+    ch->cells_per_side = (int)(area_m / cfg->range_m);
+    if (ch->cells_per_side < 1) {
+        ch->cells_per_side = 1;
+    }
+    ch->cell_m = area_m / ch->cells_per_side;
+    ch->cell_head = (int *)malloc((size_t)ch->cells_per_side * (size_t)ch->cells_per_side * sizeof(int));
+    ch->next = (int *)malloc((size_t)nodes * sizeof(int));
+
+    t->name = "channel";
+    t->broadcast = channel_broadcast;
+    t->positions_changed = channel_positions_changed;
+    t->print_stats = channel_print_stats;
+    t->destroy = channel_destroy;
+    t->ctx = ch;
+    if (!ch->cell_head || !ch->next) {
+        channel_destroy(t);
+        return NULL;
+    }
+    return t;
+}
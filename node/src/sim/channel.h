@@ -0,0 +1,34 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include "mesh.h"
+
+// In-memory broadcast channel for the mesh simulator
+//
+// Every node within range_m of the sender receives a broadcast, except that
+// each delivery is lost independently with probability loss. Loss rises
+// linearly to edge_loss over the outer 20% of the range, as signal fades.
+// A delivery arrives after base delay + uniform jitter + airtime at
+// bitrate_bps. Neighbours are found through a uniform grid of range-sized
+// cells, rebuilt after each mobility step, so a broadcast only looks at the
+// 3x3 cells around the sender.
+
+typedef struct {
+    double range_m;
+    double loss;                // 0..1
+    double edge_loss;           // loss at the edge of range, >= loss
+    uint64_t delay_us;
+    uint64_t jitter_us;
+    double bitrate_bps;         // 0 = no airtime
+} channel_config_t;
+
+void channel_config_defaults(channel_config_t *cfg);
+
+/**
+ * Create the channel transport for a simulation of nodes vehicles in a
+ * square of side area_m.
+ * @return Transport, freed through its destroy hook, or NULL on error
+ */
+mesh_transport_t *channel_create(const channel_config_t *cfg, int nodes, double area_m);
+
+#endif // CHANNEL_H
@@ -0,0 +1,619 @@
+#include "mesh.h"
+#include "../jsonmsg.h"
+#include "../crypto.h"
+#include "../timeutil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MESH_AREA_LAT0 40.70        // south-west corner, roughly lower Manhattan
+#define MESH_AREA_LON0 -74.02
+#define MESH_M_PER_DEG 111320.0
+#define MESH_HAZARD_MATCH_DEG 1e-5  // reported coordinates are rounded by the JSON
+
+static const char *const k_hazard_types[] = {
+    "ice_patch", "debris", "road_block", "construction", "weather_hazard", "animal_crossing"
+};
+
+typedef enum {
+    EV_TX = 0,
+    EV_RX,
+    EV_MOVE,
+    EV_HAZARD,
+    EV_RELAY                    // contention delay of a relay has passed
+} mesh_event_type_t;
+
+typedef struct {
+    uint64_t t_ns;
+    uint64_t order;             // insertion order breaks ties, keeping runs deterministic
+    int type;
+    int node;                   // node, or hazard index for EV_HAZARD
+    mesh_msg_t *msg;
+} mesh_event_t;
+
+// Binary min-heap on (t_ns, order)
+typedef struct {
+    mesh_event_t *ev;
+    size_t count;
+    size_t cap;
+    uint64_t next_order;
+} mesh_queue_t;
+
+static int event_before(const mesh_event_t *a, const mesh_event_t *b) {
+    return a->t_ns < b->t_ns || (a->t_ns == b->t_ns && a->order < b->order);
+}
+
+static int queue_push(mesh_queue_t *q, uint64_t t_ns, int type, int node, mesh_msg_t *msg) {
+    if (q->count == q->cap) {
+        size_t cap = q->cap ? q->cap * 2 : 4096;
+        mesh_event_t *ev = (mesh_event_t *)realloc(q->ev, cap * sizeof(mesh_event_t));
+        if (!ev) {
+            return -1;
+        }
+        q->ev = ev;
+        q->cap = cap;
+    }
+    mesh_event_t e = { t_ns, q->next_order++, type, node, msg };
+    size_t i = q->count++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!event_before(&e, &q->ev[parent])) {
+            break;
+        }
+        q->ev[i] = q->ev[parent];
+        i = parent;
+    }
+    q->ev[i] = e;
+    return 0;
+}
+
+static int queue_pop(mesh_queue_t *q, mesh_event_t *out) {
+    if (q->count == 0) {
+        return 0;
+    }
+    *out = q->ev[0];
+    mesh_event_t last = q->ev[--q->count];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= q->count) {
+            break;
+        }
+        if (child + 1 < q->count && event_before(&q->ev[child + 1], &q->ev[child])) {
+            child++;
+        }
+        if (!event_before(&q->ev[child], &last)) {
+            break;
+        }
+        q->ev[i] = q->ev[child];
+        i = child;
+    }
+    if (q->count > 0) {
+        q->ev[i] = last;
+    }
+    return 1;
+}
+
+static void msg_release(mesh_msg_t *msg) {
+    if (msg && --msg->refs == 0) {
+        free(msg);
+    }
+}
+
+static uint64_t rng_next(uint64_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+double mesh_random(mesh_sim_t *sim) {
+    return (double)(rng_next(&sim->rng) >> 11) / (double)(1ull << 53);
+}
+
+static time_t sim_seconds(const mesh_sim_t *sim) {
+    return (time_t)(MESH_EPOCH_S + sim->now_ns / 1000000000ull);
+}
+
+static void xy_to_latlon(double x, double y, double *lat, double *lon) {
+    *lat = MESH_AREA_LAT0 + y / MESH_M_PER_DEG;
+    *lon = MESH_AREA_LON0 + x / (MESH_M_PER_DEG * cos(MESH_AREA_LAT0 * 3.14159265358979323846 / 180.0));
+}
+
+// Report interval with +-10% jitter so nodes do not transmit in lockstep
+static uint64_t next_report_ns(mesh_sim_t *sim) {
+    double ms = sim->cfg.report_interval_ms * (0.9 + 0.2 * mesh_random(sim));
+    return (uint64_t)(ms * 1e6);
+}
+
+void mesh_config_defaults(mesh_config_t *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->nodes = 1000;
+    cfg->area_m = 3000.0;
+    cfg->speed_mps = 15.0;
+    cfg->report_interval_ms = 3000;     // matches the node's default
+    cfg->move_interval_ms = 100;
+    cfg->duration_ms = 60000;
+    cfg->hazards = 4;
+    cfg->detect_m = 100.0;
+    cfg->cpu_scale = 1.0;
+    cfg->replay_capacity = 1024;
+    cfg->ratelimit_capacity = 256;
+    cfg->alerts_capacity = 64;
+    cfg->relay_mode = MESH_RELAY_OFF;
+    relay_config_defaults(&cfg->relay);
+    cfg->seed = 1;
+}
+
+int mesh_init(mesh_sim_t *sim, const mesh_config_t *cfg, mesh_transport_t *transport) {
+    memset(sim, 0, sizeof(*sim));
+    sim->cfg = *cfg;
+    sim->transport = transport;
+    sim->rng = cfg->seed * 0x9E3779B97F4A7C15ull + 1;
+    if (sim->cfg.hazards > MESH_MAX_HAZARDS) {
+        sim->cfg.hazards = MESH_MAX_HAZARDS;
+    }
+    if (sim->cfg.relay_mode == MESH_RELAY_FLOOD) {
+        // No scope, no hop limit worth the name and no contention
+        sim->cfg.relay.hop_limit = 255;
+        sim->cfg.relay.radius_m = 1e9;
+        sim->cfg.relay.max_delay_ms = 0;
+    }
+
+    mesh_queue_t *q = (mesh_queue_t *)calloc(1, sizeof(mesh_queue_t));
+    sim->nodes = (mesh_node_t *)calloc((size_t)cfg->nodes, sizeof(mesh_node_t));
+    sim->verified_ns = (uint64_t *)calloc((size_t)cfg->nodes * (size_t)(sim->cfg.hazards + 1),
+                                          sizeof(uint64_t));
+    sim->queue = q;
+    if (!q || !sim->nodes || !sim->verified_ns) {
+        fprintf(stderr, "mesh: out of memory for %d nodes\n", cfg->nodes);
+        return -1;
+    }
+
+    for (int i = 0; i < cfg->nodes; i++) {
+        mesh_node_t *n = &sim->nodes[i];
+        snprintf(n->id, sizeof(n->id), "sim%05d", i);
+        n->x = mesh_random(sim) * cfg->area_m;
+        n->y = mesh_random(sim) * cfg->area_m;
+        double heading = mesh_random(sim) * 2.0 * 3.14159265358979323846;
+        double speed = cfg->speed_mps * (0.5 + 0.5 * mesh_random(sim));
+        n->vx = speed * sin(heading);
+        n->vy = speed * cos(heading);
+        if (replay_cache_init_instance(&n->replay, cfg->replay_capacity) != 0 ||
+            ratelimit_init_instance(&n->ratelimit, cfg->ratelimit_capacity) != 0 ||
+            alerts_map_init_instance(&n->alerts, cfg->alerts_capacity, cfg->alerts_capacity * 2) != 0 ||
+            (cfg->relay_mode != MESH_RELAY_OFF &&
+             relay_filter_init(&n->relay_filter, cfg->relay.filter_bits, cfg->relay.filter_window_s) != 0)) {
+            fprintf(stderr, "mesh: cannot allocate state for node %d\n", i);
+            return -1;
+        }
+        // First reports spread over one interval
+        uint64_t first = (uint64_t)(mesh_random(sim) * cfg->report_interval_ms * 1e6);
+        if (queue_push(q, first, EV_TX, i, NULL) != 0) {
+            return -1;
+        }
+    }
+
+    for (int h = 0; h < sim->cfg.hazards; h++) {
+        mesh_hazard_t *hz = &sim->hazards[h];
+        hz->x = mesh_random(sim) * cfg->area_m;
+        hz->y = mesh_random(sim) * cfg->area_m;
+        xy_to_latlon(hz->x, hz->y, &hz->lat, &hz->lon);
+        hz->type = k_hazard_types[h % (sizeof(k_hazard_types) / sizeof(k_hazard_types[0]))];
+        hz->start_ns = (uint64_t)(mesh_random(sim) * (double)cfg->duration_ms * 0.5 * 1e6);
+        if (queue_push(q, hz->start_ns, EV_HAZARD, h, NULL) != 0) {
+            return -1;
+        }
+    }
+
+    if (cfg->speed_mps > 0.0 && cfg->move_interval_ms > 0 &&
+        queue_push(q, (uint64_t)cfg->move_interval_ms * 1000000ull, EV_MOVE, -1, NULL) != 0) {
+        return -1;
+    }
+    if (transport->positions_changed) {
+        transport->positions_changed(transport, sim);
+    }
+    return 0;
+}
+
+void mesh_deliver(mesh_sim_t *sim, int dst, mesh_msg_t *msg, uint64_t delay_ns) {
+    msg->refs++;
+    if (queue_push((mesh_queue_t *)sim->queue, sim->now_ns + delay_ns, EV_RX, dst, msg) != 0) {
+        msg->refs--;
+    }
+}
+
+// Sim time the work started at t and measured at cost_ns ends; the node is
+// a single server, so work queues behind whatever it is already doing
+static uint64_t occupy_node(mesh_sim_t *sim, mesh_node_t *n, uint64_t cost_ns) {
+    uint64_t start = sim->now_ns > n->busy_until_ns ? sim->now_ns : n->busy_until_ns;
+    n->busy_until_ns = start + (uint64_t)((double)cost_ns * sim->cfg.cpu_scale);
+    return n->busy_until_ns;
+}
+
+static int find_hazard(const mesh_sim_t *sim, const hazard_report_t *r) {
+    for (int h = 0; h < sim->cfg.hazards; h++) {
+        const mesh_hazard_t *hz = &sim->hazards[h];
+        if (strcmp(hz->type, r->hazard_type) == 0 &&
+            fabs(hz->lat - r->lat) < MESH_HAZARD_MATCH_DEG &&
+            fabs(hz->lon - r->lon) < MESH_HAZARD_MATCH_DEG) {
+            return h;
+        }
+    }
+    return -1;
+}
+
+static void node_transmit(mesh_sim_t *sim, int idx) {
+    mesh_node_t *n = &sim->nodes[idx];
+    time_t now_s = sim_seconds(sim);
+    uint64_t t0 = monotonic_ns();
+
+    // Housekeeping rides on the report tick, as in emit_hazard_report()
+    alerts_map_expire_at(&n->alerts, now_s);
+
+    const mesh_hazard_t *seen = NULL;
+    for (int h = 0; h < sim->cfg.hazards; h++) {
+        const mesh_hazard_t *hz = &sim->hazards[h];
+        double dx = hz->x - n->x, dy = hz->y - n->y;
+        if (hz->active && dx * dx + dy * dy <= sim->cfg.detect_m * sim->cfg.detect_m) {
+            seen = hz;
+            break;
+        }
+    }
+
+    double lat, lon;
+    xy_to_latlon(n->x, n->y, &lat, &lon);
+    double speed = sqrt(n->vx * n->vx + n->vy * n->vy);
+    double heading = fmod(atan2(n->vx, n->vy) * 180.0 / 3.14159265358979323846 + 360.0, 360.0);
+
+    mesh_msg_t *msg = (mesh_msg_t *)malloc(sizeof(mesh_msg_t) + MESH_MSG_MAX);
+    if (!msg) {
+        return;
+    }
+    char json[MESH_MSG_MAX];
+    int len;
+    if (seen) {
+        len = format_canonical_hazard_json(json, sizeof(json), "hazard_report", n->id, ++n->seq,
+                                           (uint64_t)now_s, seen->lat, seen->lon, speed * 3.6, heading,
+                                           seen->type, 0.9, 300);
+    } else {
+        len = format_canonical_hazard_json(json, sizeof(json), "beacon", n->id, ++n->seq,
+                                           (uint64_t)now_s, lat, lon, speed * 3.6, heading,
+                                           "none", 0.5, 300);
+    }
+    unsigned char *sig = NULL;
+    size_t sig_len = 0;
+    if (len > 0 && sign_message("node_priv.pem", json, &sig, &sig_len) == 0) {
+        free(sig);
+    }
+    if (len > 0 && sim->cfg.relay_mode != MESH_RELAY_OFF) {
+        // As relay_wrap_origin() does for the node
+        relay_header_t hdr = { 0, sim->cfg.relay.hop_limit, sim->cfg.relay.radius_m, lat, lon };
+        len = relay_format(msg->data, MESH_MSG_MAX, &hdr, json, (size_t)len);
+        relay_filter_test_and_add(&n->relay_filter, relay_key(n->id, n->seq), sim->now_ns);
+    } else if (len > 0) {
+        memcpy(msg->data, json, (size_t)len + 1);
+    }
+    uint64_t cost = monotonic_ns() - t0;
+    n->cpu_ns += cost;
+    sim->stats.tx_cpu_ns += cost;
+    if (len < 0) {
+        free(msg);
+        return;
+    }
+
+    msg->refs = 1;
+    msg->src = idx;
+    msg->len = (size_t)len;
+    msg->sent_ns = occupy_node(sim, n, cost);
+    n->tx++;
+    sim->stats.tx++;
+    sim->transport->broadcast(sim->transport, sim, msg);
+    msg_release(msg);
+}
+
+// Drop a scheduled relay; returns 1 if one was pending
+static int relay_cancel(mesh_node_t *n, uint64_t key) {
+    for (int i = 0; i < n->relay_pending_count; i++) {
+        if (n->relay_pending[i] == key) {
+            n->relay_pending[i] = n->relay_pending[--n->relay_pending_count];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void relay_schedule(mesh_sim_t *sim, int idx, const relay_header_t *hdr,
+                           const hazard_report_t *report, const char *inner, uint64_t done_ns) {
+    mesh_node_t *n = &sim->nodes[idx];
+    double lat, lon;
+    xy_to_latlon(n->x, n->y, &lat, &lon);
+    relay_header_t out;
+    uint64_t delay_ns = 0;
+    relay_verdict_t v = relay_decide(&sim->cfg.relay, &n->relay_filter, lat, lon, hdr, report,
+                                     mesh_random(sim), sim->now_ns, &delay_ns, &out);
+    sim->stats.relay_verdicts[v]++;
+    if (v != RELAY_SCHEDULE) {
+        return;
+    }
+    mesh_msg_t *msg = (mesh_msg_t *)malloc(sizeof(mesh_msg_t) + MESH_MSG_MAX);
+    int len = msg ? relay_format(msg->data, MESH_MSG_MAX, &out, inner, strlen(inner)) : -1;
+    if (len < 0 || n->relay_pending_count == MESH_RELAY_PENDING) {
+        free(msg);
+        sim->stats.relay_dropped++;
+        return;
+    }
+    msg->refs = 1;
+    msg->src = idx;
+    msg->len = (size_t)len;
+    if (queue_push((mesh_queue_t *)sim->queue, done_ns + delay_ns, EV_RELAY, idx, msg) != 0) {
+        free(msg);
+        return;
+    }
+    n->relay_pending[n->relay_pending_count++] = relay_key(report->ephemeral_id, report->seq);
+}
+
+static void relay_fire(mesh_sim_t *sim, int idx, mesh_msg_t *msg) {
+    mesh_node_t *n = &sim->nodes[idx];
+    relay_header_t hdr;
+    const char *inner;
+    char ephemeral_id[64] = {0};
+    uint64_t seq = 0;
+    if (relay_parse(msg->data, msg->len, &hdr, &inner) != 1 ||
+        !parse_json_fields(inner, ephemeral_id, &seq) ||
+        !relay_cancel(n, relay_key(ephemeral_id, seq))) {
+        return;     // suppressed while waiting
+    }
+    msg->sent_ns = sim->now_ns > n->busy_until_ns ? sim->now_ns : n->busy_until_ns;
+    n->tx++;
+    sim->stats.tx++;
+    sim->stats.relay_tx++;
+    sim->transport->broadcast(sim->transport, sim, msg);
+}
+
+// Same checks, in the same order, as process_message() in main.c
+static void node_receive(mesh_sim_t *sim, int idx, mesh_msg_t *msg) {
+    mesh_node_t *n = &sim->nodes[idx];
+    time_t now_s = sim_seconds(sim);
+    int reject = -1;
+    int hazard = -1;
+    int relay_candidate = 0;
+    uint64_t t0 = monotonic_ns();
+
+    relay_header_t relay_hdr;
+    const char *inner;
+    int relayed = relay_parse(msg->data, msg->len, &relay_hdr, &inner);
+    char ephemeral_id[64] = {0};
+    uint64_t seq = 0;
+    hazard_report_t report;
+    int parsed = relayed >= 0 && parse_json_fields(inner, ephemeral_id, &seq);
+    if (parsed && sim->cfg.relay_mode == MESH_RELAY_GEO && relay_cancel(n, relay_key(ephemeral_id, seq))) {
+        sim->stats.relay_suppressed++;
+    }
+    if (!parsed) {
+        reject = REJECT_MALFORMED;
+    } else if (!replay_cache_check_at(&n->replay, ephemeral_id, seq, now_s)) {
+        reject = REJECT_REPLAY;
+    } else if (!ratelimit_allow_at(&n->ratelimit, ephemeral_id, now_s)) {
+        reject = REJECT_RATE_LIMITED;
+    } else {
+        int verify_result = verify_message("peer_pub.pem", inner, NULL, 0);
+        if (verify_result != 0) {
+            reject = REJECT_BAD_SIGNATURE;
+        } else if (!parse_hazard_report(inner, &report)) {
+            reject = REJECT_INCOMPLETE;
+        } else {
+            relay_candidate = 1;
+            if (report.has_location && report.hazard_type[0] != '\0' &&
+                strcmp(report.msg_type, "hazard_report") == 0 &&
+                alerts_map_add_at(&n->alerts, report.ephemeral_id, report.hazard_type,
+                                  report.lat, report.lon, report.confidence, now_s)) {
+                hazard = find_hazard(sim, &report);
+            }
+        }
+    }
+
+    uint64_t cost = monotonic_ns() - t0;
+    uint64_t done = occupy_node(sim, n, cost);
+    n->cpu_ns += cost;
+    n->rx++;
+    sim->stats.rx_cpu_ns += cost;
+    sim->stats.deliveries++;
+    stage_hist_add(&sim->stats.delivery, done - msg->sent_ns);
+    if (reject >= 0) {
+        sim->stats.rejects[reject]++;
+        return;
+    }
+    n->accepted++;
+    sim->stats.accepted++;
+    if (relay_candidate && sim->cfg.relay_mode != MESH_RELAY_OFF) {
+        relay_schedule(sim, idx, relayed == 1 ? &relay_hdr : NULL, &report, inner, done);
+    }
+
+    if (hazard >= 0) {
+        uint64_t *slot = &sim->verified_ns[(size_t)idx * (size_t)sim->cfg.hazards + (size_t)hazard];
+        if (*slot == 0) {
+            *slot = done;
+            stage_hist_add(&sim->stats.verify, done - sim->hazards[hazard].start_ns);
+        }
+    }
+}
+
+static void move_nodes(mesh_sim_t *sim) {
+    double dt = sim->cfg.move_interval_ms / 1000.0;
+    double side = sim->cfg.area_m;
+    for (int i = 0; i < sim->cfg.nodes; i++) {
+        mesh_node_t *n = &sim->nodes[i];
+        n->x += n->vx * dt;
+        n->y += n->vy * dt;
+        // Bounce off the area's edges
+        if (n->x < 0.0 || n->x > side) {
+            n->vx = -n->vx;
+            n->x = n->x < 0.0 ? -n->x : 2.0 * side - n->x;
+        }
+        if (n->y < 0.0 || n->y > side) {
+            n->vy = -n->vy;
+            n->y = n->y < 0.0 ? -n->y : 2.0 * side - n->y;
+        }
+    }
+    if (sim->transport->positions_changed) {
+        sim->transport->positions_changed(sim->transport, sim);
+    }
+}
+
+void mesh_run(mesh_sim_t *sim) {
+    mesh_queue_t *q = (mesh_queue_t *)sim->queue;
+    uint64_t end_ns = sim->cfg.duration_ms * 1000000ull;
+    mesh_event_t e;
+    while (queue_pop(q, &e)) {
+        if (e.t_ns > end_ns) {
+            msg_release(e.msg);
+            continue;
+        }
+        sim->now_ns = e.t_ns;
+        sim->stats.events++;
+        switch (e.type) {
+        case EV_TX:
+            node_transmit(sim, e.node);
+            queue_push(q, e.t_ns + next_report_ns(sim), EV_TX, e.node, NULL);
+            break;
+        case EV_RX:
+            node_receive(sim, e.node, e.msg);
+            msg_release(e.msg);
+            break;
+        case EV_MOVE:
+            move_nodes(sim);
+            queue_push(q, e.t_ns + (uint64_t)sim->cfg.move_interval_ms * 1000000ull, EV_MOVE, -1, NULL);
+            break;
+        case EV_HAZARD:
+            sim->hazards[e.node].active = 1;
+            break;
+        case EV_RELAY:
+            relay_fire(sim, e.node, e.msg);
+            msg_release(e.msg);
+            break;
+        }
+    }
+    sim->now_ns = end_ns;
+}
+
+void mesh_destroy(mesh_sim_t *sim) {
+    mesh_queue_t *q = (mesh_queue_t *)sim->queue;
+    if (q) {
+        mesh_event_t e;
+        while (queue_pop(q, &e)) {
+            msg_release(e.msg);
+        }
+        free(q->ev);
+        free(q);
+    }
+    if (sim->nodes) {
+        for (int i = 0; i < sim->cfg.nodes; i++) {
+            mesh_node_t *n = &sim->nodes[i];
+            if (n->replay.pool.slab) {
+                replay_cache_destroy_instance(&n->replay);
+            }
+            if (n->ratelimit.pool.slab) {
+                ratelimit_destroy_instance(&n->ratelimit);
+            }
+            if (n->alerts.buckets) {
+                alerts_map_destroy_instance(&n->alerts);
+            }
+            if (n->relay_filter.bits[0]) {
+                relay_filter_destroy(&n->relay_filter);
+            }
+        }
+    }
+    if (sim->transport && sim->transport->destroy) {
+        sim->transport->destroy(sim->transport);
+    }
+    free(sim->verified_ns);
+    free(sim->nodes);
+    memset(sim, 0, sizeof(*sim));
+}
+
+static void print_hist(const char *label, const stage_hist_t *h) {
+    if (h->count == 0) {
+        printf("  %-16s none\n", label);
+        return;
+    }
+    printf("  %-16s count=%llu avg=%.2fms p50<=%.2fms p90<=%.2fms p99<=%.2fms max=%.2fms\n",
+           label, (unsigned long long)h->count, (double)h->sum_ns / (double)h->count / 1e6,
+           (double)stage_hist_quantile(h, 0.50) / 1e6, (double)stage_hist_quantile(h, 0.90) / 1e6,
+           (double)stage_hist_quantile(h, 0.99) / 1e6, (double)h->max_ns / 1e6);
+}
+
+void mesh_print_stats(const mesh_sim_t *sim, double wall_s) {
+    const mesh_stats_t *st = &sim->stats;
+    double sim_s = (double)sim->now_ns / 1e9;
+    int nodes = sim->cfg.nodes;
+
+    printf("Mesh: %d nodes, %.1fs simulated in %.2fs wall (%.1fx real time), %llu events\n",
+           nodes, sim_s, wall_s, wall_s > 0.0 ? sim_s / wall_s : 0.0,
+           (unsigned long long)st->events);
+    printf("  traffic: %llu broadcasts, %llu deliveries (%.1f per broadcast), %llu accepted\n",
+           (unsigned long long)st->tx, (unsigned long long)st->deliveries,
+           st->tx ? (double)st->deliveries / (double)st->tx : 0.0, (unsigned long long)st->accepted);
+    printf("  rejects:");
+    for (int r = 0; r < REJECT_COUNT; r++) {
+        printf(" %s=%llu", reject_reason_name((reject_reason_t)r), (unsigned long long)st->rejects[r]);
+    }
+    printf("\n");
+    if (sim->cfg.relay_mode != MESH_RELAY_OFF) {
+        printf("  relay (%s): %llu relayed broadcasts (%.1f%% of tx), %llu suppressed, %llu dropped,",
+               sim->cfg.relay_mode == MESH_RELAY_FLOOD ? "flood" : "geo",
+               (unsigned long long)st->relay_tx, st->tx ? (double)st->relay_tx * 100.0 / (double)st->tx : 0.0,
+               (unsigned long long)st->relay_suppressed, (unsigned long long)st->relay_dropped);
+        for (int v = 0; v < RELAY_VERDICT_COUNT; v++) {
+            printf(" %s=%llu", relay_verdict_name((relay_verdict_t)v), (unsigned long long)st->relay_verdicts[v]);
+        }
+        printf("\n");
+    }
+    if (sim->transport->print_stats) {
+        sim->transport->print_stats(sim->transport);
+    }
+
+    // Per-node CPU is measured, so it reflects this build of the node modules
+    uint64_t max_cpu = 0;
+    int max_node = 0;
+    for (int i = 0; i < nodes; i++) {
+        if (sim->nodes[i].cpu_ns > max_cpu) {
+            max_cpu = sim->nodes[i].cpu_ns;
+            max_node = i;
+        }
+    }
+    double total_cpu = (double)(st->rx_cpu_ns + st->tx_cpu_ns);
+    printf("  cpu: %.3fs total, per node avg %.2fms (%.4f%% of one core), max %.2fms (%s)\n",
+           total_cpu / 1e9, total_cpu / nodes / 1e6,
+           sim_s > 0.0 ? total_cpu / nodes / (sim_s * 1e9) * 100.0 : 0.0,
+           (double)max_cpu / 1e6, sim->nodes[max_node].id);
+    printf("  cpu per message: receive %.2fus, transmit %.2fus\n",
+           st->deliveries ? (double)st->rx_cpu_ns / (double)st->deliveries / 1e3 : 0.0,
+           st->tx ? (double)st->tx_cpu_ns / (double)st->tx / 1e3 : 0.0);
+    print_hist("delivery", &st->delivery);
+    print_hist("hazard->verified", &st->verify);
+
+    for (int h = 0; h < sim->cfg.hazards; h++) {
+        const mesh_hazard_t *hz = &sim->hazards[h];
+        int verified = 0, nearby = 0;
+        uint64_t first = 0;
+        for (int i = 0; i < nodes; i++) {
+            uint64_t t = sim->verified_ns[(size_t)i * (size_t)sim->cfg.hazards + (size_t)h];
+            if (t) {
+                verified++;
+                if (first == 0 || t < first) {
+                    first = t;
+                }
+            }
+            double dx = hz->x - sim->nodes[i].x, dy = hz->y - sim->nodes[i].y;
+            if (dx * dx + dy * dy <= sim->cfg.detect_m * sim->cfg.detect_m) {
+                nearby++;
+            }
+        }
+        printf("  hazard %d %-15s at t=%.1fs: verified by %d nodes, first after %.2fs, "
+               "%d vehicles within %.0fm at end\n",
+               h, hz->type, (double)hz->start_ns / 1e9, verified,
+               first ? (double)(first - hz->start_ns) / 1e9 : 0.0, nearby, sim->cfg.detect_m);
+    }
+}
@@ -0,0 +1,165 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../replay.h"
+#include "../ratelimit.h"
+#include "../stagestats.h"
+#include "../core/alerts.h"
+#include "../relay.h"
+
+// In-process mesh simulation
+//
+// Runs hundreds to thousands of virtual nodes in one process on a
+// discrete-event clock. Each node has its own replay cache, rate limiter and
+// alert map (the real modules, through their *_instance APIs) and runs the
+// same receive checks as process_message() in main.c, timed with the real
+// clock so per-node CPU cost is measured rather than modelled.
+//
+// Vehicles drive in a square area and broadcast a report every
+// report_interval_ms: a hazard_report for any hazard within detect_m, else a
+// beacon. Hazards appear during the run; a node's time to a VERIFIED alert
+// for a hazard is its propagation latency.
+//
+// Who hears a broadcast, and when, is up to the transport (mesh_transport_t),
+// so channel models can be swapped without touching the node logic.
+//
+// With relaying on, nodes forward hazard reports as relay.h describes;
+// MESH_RELAY_FLOOD instead rebroadcasts every new report at once, as a
+// baseline for the channel load that geo-scoped relaying saves.
+//
+// Sim time is in nanoseconds from 0. Node modules that count in seconds see
+// MESH_EPOCH_S plus sim time.
+
+#define MESH_ID_MAX 32
+#define MESH_MSG_MAX 1024
+#define MESH_EPOCH_S 1700000000
+#define MESH_MAX_HAZARDS 64
+#define MESH_RELAY_PENDING 16       // per node
+
+typedef enum {
+    MESH_RELAY_OFF = 0,
+    MESH_RELAY_GEO,             // relay.h rules
+    MESH_RELAY_FLOOD            // every node relays every new report once
+} mesh_relay_mode_t;
+
+typedef struct mesh_sim mesh_sim_t;
+
+// One broadcast, shared by all its pending deliveries
+typedef struct mesh_msg {
+    int refs;
+    int src;
+    uint64_t sent_ns;
+    size_t len;
+    char data[];                // NUL-terminated
+} mesh_msg_t;
+
+// Channel model. broadcast() calls mesh_deliver() once per receiver;
+// positions_changed() runs after every mobility step and once at start.
+typedef struct mesh_transport {
+    const char *name;
+    void (*broadcast)(struct mesh_transport *t, mesh_sim_t *sim, mesh_msg_t *msg);
+    void (*positions_changed)(struct mesh_transport *t, mesh_sim_t *sim);
+    void (*print_stats)(struct mesh_transport *t);
+    void (*destroy)(struct mesh_transport *t);
+    void *ctx;
+} mesh_transport_t;
+
+typedef struct {
+    int nodes;
+    double area_m;              // side of the square the vehicles drive in
+    double speed_mps;           // top speed; 0 keeps vehicles parked
+    int report_interval_ms;
+    int move_interval_ms;       // mobility step
+    uint64_t duration_ms;
+    int hazards;                // appear at random times in the first half of the run
+    double detect_m;            // vehicles this close to a hazard report it
+    double cpu_scale;           // measured processing time occupies the node, scaled; 0 = free
+    size_t replay_capacity;     // per node
+    size_t ratelimit_capacity;
+    size_t alerts_capacity;
+    mesh_relay_mode_t relay_mode;
+    relay_config_t relay;
+    uint64_t seed;
+} mesh_config_t;
+
+typedef struct {
+    char id[MESH_ID_MAX];
+    uint64_t seq;
+    double x, y;                // metres from the area's south-west corner
+    double vx, vy;
+    uint64_t busy_until_ns;     // sim time the node finishes its current work
+    replay_cache_t replay;
+    rate_limiter_t ratelimit;
+    alerts_map_t alerts;
+    relay_filter_t relay_filter;
+    uint64_t relay_pending[MESH_RELAY_PENDING];   // relay_key() of scheduled relays
+    int relay_pending_count;
+    uint64_t cpu_ns;            // measured, receive and transmit
+    uint64_t tx;
+    uint64_t rx;
+    uint64_t accepted;
+} mesh_node_t;
+
+typedef struct {
+    double x, y;
+    double lat, lon;            // as reported, so reports of it share an alert key
+    const char *type;
+    uint64_t start_ns;
+    int active;
+} mesh_hazard_t;
+
+typedef struct {
+    uint64_t events;
+    uint64_t tx;
+    uint64_t deliveries;
+    uint64_t accepted;
+    uint64_t rejects[REJECT_COUNT];
+    uint64_t relay_verdicts[RELAY_VERDICT_COUNT];
+    uint64_t relay_tx;          // relayed broadcasts, included in tx
+    uint64_t relay_suppressed;
+    uint64_t relay_dropped;     // pending list full
+    uint64_t rx_cpu_ns;
+    uint64_t tx_cpu_ns;
+    stage_hist_t delivery;      // broadcast to end of processing at the receiver
+    stage_hist_t verify;        // hazard appearance to VERIFIED alert, per node
+} mesh_stats_t;
+
+struct mesh_sim {
+    mesh_config_t cfg;
+    mesh_transport_t *transport;
+    mesh_node_t *nodes;
+    mesh_hazard_t hazards[MESH_MAX_HAZARDS];
+    uint64_t *verified_ns;      // [node * hazards + h], 0 = not yet
+    uint64_t now_ns;
+    uint64_t rng;
+    void *queue;
+    mesh_stats_t stats;
+};
+
+void mesh_config_defaults(mesh_config_t *cfg);
+
+/**
+ * Create the nodes and schedule their first reports and the hazards.
+ * @param transport Channel model; owned by the simulation from here on
+ * @return 0 on success, -1 on error
+ */
+int mesh_init(mesh_sim_t *sim, const mesh_config_t *cfg, mesh_transport_t *transport);
+
+// Run until cfg.duration_ms of sim time has passed
+void mesh_run(mesh_sim_t *sim);
+
+void mesh_destroy(mesh_sim_t *sim);
+
+/**
+ * Schedule msg to arrive at node dst after delay_ns. For transports only.
+ */
+void mesh_deliver(mesh_sim_t *sim, int dst, mesh_msg_t *msg, uint64_t delay_ns);
+
+// Uniform in [0, 1) from the simulation's seeded generator
+double mesh_random(mesh_sim_t *sim);
+
+void mesh_print_stats(const mesh_sim_t *sim, double wall_s);
+
+#endif // MESH_H
@@ -0,0 +1,259 @@
+#include "stagestats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// One thread's counters; only the owning thread writes them
+typedef struct stage_block {
+    stage_stats_t stats;
+    struct stage_block *next;
+} stage_block_t;
+
+static stage_block_t *g_blocks = NULL;
+static int g_initialized = 0;
+static __thread stage_block_t *t_block = NULL;
+#ifdef _WIN32
+static CRITICAL_SECTION g_blocks_mutex;
+#else
+static pthread_mutex_t g_blocks_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static const char *const k_stage_names[STAGE_COUNT] = {
+    "queue", "parse", "replay", "ratelimit", "verify", "neighbor", "alert", "total"
+};
+
+static const char *const k_reject_names[REJECT_COUNT] = {
+    "malformed", "replay", "rate_limited", "bad_signature", "incomplete"
+};
+
+static const stage_t k_reject_stages[REJECT_COUNT] = {
+    STAGE_PARSE, STAGE_REPLAY, STAGE_RATELIMIT, STAGE_VERIFY, STAGE_NEIGHBOR
+};
+
+// Relaxed atomics: a plain load/store on the platforms we build for, but a
+// concurrent snapshot never sees a torn counter
+static inline void counter_add(uint64_t *p, uint64_t v) {
+    __atomic_store_n(p, __atomic_load_n(p, __ATOMIC_RELAXED) + v, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t counter_get(const uint64_t *p) {
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+static int bucket_index(uint64_t v) {
+    if (v < STAGE_HIST_SUB) {
+        return (int)v;
+    }
+    int msb = 63 - __builtin_clzll(v);
+    int octave = msb - STAGE_HIST_SUB_BITS + 1;
+    if (octave > STAGE_HIST_OCTAVES) {
+        return STAGE_HIST_BUCKETS - 1;
+    }
+    int sub = (int)((v >> (msb - STAGE_HIST_SUB_BITS)) & (STAGE_HIST_SUB - 1));
+    return octave * STAGE_HIST_SUB + sub;
+}
+
+// Largest value that lands in bucket b
+static uint64_t bucket_upper(int b) {
+    if (b < STAGE_HIST_SUB) {
+        return (uint64_t)b;
+    }
+    int octave = b / STAGE_HIST_SUB;
+    int sub = b % STAGE_HIST_SUB;
+    int shift = octave - 1;
+    uint64_t lower = (uint64_t)(STAGE_HIST_SUB + sub) << shift;
+    return lower + ((1ull << shift) - 1);
+}
+
+static stage_block_t *thread_block(void) {
+    if (t_block != NULL) {
+        return t_block;
+    }
+    stage_block_t *b = (stage_block_t *)calloc(1, sizeof(stage_block_t));
+    if (!b) {
+        return NULL;
+    }
+    b->stats.threads = 1;
+#ifdef _WIN32
+    if (!g_initialized) {
+        free(b);
+        return NULL;
+    }
+    EnterCriticalSection(&g_blocks_mutex);
+#else
+    pthread_mutex_lock(&g_blocks_mutex);
+#endif
+    b->next = g_blocks;
+    g_blocks = b;
+#ifdef _WIN32
+    LeaveCriticalSection(&g_blocks_mutex);
+#else
+    pthread_mutex_unlock(&g_blocks_mutex);
+#endif
+    t_block = b;
+    return b;
+}
+
+int stage_stats_init(void) {
+    if (g_initialized) {
+        return 0;
+    }
+#ifdef _WIN32
+    InitializeCriticalSection(&g_blocks_mutex);
+#endif
+    g_initialized = 1;
+    return 0;
+}
+
+void stage_stats_cleanup(void) {
+    // Threads that recorded must have exited; their blocks are freed here
+    stage_block_t *b = g_blocks;
+    while (b) {
+        stage_block_t *next = b->next;
+        free(b);
+        b = next;
+    }
+    g_blocks = NULL;
+    t_block = NULL;
+#ifdef _WIN32
+    if (g_initialized) {
+        DeleteCriticalSection(&g_blocks_mutex);
+    }
+#endif
+    g_initialized = 0;
+}
+
+void stage_record(stage_t stage, uint64_t ns) {
+    stage_block_t *b = thread_block();
+    if (!b || stage >= STAGE_COUNT) {
+        return;
+    }
+    stage_hist_t *h = &b->stats.stage[stage];
+    counter_add(&h->buckets[bucket_index(ns)], 1);
+    counter_add(&h->count, 1);
+    counter_add(&h->sum_ns, ns);
+    if (ns > h->max_ns) {
+        __atomic_store_n(&h->max_ns, ns, __ATOMIC_RELAXED);
+    }
+}
+
+void stage_hist_add(stage_hist_t *h, uint64_t ns) {
+    h->buckets[bucket_index(ns)]++;
+    h->count++;
+    h->sum_ns += ns;
+    if (ns > h->max_ns) {
+        h->max_ns = ns;
+    }
+}
+
+void stage_reject(reject_reason_t reason) {
+    stage_block_t *b = thread_block();
+    if (!b || reason >= REJECT_COUNT) {
+        return;
+    }
+    counter_add(&b->stats.rejects[reason], 1);
+}
+
+void stage_stats_snapshot(stage_stats_t *out) {
+    if (!out) {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+#ifdef _WIN32
+    if (!g_initialized) {
+        return;
+    }
+    EnterCriticalSection(&g_blocks_mutex);
+#else
+    pthread_mutex_lock(&g_blocks_mutex);
+#endif
+    for (const stage_block_t *b = g_blocks; b; b = b->next) {
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            const stage_hist_t *src = &b->stats.stage[s];
+            stage_hist_t *dst = &out->stage[s];
+            for (int i = 0; i < STAGE_HIST_BUCKETS; i++) {
+                dst->buckets[i] += counter_get(&src->buckets[i]);
+            }
+            dst->count += counter_get(&src->count);
+            dst->sum_ns += counter_get(&src->sum_ns);
+            uint64_t max = counter_get(&src->max_ns);
+            if (max > dst->max_ns) {
+                dst->max_ns = max;
+            }
+        }
+        for (int r = 0; r < REJECT_COUNT; r++) {
+            out->rejects[r] += counter_get(&b->stats.rejects[r]);
+        }
+        out->threads++;
+    }
+#ifdef _WIN32
+    LeaveCriticalSection(&g_blocks_mutex);
+#else
+    pthread_mutex_unlock(&g_blocks_mutex);
+#endif
+}
+
+uint64_t stage_hist_quantile(const stage_hist_t *h, double q) {
+    // Bucket counts are read one at a time, so use their sum rather than count
+    uint64_t total = 0;
+    for (int i = 0; i < STAGE_HIST_BUCKETS; i++) {
+        total += h->buckets[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(q * (double)total);
+    if (rank >= total) {
+        rank = total - 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < STAGE_HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen > rank) {
+            uint64_t upper = bucket_upper(i);
+            return upper < h->max_ns ? upper : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
+
+const char *stage_name(stage_t stage) {
+    return stage < STAGE_COUNT ? k_stage_names[stage] : "unknown";
+}
+
+const char *reject_reason_name(reject_reason_t reason) {
+    return reason < REJECT_COUNT ? k_reject_names[reason] : "unknown";
+}
+
+stage_t reject_reason_stage(reject_reason_t reason) {
+    return reason < REJECT_COUNT ? k_reject_stages[reason] : STAGE_TOTAL;
+}
+
+void stage_stats_print(void) {
+    stage_stats_t st;
+    stage_stats_snapshot(&st);
+    printf("Pipeline stages (%d recording thread%s):\n", st.threads, st.threads == 1 ? "" : "s");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const stage_hist_t *h = &st.stage[s];
+        if (h->count == 0) {
+            continue;
+        }
+        printf("  %-9s count=%llu avg=%.1fus p50<=%.1fus p99<=%.1fus p999<=%.1fus max=%.1fus\n",
+               stage_name((stage_t)s), (unsigned long long)h->count,
+               (double)h->sum_ns / (double)h->count / 1000.0,
+               (double)stage_hist_quantile(h, 0.50) / 1000.0,
+               (double)stage_hist_quantile(h, 0.99) / 1000.0,
+               (double)stage_hist_quantile(h, 0.999) / 1000.0,
+               (double)h->max_ns / 1000.0);
+    }
+    printf("  rejects:");
+    for (int r = 0; r < REJECT_COUNT; r++) {
+        printf(" %s=%llu", reject_reason_name((reject_reason_t)r), (unsigned long long)st.rejects[r]);
+    }
+    printf("\n");
+}
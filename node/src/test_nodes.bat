@@ -3,6 +3,9 @@ echo ========================================
 echo V2V Node Communication Test
 echo ========================================
 echo.
+if /i "%1"=="multicast" goto multicast
+if /i "%1"=="alertsync" goto alertsync
+
 echo Starting two V2V nodes for communication test...
 echo.
 echo Node 1: Port 8080 -> sends to 127.0.0.1:8081
@@ -27,3 +30,50 @@ start "V2V Node 2" cmd /k "v2v_node.exe --port 8081 --peer 127.0.0.1:8080"
 echo Both nodes started! Check the console windows for output.
 echo.
 pause
+goto :eof
+
+:multicast
+echo Starting three V2V nodes in one multicast group...
+echo.
+echo Group 239.255.42.99:8090, TTL 1, loopback on
+echo Every report is sent once and reaches both other nodes, as a radio
+echo broadcast would.
+echo.
+echo Press Ctrl+C to stop the nodes
+echo ========================================
+echo.
+
+cd /d d:\v2v\node\src
+
+start "V2V Node 1" cmd /k "v2v_node.exe --group 239.255.42.99:8090 --id node_001 --position 40.7128:-74.0060"
+timeout /t 1 /nobreak >nul
+start "V2V Node 2" cmd /k "v2v_node.exe --group 239.255.42.99:8090 --id node_002 --position 40.7589:-73.9851"
+timeout /t 1 /nobreak >nul
+start "V2V Node 3" cmd /k "v2v_node.exe --group 239.255.42.99:8090 --id node_003 --position 40.7306:-73.9866"
+
+echo All three nodes started! Each should list the other two as neighbours.
+echo.
+pause
+goto :eof
+
+:alertsync
+echo Starting two V2V nodes that sync their alert tables...
+echo.
+echo Group 239.255.42.99:8091, alert digests every 1-8 s
+echo Both nodes also send hazard reports, so the digests, replay checks
+echo and report sequence numbers all run side by side.
+echo.
+echo Press Ctrl+C to stop the nodes; each prints its alert sync stats
+echo ========================================
+echo.
+
+cd /d d:\v2v\node\src
+
+start "V2V Node 1" cmd /k "v2v_node.exe --group 239.255.42.99:8091 --id node_001 --position 40.7128:-74.0060 --alert-sync 1000:8000"
+timeout /t 15 /nobreak >nul
+start "V2V Node 2" cmd /k "v2v_node.exe --group 239.255.42.99:8091 --id node_002 --position 40.7589:-73.9851 --alert-sync 1000:8000"
+
+echo Both nodes started! On exit, "Alert sync:" should show digests
+echo received and matched, and no replay rejects.
+echo.
+pause
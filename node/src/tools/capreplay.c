@@ -0,0 +1,306 @@
+// Capture replayer: re-sends a datagram capture (node --capture) to a node.
+//
+// Datagrams are sent byte for byte, bundles included, at their original
+// spacing, scaled by --speed, or back to back with --fast. Replaying the
+// same capture into a fresh node of two builds gives the same input stream,
+// so their logs (--log-format json) and stage statistics can be diffed.
+// --bind fixes the source port so the node's log lines match across runs.
+//
+//   ./tools/capreplay --target IP:PORT [--speed X | --fast] [--from S] [--to S]
+//                     [--loop N] [--bind PORT] CAPTURE
+//   ./tools/capreplay --dump CAPTURE
+//
+// The node sees every datagram as coming from the replayer; the original
+// source addresses are only shown by --dump. Passes after the first with
+// --loop repeat sequence numbers, so a node that saw the first pass rejects
+// them as replays.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include "../net.h"
+#include "../capture.h"
+#include "../timeutil.h"
+
+#define CAPREPLAY_SPIN_NS 200000ull     // busy-wait the last stretch before a send
+#define CAPREPLAY_LATE_NS 1000000ull    // sends later than this are counted as late
+#define CAPREPLAY_DUMP_CHARS 96
+
+typedef struct {
+    char ip[64];
+    int port;
+    double speed;           // 0 = as fast as possible
+    uint64_t from_ns;
+    uint64_t to_ns;         // 0 = to the end
+    int loops;
+    int bind_port;
+} replay_config_t;
+
+typedef struct {
+    uint64_t datagrams;
+    uint64_t bytes;
+    uint64_t errors;
+    uint64_t late;
+    uint64_t late_sum_ns;
+    uint64_t late_max_ns;
+} replay_stats_t;
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+static void sleep_ns(uint64_t ns) {
+#ifdef _WIN32
+    Sleep((DWORD)(ns / 1000000ull));
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ns / 1000000000ull);
+    ts.tv_nsec = (long)(ns % 1000000000ull);
+    nanosleep(&ts, NULL);
+#endif
+}
+
+// Sleep until close to due, then spin, so sends land within a few
+// microseconds of their slot instead of a scheduler tick
+static void wait_until(uint64_t due) {
+    for (;;) {
+        uint64_t now = monotonic_ns();
+        if (now >= due || g_stop) {
+            return;
+        }
+        if (due - now > CAPREPLAY_SPIN_NS) {
+            sleep_ns(due - now - CAPREPLAY_SPIN_NS);
+        }
+    }
+}
+
+static void format_addr(uint32_t ip, uint16_t port, char *out, size_t cap) {
+    struct in_addr a;
+    a.s_addr = ip;
+    char ipstr[INET_ADDRSTRLEN];
+    if (!inet_ntop(AF_INET, &a, ipstr, sizeof(ipstr))) {
+        strcpy(ipstr, "?");
+    }
+    snprintf(out, cap, "%s:%u", ipstr, (unsigned)ntohs(port));
+}
+
+static int dump_capture(const char *path) {
+    capture_reader_t *r = (capture_reader_t *)malloc(sizeof(capture_reader_t));
+    if (!r || capture_reader_open(r, path) != 0) {
+        free(r);
+        return 1;
+    }
+    time_t start = (time_t)(r->start_us / 1000000);
+    char when[32];
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", gmtime(&start));
+    printf("# capture started %s UTC\n", when);
+
+    capture_record_t rec;
+    uint64_t bytes = 0, last_ns = 0;
+    int rc;
+    while ((rc = capture_reader_next(r, &rec)) == 1) {
+        char addr[32];
+        char text[CAPREPLAY_DUMP_CHARS + 1];
+        size_t n = rec.len < CAPREPLAY_DUMP_CHARS ? rec.len : CAPREPLAY_DUMP_CHARS;
+        for (size_t i = 0; i < n; i++) {
+            text[i] = (rec.data[i] >= 0x20 && rec.data[i] < 0x7f) ? (char)rec.data[i] : '.';
+        }
+        text[n] = '\0';
+        format_addr(rec.src_ip, rec.src_port, addr, sizeof(addr));
+        printf("%12.6f  %-21s %5u  %s%s\n", (double)rec.t_ns / 1e9, addr, (unsigned)rec.len,
+               text, rec.len > n ? "..." : "");
+        bytes += rec.len;
+        last_ns = rec.t_ns;
+    }
+    printf("# %llu datagrams, %llu payload bytes over %.3fs%s\n",
+           (unsigned long long)r->records, (unsigned long long)bytes, (double)last_ns / 1e9,
+           rc < 0 ? " (read error)" : "");
+    capture_reader_close(r);
+    free(r);
+    return rc < 0 ? 1 : 0;
+}
+
+// One pass over the capture; returns -1 on a read error
+static int replay_pass(capture_reader_t *r, int sock, const replay_config_t *cfg, replay_stats_t *st) {
+    capture_record_t rec;
+    uint64_t start = 0;
+    int started = 0;
+    int rc;
+    while (!g_stop && (rc = capture_reader_next(r, &rec)) == 1) {
+        if (rec.t_ns < cfg->from_ns) {
+            continue;
+        }
+        if (cfg->to_ns && rec.t_ns > cfg->to_ns) {
+            return 0;
+        }
+        if (!started) {
+            start = monotonic_ns();
+            started = 1;
+        }
+        if (cfg->speed > 0.0) {
+            uint64_t due = start + (uint64_t)((double)(rec.t_ns - cfg->from_ns) / cfg->speed);
+            wait_until(due);
+            uint64_t now = monotonic_ns();
+            if (now > due + CAPREPLAY_LATE_NS) {
+                st->late++;
+            }
+            if (now > due) {
+                st->late_sum_ns += now - due;
+                if (now - due > st->late_max_ns) {
+                    st->late_max_ns = now - due;
+                }
+            }
+        }
+        if (udp_send_buf(sock, cfg->ip, cfg->port, rec.data, rec.len) < 0) {
+            st->errors++;
+        } else {
+            st->datagrams++;
+            st->bytes += rec.len;
+        }
+    }
+    return g_stop ? 0 : rc;
+}
+
+static int parse_target(const char *s, char *ip, int *port) {
+    const char *colon = strchr(s, ':');
+    if (!colon || (size_t)(colon - s) >= 64) {
+        return -1;
+    }
+    memcpy(ip, s, (size_t)(colon - s));
+    ip[colon - s] = '\0';
+    *port = atoi(colon + 1);
+    return (*port > 0 && *port < 65536) ? 0 : -1;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s --target IP:PORT [--speed X | --fast] [--from S] [--to S]\n"
+            "          [--loop N] [--bind PORT] CAPTURE\n"
+            "       %s --dump CAPTURE\n", prog, prog);
+}
+
+int main(int argc, char **argv) {
+    replay_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.speed = 1.0;
+    cfg.loops = 1;
+    const char *path = NULL;
+    int have_target = 0;
+    int dump = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (strcmp(a, "--target") == 0 && i + 1 < argc) {
+            if (parse_target(argv[++i], cfg.ip, &cfg.port) != 0) {
+                fprintf(stderr, "invalid --target, expected IP:PORT\n");
+                return 1;
+            }
+            have_target = 1;
+        } else if (strcmp(a, "--speed") == 0 && i + 1 < argc) {
+            cfg.speed = atof(argv[++i]);
+            if (cfg.speed <= 0.0) {
+                fprintf(stderr, "--speed must be positive; use --fast for no pacing\n");
+                return 1;
+            }
+        } else if (strcmp(a, "--fast") == 0) {
+            cfg.speed = 0.0;
+        } else if (strcmp(a, "--from") == 0 && i + 1 < argc) {
+            cfg.from_ns = (uint64_t)(atof(argv[++i]) * 1e9);
+        } else if (strcmp(a, "--to") == 0 && i + 1 < argc) {
+            cfg.to_ns = (uint64_t)(atof(argv[++i]) * 1e9);
+        } else if (strcmp(a, "--loop") == 0 && i + 1 < argc) {
+            cfg.loops = atoi(argv[++i]);
+        } else if (strcmp(a, "--bind") == 0 && i + 1 < argc) {
+            cfg.bind_port = atoi(argv[++i]);
+        } else if (strcmp(a, "--dump") == 0) {
+            dump = 1;
+        } else if (a[0] != '-' && !path) {
+            path = a;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!path) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (dump) {
+        return dump_capture(path);
+    }
+    if (!have_target || cfg.loops <= 0 || (cfg.to_ns && cfg.to_ns < cfg.from_ns)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    capture_reader_t *r = (capture_reader_t *)malloc(sizeof(capture_reader_t));
+    if (!r || capture_reader_open(r, path) != 0) {
+        free(r);
+        return 1;
+    }
+    int sock = udp_socket_bind(cfg.bind_port);
+    if (sock < 0) {
+        fprintf(stderr, "failed to open UDP socket\n");
+        capture_reader_close(r);
+        free(r);
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    char speed_str[32];
+    if (cfg.speed > 0.0) {
+        snprintf(speed_str, sizeof(speed_str), "%gx speed", cfg.speed);
+    } else {
+        strcpy(speed_str, "as fast as possible");
+    }
+    printf("capreplay: %s -> %s:%d, %s, %d pass(es)\n", path, cfg.ip, cfg.port, speed_str, cfg.loops);
+    fflush(stdout);
+
+    replay_stats_t st;
+    memset(&st, 0, sizeof(st));
+    uint64_t start = monotonic_ns();
+    int rc = 0;
+    for (int pass = 0; pass < cfg.loops && !g_stop && rc == 0; pass++) {
+        if (pass > 0 && capture_reader_rewind(r) != 0) {
+            rc = -1;
+            break;
+        }
+        rc = replay_pass(r, sock, &cfg, &st);
+    }
+    double elapsed = (double)(monotonic_ns() - start) / 1e9;
+    if (elapsed <= 0.0) {
+        elapsed = 1e-9;
+    }
+
+    printf("sent %llu datagrams (%llu bytes) over %.3fs: %.0f datagrams/s, %.1f Mbit/s, %llu errors\n",
+           (unsigned long long)st.datagrams, (unsigned long long)st.bytes, elapsed,
+           (double)st.datagrams / elapsed, (double)st.bytes * 8.0 / elapsed / 1e6,
+           (unsigned long long)st.errors);
+    if (cfg.speed > 0.0 && st.datagrams > 0) {
+        printf("timing: avg slip %.1fus, max %.1fus, %llu sends more than %llums late\n",
+               (double)st.late_sum_ns / (double)st.datagrams / 1e3, (double)st.late_max_ns / 1e3,
+               (unsigned long long)st.late, (unsigned long long)(CAPREPLAY_LATE_NS / 1000000ull));
+    }
+    if (rc < 0) {
+        fprintf(stderr, "read error in %s\n", path);
+    }
+
+#ifdef _WIN32
+    closesocket(sock);
+#else
+    close(sock);
+#endif
+    capture_reader_close(r);
+    free(r);
+    return (rc < 0 || st.errors) ? 1 : 0;
+}
@@ -0,0 +1,173 @@
+// Reader for the event journal written with --event-journal.
+//
+// Scans the segments in a journal directory and prints, exports or counts the
+// records in a time range. Safe to run against a journal a node is writing.
+//
+//   ./tools/journal_tool <dir> [--from UNIX_SEC] [--to UNIX_SEC]
+//                        [--json | --sqlite out.db | --stats]
+//
+// --json (the default) prints one JSON object per line. --sqlite appends the
+// records to the audit_log table of the given database, so the usual queries
+// and /metrics work on exported data.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../db/db.h"
+#include "../db/journal.h"
+
+typedef enum { MODE_JSON, MODE_SQLITE, MODE_STATS } tool_mode_t;
+
+typedef struct {
+    long long records;
+    long long errors;
+    int64_t first_us;
+    int64_t last_us;
+    uint32_t segments;
+    uint32_t last_segment;
+} scan_totals_t;
+
+static void print_json_string(const char *s) {
+    if (s == NULL) {
+        fputs("null", stdout);
+        return;
+    }
+    putchar('"');
+    for (const unsigned char *p = (const unsigned char *)s; *p; p++) {
+        switch (*p) {
+            case '"':  fputs("\\\"", stdout); break;
+            case '\\': fputs("\\\\", stdout); break;
+            case '\n': fputs("\\n", stdout); break;
+            case '\r': fputs("\\r", stdout); break;
+            case '\t': fputs("\\t", stdout); break;
+            default:
+                if (*p < 0x20) {
+                    printf("\\u%04x", *p);
+                } else {
+                    putchar(*p);
+                }
+        }
+    }
+    putchar('"');
+}
+
+static void track(scan_totals_t *t, const journal_record_t *rec) {
+    if (t->records == 0) {
+        t->first_us = rec->timestamp_us;
+    }
+    t->last_us = rec->timestamp_us;
+    if (t->segments == 0 || rec->segment != t->last_segment) {
+        t->segments++;
+        t->last_segment = rec->segment;
+    }
+    t->records++;
+}
+
+static int emit_json(const journal_record_t *rec, void *arg) {
+    track((scan_totals_t *)arg, rec);
+    printf("{\"timestamp_us\":%lld,\"event_type\":", (long long)rec->timestamp_us);
+    print_json_string(rec->event_type);
+    fputs(",\"payload\":", stdout);
+    print_json_string(rec->payload);
+    fputs(",\"details\":", stdout);
+    print_json_string(rec->details);
+    fputs("}\n", stdout);
+    return 0;
+}
+
+static int emit_sqlite(const journal_record_t *rec, void *arg) {
+    scan_totals_t *t = (scan_totals_t *)arg;
+    track(t, rec);
+    if (db_log_event_at(rec->event_type, rec->payload, rec->details,
+                        (time_t)(rec->timestamp_us / 1000000)) != 0) {
+        t->errors++;
+    }
+    // Keep transactions bounded on large exports
+    if (t->records % 50000 == 0) {
+        db_commit();
+        db_begin();
+    }
+    return 0;
+}
+
+static int count_only(const journal_record_t *rec, void *arg) {
+    track((scan_totals_t *)arg, rec);
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <dir> [--from UNIX_SEC] [--to UNIX_SEC] "
+            "[--json | --sqlite out.db | --stats]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const char *dir = argv[1];
+    const char *db_path = NULL;
+    int64_t from_us = 0, to_us = 0;
+    tool_mode_t mode = MODE_JSON;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            from_us = atoll(argv[++i]) * 1000000ll;
+        } else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            to_us = atoll(argv[++i]) * 1000000ll;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            mode = MODE_JSON;
+        } else if (strcmp(argv[i], "--sqlite") == 0 && i + 1 < argc) {
+            mode = MODE_SQLITE;
+            db_path = argv[++i];
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            mode = MODE_STATS;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    scan_totals_t totals;
+    memset(&totals, 0, sizeof(totals));
+    long long n;
+
+    switch (mode) {
+        case MODE_SQLITE:
+            if (db_init(db_path) != 0) {
+                return 1;
+            }
+            db_set_verbose(0);
+            db_begin();
+            n = journal_scan(dir, from_us, to_us, emit_sqlite, &totals);
+            db_commit();
+            db_close();
+            break;
+        case MODE_STATS:
+            n = journal_scan(dir, from_us, to_us, count_only, &totals);
+            break;
+        default:
+            n = journal_scan(dir, from_us, to_us, emit_json, &totals);
+            break;
+    }
+
+    if (n < 0) {
+        fprintf(stderr, "Cannot read journal directory %s\n", dir);
+        return 1;
+    }
+
+    if (mode != MODE_JSON) {
+        printf("%lld records from %u segments", totals.records, totals.segments);
+        if (totals.records > 0) {
+            printf(", %lld.%06lld .. %lld.%06lld",
+                   (long long)(totals.first_us / 1000000), (long long)(totals.first_us % 1000000),
+                   (long long)(totals.last_us / 1000000), (long long)(totals.last_us % 1000000));
+        }
+        printf("\n");
+    }
+    if (mode == MODE_SQLITE) {
+        printf("exported to %s (%lld errors)\n", db_path, totals.errors);
+    }
+    return totals.errors ? 1 : 0;
+}
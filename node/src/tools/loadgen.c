@@ -0,0 +1,591 @@
+// Load generator: emulates thousands of vehicles sending to one node.
+//
+// Each vehicle has its own ephemeral ID, sequence counter and position.
+// Sender threads each own a slice of the vehicles and a socket, and send
+// canonical hazard reports, emergency reports and beacons in the configured
+// mix, at a fixed total rate or as fast as the socket allows. Deliberate
+// replays (a vehicle's last seq sent again) and floods (a few IDs sending far
+// above the rate limit) exercise the node's rejection paths.
+//
+//   ./tools/loadgen --target IP:PORT [-n vehicles] [-r msgs_per_sec] [-d seconds]
+//                   [-j threads] [--mobility static|linear|grid|random]
+//                   [--mix HAZARD:EMERGENCY:BEACON] [--sign] [--replay PCT]
+//                   [--flood IDS:PCT] [--bundle MTU] [--seed N]
+//
+// -r 0 sends as fast as possible. Prints the achieved rate every second and a
+// summary with per-ID sequence statistics at the end.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <signal.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#include "../net.h"
+#include "../jsonmsg.h"
+#include "../crypto.h"
+#include "../bundle.h"
+#include "../timeutil.h"
+
+#define LOADGEN_MAX_THREADS 64
+#define LOADGEN_ID_MAX 32
+#define LOADGEN_MSG_MAX 1024
+#define LOADGEN_BUNDLE_MAX 2048
+#define LOADGEN_FLUSH_NS 5000000ull    // longest a partial bundle waits
+#define EARTH_M_PER_DEG 111320.0
+
+// Area the vehicles drive in, roughly midtown Manhattan
+#define AREA_LAT0 40.70
+#define AREA_LAT1 40.80
+#define AREA_LON0 -74.02
+#define AREA_LON1 -73.93
+
+typedef enum { MOB_STATIC, MOB_LINEAR, MOB_GRID, MOB_RANDOM } mobility_t;
+
+typedef struct {
+    char id[LOADGEN_ID_MAX];
+    uint64_t seq;
+    double lat, lon;
+    double speed;       // m/s
+    double heading;     // degrees, 0 = north
+    uint64_t last_ns;
+} vehicle_t;
+
+typedef struct {
+    uint64_t sent;
+    uint64_t datagrams;
+    uint64_t bytes;
+    uint64_t errors;
+    uint64_t hazard;
+    uint64_t emergency;
+    uint64_t beacon;
+    uint64_t replays;
+    uint64_t flood;
+} loadgen_stats_t;
+
+typedef struct {
+    char ip[64];
+    int port;
+    int vehicles;
+    double rate;            // total msgs/s, 0 = unlimited
+    int seconds;
+    int threads;
+    mobility_t mobility;
+    int mix[3];             // hazard, emergency, beacon weights
+    int sign;
+    double replay_pct;
+    int flood_ids;
+    double flood_pct;
+    size_t bundle_mtu;      // 0 = one message per datagram
+    uint64_t seed;
+    char prefix[16];
+} loadgen_config_t;
+
+typedef struct {
+    const loadgen_config_t *cfg;
+    int index;
+    vehicle_t *vehicles;    // this thread's slice
+    int count;
+    vehicle_t *flooders;
+    int flood_count;
+    uint64_t rng;
+    volatile loadgen_stats_t stats;
+} sender_t;
+
+static volatile sig_atomic_t g_stop = 0;
+
+static const char *const k_hazards[] = {
+    "ice_patch", "debris", "road_block", "construction", "weather_hazard", "animal_crossing"
+};
+static const char *const k_emergencies[] = { "accident", "ambulance", "collision" };
+
+static void on_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+static uint64_t rng_next(uint64_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static double rng_unit(uint64_t *s) {
+    return (double)(rng_next(s) >> 11) / (double)(1ull << 53);
+}
+
+static double rng_range(uint64_t *s, double lo, double hi) {
+    return lo + rng_unit(s) * (hi - lo);
+}
+
+static void sleep_ns(uint64_t ns) {
+#ifdef _WIN32
+    Sleep((DWORD)(ns / 1000000ull));
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ns / 1000000000ull);
+    ts.tv_nsec = (long)(ns % 1000000000ull);
+    nanosleep(&ts, NULL);
+#endif
+}
+
+static void vehicle_init(vehicle_t *v, const char *prefix, int n, const loadgen_config_t *cfg, uint64_t *rng) {
+    snprintf(v->id, sizeof(v->id), "%s_%05d", prefix, n);
+    v->seq = 0;
+    v->lat = rng_range(rng, AREA_LAT0, AREA_LAT1);
+    v->lon = rng_range(rng, AREA_LON0, AREA_LON1);
+    v->speed = cfg->mobility == MOB_STATIC ? 0.0 : rng_range(rng, 3.0, 30.0);
+    v->heading = cfg->mobility == MOB_GRID ? 90.0 * (double)(rng_next(rng) % 4)
+                                           : rng_range(rng, 0.0, 360.0);
+    v->last_ns = 0;
+}
+
+// Advance a vehicle to now; vehicles bounce off the edges of the area
+static void vehicle_move(vehicle_t *v, mobility_t mob, uint64_t now, uint64_t *rng) {
+    double dt = v->last_ns ? (double)(now - v->last_ns) / 1e9 : 0.0;
+    v->last_ns = now;
+    if (mob == MOB_STATIC || dt <= 0.0) {
+        return;
+    }
+    if (mob == MOB_RANDOM) {
+        v->heading += rng_range(rng, -15.0, 15.0);
+        v->speed += rng_range(rng, -1.0, 1.0);
+        if (v->speed < 0.0) v->speed = 0.0;
+        if (v->speed > 40.0) v->speed = 40.0;
+    } else if (mob == MOB_GRID && rng_unit(rng) < 0.05) {
+        v->heading += (rng_next(rng) & 1) ? 90.0 : -90.0;   // turn at an intersection
+    }
+    v->heading = fmod(v->heading + 360.0, 360.0);
+
+    double rad = v->heading * 3.14159265358979323846 / 180.0;
+    double d = v->speed * dt;
+    v->lat += d * cos(rad) / EARTH_M_PER_DEG;
+    v->lon += d * sin(rad) / (EARTH_M_PER_DEG * cos(v->lat * 3.14159265358979323846 / 180.0));
+    if (v->lat < AREA_LAT0 || v->lat > AREA_LAT1) {
+        v->lat = v->lat < AREA_LAT0 ? AREA_LAT0 : AREA_LAT1;
+        v->heading = fmod(540.0 - v->heading, 360.0);
+    }
+    if (v->lon < AREA_LON0 || v->lon > AREA_LON1) {
+        v->lon = v->lon < AREA_LON0 ? AREA_LON0 : AREA_LON1;
+        v->heading = fmod(360.0 - v->heading, 360.0);
+    }
+}
+
+// Append the signature as a base64 "sig" field, as a signing sender would
+static int append_signature(char *buf, int len, size_t cap) {
+    unsigned char *sig = NULL;
+    size_t sig_len = 0;
+    char *b64 = NULL;
+    if (sign_message("node_priv.pem", buf, &sig, &sig_len) != 0 ||
+        base64_encode(sig, sig_len, &b64) != 0) {
+        free(sig);
+        return -1;
+    }
+    int n = snprintf(buf + len - 1, cap - (size_t)(len - 1), ",\"sig\":\"%s\"}", b64);
+    free(sig);
+    free(b64);
+    if (n < 0 || (size_t)n >= cap - (size_t)(len - 1)) {
+        return -1;
+    }
+    return len - 1 + n;
+}
+
+// Build the next message for v into buf; returns its length or -1
+static int build_message(sender_t *s, vehicle_t *v, char *buf, size_t cap, int replay) {
+    const loadgen_config_t *cfg = s->cfg;
+    int total = cfg->mix[0] + cfg->mix[1] + cfg->mix[2];
+    int pick = total > 0 ? (int)(rng_next(&s->rng) % (uint64_t)total) : 0;
+    const char *msg_type = "hazard_report";
+    const char *hazard;
+    if (pick < cfg->mix[0]) {
+        hazard = k_hazards[rng_next(&s->rng) % (sizeof(k_hazards) / sizeof(k_hazards[0]))];
+        s->stats.hazard++;
+    } else if (pick < cfg->mix[0] + cfg->mix[1]) {
+        hazard = k_emergencies[rng_next(&s->rng) % (sizeof(k_emergencies) / sizeof(k_emergencies[0]))];
+        s->stats.emergency++;
+    } else {
+        msg_type = "beacon";
+        hazard = "none";
+        s->stats.beacon++;
+    }
+
+    uint64_t seq = v->seq;
+    if (!replay || seq == 0) {
+        seq = ++v->seq;
+    } else {
+        s->stats.replays++;
+    }
+    int len = format_canonical_hazard_json(buf, cap, msg_type, v->id, seq, (uint64_t)time(NULL),
+                                           v->lat, v->lon, v->speed * 3.6, v->heading, hazard,
+                                           rng_range(&s->rng, 0.5, 1.0), 300);
+    if (len > 0 && cfg->sign) {
+        len = append_signature(buf, len, cap);
+    }
+    return len;
+}
+
+static void send_datagram(sender_t *s, int sock, const void *buf, size_t len) {
+    if (udp_send_buf(sock, s->cfg->ip, s->cfg->port, buf, len) < 0) {
+        s->stats.errors++;
+    } else {
+        s->stats.datagrams++;
+        s->stats.bytes += len;
+    }
+}
+
+static void sender_run(sender_t *s) {
+    const loadgen_config_t *cfg = s->cfg;
+    int sock = udp_socket_bind(0);
+    if (sock < 0) {
+        fprintf(stderr, "sender %d: cannot open socket\n", s->index);
+        return;
+    }
+
+    char msg[LOADGEN_MSG_MAX];
+    uint8_t bundle_buf[LOADGEN_BUNDLE_MAX];
+    bundle_writer_t w;
+    bundle_writer_init(&w, bundle_buf, cfg->bundle_mtu);
+    uint64_t bundle_started = 0;
+
+    double per_thread = cfg->rate / cfg->threads;
+    uint64_t gap_ns = per_thread > 0.0 ? (uint64_t)(1e9 / per_thread) : 0;
+    uint64_t start = monotonic_ns();
+    uint64_t end = start + (uint64_t)cfg->seconds * 1000000000ull;
+    uint64_t next = start;
+    int cursor = 0;
+
+    while (!g_stop) {
+        uint64_t now = monotonic_ns();
+        if (cfg->seconds > 0 && now >= end) {
+            break;
+        }
+        if (gap_ns > 0 && now < next) {
+            // Ahead of schedule; a partial bundle still goes out on its deadline
+            uint64_t until = next;
+            if (w.count > 0) {
+                uint64_t flush_at = bundle_started + LOADGEN_FLUSH_NS;
+                if (now >= flush_at) {
+                    send_datagram(s, sock, bundle_buf, bundle_writer_finish(&w));
+                    bundle_writer_init(&w, bundle_buf, cfg->bundle_mtu);
+                } else if (flush_at < until) {
+                    until = flush_at;
+                }
+            }
+            sleep_ns(until - now);
+            continue;
+        }
+        next += gap_ns;
+
+        vehicle_t *v;
+        if (s->flood_count > 0 && rng_unit(&s->rng) * 100.0 < cfg->flood_pct) {
+            v = &s->flooders[rng_next(&s->rng) % (uint64_t)s->flood_count];
+            s->stats.flood++;
+        } else {
+            v = &s->vehicles[cursor];
+            cursor = (cursor + 1) % s->count;
+        }
+        vehicle_move(v, cfg->mobility, now, &s->rng);
+        int replay = cfg->replay_pct > 0.0 && rng_unit(&s->rng) * 100.0 < cfg->replay_pct;
+        int len = build_message(s, v, msg, sizeof(msg), replay);
+        if (len < 0) {
+            s->stats.errors++;
+            continue;
+        }
+        s->stats.sent++;
+
+        if (cfg->bundle_mtu == 0) {
+            send_datagram(s, sock, msg, (size_t)len);
+            continue;
+        }
+        if (!bundle_writer_fits(&w, (size_t)len) ||
+            (w.count > 0 && now - bundle_started >= LOADGEN_FLUSH_NS)) {
+            if (w.count > 0) {
+                send_datagram(s, sock, bundle_buf, bundle_writer_finish(&w));
+            }
+            bundle_writer_init(&w, bundle_buf, cfg->bundle_mtu);
+        }
+        if (w.count == 0) {
+            bundle_started = now;
+        }
+        if (bundle_writer_add(&w, msg, (size_t)len) != 0) {
+            send_datagram(s, sock, msg, (size_t)len);   // larger than the MTU on its own
+        }
+    }
+    if (w.count > 0) {
+        send_datagram(s, sock, bundle_buf, bundle_writer_finish(&w));
+    }
+#ifdef _WIN32
+    closesocket(sock);
+#else
+    close(sock);
+#endif
+}
+
+#ifdef _WIN32
+static DWORD WINAPI sender_thread(LPVOID arg) {
+    sender_run((sender_t *)arg);
+    return 0;
+}
+#else
+static void *sender_thread(void *arg) {
+    sender_run((sender_t *)arg);
+    return NULL;
+}
+#endif
+
+static void sum_stats(const sender_t *senders, int n, loadgen_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    for (int i = 0; i < n; i++) {
+        const volatile loadgen_stats_t *st = &senders[i].stats;
+        out->sent += st->sent;
+        out->datagrams += st->datagrams;
+        out->bytes += st->bytes;
+        out->errors += st->errors;
+        out->hazard += st->hazard;
+        out->emergency += st->emergency;
+        out->beacon += st->beacon;
+        out->replays += st->replays;
+        out->flood += st->flood;
+    }
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Messages per vehicle ID, i.e. its last seq
+static void print_seq_stats(const char *label, const vehicle_t *vehicles, int n) {
+    uint64_t *seqs = (uint64_t *)malloc((size_t)n * sizeof(uint64_t));
+    if (!seqs) {
+        return;
+    }
+    uint64_t total = 0;
+    int active = 0;
+    for (int i = 0; i < n; i++) {
+        seqs[i] = vehicles[i].seq;
+        total += seqs[i];
+        active += seqs[i] > 0;
+    }
+    qsort(seqs, (size_t)n, sizeof(uint64_t), cmp_u64);
+    printf("%s seq: %d/%d IDs active, min=%llu p50=%llu p99=%llu max=%llu mean=%.1f\n",
+           label, active, n, (unsigned long long)seqs[0], (unsigned long long)seqs[n / 2],
+           (unsigned long long)seqs[(size_t)((double)n * 0.99)],
+           (unsigned long long)seqs[n - 1], (double)total / n);
+    free(seqs);
+}
+
+static int parse_target(const char *s, char *ip, int *port) {
+    const char *colon = strchr(s, ':');
+    if (!colon || (size_t)(colon - s) >= 64) {
+        return -1;
+    }
+    memcpy(ip, s, (size_t)(colon - s));
+    ip[colon - s] = '\0';
+    *port = atoi(colon + 1);
+    return (*port > 0 && *port < 65536) ? 0 : -1;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s --target IP:PORT [-n vehicles] [-r msgs_per_sec] [-d seconds]\n"
+            "          [-j threads] [--mobility static|linear|grid|random]\n"
+            "          [--mix HAZARD:EMERGENCY:BEACON] [--sign] [--replay PCT]\n"
+            "          [--flood IDS:PCT] [--bundle MTU] [--seed N]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    loadgen_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.vehicles = 2000;
+    cfg.rate = 10000.0;
+    cfg.seconds = 10;
+    cfg.threads = 1;
+    cfg.mobility = MOB_LINEAR;
+    cfg.mix[0] = 70;
+    cfg.mix[1] = 5;
+    cfg.mix[2] = 25;
+    cfg.seed = (uint64_t)time(NULL);
+    int have_target = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (strcmp(a, "--target") == 0 && i + 1 < argc) {
+            if (parse_target(argv[++i], cfg.ip, &cfg.port) != 0) {
+                fprintf(stderr, "invalid --target, expected IP:PORT\n");
+                return 1;
+            }
+            have_target = 1;
+        } else if (strcmp(a, "-n") == 0 && i + 1 < argc) {
+            cfg.vehicles = atoi(argv[++i]);
+        } else if (strcmp(a, "-r") == 0 && i + 1 < argc) {
+            cfg.rate = atof(argv[++i]);
+        } else if (strcmp(a, "-d") == 0 && i + 1 < argc) {
+            cfg.seconds = atoi(argv[++i]);
+        } else if (strcmp(a, "-j") == 0 && i + 1 < argc) {
+            cfg.threads = atoi(argv[++i]);
+        } else if (strcmp(a, "--mobility") == 0 && i + 1 < argc) {
+            const char *m = argv[++i];
+            if (strcmp(m, "static") == 0) cfg.mobility = MOB_STATIC;
+            else if (strcmp(m, "linear") == 0) cfg.mobility = MOB_LINEAR;
+            else if (strcmp(m, "grid") == 0) cfg.mobility = MOB_GRID;
+            else if (strcmp(m, "random") == 0) cfg.mobility = MOB_RANDOM;
+            else {
+                fprintf(stderr, "invalid --mobility %s\n", m);
+                return 1;
+            }
+        } else if (strcmp(a, "--mix") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d:%d:%d", &cfg.mix[0], &cfg.mix[1], &cfg.mix[2]) != 3 ||
+                cfg.mix[0] < 0 || cfg.mix[1] < 0 || cfg.mix[2] < 0) {
+                fprintf(stderr, "invalid --mix, expected HAZARD:EMERGENCY:BEACON weights\n");
+                return 1;
+            }
+        } else if (strcmp(a, "--sign") == 0) {
+            cfg.sign = 1;
+        } else if (strcmp(a, "--replay") == 0 && i + 1 < argc) {
+            cfg.replay_pct = atof(argv[++i]);
+        } else if (strcmp(a, "--flood") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d:%lf", &cfg.flood_ids, &cfg.flood_pct) != 2 || cfg.flood_ids < 0) {
+                fprintf(stderr, "invalid --flood, expected IDS:PCT\n");
+                return 1;
+            }
+        } else if (strcmp(a, "--bundle") == 0 && i + 1 < argc) {
+            cfg.bundle_mtu = (size_t)atoi(argv[++i]);
+        } else if (strcmp(a, "--seed") == 0 && i + 1 < argc) {
+            cfg.seed = strtoull(argv[++i], NULL, 10);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!have_target || cfg.vehicles <= 0 || cfg.rate < 0.0 || cfg.seconds < 0 ||
+        cfg.threads <= 0 || cfg.threads > LOADGEN_MAX_THREADS || cfg.threads > cfg.vehicles) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (cfg.bundle_mtu > 0 && (cfg.bundle_mtu < BUNDLE_MIN_MTU || cfg.bundle_mtu > LOADGEN_BUNDLE_MAX)) {
+        fprintf(stderr, "--bundle must be between %d and %d bytes\n", BUNDLE_MIN_MTU, LOADGEN_BUNDLE_MAX);
+        return 1;
+    }
+
+    // IDs carry the seed so repeated runs do not look like replays to the node
+    snprintf(cfg.prefix, sizeof(cfg.prefix), "lg%04x", (unsigned)(cfg.seed & 0xFFFF));
+
+    vehicle_t *vehicles = (vehicle_t *)calloc((size_t)cfg.vehicles, sizeof(vehicle_t));
+    vehicle_t *flooders = (vehicle_t *)calloc((size_t)(cfg.flood_ids > 0 ? cfg.flood_ids : 1), sizeof(vehicle_t));
+    sender_t *senders = (sender_t *)calloc((size_t)cfg.threads, sizeof(sender_t));
+    if (!vehicles || !flooders || !senders) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    uint64_t rng = cfg.seed * 0x9E3779B97F4A7C15ull + 1;
+    char flood_prefix[24];
+    snprintf(flood_prefix, sizeof(flood_prefix), "%s_flood", cfg.prefix);
+    for (int i = 0; i < cfg.vehicles; i++) {
+        vehicle_init(&vehicles[i], cfg.prefix, i, &cfg, &rng);
+    }
+    for (int i = 0; i < cfg.flood_ids; i++) {
+        vehicle_init(&flooders[i], flood_prefix, i, &cfg, &rng);
+    }
+
+    // Flooders are split between threads too, so no vehicle is shared
+    for (int t = 0; t < cfg.threads; t++) {
+        sender_t *s = &senders[t];
+        int v0 = (int)((long long)cfg.vehicles * t / cfg.threads);
+        int v1 = (int)((long long)cfg.vehicles * (t + 1) / cfg.threads);
+        int f0 = (int)((long long)cfg.flood_ids * t / cfg.threads);
+        int f1 = (int)((long long)cfg.flood_ids * (t + 1) / cfg.threads);
+        s->cfg = &cfg;
+        s->index = t;
+        s->vehicles = &vehicles[v0];
+        s->count = v1 - v0;
+        s->flooders = &flooders[f0];
+        s->flood_count = f1 - f0;
+        s->rng = rng_next(&rng) | 1;
+    }
+
+    signal(SIGINT, on_signal);
+    char rate_str[32];
+    if (cfg.rate > 0.0) {
+        snprintf(rate_str, sizeof(rate_str), "%.0f", cfg.rate);
+    } else {
+        strcpy(rate_str, "unlimited");
+    }
+    printf("loadgen: %d vehicles, %s msgs/s, %d thread(s) -> %s:%d%s%s\n",
+           cfg.vehicles, rate_str, cfg.threads, cfg.ip, cfg.port,
+           cfg.sign ? ", signed" : "", cfg.bundle_mtu ? ", bundled" : "");
+    fflush(stdout);
+
+#ifdef _WIN32
+    HANDLE threads[LOADGEN_MAX_THREADS];
+    for (int t = 0; t < cfg.threads; t++) {
+        threads[t] = CreateThread(NULL, 0, sender_thread, &senders[t], 0, NULL);
+    }
+#else
+    pthread_t threads[LOADGEN_MAX_THREADS];
+    for (int t = 0; t < cfg.threads; t++) {
+        if (pthread_create(&threads[t], NULL, sender_thread, &senders[t]) != 0) {
+            fprintf(stderr, "failed to start sender %d\n", t);
+            return 1;
+        }
+    }
+#endif
+
+    // Progress once a second while the senders run
+    uint64_t start = monotonic_ns();
+    uint64_t last_sent = 0;
+    for (int sec = 1; !g_stop && (cfg.seconds == 0 || sec <= cfg.seconds); sec++) {
+        uint64_t due = start + (uint64_t)sec * 1000000000ull;
+        uint64_t now = monotonic_ns();
+        if (due > now) {
+            sleep_ns(due - now);
+        }
+        loadgen_stats_t st;
+        sum_stats(senders, cfg.threads, &st);
+        printf("  t=%3ds  %8llu msgs/s  total=%llu errors=%llu\n", sec,
+               (unsigned long long)(st.sent - last_sent), (unsigned long long)st.sent,
+               (unsigned long long)st.errors);
+        fflush(stdout);
+        last_sent = st.sent;
+    }
+    g_stop = 1;
+
+#ifdef _WIN32
+    WaitForMultipleObjects((DWORD)cfg.threads, threads, TRUE, INFINITE);
+    for (int t = 0; t < cfg.threads; t++) {
+        CloseHandle(threads[t]);
+    }
+#else
+    for (int t = 0; t < cfg.threads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+#endif
+    double elapsed = (double)(monotonic_ns() - start) / 1e9;
+
+    loadgen_stats_t st;
+    sum_stats(senders, cfg.threads, &st);
+    printf("sent %llu msgs in %llu datagrams (%llu bytes) over %.2fs: %.0f msgs/s, %.0f datagrams/s, %.1f Mbit/s\n",
+           (unsigned long long)st.sent, (unsigned long long)st.datagrams,
+           (unsigned long long)st.bytes, elapsed, (double)st.sent / elapsed,
+           (double)st.datagrams / elapsed, (double)st.bytes * 8.0 / elapsed / 1e6);
+    printf("mix: hazard=%llu emergency=%llu beacon=%llu; replays=%llu flood=%llu errors=%llu\n",
+           (unsigned long long)st.hazard, (unsigned long long)st.emergency,
+           (unsigned long long)st.beacon, (unsigned long long)st.replays,
+           (unsigned long long)st.flood, (unsigned long long)st.errors);
+    print_seq_stats("per-ID", vehicles, cfg.vehicles);
+    if (cfg.flood_ids > 0) {
+        print_seq_stats("flood ID", flooders, cfg.flood_ids);
+    }
+
+    free(senders);
+    free(flooders);
+    free(vehicles);
+    return st.errors ? 1 : 0;
+}